@@ -33,7 +33,10 @@ HEADERS += \
     $$PWD/src/SimVis/CylinderData \
     $$PWD/src/utils/marchingcubestabletexture.h \
     $$PWD/src/render/geometry/bonddata.h \
-    $$PWD/src/SimVis/BondData
+    $$PWD/src/SimVis/BondData \
+    $$PWD/src/render/geometry/vertexstaging.h \
+    $$PWD/src/render/geometry/imagetranslations.h \
+    $$PWD/src/utils/triplebuffer.h
 
 DISTFILES += \
     $$PWD/src/render/shaders/gl3/spheres-deferred.frag \
@@ -4,13 +4,19 @@
 Simulator::Simulator(QNode *parent)
     : QNode(parent)
 {
+    // Steps are normally driven by the window's frames and by requests from the worker, the
+    // timer only picks up state changes while the worker is idle
     connect(&m_timer, &QTimer::timeout, this, &Simulator::step);
-    m_timer.start(1);
+    m_timer.start(100);
 }
 
 Simulator::~Simulator()
 {
     m_workerThread.requestInterruption();
+    if(m_worker) {
+        QMutexLocker locker(&m_workerSynchronizeMutex);
+        m_worker->m_synchronized.wakeAll();
+    }
     m_workerThread.quit();
     m_workerThread.wait();
     if(m_worker) {
@@ -28,19 +34,38 @@ double Simulator::interval() const
     return m_timer.interval();
 }
 
+QQuickWindow *Simulator::window() const
+{
+    return m_window;
+}
+
+void Simulator::requestStep()
+{
+    if(m_stepRequested.exchange(true)) return;
+    QMetaObject::invokeMethod(this, "requestedStep", Qt::QueuedConnection);
+}
+
+void Simulator::requestedStep()
+{
+    m_stepRequested = false;
+    if(running()) step();
+}
+
 void Simulator::step()
 {
     if(!m_worker) {
         m_worker = createWorker();
+        m_worker->m_simulator = this;
         m_worker->moveToThread(&m_workerThread);
         m_workerThread.start(QThread::TimeCriticalPriority);
     }
-    if(m_worker->m_needsSynchronization && m_workerSynchronizeMutex.tryLock()) {
-        m_timer.setInterval(1);
+    m_worker->synchronizeRenderer(this);
+    if(m_worker->m_needsSynchronization) {
+        // The worker only holds this mutex while checking the flag, it is released while it waits
+        QMutexLocker locker(&m_workerSynchronizeMutex);
         m_worker->synchronizeSimulator(this);
-        m_workerSynchronizeMutex.unlock();
+        m_worker->m_synchronized.wakeAll();
     } else if(m_workerMutex.tryLock()) {
-        m_timer.setInterval(200);
         m_worker->synchronizeSimulator(this);
         QMetaObject::invokeMethod(m_worker, "workAndUnlock",
                                   Qt::QueuedConnection,
@@ -70,8 +95,37 @@ void Simulator::setInterval(double interval)
     emit intervalChanged(interval);
 }
 
+void Simulator::setWindow(QQuickWindow *window)
+{
+    if (m_window == window)
+        return;
+
+    disconnect(m_frameSwappedConnection);
+    m_window = window;
+    if(m_window) {
+        // Emitted on the render thread, requestStep only queues the step on ours. Uploading new
+        // data right after a swap gives the renderer a full frame to pick it up.
+        m_frameSwappedConnection = connect(window, &QQuickWindow::frameSwapped, this, &Simulator::requestStep, Qt::DirectConnection);
+    }
+    emit windowChanged(window);
+}
+
 void SimulatorWorker::workAndUnlock(Simulator* simulator)
 {
     work();
     simulator->m_workerMutex.unlock();
 }
+
+void SimulatorWorker::requestStep()
+{
+    if(m_simulator) m_simulator->requestStep();
+}
+
+bool SimulatorWorker::waitForSynchronization(unsigned long timeout)
+{
+    QMutexLocker locker(&m_simulator->m_workerSynchronizeMutex);
+    if(m_needsSynchronization) {
+        m_synchronized.wait(&m_simulator->m_workerSynchronizeMutex, timeout);
+    }
+    return m_needsSynchronization;
+}
@@ -7,7 +7,11 @@
 #include <QTimer>
 #include <QDebug>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QPointer>
 #include <QQuickItem>
+#include <QQuickWindow>
+#include <atomic>
 
 #include <Qt3DRender/QBuffer>
 #include <Qt3DCore/QEntity>
@@ -18,15 +22,27 @@ class SimulatorWorker : public QObject {
 protected:
     virtual void work() = 0;
 
+public:
+    // Called on the worker's thread. Asks the simulator for a step as soon as possible instead
+    // of at its next frame or timer tick.
+    void requestStep();
+    // Called on the worker's thread after setting m_needsSynchronization. Sleeps until the
+    // simulator synchronized or timeout ms passed. Returns whether synchronization is still needed.
+    bool waitForSynchronization(unsigned long timeout);
+
 private:
     virtual void synchronizeSimulator(class Simulator *simulator) = 0;
+    // Called on the simulator's thread on every step, also while the worker is busy
+    virtual void synchronizeRenderer(class Simulator *simulator) { Q_UNUSED(simulator) }
     Q_INVOKABLE void workAndUnlock(class Simulator *simulator);
 signals:
     void workDone();
 protected:
-    bool m_needsSynchronization = false;
+    std::atomic<bool> m_needsSynchronization{false};
 
 private:
+    class Simulator *m_simulator = nullptr;
+    QWaitCondition m_synchronized;
     friend class Simulator;
 };
 
@@ -35,6 +51,7 @@ class Simulator : public Qt3DCore::QNode
     Q_OBJECT
     Q_PROPERTY(bool running READ running WRITE setRunning NOTIFY runningChanged)
     Q_PROPERTY(double interval READ interval WRITE setInterval NOTIFY intervalChanged)
+    Q_PROPERTY(QQuickWindow* window READ window WRITE setWindow NOTIFY windowChanged)
 
 public:
     explicit Simulator(QNode *parent = 0);
@@ -42,25 +59,36 @@ public:
 
     bool running() const;
     double interval() const;
+    QQuickWindow *window() const;
+    // Thread safe. Steps on the simulator's thread soon, requests made before it runs are merged.
+    void requestStep();
 
 public slots:
     void step();
     void setRunning(bool running);
     void setInterval(double interval);
+    void setWindow(QQuickWindow *window);
 
 signals:
     void runningChanged(bool running);
     void intervalChanged(double interval);
+    void windowChanged(QQuickWindow *window);
 
 protected:
     virtual SimulatorWorker *createWorker() = 0;
 
+private slots:
+    void requestedStep();
+
 private:
     SimulatorWorker *m_worker = 0;
     QThread m_workerThread;
-    QTimer  m_timer;
+    QTimer  m_timer; // Heartbeat for when neither the window nor the worker asks for steps
     QMutex m_workerMutex;
     QMutex m_workerSynchronizeMutex;
+    QPointer<QQuickWindow> m_window;
+    QMetaObject::Connection m_frameSwappedConnection;
+    std::atomic<bool> m_stepRequested{false};
 
     friend class SimulatorWorker;
 };
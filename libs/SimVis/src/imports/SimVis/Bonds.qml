@@ -21,6 +21,8 @@ Entity {
     property alias color: color.value
 
     property BondData bondData
+    // Consecutive instances are the periodic images of one bond
+    readonly property int imageCount: bondData ? bondData.imageCount : 1
 
     Transform {
         id: transform
@@ -31,7 +33,9 @@ Entity {
         parameters: [
             Parameter { id:posMin; name: "posMin"; value: 0.0 },
             Parameter { id:posMax; name: "posMax"; value: 200.0 },
-            Parameter { id:color; name: "color"; value: Qt.vector3d(0.7, 0.7, 0.7) }
+            Parameter { id:color; name: "color"; value: Qt.vector3d(0.7, 0.7, 0.7) },
+            Parameter { name: "imageCounts"; value: bondData ? bondData.imageCounts : Qt.vector3d(1, 1, 1) },
+            Parameter { name: "imageTransform"; value: bondData ? bondData.imageTransform : Qt.matrix4x4() }
         ]
         effect: Effect {
             techniques: [
@@ -121,7 +125,7 @@ Entity {
         id: bondsMeshInstanced
         primitiveType: GeometryRenderer.TriangleStrip
         enabled: instanceCount != 0
-        instanceCount: bondData ? bondData.count : 0
+        instanceCount: bondData ? bondData.count*imageCount : 0
 
         geometry: PointGeometry {
             attributes: [
@@ -131,8 +135,8 @@ Entity {
                     vertexBaseType: Attribute.Float
                     vertexSize: 3
                     byteOffset: 0
-                    byteStride: (3 + 3 + 1 + 1 + 1 + 1) * 4
-                    divisor: 1
+                    byteStride: (3 + 3 + 1 + 1 + 1 + 1 + 3) * 4
+                    divisor: imageCount
                     buffer: bondData ? bondData.buffer : null
                 },
                 Attribute {
@@ -141,8 +145,8 @@ Entity {
                     vertexBaseType: Attribute.Float
                     vertexSize: 3
                     byteOffset: 3 * 4
-                    byteStride: (3 + 3 + 1 + 1 + 1 + 1) * 4
-                    divisor: 1
+                    byteStride: (3 + 3 + 1 + 1 + 1 + 1 + 3) * 4
+                    divisor: imageCount
                     buffer: bondData ? bondData.buffer : null
                 },
                 Attribute {
@@ -151,8 +155,8 @@ Entity {
                     vertexBaseType: Attribute.Float
                     vertexSize: 1
                     byteOffset: 6 * 4
-                    byteStride: (3 + 3 + 1 + 1 + 1 + 1) * 4
-                    divisor: 1
+                    byteStride: (3 + 3 + 1 + 1 + 1 + 1 + 3) * 4
+                    divisor: imageCount
                     buffer: bondData ? bondData.buffer : null
                 },
                 Attribute {
@@ -161,8 +165,8 @@ Entity {
                     vertexBaseType: Attribute.Float
                     vertexSize: 1
                     byteOffset: 7 * 4
-                    byteStride: (3 + 3 + 1 + 1 + 1 + 1) * 4
-                    divisor: 1
+                    byteStride: (3 + 3 + 1 + 1 + 1 + 1 + 3) * 4
+                    divisor: imageCount
                     buffer: bondData.buffer
                 },
                 Attribute {
@@ -171,8 +175,8 @@ Entity {
                     vertexBaseType: Attribute.Float
                     vertexSize: 1
                     byteOffset: 8 * 4
-                    byteStride: (3 + 3 + 1 + 1 + 1 + 1) * 4
-                    divisor: 1
+                    byteStride: (3 + 3 + 1 + 1 + 1 + 1 + 3) * 4
+                    divisor: imageCount
                     buffer: bondData.buffer
                 },
                 Attribute {
@@ -181,8 +185,18 @@ Entity {
                     vertexBaseType: Attribute.Float
                     vertexSize: 1
                     byteOffset: 9 * 4
-                    byteStride: (3 + 3 + 1 + 1 + 1 + 1) * 4
-                    divisor: 1
+                    byteStride: (3 + 3 + 1 + 1 + 1 + 1 + 3) * 4
+                    divisor: imageCount
+                    buffer: bondData ? bondData.buffer : null
+                },
+                Attribute {
+                    name: "vertex2Image"
+                    attributeType: Attribute.VertexAttribute
+                    vertexBaseType: Attribute.Float
+                    vertexSize: 3
+                    byteOffset: 10 * 4
+                    byteStride: (3 + 3 + 1 + 1 + 1 + 1 + 3) * 4
+                    divisor: imageCount
                     buffer: bondData ? bondData.buffer : null
                 }
             ]
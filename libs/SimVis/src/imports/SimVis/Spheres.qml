@@ -23,6 +23,8 @@ Entity {
     property alias posMax: posMax.value
 
     property SphereData sphereData
+    // Consecutive instances are the periodic images of one sphere
+    readonly property int imageCount: sphereData ? sphereData.imageCount : 1
     property Camera camera
 
     onSphereDataChanged: {
@@ -33,7 +35,9 @@ Entity {
         id: material
         parameters: [
             Parameter { id:posMin; name: "posMin"; value: 0.0 },
-            Parameter { id:posMax; name: "posMax"; value: 200.0 }
+            Parameter { id:posMax; name: "posMax"; value: 200.0 },
+            Parameter { name: "imageCounts"; value: sphereData ? sphereData.imageCounts : Qt.vector3d(1, 1, 1) },
+            Parameter { name: "imageTransform"; value: sphereData ? sphereData.imageTransform : Qt.matrix4x4() }
         ]
         effect: Effect {
             techniques: [
@@ -127,7 +131,7 @@ Entity {
         id: spheresMeshInstanced
         primitiveType: GeometryRenderer.TriangleStrip
         enabled: instanceCount != 0
-        instanceCount: sphereData.count
+        instanceCount: sphereData.count*imageCount
 
         geometry: SpheresPointGeometry {
             attributes: [
@@ -138,7 +142,7 @@ Entity {
                     vertexSize: 3
                     byteOffset: 0
                     byteStride: (3 + 3 + 1) * 4
-                    divisor: 1
+                    divisor: imageCount
                     buffer: sphereData ? sphereData.buffer : null
                 },
                 Attribute {
@@ -148,7 +152,7 @@ Entity {
                     vertexSize: 3
                     byteOffset: 3*4
                     byteStride: (3 + 3 + 1) * 4
-                    divisor: 1
+                    divisor: imageCount
                     buffer: sphereData ? sphereData.buffer : null
                 },
                 Attribute {
@@ -158,7 +162,7 @@ Entity {
                     vertexSize: 1
                     byteOffset: (3+3)*4
                     byteStride: (3 + 3 + 1) * 4
-                    divisor: 1
+                    divisor: imageCount
                     buffer: sphereData ? sphereData.buffer : null
                 }
             ]
@@ -40,3 +40,49 @@ int BondData::count() const
 {
     return m_count;
 }
+
+const ImageTranslations &BondData::images() const
+{
+    return m_images;
+}
+
+void BondData::setImages(const ImageTranslations &images)
+{
+    if (m_images == images)
+        return;
+
+    m_images = images;
+    emit imagesChanged();
+}
+
+int BondData::imageCount() const
+{
+    return m_images.count();
+}
+
+QVector3D BondData::imageCounts() const
+{
+    return QVector3D(m_images.counts[0], m_images.counts[1], m_images.counts[2]);
+}
+
+QMatrix4x4 BondData::imageTransform() const
+{
+    return m_images.transform();
+}
+
+VertexStaging<BondVBOData> &BondData::staging()
+{
+    return m_staging;
+}
+
+void BondData::uploadStaging()
+{
+    int count = m_count;
+    ImageTranslations images = m_images;
+    if(!m_staging.upload(m_buffer.data(), count, images)) return;
+    setImages(images);
+    if(m_count != count) {
+        m_count = count;
+        emit countChanged(m_count);
+    }
+}
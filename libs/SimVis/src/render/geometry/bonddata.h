@@ -5,6 +5,8 @@
 #include <Qt3DRender/QBuffer>
 #include <Qt3DCore/QNode>
 #include <QVector3D>
+#include <QMatrix4x4>
+#include "vertexstaging.h"
 
 struct BondVBOData
 {
@@ -14,6 +16,9 @@ struct BondVBOData
     float sphereRadius2;
     float radius1;
     float radius2;
+    // Periodic image of vertex2 relative to that of vertex1, in cell vectors. Nonzero for bonds
+    // across the cell boundary, which are not drawn in images where the partner image is missing.
+    QVector3D vertex2Image;
 };
 
 // TODO rename to BondBuffer
@@ -22,6 +27,9 @@ class BondData : public Qt3DCore::QNode
     Q_OBJECT
     Q_PROPERTY(Qt3DRender::QBuffer* buffer READ buffer CONSTANT)
     Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int imageCount READ imageCount NOTIFY imagesChanged)
+    Q_PROPERTY(QVector3D imageCounts READ imageCounts NOTIFY imagesChanged)
+    Q_PROPERTY(QMatrix4x4 imageTransform READ imageTransform NOTIFY imagesChanged)
 public:
     explicit BondData(QNode *parent = 0);
 
@@ -29,15 +37,28 @@ public:
     void setData(QVector<BondVBOData> data);
     void setData(QByteArray ba, int count);
     int count() const;
+    // Every bond is drawn once per periodic image, see ImageTranslations
+    const ImageTranslations &images() const;
+    void setImages(const ImageTranslations &images);
+    int imageCount() const;
+    QVector3D imageCounts() const;
+    QMatrix4x4 imageTransform() const;
+    // Written from any single producer thread. On the render thread the staging consumes the
+    // newest buffer and uploadStaging uploads it.
+    VertexStaging<BondVBOData> &staging();
+    void uploadStaging();
 signals:
 
     void countChanged(int count);
+    void imagesChanged();
 
 public slots:
 
 private:
     QScopedPointer<Qt3DRender::QBuffer> m_buffer;
     int m_count = 0;
+    ImageTranslations m_images;
+    VertexStaging<BondVBOData> m_staging;
 };
 
 #endif // BONDDATA_H
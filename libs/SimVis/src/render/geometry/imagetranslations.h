@@ -0,0 +1,38 @@
+#ifndef IMAGETRANSLATIONS_H
+#define IMAGETRANSLATIONS_H
+
+#include <QVector3D>
+#include <QMatrix4x4>
+
+// Periodic images drawn by instancing. Every vertex in a buffer is drawn once per image and the
+// vertex shader translates it by the cell vectors, so the buffers only ever hold one cell.
+struct ImageTranslations
+{
+    int counts[3] = {1, 1, 1}; // Images along each cell vector, centered on the original cell
+    QVector3D cellVectors[3];
+
+    int count() const { return counts[0]*counts[1]*counts[2]; }
+    int low(int dimension) const { return -(counts[dimension] - 1)/2; }
+
+    // Maps the image index (i, j, k), each starting at 0, to its translation
+    QMatrix4x4 transform() const {
+        QMatrix4x4 transform;
+        QVector3D lowest;
+        for(int d=0; d<3; d++) {
+            transform.setColumn(d, QVector4D(cellVectors[d], 0));
+            lowest += low(d)*cellVectors[d];
+        }
+        transform.setColumn(3, QVector4D(lowest, 1));
+        return transform;
+    }
+
+    bool operator==(const ImageTranslations &other) const {
+        for(int d=0; d<3; d++) {
+            if(counts[d] != other.counts[d] || cellVectors[d] != other.cellVectors[d]) return false;
+        }
+        return true;
+    }
+    bool operator!=(const ImageTranslations &other) const { return !(*this == other); }
+};
+
+#endif // IMAGETRANSLATIONS_H
@@ -75,3 +75,49 @@ int SphereData::count() const
 {
     return m_count;
 }
+
+const ImageTranslations &SphereData::images() const
+{
+    return m_images;
+}
+
+void SphereData::setImages(const ImageTranslations &images)
+{
+    if (m_images == images)
+        return;
+
+    m_images = images;
+    emit imagesChanged();
+}
+
+int SphereData::imageCount() const
+{
+    return m_images.count();
+}
+
+QVector3D SphereData::imageCounts() const
+{
+    return QVector3D(m_images.counts[0], m_images.counts[1], m_images.counts[2]);
+}
+
+QMatrix4x4 SphereData::imageTransform() const
+{
+    return m_images.transform();
+}
+
+VertexStaging<SphereVBOData> &SphereData::staging()
+{
+    return m_staging;
+}
+
+void SphereData::uploadStaging()
+{
+    int count = m_count;
+    ImageTranslations images = m_images;
+    if(!m_staging.upload(m_buffer.data(), count, images)) return;
+    setImages(images);
+    if(m_count != count) {
+        m_count = count;
+        emit countChanged(m_count);
+    }
+}
@@ -5,6 +5,8 @@
 #include <Qt3DRender/QBuffer>
 #include <Qt3DCore/QNode>
 #include <QVector3D>
+#include <QMatrix4x4>
+#include "vertexstaging.h"
 struct SphereVBOData
 {
     QVector3D position;
@@ -17,6 +19,9 @@ class SphereData : public Qt3DCore::QNode
     Q_OBJECT
     Q_PROPERTY(Qt3DRender::QBuffer* buffer READ buffer CONSTANT)
     Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int imageCount READ imageCount NOTIFY imagesChanged)
+    Q_PROPERTY(QVector3D imageCounts READ imageCounts NOTIFY imagesChanged)
+    Q_PROPERTY(QMatrix4x4 imageTransform READ imageTransform NOTIFY imagesChanged)
 public:
     explicit SphereData(QNode *parent = 0);
 
@@ -26,15 +31,28 @@ public:
     void setData(QByteArray byteArray, int count);
     void setPositions(QVector<QVector3D> positions, QVector3D color = QVector3D(1.0, 1.0, 1.0), float scale = 1.0);
     int count() const;
+    // Every sphere is drawn once per periodic image, see ImageTranslations
+    const ImageTranslations &images() const;
+    void setImages(const ImageTranslations &images);
+    int imageCount() const;
+    QVector3D imageCounts() const;
+    QMatrix4x4 imageTransform() const;
+    // Written from any single producer thread. On the render thread the staging consumes the
+    // newest buffer and uploadStaging uploads it.
+    VertexStaging<SphereVBOData> &staging();
+    void uploadStaging();
 signals:
 
     void countChanged(int count);
+    void imagesChanged();
 
 public slots:
 
 private:
     QScopedPointer<Qt3DRender::QBuffer> m_buffer;
     int m_count = 0;
+    ImageTranslations m_images;
+    VertexStaging<SphereVBOData> m_staging;
 };
 
 #endif // SPHEREDATA_H
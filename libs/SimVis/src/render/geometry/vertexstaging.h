@@ -0,0 +1,164 @@
+#ifndef VERTEXSTAGING_H
+#define VERTEXSTAGING_H
+
+#include <QByteArray>
+#include <QList>
+#include <Qt3DRender/QBuffer>
+#include <algorithm>
+#include <cstring>
+#include "../../utils/triplebuffer.h"
+#include "imagetranslations.h"
+
+// Persistent staging memory for a vertex buffer. A producer thread writes vertices straight
+// into the back buffer and commits it, the render thread uploads the newest committed one.
+// A committed byte array is handed to Qt3D as a whole and the staging slot takes over an
+// array Qt3D has released, so the producer never writes to a shared array (which would
+// detach and copy it). In the steady state there are no allocations and no copies other
+// than the GPU upload itself.
+template<typename VBOData>
+class VertexStaging
+{
+public:
+    // Producer side. Returns storage for count vertices in the back buffer.
+    VBOData *resize(int count) {
+        Buffer &buffer = m_buffers.back();
+        reserve(buffer, count);
+        buffer.count = count;
+        return reinterpret_cast<VBOData*>(buffer.data.data());
+    }
+
+    void clear() {
+        // Keep the storage, QByteArray::resize(0) would release it
+        m_buffers.back().count = 0;
+    }
+
+    void append(const VBOData &vertex) {
+        Buffer &buffer = m_buffers.back();
+        reserve(buffer, buffer.count + 1);
+        reinterpret_cast<VBOData*>(buffer.data.data())[buffer.count++] = vertex;
+    }
+
+    int count() {
+        return m_buffers.back().count;
+    }
+
+    // Periodic images the vertices in the back buffer are drawn with
+    void setImages(const ImageTranslations &images) {
+        m_buffers.back().images = images;
+    }
+
+    // Returns true if the previously committed buffer was never uploaded. Stagings that are
+    // drawn together commit under the same frame id so the consumer can pair them up.
+    bool commit(quint64 frame = 0) {
+        Buffer &buffer = m_buffers.back();
+        buffer.frame = frame;
+        // Shrinking keeps the allocation, reserve() grows it again without reallocating
+        if(buffer.count > 0) buffer.data.resize(buffer.count*sizeof(VBOData));
+        return m_buffers.publish();
+    }
+
+    // Consumer side. Picks up the newest committed buffer, if any, without uploading it yet.
+    bool consume() {
+        if(!m_buffers.consume()) return false;
+        m_uploaded = false;
+        return true;
+    }
+
+    // Frame id the consumed buffer was committed with
+    quint64 frame() {
+        return m_buffers.front().frame;
+    }
+
+    // Uploads the consumed buffer unless that already happened. When the vertex count is
+    // unchanged only the range between the first and last changed vertex is sent.
+    bool upload(Qt3DRender::QBuffer *target, int &count, ImageTranslations &images) {
+        if(m_uploaded) return false;
+        m_uploaded = true;
+
+        Buffer &buffer = m_buffers.front();
+        count = buffer.count;
+        images = buffer.images;
+        if(buffer.count == 0) {
+            target->setData(QByteArray());
+            return true;
+        }
+
+        const QByteArray current = target->data();
+        if(current.size() != buffer.data.size()) {
+            handOff(target, buffer);
+            return true;
+        }
+
+        const char *oldData = current.constData();
+        const char *newData = buffer.data.constData();
+        const int stride = sizeof(VBOData);
+        int first = 0;
+        int last = buffer.count - 1;
+        while(first <= last && memcmp(oldData + first*stride, newData + first*stride, stride) == 0) first++;
+        if(first > last) return true; // Nothing changed
+        while(last > first && memcmp(oldData + last*stride, newData + last*stride, stride) == 0) last--;
+
+        const int changedCount = last - first + 1;
+        if(2*changedCount > buffer.count) {
+            // Most of the buffer changed, hand over the whole array instead of copying a range
+            handOff(target, buffer);
+        } else {
+            target->updateData(first*stride, QByteArray(newData + first*stride, changedCount*stride));
+        }
+        return true;
+    }
+
+    // Only safe when neither producer nor consumer is active
+    void reset() {
+        m_buffers.reset();
+        m_handedOff.clear();
+        m_uploaded = true;
+    }
+
+    long memoryUsage() {
+        long bytes = 0;
+        for(int i=0; i<m_buffers.count(); i++) {
+            bytes += m_buffers.buffers()[i].data.capacity();
+        }
+        return bytes;
+    }
+
+private:
+    struct Buffer {
+        QByteArray data;
+        int count = 0;
+        quint64 frame = 0;
+        ImageTranslations images;
+    };
+
+    void reserve(Buffer &buffer, int count) {
+        const int bytes = count*sizeof(VBOData);
+        if(bytes <= buffer.data.size()) return;
+        // Compare against the allocation, not the size, which commit() shrinks every frame
+        if(bytes > buffer.data.capacity()) buffer.data.reserve(std::max(bytes, 2*buffer.data.capacity()));
+        buffer.data.resize(bytes);
+    }
+
+    // Gives the array of a consumed buffer to Qt3D and refills the slot with an array Qt3D no
+    // longer references, or an empty one that the producer allocates once.
+    void handOff(Qt3DRender::QBuffer *target, Buffer &buffer) {
+        target->setData(buffer.data);
+        QByteArray handedOff = buffer.data;
+        buffer.data = QByteArray();
+        for(int i=0; i<m_handedOff.size(); i++) {
+            if(m_handedOff[i].isDetached()) {
+                buffer.data = m_handedOff.takeAt(i);
+                break;
+            }
+        }
+        m_handedOff.append(handedOff);
+        // Qt3D keeps at most the current and the previous array, older ones are never reused
+        while(m_handedOff.size() > TripleBuffer<Buffer>::count()) m_handedOff.removeFirst();
+    }
+
+    TripleBuffer<Buffer> m_buffers;
+    QList<QByteArray> m_handedOff; // Render thread only
+    bool m_uploaded = true; // Render thread only
+};
+
+#endif // VERTEXSTAGING_H
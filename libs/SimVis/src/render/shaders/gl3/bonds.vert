@@ -7,6 +7,7 @@ in float radius2;
 in float sphereRadius1;
 in float sphereRadius2;
 in float vertexId;
+in vec3 vertex2Image;
 
 out vec3 vs_vertex1Position;
 out vec3 vs_vertex2Position;
@@ -38,6 +39,21 @@ uniform mat3 modelViewNormal;
 uniform mat4 projectionMatrix;
 uniform vec3 eyePosition;
 
+// Periodic images, see ImageTranslations. Consecutive instances are the images of one
+// primitive, its vertex attributes advance once every imageCount instances.
+uniform vec3 imageCounts = vec3(1.0, 1.0, 1.0);
+uniform mat4 imageTransform = mat4(1.0);
+
+ivec3 imageIndex() {
+    ivec3 counts = max(ivec3(imageCounts + 0.5), ivec3(1));
+    int image = gl_InstanceID % (counts.x*counts.y*counts.z);
+    return ivec3(image % counts.x, (image / counts.x) % counts.y, image / (counts.x*counts.y));
+}
+
+vec3 imageOffset(ivec3 index) {
+    return (imageTransform * vec4(vec3(index), 1.0)).xyz;
+}
+
 vec3 makePerpendicular(vec3 v) {
     if(v.x == 0.0 && v.y == 0.0) {
         if(v.z == 0.0) {
@@ -50,8 +66,10 @@ vec3 makePerpendicular(vec3 v) {
 
 void main(void)
 {
-    vs_vertex1Position = vertex1Position;
-    vs_vertex2Position = vertex2Position;
+    ivec3 image = imageIndex();
+    vec3 offset = imageOffset(image);
+    vs_vertex1Position = vertex1Position + offset;
+    vs_vertex2Position = vertex2Position + offset;
     vs_radius1 = radius1;
     vs_radius2 = radius2;
     vs_sphereRadius1 = sphereRadius1;
@@ -141,4 +159,11 @@ void main(void)
     modelViewPosition = (modelView * ppos).xyz;
     worldPosition = vertices[i];
     gl_Position = mvp*vec4(vertices[i], 1.0);
+
+    // Bonds across the cell boundary whose partner image is not drawn are clipped away
+    ivec3 partnerImage = image + ivec3(round(vertex2Image));
+    ivec3 counts = max(ivec3(imageCounts + 0.5), ivec3(1));
+    if(any(lessThan(partnerImage, ivec3(0))) || any(greaterThanEqual(partnerImage, counts))) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+    }
 }
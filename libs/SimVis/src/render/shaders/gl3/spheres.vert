@@ -11,6 +11,21 @@ uniform vec3 eyePosition = vec3(0.0, 0.0, 0.0);
 uniform mat4 modelMatrix;
 uniform mat4 mvp;
 
+// Periodic images, see ImageTranslations. Consecutive instances are the images of one
+// primitive, its vertex attributes advance once every imageCount instances.
+uniform vec3 imageCounts = vec3(1.0, 1.0, 1.0);
+uniform mat4 imageTransform = mat4(1.0);
+
+ivec3 imageIndex() {
+    ivec3 counts = max(ivec3(imageCounts + 0.5), ivec3(1));
+    int image = gl_InstanceID % (counts.x*counts.y*counts.z);
+    return ivec3(image % counts.x, (image / counts.x) % counts.y, image / (counts.x*counts.y));
+}
+
+vec3 imageOffset(ivec3 index) {
+    return (imageTransform * vec4(vec3(index), 1.0)).xyz;
+}
+
 out vec3 modelSpherePosition;
 out vec3 modelPosition;
 out vec3 color;
@@ -27,7 +42,7 @@ vec3 makePerpendicular(vec3 v) {
 }
 
 void main() {
-    vec3 position = vertexPosition + pos;
+    vec3 position = vertexPosition + pos + imageOffset(imageIndex());
     color = col;
     radius = scale;
     modelSpherePosition = (modelMatrix * vec4(position, 1.0)).xyz;
@@ -0,0 +1,66 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+#include <atomic>
+
+// Lock free single producer, single consumer triple buffer. The producer fills back() and
+// publishes it, the consumer picks up the latest published buffer in front(). Neither side
+// ever waits for the other; if the producer publishes twice before the consumer looks,
+// the older buffer is overwritten.
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() { }
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // Producer side
+    T &back() {
+        return m_buffers[m_back];
+    }
+
+    // Returns true if the previously published buffer was never consumed
+    bool publish() {
+        int previous = m_ready.exchange(m_back | NewDataBit, std::memory_order_acq_rel);
+        m_back = previous & IndexMask;
+        return previous & NewDataBit;
+    }
+
+    // Consumer side
+    T &front() {
+        return m_buffers[m_front];
+    }
+
+    // Returns true if front() was replaced with a newly published buffer
+    bool consume() {
+        if(!(m_ready.load(std::memory_order_acquire) & NewDataBit)) return false;
+        int previous = m_ready.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & IndexMask;
+        return true;
+    }
+
+    // Only safe when neither producer nor consumer is active
+    void reset() {
+        for(T &buffer : m_buffers) buffer = T();
+        m_back = 0;
+        m_ready.store(1);
+        m_front = 2;
+    }
+
+    T *buffers() {
+        return m_buffers;
+    }
+
+    static constexpr int count() {
+        return 3;
+    }
+
+private:
+    enum { IndexMask = 3, NewDataBit = 4 };
+    T m_buffers[3];
+    int m_back = 0;
+    std::atomic<int> m_ready {1};
+    int m_front = 2;
+};
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,545 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Vectorized lj/cut: neighbors are processed in chunks of SIMD width
+   with AVX-512 or AVX2 gathers, or with plain loops the compiler may
+   vectorize. Forces are threaded with OpenMP over owned atoms.
+------------------------------------------------------------------------- */
+
+#include <string.h>
+#include "pair_lj_cut_simd.h"
+#include "atom.h"
+#include "comm.h"
+#include "force.h"
+#include "neigh_list.h"
+#include "memory.h"
+
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+#define LMP_LJ_SIMD_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define LMP_LJ_SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace LAMMPS_NS;
+
+namespace {
+
+/* ----------------------------------------------------------------------
+   lane operations, one set per instruction set
+   vint holds neighbor indices, imask selects valid neighbor slots,
+   vmask selects double lanes, gathers return 0.0 in unselected lanes
+------------------------------------------------------------------------- */
+
+#if defined(LMP_LJ_SIMD_AVX512)
+
+struct SIMD {
+  enum { width = 8 };
+  typedef __m512d vdouble;
+  typedef __m256i vint;
+  typedef __mmask8 imask;
+  typedef __mmask8 vmask;
+
+  static imask first(int n) { return (imask) ((1u << n) - 1); }
+  static vint load(const int *p, imask m) { return _mm256_maskz_loadu_epi32(m,p); }
+  static vint shr(vint a, int n) { return _mm256_srl_epi32(a,_mm_cvtsi32_si128(n)); }
+  static vint band(vint a, int b) { return _mm256_and_si256(a,_mm256_set1_epi32(b)); }
+  static vint add(vint a, vint b) { return _mm256_add_epi32(a,b); }
+  static vint add(vint a, int b) { return _mm256_add_epi32(a,_mm256_set1_epi32(b)); }
+  static vint gather(const int *p, vint idx, imask m) {
+    return _mm256_mmask_i32gather_epi32(_mm256_setzero_si256(),m,idx,p,4);
+  }
+  static imask lt(vint a, int b) { return _mm256_cmplt_epi32_mask(a,_mm256_set1_epi32(b)); }
+  static vmask widen(imask m) { return m; }
+
+  static vdouble set1(double a) { return _mm512_set1_pd(a); }
+  static vdouble zero() { return _mm512_setzero_pd(); }
+  static vdouble gather(const double *p, vint idx, imask m) {
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(),m,idx,p,8);
+  }
+  static vdouble add(vdouble a, vdouble b) { return _mm512_add_pd(a,b); }
+  static vdouble sub(vdouble a, vdouble b) { return _mm512_sub_pd(a,b); }
+  static vdouble mul(vdouble a, vdouble b) { return _mm512_mul_pd(a,b); }
+  static vdouble div(vdouble a, vdouble b) { return _mm512_div_pd(a,b); }
+  static vmask lt(vdouble a, vdouble b) { return _mm512_cmp_pd_mask(a,b,_CMP_LT_OQ); }
+  static vmask mand(vmask a, vmask b) { return a & b; }
+  static vdouble select(vmask m, vdouble a) { return _mm512_maskz_mov_pd(m,a); }
+  static vdouble blend(vmask m, vdouble a, vdouble b) { return _mm512_mask_blend_pd(m,b,a); }
+  static int bits(vmask m) { return (int) m; }
+  static double sum(vdouble a) { return _mm512_reduce_add_pd(a); }
+  static void store(double *p, vdouble a) { _mm512_storeu_pd(p,a); }
+  static void store(int *p, vint a) { _mm256_storeu_si256((__m256i *) p,a); }
+};
+
+#elif defined(LMP_LJ_SIMD_AVX2)
+
+struct SIMD {
+  enum { width = 4 };
+  typedef __m256d vdouble;
+  typedef __m128i vint;
+  typedef __m128i imask;
+  typedef __m256d vmask;
+
+  static imask first(int n) {
+    return _mm_cmpgt_epi32(_mm_set1_epi32(n),_mm_setr_epi32(0,1,2,3));
+  }
+  static vint load(const int *p, imask m) { return _mm_maskload_epi32(p,m); }
+  static vint shr(vint a, int n) { return _mm_srl_epi32(a,_mm_cvtsi32_si128(n)); }
+  static vint band(vint a, int b) { return _mm_and_si128(a,_mm_set1_epi32(b)); }
+  static vint add(vint a, vint b) { return _mm_add_epi32(a,b); }
+  static vint add(vint a, int b) { return _mm_add_epi32(a,_mm_set1_epi32(b)); }
+  static vint gather(const int *p, vint idx, imask m) {
+    return _mm_mask_i32gather_epi32(_mm_setzero_si128(),p,idx,m,4);
+  }
+  static imask lt(vint a, int b) { return _mm_cmpgt_epi32(_mm_set1_epi32(b),a); }
+  static vmask widen(imask m) { return _mm256_castsi256_pd(_mm256_cvtepi32_epi64(m)); }
+
+  static vdouble set1(double a) { return _mm256_set1_pd(a); }
+  static vdouble zero() { return _mm256_setzero_pd(); }
+  static vdouble gather(const double *p, vint idx, imask m) {
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(),p,idx,widen(m),8);
+  }
+  static vdouble add(vdouble a, vdouble b) { return _mm256_add_pd(a,b); }
+  static vdouble sub(vdouble a, vdouble b) { return _mm256_sub_pd(a,b); }
+  static vdouble mul(vdouble a, vdouble b) { return _mm256_mul_pd(a,b); }
+  static vdouble div(vdouble a, vdouble b) { return _mm256_div_pd(a,b); }
+  static vmask lt(vdouble a, vdouble b) { return _mm256_cmp_pd(a,b,_CMP_LT_OQ); }
+  static vmask mand(vmask a, vmask b) { return _mm256_and_pd(a,b); }
+  static vdouble select(vmask m, vdouble a) { return _mm256_and_pd(m,a); }
+  static vdouble blend(vmask m, vdouble a, vdouble b) { return _mm256_blendv_pd(b,a,m); }
+  static int bits(vmask m) { return _mm256_movemask_pd(m); }
+  static double sum(vdouble a) {
+    __m128d lo = _mm_add_pd(_mm256_castpd256_pd128(a),_mm256_extractf128_pd(a,1));
+    return _mm_cvtsd_f64(_mm_add_sd(lo,_mm_unpackhi_pd(lo,lo)));
+  }
+  static void store(double *p, vdouble a) { _mm256_storeu_pd(p,a); }
+  static void store(int *p, vint a) { _mm_storeu_si128((__m128i *) p,a); }
+};
+
+#else
+
+// portable fallback, one neighbor per lane so the loops fold away,
+// wider emulated lanes were slower than the scalar kernel
+
+struct SIMD {
+  enum { width = 1 };
+  struct vdouble { double v[width]; };
+  struct vint { int v[width]; };
+  typedef int imask;
+  typedef int vmask;
+
+  static imask first(int n) { return (1 << n) - 1; }
+  static vint load(const int *p, imask m) {
+    vint r;
+    for (int k = 0; k < width; k++) r.v[k] = (m >> k & 1) ? p[k] : 0;
+    return r;
+  }
+  static vint shr(vint a, int n) {
+    for (int k = 0; k < width; k++) a.v[k] = (unsigned int) a.v[k] >> n;
+    return a;
+  }
+  static vint band(vint a, int b) {
+    for (int k = 0; k < width; k++) a.v[k] &= b;
+    return a;
+  }
+  static vint add(vint a, vint b) {
+    for (int k = 0; k < width; k++) a.v[k] += b.v[k];
+    return a;
+  }
+  static vint add(vint a, int b) {
+    for (int k = 0; k < width; k++) a.v[k] += b;
+    return a;
+  }
+  static vint gather(const int *p, vint idx, imask m) {
+    vint r;
+    for (int k = 0; k < width; k++) r.v[k] = (m >> k & 1) ? p[idx.v[k]] : 0;
+    return r;
+  }
+  static imask lt(vint a, int b) {
+    int m = 0;
+    for (int k = 0; k < width; k++) m |= (a.v[k] < b) << k;
+    return m;
+  }
+  static vmask widen(imask m) { return m; }
+
+  static vdouble set1(double a) {
+    vdouble r;
+    for (int k = 0; k < width; k++) r.v[k] = a;
+    return r;
+  }
+  static vdouble zero() { return set1(0.0); }
+  static vdouble gather(const double *p, vint idx, imask m) {
+    vdouble r;
+    for (int k = 0; k < width; k++) r.v[k] = (m >> k & 1) ? p[idx.v[k]] : 0.0;
+    return r;
+  }
+  static vdouble add(vdouble a, vdouble b) {
+    for (int k = 0; k < width; k++) a.v[k] += b.v[k];
+    return a;
+  }
+  static vdouble sub(vdouble a, vdouble b) {
+    for (int k = 0; k < width; k++) a.v[k] -= b.v[k];
+    return a;
+  }
+  static vdouble mul(vdouble a, vdouble b) {
+    for (int k = 0; k < width; k++) a.v[k] *= b.v[k];
+    return a;
+  }
+  static vdouble div(vdouble a, vdouble b) {
+    for (int k = 0; k < width; k++) a.v[k] /= b.v[k];
+    return a;
+  }
+  static vmask lt(vdouble a, vdouble b) {
+    int m = 0;
+    for (int k = 0; k < width; k++) m |= (a.v[k] < b.v[k]) << k;
+    return m;
+  }
+  static vmask mand(vmask a, vmask b) { return a & b; }
+  static vdouble select(vmask m, vdouble a) {
+    for (int k = 0; k < width; k++) if (!(m >> k & 1)) a.v[k] = 0.0;
+    return a;
+  }
+  static vdouble blend(vmask m, vdouble a, vdouble b) {
+    for (int k = 0; k < width; k++) if (!(m >> k & 1)) a.v[k] = b.v[k];
+    return a;
+  }
+  static int bits(vmask m) { return m; }
+  static double sum(vdouble a) {
+    double s = 0.0;
+    for (int k = 0; k < width; k++) s += a.v[k];
+    return s;
+  }
+  static void store(double *p, vdouble a) { memcpy(p,a.v,sizeof(a.v)); }
+  static void store(int *p, vint a) { memcpy(p,a.v,sizeof(a.v)); }
+};
+
+#endif
+
+}
+
+/* ---------------------------------------------------------------------- */
+
+PairLJCutSIMD::PairLJCutSIMD(LAMMPS *lmp) : PairLJCut(lmp)
+{
+  params = NULL;
+  maxparams = 0;
+  fthr = NULL;
+  maxfthr = nfthr = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+PairLJCutSIMD::~PairLJCutSIMD()
+{
+  memory->destroy(params);
+  memory->destroy(fthr);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairLJCutSIMD::compute(int eflag, int vflag)
+{
+  // per-atom energy and virial are left to the scalar kernel
+
+  if (eflag/2 || vflag/4) {
+    PairLJCut::compute(eflag,vflag);
+    return;
+  }
+
+  if (eflag || vflag) ev_setup(eflag,vflag);
+  else evflag = vflag_fdotr = 0;
+
+  // with fdotr the global virial comes from virial_fdotr_compute()
+
+  const int eglobal = evflag && eflag_global;
+  const int vglobal = evflag && vflag_global;
+
+  if (eglobal) {
+    if (vglobal) {
+      if (force->newton_pair) eval<1,1,1>();
+      else eval<1,1,0>();
+    } else {
+      if (force->newton_pair) eval<1,0,1>();
+      else eval<1,0,0>();
+    }
+  } else {
+    if (vglobal) {
+      if (force->newton_pair) eval<0,1,1>();
+      else eval<0,1,0>();
+    } else {
+      if (force->newton_pair) eval<0,0,1>();
+      else eval<0,0,0>();
+    }
+  }
+
+  if (vflag_fdotr) virial_fdotr_compute();
+}
+
+/* ----------------------------------------------------------------------
+   pack coefficients into flat per-type-pair tables for gathers
+   table k holds entry (itype-1)*ntypes + jtype-1
+------------------------------------------------------------------------- */
+
+void PairLJCutSIMD::pack_params()
+{
+  const int ntypes = atom->ntypes;
+  const int n2 = ntypes*ntypes;
+
+  if (6*n2 > maxparams) {
+    memory->destroy(params);
+    maxparams = 6*n2;
+    memory->create(params,maxparams,"pair:params");
+  }
+
+  for (int i = 0; i < ntypes; i++)
+    for (int j = 0; j < ntypes; j++) {
+      const int ij = i*ntypes + j;
+      params[ij] = cutsq[i+1][j+1];
+      params[n2+ij] = lj1[i+1][j+1];
+      params[2*n2+ij] = lj2[i+1][j+1];
+      params[3*n2+ij] = lj3[i+1][j+1];
+      params[4*n2+ij] = lj4[i+1][j+1];
+      params[5*n2+ij] = offset[i+1][j+1];
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+template < int EFLAG, int VFLAG, int NEWTON_PAIR >
+void PairLJCutSIMD::eval()
+{
+  typedef SIMD::vdouble vdouble;
+  typedef SIMD::vint vint;
+  const int W = SIMD::width;
+
+  const double * _noalias const x0 = atom->x[0];
+  const int * _noalias const type = atom->type;
+  const double * _noalias const special_lj = force->special_lj;
+  const int nlocal = atom->nlocal;
+  const int nall = nlocal + atom->nghost;
+  const int ntypes = atom->ntypes;
+  const int n2 = ntypes*ntypes;
+
+  const int inum = list->inum;
+  const int * _noalias const ilist = list->ilist;
+  const int * _noalias const numneigh = list->numneigh;
+  int ** const firstneigh = list->firstneigh;
+
+  pack_params();
+  const double * _noalias const pcutsq = params;
+  const double * _noalias const plj1 = params + n2;
+  const double * _noalias const plj2 = params + 2*n2;
+  const double * _noalias const plj3 = params + 3*n2;
+  const double * _noalias const plj4 = params + 4*n2;
+  const double * _noalias const poffset = params + 5*n2;
+
+  // a single atom type needs no per-pair gathers
+
+  const int onetype = (ntypes == 1);
+
+  // threads beyond the first accumulate into private copies of f
+
+  const int nthreads = comm->nthreads;
+  if (atom->nmax > maxfthr || nthreads-1 > nfthr) {
+    memory->destroy(fthr);
+    maxfthr = atom->nmax;
+    nfthr = nthreads-1;
+    memory->create(fthr,3*nfthr*maxfthr,"pair:fthr");
+  }
+
+  double evdwl = 0.0;
+  double v0 = 0.0, v1 = 0.0, v2 = 0.0, v3 = 0.0, v4 = 0.0, v5 = 0.0;
+
+#if defined(_OPENMP)
+#pragma omp parallel num_threads(nthreads) reduction(+:evdwl,v0,v1,v2,v3,v4,v5)
+#endif
+  {
+    int tid = 0, nt = 1;
+#if defined(_OPENMP)
+    tid = omp_get_thread_num();
+    nt = omp_get_num_threads();
+#endif
+
+    double * _noalias fo = atom->f[0];
+    if (tid > 0) {
+      fo = fthr + (bigint) 3*(tid-1)*maxfthr;
+      memset(fo,0,3*nall*sizeof(double));
+    }
+
+    const int chunk = (inum + nt - 1) / nt;
+    const int ifrom = MIN(tid*chunk,inum);
+    const int ito = MIN(ifrom+chunk,inum);
+
+    double fxj[W],fyj[W],fzj[W];
+    int jidx[W];
+
+    const vdouble cutsq11 = SIMD::set1(pcutsq[0]);
+    const vdouble lj111 = SIMD::set1(plj1[0]);
+    const vdouble lj211 = SIMD::set1(plj2[0]);
+    const vdouble lj311 = SIMD::set1(plj3[0]);
+    const vdouble lj411 = SIMD::set1(plj4[0]);
+    const vdouble offset11 = SIMD::set1(poffset[0]);
+
+    for (int ii = ifrom; ii < ito; ii++) {
+      const int i = ilist[ii];
+      const vdouble xtmp = SIMD::set1(x0[3*i]);
+      const vdouble ytmp = SIMD::set1(x0[3*i+1]);
+      const vdouble ztmp = SIMD::set1(x0[3*i+2]);
+      const int ioffset = (type[i]-1)*ntypes - 1;
+      const int * _noalias const jlist = firstneigh[i];
+      const int jnum = numneigh[i];
+
+      vdouble fxtmp = SIMD::zero();
+      vdouble fytmp = SIMD::zero();
+      vdouble fztmp = SIMD::zero();
+      vdouble evec = SIMD::zero();
+      vdouble vv0 = SIMD::zero(), vv1 = SIMD::zero(), vv2 = SIMD::zero();
+      vdouble vv3 = SIMD::zero(), vv4 = SIMD::zero(), vv5 = SIMD::zero();
+
+      // the last chunk is padded with masked lanes
+
+      for (int jj = 0; jj < jnum; jj += W) {
+        const SIMD::imask valid = SIMD::first(MIN(W,jnum-jj));
+        vint j = SIMD::load(&jlist[jj],valid);
+        const vint sbindex = SIMD::band(SIMD::shr(j,SBBITS),3);
+        j = SIMD::band(j,NEIGHMASK);
+        const vint j3 = SIMD::add(j,SIMD::add(j,j));
+
+        const vdouble delx = SIMD::sub(xtmp,SIMD::gather(x0,j3,valid));
+        const vdouble dely = SIMD::sub(ytmp,SIMD::gather(x0+1,j3,valid));
+        const vdouble delz = SIMD::sub(ztmp,SIMD::gather(x0+2,j3,valid));
+        const vdouble rsq = SIMD::add(SIMD::add(SIMD::mul(delx,delx),
+                                                SIMD::mul(dely,dely)),
+                                      SIMD::mul(delz,delz));
+
+        const vint ij = onetype ? j : SIMD::add(SIMD::gather(type,j,valid),ioffset);
+        const vdouble cutsqj = onetype ? cutsq11 : SIMD::gather(pcutsq,ij,valid);
+        const SIMD::vmask incut = SIMD::mand(SIMD::lt(rsq,cutsqj),SIMD::widen(valid));
+        const int hits = SIMD::bits(incut);
+        if (!hits) continue;
+
+        const vdouble factor_lj = SIMD::gather(special_lj,sbindex,valid);
+        const vdouble r2inv = SIMD::div(SIMD::set1(1.0),rsq);
+        const vdouble r6inv = SIMD::mul(SIMD::mul(r2inv,r2inv),r2inv);
+        const vdouble lj1j = onetype ? lj111 : SIMD::gather(plj1,ij,valid);
+        const vdouble lj2j = onetype ? lj211 : SIMD::gather(plj2,ij,valid);
+        const vdouble forcelj = SIMD::mul(r6inv,SIMD::sub(SIMD::mul(lj1j,r6inv),lj2j));
+        const vdouble fpair =
+          SIMD::select(incut,SIMD::mul(SIMD::mul(factor_lj,forcelj),r2inv));
+
+        const vdouble fx = SIMD::mul(delx,fpair);
+        const vdouble fy = SIMD::mul(dely,fpair);
+        const vdouble fz = SIMD::mul(delz,fpair);
+        fxtmp = SIMD::add(fxtmp,fx);
+        fytmp = SIMD::add(fytmp,fy);
+        fztmp = SIMD::add(fztmp,fz);
+
+        // neighbors of one atom are unique, so the scatter has no conflicts
+
+        SIMD::store(fxj,fx);
+        SIMD::store(fyj,fy);
+        SIMD::store(fzj,fz);
+        SIMD::store(jidx,j);
+        for (int k = 0; k < W; k++) {
+          if (!(hits >> k & 1)) continue;
+          const int jk = jidx[k];
+          if (NEWTON_PAIR || jk < nlocal) {
+            fo[3*jk] -= fxj[k];
+            fo[3*jk+1] -= fyj[k];
+            fo[3*jk+2] -= fzj[k];
+          }
+        }
+
+        // same weights as ev_tally(): half a pair for each owned atom
+
+        if (EFLAG || VFLAG) {
+          const vdouble weight = NEWTON_PAIR ? SIMD::set1(1.0) :
+            SIMD::blend(SIMD::widen(SIMD::lt(j,nlocal)),SIMD::set1(1.0),SIMD::set1(0.5));
+
+          if (EFLAG) {
+            const vdouble lj3j = onetype ? lj311 : SIMD::gather(plj3,ij,valid);
+            const vdouble lj4j = onetype ? lj411 : SIMD::gather(plj4,ij,valid);
+            const vdouble offsetj = onetype ? offset11 : SIMD::gather(poffset,ij,valid);
+            const vdouble e =
+              SIMD::sub(SIMD::mul(r6inv,SIMD::sub(SIMD::mul(lj3j,r6inv),lj4j)),offsetj);
+            evec = SIMD::add(evec,SIMD::select(incut,SIMD::mul(weight,SIMD::mul(factor_lj,e))));
+          }
+
+          if (VFLAG) {
+            vv0 = SIMD::add(vv0,SIMD::mul(weight,SIMD::mul(SIMD::mul(delx,delx),fpair)));
+            vv1 = SIMD::add(vv1,SIMD::mul(weight,SIMD::mul(SIMD::mul(dely,dely),fpair)));
+            vv2 = SIMD::add(vv2,SIMD::mul(weight,SIMD::mul(SIMD::mul(delz,delz),fpair)));
+            vv3 = SIMD::add(vv3,SIMD::mul(weight,SIMD::mul(SIMD::mul(delx,dely),fpair)));
+            vv4 = SIMD::add(vv4,SIMD::mul(weight,SIMD::mul(SIMD::mul(delx,delz),fpair)));
+            vv5 = SIMD::add(vv5,SIMD::mul(weight,SIMD::mul(SIMD::mul(dely,delz),fpair)));
+          }
+        }
+      }
+
+      fo[3*i] += SIMD::sum(fxtmp);
+      fo[3*i+1] += SIMD::sum(fytmp);
+      fo[3*i+2] += SIMD::sum(fztmp);
+
+      if (EFLAG) evdwl += SIMD::sum(evec);
+      if (VFLAG) {
+        v0 += SIMD::sum(vv0);
+        v1 += SIMD::sum(vv1);
+        v2 += SIMD::sum(vv2);
+        v3 += SIMD::sum(vv3);
+        v4 += SIMD::sum(vv4);
+        v5 += SIMD::sum(vv5);
+      }
+    }
+
+    // reduce thread forces into f, ghosts included for reverse comm
+
+    if (nt > 1) {
+      double * _noalias const f0 = atom->f[0];
+#if defined(_OPENMP)
+#pragma omp barrier
+#pragma omp for schedule(static)
+#endif
+      for (int k = 0; k < 3*nall; k++) {
+        double sum = 0.0;
+        for (int t = 1; t < nt; t++) sum += fthr[(bigint) 3*(t-1)*maxfthr + k];
+        f0[k] += sum;
+      }
+    }
+  }
+
+  if (EFLAG) eng_vdwl += evdwl;
+  if (VFLAG) {
+    virial[0] += v0;
+    virial[1] += v1;
+    virial[2] += v2;
+    virial[3] += v3;
+    virial[4] += v4;
+    virial[5] += v5;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+double PairLJCutSIMD::memory_usage()
+{
+  double bytes = PairLJCut::memory_usage();
+  bytes += maxparams * sizeof(double);
+  bytes += (double) 3*nfthr*maxfthr * sizeof(double);
+  return bytes;
+}
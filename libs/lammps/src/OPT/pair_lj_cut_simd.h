@@ -0,0 +1,48 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef PAIR_CLASS
+
+PairStyle(lj/cut/simd,PairLJCutSIMD)
+
+#else
+
+#ifndef LMP_PAIR_LJ_CUT_SIMD_H
+#define LMP_PAIR_LJ_CUT_SIMD_H
+
+#include "pair_lj_cut.h"
+
+namespace LAMMPS_NS {
+
+class PairLJCutSIMD : public PairLJCut {
+ public:
+  PairLJCutSIMD(class LAMMPS *);
+  virtual ~PairLJCutSIMD();
+  void compute(int, int);
+  double memory_usage();
+
+ private:
+  double *params;          // packed cutsq,lj1,lj2,lj3,lj4,offset tables
+  int maxparams;
+  double *fthr;            // forces of threads 1..nthreads-1
+  int maxfthr;             // atoms per thread in fthr
+  int nfthr;               // threads with a copy in fthr
+
+  void pack_params();
+  template < int EFLAG, int VFLAG, int NEWTON_PAIR > void eval();
+};
+
+}
+
+#endif
+#endif
@@ -44,14 +44,22 @@
 #include "neigh_request.h"
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace LAMMPS_NS;
 using namespace MathConst;
 
 #define DELTA 1
 #define DELTA_MEMSTR 1024
 #define EPSILON 1.0e-6
+#define MAXCURVEBITS 21      // bits per dimension that fit in a 63-bit curve key
+#define RADIXBITS 8
+#define RADIX (1 << RADIXBITS)
 
 enum{LAYOUT_UNIFORM,LAYOUT_NONUNIFORM,LAYOUT_TILED};    // several files
+enum{SORT_BIN,SORT_MORTON,SORT_HILBERT};
 
 /* ---------------------------------------------------------------------- */
 
@@ -67,9 +75,14 @@ Atom::Atom(LAMMPS *lmp) : Pointers(lmp)
   sortfreq = 1000;
   nextsort = 0;
   userbinsize = 0.0;
+  sortorder = SORT_BIN;
   maxbin = maxnext = 0;
   binhead = NULL;
   next = permute = NULL;
+  nbinbits = 0;
+  sortkey = sortkeytmp = NULL;
+  maxradix = 0;
+  radixcount = NULL;
 
   // initialize atom arrays
   // customize by adding new array
@@ -241,6 +254,9 @@ Atom::~Atom()
   memory->destroy(binhead);
   memory->destroy(next);
   memory->destroy(permute);
+  memory->destroy(sortkey);
+  memory->destroy(sortkeytmp);
+  memory->destroy(radixcount);
 
   // delete atom arrays
   // customize by adding new array
@@ -389,6 +405,7 @@ void Atom::settings(Atom *old)
   map_style = old->map_style;
   sortfreq = old->sortfreq;
   userbinsize = old->userbinsize;
+  sortorder = old->sortorder;
   if (old->firstgroupname) {
     int n = strlen(old->firstgroupname) + 1;
     firstgroupname = new char[n];
@@ -619,6 +636,13 @@ void Atom::modify_params(int narg, char **arg)
         error->all(FLERR,"Atom_modify sort and first options "
                    "cannot be used together");
       iarg += 3;
+    } else if (strcmp(arg[iarg],"order") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal atom_modify command");
+      if (strcmp(arg[iarg+1],"bin") == 0) sortorder = SORT_BIN;
+      else if (strcmp(arg[iarg+1],"morton") == 0) sortorder = SORT_MORTON;
+      else if (strcmp(arg[iarg+1],"hilbert") == 0) sortorder = SORT_HILBERT;
+      else error->all(FLERR,"Illegal atom_modify command");
+      iarg += 2;
     } else error->all(FLERR,"Illegal atom_modify command");
   }
 }
@@ -817,6 +841,165 @@ void Atom::deallocate_topology()
     atom->improper_atom3 = atom->improper_atom4 = NULL;
 }
 
+/* ----------------------------------------------------------------------
+   helpers for parsing a chunk of lines from a data file section
+   lines of a chunk are independent of each other, so callers tokenize
+     them and convert their numeric values in parallel with OpenMP
+   parse_int() and parse_double() give the same results as atoi() and
+     atof() on a single word, but are faster for typical data files
+------------------------------------------------------------------------- */
+
+static const double exact_pow10[] = {
+  1.0e0,  1.0e1,  1.0e2,  1.0e3,  1.0e4,  1.0e5,  1.0e6,  1.0e7,
+  1.0e8,  1.0e9,  1.0e10, 1.0e11, 1.0e12, 1.0e13, 1.0e14, 1.0e15,
+  1.0e16, 1.0e17, 1.0e18, 1.0e19, 1.0e20, 1.0e21, 1.0e22
+};
+
+// split N newline-terminated lines in buf into strings stored in lines
+
+static void split_lines(int n, char *buf, char **lines)
+{
+  char *next;
+
+  for (int i = 0; i < n; i++) {
+    lines[i] = buf;
+    next = strchr(buf,'\n');
+    if (next) {
+      *next = '\0';
+      buf = next + 1;
+    } else buf += strlen(buf);
+  }
+}
+
+// split line in place into its first N words at the delimiters of strtok()
+// return # of words found
+
+static int tokenize(char *line, char **words, int n)
+{
+  char *ptr = line;
+  int m = 0;
+
+  while (m < n) {
+    while (*ptr == ' ' || *ptr == '\t' || *ptr == '\n' ||
+           *ptr == '\r' || *ptr == '\f') ptr++;
+    if (*ptr == '\0') break;
+    words[m++] = ptr;
+    while (*ptr && *ptr != ' ' && *ptr != '\t' && *ptr != '\n' &&
+           *ptr != '\r' && *ptr != '\f') ptr++;
+    if (*ptr == '\0') break;
+    *ptr++ = '\0';
+  }
+
+  return m;
+}
+
+// convert leading integer of word, caller casts result to int or tagint
+
+static bigint parse_int(const char *word)
+{
+  const char *ptr = word;
+  int negative = 0;
+  if (*ptr == '-') {
+    negative = 1;
+    ptr++;
+  } else if (*ptr == '+') ptr++;
+
+  bigint value = 0;
+  while (*ptr >= '0' && *ptr <= '9') value = 10*value + (*ptr++ - '0');
+  return negative ? -value : value;
+}
+
+// convert word to double
+// mantissa with <= 15 digits and power of 10 with |exponent| <= 22 are
+//   exact doubles, so one multiply or divide gives the correctly rounded
+//   value, same as atof()
+// anything else, e.g. more digits, hex, inf or nan, falls back to atof()
+
+static double parse_double(const char *word)
+{
+  const char *ptr = word;
+  int negative = 0;
+  if (*ptr == '-') {
+    negative = 1;
+    ptr++;
+  } else if (*ptr == '+') ptr++;
+
+  bigint mantissa = 0;
+  int ndigits = 0;
+  int exponent = 0;
+  int anydigit = 0;
+
+  for (; *ptr >= '0' && *ptr <= '9'; ptr++) {
+    anydigit = 1;
+    if (mantissa == 0 && *ptr == '0') continue;
+    if (++ndigits > 15) return atof(word);
+    mantissa = 10*mantissa + (*ptr - '0');
+  }
+  if (*ptr == '.') {
+    for (ptr++; *ptr >= '0' && *ptr <= '9'; ptr++) {
+      anydigit = 1;
+      exponent--;
+      if (mantissa == 0 && *ptr == '0') continue;
+      if (++ndigits > 15) return atof(word);
+      mantissa = 10*mantissa + (*ptr - '0');
+    }
+  }
+  if (!anydigit) return atof(word);
+
+  if (*ptr == 'e' || *ptr == 'E') {
+    ptr++;
+    int enegative = 0;
+    if (*ptr == '-') {
+      enegative = 1;
+      ptr++;
+    } else if (*ptr == '+') ptr++;
+    if (*ptr < '0' || *ptr > '9') return atof(word);
+    int evalue = 0;
+    for (; *ptr >= '0' && *ptr <= '9'; ptr++)
+      if (evalue < 10000) evalue = 10*evalue + (*ptr - '0');
+    exponent += enegative ? -evalue : evalue;
+  }
+  if (*ptr != '\0') return atof(word);
+
+  double value = (double) mantissa;
+  if (mantissa) {
+    if (exponent < -22 || exponent > 22) return atof(word);
+    if (exponent < 0) value /= exact_pow10[-exponent];
+    else value *= exact_pow10[exponent];
+  }
+  return negative ? -value : value;
+}
+
+// tokenize N lines of a topology section in parallel
+// store type and NATOM atom IDs of each line
+// return # of lines with too few words
+
+static int parse_topology(int n, char *buf, int natom,
+                          int *itype, tagint *atom)
+{
+  char **lines = new char*[n];
+  split_lines(n,buf,lines);
+
+  int nbad = 0;
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) reduction(+:nbad)
+#endif
+  for (int i = 0; i < n; i++) {
+    char *words[6];
+    tagint *iatom = &atom[natom*i];
+    if (tokenize(lines[i],words,natom+2) < natom+2) {
+      nbad++;
+      continue;
+    }
+    itype[i] = parse_int(words[1]);
+    for (int j = 0; j < natom; j++) iatom[j] = parse_int(words[j+2]);
+  }
+
+  delete [] lines;
+  return nbad;
+}
+
 /* ----------------------------------------------------------------------
    unpack N lines from Atom section of data file
    call style-specific routine to parse line
@@ -825,21 +1008,20 @@ void Atom::deallocate_topology()
 void Atom::data_atoms(int n, char *buf, tagint id_offset, int type_offset,
                       int shiftflag, double *shift)
 {
-  int m,xptr,iptr;
-  imageint imagedata;
-  double xdata[3],lamda[3];
-  double *coord;
-  char *next;
+  int xptr,iptr;
 
-  next = strchr(buf,'\n');
-  *next = '\0';
-  int nwords = count_words(buf);
-  *next = '\n';
+  char **lines = new char*[n];
+  split_lines(n,buf,lines);
+
+  int nwords = count_words(lines[0]);
 
   if (nwords != avec->size_data_atom && nwords != avec->size_data_atom + 3)
     error->all(FLERR,"Incorrect atom format in data file");
 
-  char **values = new char*[nwords];
+  char **values = new char*[n*nwords];
+  double *xdata = new double[3*n];
+  imageint *imagedata = new imageint[n];
+  int *flag = new int[n];
 
   // set bounds for my proc
   // if periodic and I am lo/hi proc, adjust bounds by EPSILON
@@ -903,62 +1085,79 @@ void Atom::data_atoms(int n, char *buf, tagint id_offset, int type_offset,
   if (nwords > avec->size_data_atom) imageflag = 1;
   if (imageflag) iptr = nwords - 3;
 
-  // loop over lines of atom data
+  // loop over lines of atom data, in parallel with OpenMP
   // tokenize the line into values
   // extract xyz coords and image flags
   // remap atom into simulation box
-  // if atom is in my sub-domain, unpack its values
+  // flag = 1 if atom is in my sub-domain, 0 if not, -1 if line is too short
 
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
   for (int i = 0; i < n; i++) {
-    next = strchr(buf,'\n');
-
-    values[0] = strtok(buf," \t\n\r\f");
-    if (values[0] == NULL)
-      error->all(FLERR,"Incorrect atom format in data file");
-    for (m = 1; m < nwords; m++) {
-      values[m] = strtok(NULL," \t\n\r\f");
-      if (values[m] == NULL)
-        error->all(FLERR,"Incorrect atom format in data file");
+    char **words = &values[i*nwords];
+    double *x = &xdata[3*i];
+    double lamda[3];
+    double *coord;
+    int ix,iy,iz;
+
+    if (tokenize(lines[i],words,nwords) < nwords) {
+      flag[i] = -1;
+      continue;
     }
 
-    if (imageflag)
-      imagedata = ((imageint) (atoi(values[iptr]) + IMGMAX) & IMGMASK) |
-        (((imageint) (atoi(values[iptr+1]) + IMGMAX) & IMGMASK) << IMGBITS) |
-        (((imageint) (atoi(values[iptr+2]) + IMGMAX) & IMGMASK) << IMG2BITS);
-    else imagedata = ((imageint) IMGMAX << IMG2BITS) |
-           ((imageint) IMGMAX << IMGBITS) | IMGMAX;
-
-    xdata[0] = atof(values[xptr]);
-    xdata[1] = atof(values[xptr+1]);
-    xdata[2] = atof(values[xptr+2]);
+    if (imageflag) {
+      ix = parse_int(words[iptr]);
+      iy = parse_int(words[iptr+1]);
+      iz = parse_int(words[iptr+2]);
+      imagedata[i] = ((imageint) (ix + IMGMAX) & IMGMASK) |
+        (((imageint) (iy + IMGMAX) & IMGMASK) << IMGBITS) |
+        (((imageint) (iz + IMGMAX) & IMGMASK) << IMG2BITS);
+    } else imagedata[i] = ((imageint) IMGMAX << IMG2BITS) |
+             ((imageint) IMGMAX << IMGBITS) | IMGMAX;
+
+    x[0] = parse_double(words[xptr]);
+    x[1] = parse_double(words[xptr+1]);
+    x[2] = parse_double(words[xptr+2]);
     if (shiftflag) {
-      xdata[0] += shift[0];
-      xdata[1] += shift[1];
-      xdata[2] += shift[2];
+      x[0] += shift[0];
+      x[1] += shift[1];
+      x[2] += shift[2];
     }
 
-    domain->remap(xdata,imagedata);
+    domain->remap(x,imagedata[i]);
     if (triclinic) {
-      domain->x2lamda(xdata,lamda);
+      domain->x2lamda(x,lamda);
       coord = lamda;
-    } else coord = xdata;
+    } else coord = x;
 
     if (coord[0] >= sublo[0] && coord[0] < subhi[0] &&
         coord[1] >= sublo[1] && coord[1] < subhi[1] &&
-        coord[2] >= sublo[2] && coord[2] < subhi[2]) {
-      avec->data_atom(xdata,imagedata,values);
-      if (id_offset) tag[nlocal-1] += id_offset;
-      if (type_offset) {
-        type[nlocal-1] += type_offset;
-        if (type[nlocal-1] > ntypes)
-          error->one(FLERR,"Invalid atom type in Atoms section of data file");
-      }
-    }
+        coord[2] >= sublo[2] && coord[2] < subhi[2]) flag[i] = 1;
+    else flag[i] = 0;
+  }
 
-    buf = next + 1;
+  // if atom is in my sub-domain, unpack its values, in order of lines
+
+  for (int i = 0; i < n; i++) {
+    if (flag[i] < 0)
+      error->all(FLERR,"Incorrect atom format in data file");
+    if (flag[i] == 0) continue;
+
+    avec->data_atom(&xdata[3*i],imagedata[i],&values[i*nwords]);
+    if (id_offset) tag[nlocal-1] += id_offset;
+    if (type_offset) {
+      type[nlocal-1] += type_offset;
+      if (type[nlocal-1] > ntypes)
+        error->one(FLERR,"Invalid atom type in Atoms section of data file");
+    }
   }
 
+  delete [] lines;
   delete [] values;
+  delete [] xdata;
+  delete [] imagedata;
+  delete [] flag;
 }
 
 /* ----------------------------------------------------------------------
@@ -969,40 +1168,51 @@ void Atom::data_atoms(int n, char *buf, tagint id_offset, int type_offset,
 
 void Atom::data_vels(int n, char *buf, tagint id_offset)
 {
-  int j,m;
-  tagint tagdata;
-  char *next;
+  int m;
 
-  next = strchr(buf,'\n');
-  *next = '\0';
-  int nwords = count_words(buf);
-  *next = '\n';
+  char **lines = new char*[n];
+  split_lines(n,buf,lines);
+
+  int nwords = count_words(lines[0]);
 
   if (nwords != avec->size_data_vel)
     error->all(FLERR,"Incorrect velocity format in data file");
 
-  char **values = new char*[nwords];
+  char **values = new char*[n*nwords];
+  tagint *tagdata = new tagint[n];
+  int *flag = new int[n];
 
-  // loop over lines of atom velocities
-  // tokenize the line into values
-  // if I own atom tag, unpack its values
+  // tokenize lines of atom velocities into values, in parallel with OpenMP
+  // flag = -1 if line is too short
 
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
   for (int i = 0; i < n; i++) {
-    next = strchr(buf,'\n');
+    char **words = &values[i*nwords];
+    if (tokenize(lines[i],words,nwords) < nwords) {
+      flag[i] = -1;
+      continue;
+    }
+    tagdata[i] = parse_int(words[0]);
+    tagdata[i] += id_offset;
+    flag[i] = 0;
+  }
 
-    values[0] = strtok(buf," \t\n\r\f");
-    for (j = 1; j < nwords; j++)
-      values[j] = strtok(NULL," \t\n\r\f");
+  // if I own atom tag, unpack its values
 
-    tagdata = ATOTAGINT(values[0]) + id_offset;
-    if (tagdata <= 0 || tagdata > map_tag_max)
+  for (int i = 0; i < n; i++) {
+    if (flag[i] < 0)
+      error->all(FLERR,"Incorrect velocity format in data file");
+    if (tagdata[i] <= 0 || tagdata[i] > map_tag_max)
       error->one(FLERR,"Invalid atom ID in Velocities section of data file");
-    if ((m = map(tagdata)) >= 0) avec->data_vel(m,&values[1]);
-
-    buf = next + 1;
+    if ((m = map(tagdata[i])) >= 0) avec->data_vel(m,&values[i*nwords+1]);
   }
 
+  delete [] lines;
   delete [] values;
+  delete [] tagdata;
+  delete [] flag;
 }
 
 /* ----------------------------------------------------------------------
@@ -1015,16 +1225,21 @@ void Atom::data_vels(int n, char *buf, tagint id_offset)
 void Atom::data_bonds(int n, char *buf, int *count, tagint id_offset,
                       int type_offset)
 {
-  int m,tmp,itype;
+  int m,itype;
   tagint atom1,atom2;
-  char *next;
   int newton_bond = force->newton_bond;
 
+  int *itypes;
+  tagint *atoms;
+  memory->create(itypes,n,"atom:itypes");
+  memory->create(atoms,2*n,"atom:atoms");
+  if (parse_topology(n,buf,2,itypes,atoms))
+    error->all(FLERR,"Incorrect format in Bonds section of data file");
+
   for (int i = 0; i < n; i++) {
-    next = strchr(buf,'\n');
-    *next = '\0';
-    sscanf(buf,"%d %d " TAGINT_FORMAT " " TAGINT_FORMAT,
-           &tmp,&itype,&atom1,&atom2);
+    itype = itypes[i];
+    atom1 = atoms[2*i];
+    atom2 = atoms[2*i+1];
     if (id_offset) {
       atom1 += id_offset;
       atom2 += id_offset;
@@ -1054,8 +1269,10 @@ void Atom::data_bonds(int n, char *buf, int *count, tagint id_offset,
         }
       }
     }
-    buf = next + 1;
   }
+
+  memory->destroy(itypes);
+  memory->destroy(atoms);
 }
 
 /* ----------------------------------------------------------------------
@@ -1068,16 +1285,22 @@ void Atom::data_bonds(int n, char *buf, int *count, tagint id_offset,
 void Atom::data_angles(int n, char *buf, int *count, tagint id_offset,
                        int type_offset)
 {
-  int m,tmp,itype;
+  int m,itype;
   tagint atom1,atom2,atom3;
-  char *next;
   int newton_bond = force->newton_bond;
 
+  int *itypes;
+  tagint *atoms;
+  memory->create(itypes,n,"atom:itypes");
+  memory->create(atoms,3*n,"atom:atoms");
+  if (parse_topology(n,buf,3,itypes,atoms))
+    error->all(FLERR,"Incorrect format in Angles section of data file");
+
   for (int i = 0; i < n; i++) {
-    next = strchr(buf,'\n');
-    *next = '\0';
-    sscanf(buf,"%d %d " TAGINT_FORMAT " " TAGINT_FORMAT " " TAGINT_FORMAT,
-           &tmp,&itype,&atom1,&atom2,&atom3);
+    itype = itypes[i];
+    atom1 = atoms[3*i];
+    atom2 = atoms[3*i+1];
+    atom3 = atoms[3*i+2];
     if (id_offset) {
       atom1 += id_offset;
       atom2 += id_offset;
@@ -1123,8 +1346,10 @@ void Atom::data_angles(int n, char *buf, int *count, tagint id_offset,
         }
       }
     }
-    buf = next + 1;
   }
+
+  memory->destroy(itypes);
+  memory->destroy(atoms);
 }
 
 /* ----------------------------------------------------------------------
@@ -1137,17 +1362,23 @@ void Atom::data_angles(int n, char *buf, int *count, tagint id_offset,
 void Atom::data_dihedrals(int n, char *buf, int *count, tagint id_offset,
                           int type_offset)
 {
-  int m,tmp,itype;
+  int m,itype;
   tagint atom1,atom2,atom3,atom4;
-  char *next;
   int newton_bond = force->newton_bond;
 
+  int *itypes;
+  tagint *atoms;
+  memory->create(itypes,n,"atom:itypes");
+  memory->create(atoms,4*n,"atom:atoms");
+  if (parse_topology(n,buf,4,itypes,atoms))
+    error->all(FLERR,"Incorrect format in Dihedrals section of data file");
+
   for (int i = 0; i < n; i++) {
-    next = strchr(buf,'\n');
-    *next = '\0';
-    sscanf(buf,"%d %d "
-           TAGINT_FORMAT " " TAGINT_FORMAT " " TAGINT_FORMAT " " TAGINT_FORMAT,
-           &tmp,&itype,&atom1,&atom2,&atom3,&atom4);
+    itype = itypes[i];
+    atom1 = atoms[4*i];
+    atom2 = atoms[4*i+1];
+    atom3 = atoms[4*i+2];
+    atom4 = atoms[4*i+3];
     if (id_offset) {
       atom1 += id_offset;
       atom2 += id_offset;
@@ -1210,8 +1441,10 @@ void Atom::data_dihedrals(int n, char *buf, int *count, tagint id_offset,
         }
       }
     }
-    buf = next + 1;
   }
+
+  memory->destroy(itypes);
+  memory->destroy(atoms);
 }
 
 /* ----------------------------------------------------------------------
@@ -1224,17 +1457,23 @@ void Atom::data_dihedrals(int n, char *buf, int *count, tagint id_offset,
 void Atom::data_impropers(int n, char *buf, int *count, tagint id_offset,
                           int type_offset)
 {
-  int m,tmp,itype;
+  int m,itype;
   tagint atom1,atom2,atom3,atom4;
-  char *next;
   int newton_bond = force->newton_bond;
 
+  int *itypes;
+  tagint *atoms;
+  memory->create(itypes,n,"atom:itypes");
+  memory->create(atoms,4*n,"atom:atoms");
+  if (parse_topology(n,buf,4,itypes,atoms))
+    error->all(FLERR,"Incorrect format in Impropers section of data file");
+
   for (int i = 0; i < n; i++) {
-    next = strchr(buf,'\n');
-    *next = '\0';
-    sscanf(buf,"%d %d "
-           TAGINT_FORMAT " " TAGINT_FORMAT " " TAGINT_FORMAT " " TAGINT_FORMAT,
-           &tmp,&itype,&atom1,&atom2,&atom3,&atom4);
+    itype = itypes[i];
+    atom1 = atoms[4*i];
+    atom2 = atoms[4*i+1];
+    atom3 = atoms[4*i+2];
+    atom4 = atoms[4*i+3];
     if (id_offset) {
       atom1 += id_offset;
       atom2 += id_offset;
@@ -1297,8 +1536,10 @@ void Atom::data_impropers(int n, char *buf, int *count, tagint id_offset,
         }
       }
     }
-    buf = next + 1;
   }
+
+  memory->destroy(itypes);
+  memory->destroy(atoms);
 }
 
 /* ----------------------------------------------------------------------
@@ -1755,6 +1996,56 @@ void Atom::first_reorder()
   }
 }
 
+/* ----------------------------------------------------------------------
+   Morton key of a bin: interleave the bits of its dim indices,
+   c[0] in the most significant position of each group of dim bits
+------------------------------------------------------------------------- */
+
+static bigint interleave_bits(const int *c, int dim, int bits)
+{
+  bigint key = 0;
+  for (int b = bits-1; b >= 0; b--)
+    for (int d = 0; d < dim; d++)
+      key = (key << 1) | ((c[d] >> b) & 1);
+  return key;
+}
+
+/* ----------------------------------------------------------------------
+   Hilbert key of a bin
+   transform the indices to the transposed Hilbert index as in
+   J. Skilling, AIP Conf Proc 707, 381 (2004), then interleave its bits
+------------------------------------------------------------------------- */
+
+static bigint hilbert_key(const int *c, int dim, int bits)
+{
+  int x[3],p,q,t;
+  for (int d = 0; d < dim; d++) x[d] = c[d];
+
+  // inverse undo
+
+  for (q = 1 << (bits-1); q > 1; q >>= 1) {
+    p = q - 1;
+    for (int d = 0; d < dim; d++) {
+      if (x[d] & q) x[0] ^= p;
+      else {
+        t = (x[0] ^ x[d]) & p;
+        x[0] ^= t;
+        x[d] ^= t;
+      }
+    }
+  }
+
+  // Gray encode
+
+  for (int d = 1; d < dim; d++) x[d] ^= x[d-1];
+  t = 0;
+  for (q = 1 << (bits-1); q > 1; q >>= 1)
+    if (x[dim-1] & q) t ^= q - 1;
+  for (int d = 0; d < dim; d++) x[d] ^= t;
+
+  return interleave_bits(x,dim,bits);
+}
+
 /* ----------------------------------------------------------------------
    perform spatial sort of atoms within my sub-domain
    always called between comm->exchange() and comm->borders()
@@ -1763,7 +2054,7 @@ void Atom::first_reorder()
 
 void Atom::sort()
 {
-  int i,m,n,ix,iy,iz,ibin,empty;
+  int i,m,n,ix,iy,iz,ibin;
 
   // set next timestep for sorting to take place
 
@@ -1779,6 +2070,8 @@ void Atom::sort()
   if (nlocal > maxnext) {
     memory->destroy(next);
     memory->destroy(permute);
+    memory->destroy(sortkey);
+    memory->destroy(sortkeytmp);
     maxnext = atom->nmax;
     memory->create(next,maxnext,"atom:next");
     memory->create(permute,maxnext,"atom:permute");
@@ -1788,6 +2081,44 @@ void Atom::sort()
 
   if (nlocal == nmax) avec->grow(0);
 
+  // permute = desired permutation of atoms
+  // permute[I] = J means Ith new atom will be Jth old atom
+
+  if (sortorder != SORT_BIN && nbinbits <= MAXCURVEBITS) {
+
+    // visit bins along a Morton or Hilbert curve instead of row by row,
+    // so atoms adjacent in the list are also close along y and z
+    // stable radix sort keeps atoms in one bin in their current order
+
+    if (sortkey == NULL) {
+      memory->create(sortkey,maxnext,"atom:sortkey");
+      memory->create(sortkeytmp,maxnext,"atom:sortkeytmp");
+    }
+
+    const int dim = domain->dimension;
+    const int hilbert = (sortorder == SORT_HILBERT);
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nlocal; i++) {
+      int c[3];
+      c[0] = static_cast<int> ((x[i][0]-bboxlo[0])*bininvx);
+      c[1] = static_cast<int> ((x[i][1]-bboxlo[1])*bininvy);
+      c[2] = static_cast<int> ((x[i][2]-bboxlo[2])*bininvz);
+      c[0] = MIN(MAX(c[0],0),nbinx-1);
+      c[1] = MIN(MAX(c[1],0),nbiny-1);
+      c[2] = MIN(MAX(c[2],0),nbinz-1);
+      sortkey[i] = hilbert ? hilbert_key(c,dim,nbinbits) :
+        interleave_bits(c,dim,nbinbits);
+      permute[i] = i;
+    }
+
+    sort_curve_keys(dim*nbinbits);
+    avec->permute(nlocal,permute,next);
+    return;
+  }
+
   // bin atoms in reverse order so linked list will be in forward order
 
   for (i = 0; i < nbins; i++) binhead[i] = -1;
@@ -1819,39 +2150,80 @@ void Atom::sort()
     }
   }
 
-  // current = current permutation, just reuse next vector
-  // current[I] = J means Ith current atom is Jth old atom
+  // reorder local atom list, next is scratch space
 
-  int *current = next;
-  for (i = 0; i < nlocal; i++) current[i] = i;
+  avec->permute(nlocal,permute,next);
+}
 
-  // reorder local atom list, when done, current = permute
-  // perform "in place" using copy() to extra atom location at end of list
-  // inner while loop processes one cycle of the permutation
-  // copy before inner-loop moves an atom to end of atom list
-  // copy after inner-loop moves atom at end of list back into list
-  // empty = location in atom list that is currently empty
+/* ----------------------------------------------------------------------
+   stable LSD radix sort of sortkey with permute carried along
+   each thread histograms and scatters its own contiguous chunk of atoms,
+   offsets are laid out bucket by bucket, thread by thread to stay stable
+   next and sortkeytmp are the scatter buffers, swapped after each pass
+------------------------------------------------------------------------- */
 
-  for (i = 0; i < nlocal; i++) {
-    if (current[i] == permute[i]) continue;
-    avec->copy(i,nlocal,0);
-    empty = i;
-    while (permute[empty] != i) {
-      avec->copy(permute[empty],empty,0);
-      empty = current[empty] = permute[empty];
-    }
-    avec->copy(nlocal,empty,0);
-    current[empty] = permute[empty];
+void Atom::sort_curve_keys(int nbits)
+{
+  int nthreads = 1;
+#if defined(_OPENMP)
+  nthreads = omp_get_max_threads();
+#endif
+  if (nthreads*RADIX > maxradix) {
+    memory->destroy(radixcount);
+    maxradix = nthreads*RADIX;
+    memory->create(radixcount,maxradix,"atom:radixcount");
   }
 
-  // sanity check that current = permute
+  const int n = nlocal;
+  for (int shift = 0; shift < nbits; shift += RADIXBITS) {
+    bigint *key = sortkey;
+    bigint *keytmp = sortkeytmp;
+    int *index = permute;
+    int *indextmp = next;
+
+#if defined(_OPENMP)
+#pragma omp parallel num_threads(nthreads)
+#endif
+    {
+      int tid = 0;
+      int nt = 1;
+#if defined(_OPENMP)
+      tid = omp_get_thread_num();
+      nt = omp_get_num_threads();
+#endif
+      const int lo = static_cast<bigint>(n)*tid/nt;
+      const int hi = static_cast<bigint>(n)*(tid+1)/nt;
+      int *count = &radixcount[tid*RADIX];
+
+      for (int b = 0; b < RADIX; b++) count[b] = 0;
+      for (int i = lo; i < hi; i++) count[(key[i] >> shift) & (RADIX-1)]++;
 
-  //int flag = 0;
-  //for (i = 0; i < nlocal; i++)
-  //  if (current[i] != permute[i]) flag = 1;
-  //int flagall;
-  //MPI_Allreduce(&flag,&flagall,1,MPI_INT,MPI_SUM,world);
-  //if (flagall) error->all(FLERR,"Atom sort did not operate correctly");
+#if defined(_OPENMP)
+#pragma omp barrier
+#pragma omp single
+#endif
+      {
+        int offset = 0;
+        for (int b = 0; b < RADIX; b++)
+          for (int t = 0; t < nt; t++) {
+            int c = radixcount[t*RADIX+b];
+            radixcount[t*RADIX+b] = offset;
+            offset += c;
+          }
+      }
+
+      for (int i = lo; i < hi; i++) {
+        int m = count[(key[i] >> shift) & (RADIX-1)]++;
+        keytmp[m] = key[i];
+        indextmp[m] = index[i];
+      }
+    }
+
+    sortkey = keytmp;
+    sortkeytmp = key;
+    permute = indextmp;
+    next = index;
+  }
 }
 
 /* ----------------------------------------------------------------------
@@ -1951,6 +2323,12 @@ void Atom::setup_sort_bins()
 
   nbins = nbinx*nbiny*nbinz;
 
+  // bits per dimension for space-filling curve keys
+
+  int nbinmax = MAX(MAX(nbinx,nbiny),nbinz);
+  nbinbits = 1;
+  while ((1 << nbinbits) < nbinmax && nbinbits <= MAXCURVEBITS) nbinbits++;
+
   // reallocate per-bin memory if needed
 
   if (nbins > maxbin) {
@@ -2235,6 +2613,10 @@ bigint Atom::memory_usage()
   if (maxnext) {
     bytes += memory->usage(next,maxnext);
     bytes += memory->usage(permute,maxnext);
+    if (sortkey) {
+      bytes += memory->usage(sortkey,maxnext);
+      bytes += memory->usage(sortkeytmp,maxnext);
+    }
   }
 
   return bytes;
@@ -195,6 +195,7 @@ class Atom : protected Pointers {
   int sortfreq;             // sort atoms every this many steps, 0 = off
   bigint nextsort;          // next timestep to sort on
   double userbinsize;       // requested sort bin size
+  int sortorder;            // order of sort bins: row-major, Morton or Hilbert
 
   // indices of atoms with same ID
 
@@ -324,11 +325,16 @@ class Atom : protected Pointers {
   int *permute;                   // permutation vector
   double bininvx,bininvy,bininvz; // inverse actual bin sizes
   double bboxlo[3],bboxhi[3];     // bounding box of my sub-domain
+  int nbinbits;                   // bits needed for the largest bin index
+  bigint *sortkey,*sortkeytmp;    // curve key of each atom, radix sort buffer
+  int maxradix;                   // max size of radixcount
+  int *radixcount;                // per-thread radix sort histograms
 
   int memlength;                  // allocated size of memstr
   char *memstr;                   // string of array names already counted
 
   void setup_sort_bins();
+  void sort_curve_keys(int);
   int next_prime(int);
 
  private:
@@ -422,6 +428,11 @@ E: Invalid atom ID in Velocities section of data file
 Atom IDs must be positive integers and within range of defined
 atoms.
 
+E: Incorrect format in Bonds section of data file
+
+A line in the Bonds section of the data file has fewer values than
+expected.
+
 E: Invalid atom ID in Bonds section of data file
 
 Atom IDs must be positive integers and within range of defined
@@ -432,6 +443,11 @@ E: Invalid bond type in Bonds section of data file
 Bond type must be positive integer and within range of specified bond
 types.
 
+E: Incorrect format in Angles section of data file
+
+A line in the Angles section of the data file has fewer values than
+expected.
+
 E: Invalid atom ID in Angles section of data file
 
 Atom IDs must be positive integers and within range of defined
@@ -442,6 +458,11 @@ E: Invalid angle type in Angles section of data file
 Angle type must be positive integer and within range of specified angle
 types.
 
+E: Incorrect format in Dihedrals section of data file
+
+A line in the Dihedrals section of the data file has fewer values than
+expected.
+
 E: Invalid atom ID in Dihedrals section of data file
 
 Atom IDs must be positive integers and within range of defined
@@ -452,6 +473,11 @@ E: Invalid dihedral type in Dihedrals section of data file
 Dihedral type must be positive integer and within range of specified
 dihedral types.
 
+E: Incorrect format in Impropers section of data file
+
+A line in the Impropers section of the data file has fewer values than
+expected.
+
 E: Invalid atom ID in Impropers section of data file
 
 Atom IDs must be positive integers and within range of defined
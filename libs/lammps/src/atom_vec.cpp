@@ -17,6 +17,9 @@
 #include "atom.h"
 #include "force.h"
 #include "domain.h"
+#include "modify.h"
+#include "fix.h"
+#include "memory.h"
 #include "error.h"
 
 using namespace LAMMPS_NS;
@@ -37,6 +40,9 @@ AtomVec::AtomVec(LAMMPS *lmp) : Pointers(lmp)
 
   nargcopy = 0;
   argcopy = NULL;
+
+  permutebuf = NULL;
+  maxpermutebuf = 0;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -45,6 +51,7 @@ AtomVec::~AtomVec()
 {
   for (int i = 0; i < nargcopy; i++) delete [] argcopy[i];
   delete [] argcopy;
+  memory->sfree(permutebuf);
 }
 
 /* ----------------------------------------------------------------------
@@ -106,6 +113,87 @@ int AtomVec::grow_nmax_bonus(int nmax_bonus)
   return nmax_bonus;
 }
 
+/* ----------------------------------------------------------------------
+   reorder the first n local atoms, new atom I = old atom permute[I]
+   current = scratch vector of length n
+   styles override this to gather each per-atom array in bulk
+------------------------------------------------------------------------- */
+
+void AtomVec::permute(int n, int *permute, int *current)
+{
+  permute_cycles(n,permute,current,0);
+}
+
+/* ----------------------------------------------------------------------
+   reorder atoms one permutation cycle at a time
+   extraonly = 0: move all per-atom values with copy()
+   extraonly = 1: move only arrays of fixes with grow callbacks
+   requires one spare atom location at index n
+------------------------------------------------------------------------- */
+
+void AtomVec::permute_cycles(int n, int *permute, int *current, int extraonly)
+{
+  int i,empty;
+
+  // current = current permutation
+  // current[I] = J means Ith current atom is Jth old atom
+
+  for (i = 0; i < n; i++) current[i] = i;
+
+  // reorder local atom list, when done, current = permute
+  // perform "in place" using copy() to extra atom location at end of list
+  // inner while loop processes one cycle of the permutation
+  // copy before inner-loop moves an atom to end of atom list
+  // copy after inner-loop moves atom at end of list back into list
+  // empty = location in atom list that is currently empty
+
+  for (i = 0; i < n; i++) {
+    if (current[i] == permute[i]) continue;
+    copy_permuted(i,n,extraonly);
+    empty = i;
+    while (permute[empty] != i) {
+      copy_permuted(permute[empty],empty,extraonly);
+      empty = current[empty] = permute[empty];
+    }
+    copy_permuted(n,empty,extraonly);
+    current[empty] = permute[empty];
+  }
+
+  // sanity check that current = permute
+
+  //int flag = 0;
+  //for (i = 0; i < n; i++)
+  //  if (current[i] != permute[i]) flag = 1;
+  //int flagall;
+  //MPI_Allreduce(&flag,&flagall,1,MPI_INT,MPI_SUM,world);
+  //if (flagall) error->all(FLERR,"Atom sort did not operate correctly");
+}
+
+/* ---------------------------------------------------------------------- */
+
+void AtomVec::copy_permuted(int i, int j, int extraonly)
+{
+  if (!extraonly) {
+    copy(i,j,0);
+    return;
+  }
+  for (int iextra = 0; iextra < atom->nextra_grow; iextra++)
+    modify->fix[atom->extra_grow[iextra]]->copy_arrays(i,j,0);
+}
+
+/* ----------------------------------------------------------------------
+   return scratch space of at least nbytes for permute_array()
+------------------------------------------------------------------------- */
+
+void *AtomVec::grow_permutebuf(bigint nbytes)
+{
+  if (nbytes > maxpermutebuf) {
+    maxpermutebuf = nbytes;
+    permutebuf = memory->srealloc(permutebuf,maxpermutebuf,"atom:permutebuf");
+  }
+  return permutebuf;
+}
+
 /* ----------------------------------------------------------------------
    unpack one line from Velocities section of data file
 ------------------------------------------------------------------------- */
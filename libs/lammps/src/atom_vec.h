@@ -15,6 +15,7 @@
 #define LMP_ATOM_VEC_H
 
 #include <stdio.h>
+#include <string.h>
 #include "pointers.h"
 
 namespace LAMMPS_NS {
@@ -57,6 +58,7 @@ class AtomVec : protected Pointers {
   virtual void grow(int) = 0;
   virtual void grow_reset() = 0;
   virtual void copy(int, int, int) = 0;
+  virtual void permute(int, int *, int *);
   virtual void clear_bonus() {}
   virtual void force_clear(int, size_t) {}
 
@@ -144,6 +146,33 @@ class AtomVec : protected Pointers {
 
   void grow_nmax();
   int grow_nmax_bonus(int);
+
+  // bulk reordering of per-atom arrays for permute()
+
+  void *permutebuf;                     // scratch copy of one per-atom array
+  bigint maxpermutebuf;                 // allocated bytes of permutebuf
+  void *grow_permutebuf(bigint);
+  void permute_cycles(int, int *, int *, int);
+  void copy_permuted(int, int, int);
+
+  // gather n atoms of an array with stride values per atom,
+  //   new atom I = old atom permute[I]
+
+  template <class T>
+  void permute_array(T *array, int stride, int n, int *permute) {
+    if (n <= 0) return;
+    const bigint nbytes = (bigint) sizeof(T)*stride*n;
+    T *buf = (T *) grow_permutebuf(nbytes);
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < n; i++) {
+      const T *src = &array[(bigint) permute[i]*stride];
+      T *dst = &buf[(bigint) i*stride];
+      for (int k = 0; k < stride; k++) dst[k] = src[k];
+    }
+    memcpy(array,buf,nbytes);
+  }
 };
 
 }
@@ -100,6 +100,23 @@ void AtomVecAtomic::copy(int i, int j, int delflag)
       modify->fix[atom->extra_grow[iextra]]->copy_arrays(i,j,delflag);
 }
 
+/* ----------------------------------------------------------------------
+   reorder the first n local atoms, new atom I = old atom permute[I]
+   gather each array as a whole instead of one copy() per atom
+------------------------------------------------------------------------- */
+
+void AtomVecAtomic::permute(int n, int *permute, int *current)
+{
+  permute_array(tag,1,n,permute);
+  permute_array(type,1,n,permute);
+  permute_array(mask,1,n,permute);
+  permute_array(image,1,n,permute);
+  permute_array(x[0],3,n,permute);
+  permute_array(v[0],3,n,permute);
+
+  if (atom->nextra_grow) permute_cycles(n,permute,current,1);
+}
+
 /* ---------------------------------------------------------------------- */
 
 int AtomVecAtomic::pack_comm(int n, int *list, double *buf,
@@ -53,6 +53,11 @@ enum{LAYOUT_UNIFORM,LAYOUT_NONUNIFORM,LAYOUT_TILED};    // several files
 #define DELTAREGION 4
 #define BONDSTRETCH 1.1
 
+// generation counters continue where the previous Domain left off, e.g. after
+// a clear command recreated it, so a counter cached together with a pointer
+// or index by a library caller can never match a newer Domain
+static bigint last_generation = 0;
+
 /* ----------------------------------------------------------------------
    default is periodic
 ------------------------------------------------------------------------- */
@@ -103,6 +108,7 @@ Domain::Domain(LAMMPS *lmp) : Pointers(lmp)
   delete [] args;
 
   nregion = maxregion = 0;
+  region_generation = last_generation + 1;
   regions = NULL;
 
   copymode = 0;
@@ -123,6 +129,8 @@ Domain::~Domain()
 {
   if (copymode) return;
 
+  if (region_generation > last_generation) last_generation = region_generation;
+
   delete lattice;
   for (int i = 0; i < nregion; i++) delete regions[i];
   memory->sfree(regions);
@@ -1736,6 +1744,7 @@ void Domain::add_region(int narg, char **arg)
         regions[nregion] = region_creator(lmp, narg, arg);
         regions[nregion]->init();
         nregion++;
+        region_generation++;
         return;
       }
     }
@@ -1748,6 +1757,7 @@ void Domain::add_region(int narg, char **arg)
         regions[nregion] = region_creator(lmp, narg, arg);
         regions[nregion]->init();
         nregion++;
+        region_generation++;
         return;
       }
     }
@@ -1765,6 +1775,7 @@ void Domain::add_region(int narg, char **arg)
 
   regions[nregion]->init();
   nregion++;
+  region_generation++;
 }
 
 /* ----------------------------------------------------------------------
@@ -1791,6 +1802,7 @@ void Domain::delete_region(int narg, char **arg)
   delete regions[iregion];
   regions[iregion] = regions[nregion-1];
   nregion--;
+  region_generation++;
 }
 
 /* ----------------------------------------------------------------------
@@ -91,6 +91,7 @@ class Domain : protected Pointers {
   int nregion;                             // # of defined Regions
   int maxregion;                           // max # list can hold
   class Region **regions;                  // list of defined Regions
+  bigint region_generation;                // incremented whenever a Region is added/deleted
 
   int copymode;
 
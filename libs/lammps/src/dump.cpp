@@ -12,6 +12,7 @@
 ------------------------------------------------------------------------- */
 
 #include <mpi.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -39,6 +40,7 @@ Dump *Dump::dumpptr;
 
 #define BIG 1.0e20
 #define EPSILON 1.0e-6
+#define MAXCONVERT 4096
 
 enum{ASCEND,DESCEND};
 
@@ -83,8 +85,12 @@ Dump::Dump(LAMMPS *lmp, int narg, char **arg) : Pointers(lmp)
   append_flag = 0;
   buffer_allow = 0;
   buffer_flag = 0;
+  async_allow = 0;
+  async_flag = 0;
+  fastformat = 0;
   padflag = 0;
   pbcflag = 0;
+  dumpstep = 0;
 
   maxbuf = maxids = maxsort = maxproc = 0;
   buf = bufsort = NULL;
@@ -99,6 +105,18 @@ Dump::Dump(LAMMPS *lmp, int narg, char **arg) : Pointers(lmp)
   xpbc = vpbc = NULL;
   imagepbc = NULL;
 
+#if defined(LAMMPS_ASYNC_DUMP)
+  for (int i = 0; i < 2; i++) {
+    frames[i].queued = 0;
+    frames[i].nlines = NULL;
+    frames[i].maxbuf = 0;
+    frames[i].buf = NULL;
+  }
+  iframe = 0;
+  writer_active = 0;
+  writer_stop = 0;
+#endif
+
   // parse filename for special syntax
   // if contains '%', write one file per proc and replace % with proc-ID
   // if contains '*', write one file per timestep and replace * with timestep
@@ -148,6 +166,11 @@ Dump::Dump(LAMMPS *lmp, int narg, char **arg) : Pointers(lmp)
 
 Dump::~Dump()
 {
+  // write snapshots still in flight
+  // styles whose conversion uses data they own also do this in their destructor
+
+  stop_writer();
+
   delete [] id;
   delete [] style;
   delete [] filename;
@@ -196,6 +219,10 @@ Dump::~Dump()
 
 void Dump::init()
 {
+  // formats and files may be reset, so snapshots in flight are written first
+
+  wait_writer();
+
   init_style();
 
   if (!sort_flag) {
@@ -280,6 +307,10 @@ void Dump::init()
   // preallocation for PBC copies if requested
 
   if (pbcflag && atom->nlocal > maxpbc) pbc_allocate();
+
+#if defined(LAMMPS_ASYNC_DUMP)
+  if (async_flag && filewriter && !writer_active) start_writer();
+#endif
 }
 
 /* ---------------------------------------------------------------------- */
@@ -308,25 +339,29 @@ void Dump::write()
 
   if (multifile) openfile();
 
-  // simulation box bounds
-
-  if (domain->triclinic == 0) {
-    boxxlo = domain->boxlo[0];
-    boxxhi = domain->boxhi[0];
-    boxylo = domain->boxlo[1];
-    boxyhi = domain->boxhi[1];
-    boxzlo = domain->boxlo[2];
-    boxzhi = domain->boxhi[2];
-  } else {
-    boxxlo = domain->boxlo_bound[0];
-    boxxhi = domain->boxhi_bound[0];
-    boxylo = domain->boxlo_bound[1];
-    boxyhi = domain->boxhi_bound[1];
-    boxzlo = domain->boxlo_bound[2];
-    boxzhi = domain->boxhi_bound[2];
-    boxxy = domain->xy;
-    boxxz = domain->xz;
-    boxyz = domain->yz;
+  // simulation box bounds and timestep for header
+  // with async output, writer thread sets them from its frame instead
+
+  if (!async_flag) {
+    dumpstep = update->ntimestep;
+    if (domain->triclinic == 0) {
+      boxxlo = domain->boxlo[0];
+      boxxhi = domain->boxhi[0];
+      boxylo = domain->boxlo[1];
+      boxyhi = domain->boxhi[1];
+      boxzlo = domain->boxlo[2];
+      boxzhi = domain->boxhi[2];
+    } else {
+      boxxlo = domain->boxlo_bound[0];
+      boxxhi = domain->boxhi_bound[0];
+      boxylo = domain->boxlo_bound[1];
+      boxyhi = domain->boxhi_bound[1];
+      boxzlo = domain->boxlo_bound[2];
+      boxzhi = domain->boxhi_bound[2];
+      boxxy = domain->xy;
+      boxxz = domain->xz;
+      boxyz = domain->yz;
+    }
   }
 
   // nme = # of dump lines this proc contributes to dump
@@ -351,7 +386,7 @@ void Dump::write()
   if (multiproc)
     MPI_Allreduce(&bnme,&nheader,1,MPI_LMP_BIGINT,MPI_SUM,clustercomm);
 
-  if (filewriter) write_header(nheader);
+  if (filewriter && !async_flag) write_header(nheader);
 
   // insure buf is sized for packing and communicating
   // use nmax to insure filewriter proc can receive info from others
@@ -403,8 +438,9 @@ void Dump::write()
   // if buffering, convert doubles into strings
   // insure sbuf is sized for communicating
   // cannot buffer if output is to binary file
+  // with async output, writer thread converts after the gather
 
-  if (buffer_flag && !binary) {
+  if (buffer_flag && !binary && !async_flag) {
     nsme = convert_string(nme,buf);
     int nsmin,nsmax;
     MPI_Allreduce(&nsme,&nsmin,1,MPI_INT,MPI_MIN,world);
@@ -427,9 +463,11 @@ void Dump::write()
   MPI_Request request;
 
   // comm and output buf of doubles
+  // with async output, gather into a frame for the writer thread instead
 
-  if (buffer_flag == 0 || binary) {
-    if (filewriter) {
+  if (buffer_flag == 0 || binary || async_flag) {
+    if (filewriter && async_flag) gather_frame(nheader);
+    else if (filewriter) {
       for (int iproc = 0; iproc < nclusterprocs; iproc++) {
         if (iproc) {
           MPI_Irecv(buf,maxbuf*size_one,MPI_DOUBLE,me+iproc,0,world,&request);
@@ -490,6 +528,308 @@ void Dump::write()
   }
 }
 
+/* ----------------------------------------------------------------------
+   async output: gather data of my cluster into the next free frame
+   and queue it for the writer thread
+   only waits if the writer is still busy with the frame before last
+------------------------------------------------------------------------- */
+
+void Dump::gather_frame(bigint nheader)
+{
+#if defined(LAMMPS_ASYNC_DUMP)
+  Frame *frame = &frames[iframe];
+
+  pthread_mutex_lock(&writer_mutex);
+  while (frame->queued) pthread_cond_wait(&writer_cond,&writer_mutex);
+  pthread_mutex_unlock(&writer_mutex);
+
+  if (nheader*size_one > frame->maxbuf) {
+    frame->maxbuf = nheader*size_one;
+    memory->sfree(frame->buf);
+    frame->buf = (double *)
+      memory->smalloc(frame->maxbuf*sizeof(double),"dump:framebuf");
+  }
+
+  frame->ntimestep = update->ntimestep;
+  frame->nheader = nheader;
+
+  double *lo = domain->boxlo;
+  double *hi = domain->boxhi;
+  if (domain->triclinic) {
+    lo = domain->boxlo_bound;
+    hi = domain->boxhi_bound;
+  }
+  frame->box[0] = lo[0];
+  frame->box[1] = hi[0];
+  frame->box[2] = lo[1];
+  frame->box[3] = hi[1];
+  frame->box[4] = lo[2];
+  frame->box[5] = hi[2];
+  frame->box[6] = domain->xy;
+  frame->box[7] = domain->xz;
+  frame->box[8] = domain->yz;
+
+  int tmp,nlines;
+  MPI_Status status;
+  MPI_Request request;
+
+  bigint offset = 0;
+  for (int iproc = 0; iproc < nclusterprocs; iproc++) {
+    if (iproc) {
+      MPI_Irecv(buf,maxbuf*size_one,MPI_DOUBLE,me+iproc,0,world,&request);
+      MPI_Send(&tmp,0,MPI_INT,me+iproc,0,world);
+      MPI_Wait(&request,&status);
+      MPI_Get_count(&status,MPI_DOUBLE,&nlines);
+      nlines /= size_one;
+    } else nlines = nme;
+
+    if (nlines)
+      memcpy(&frame->buf[offset],buf,(bigint) nlines*size_one*sizeof(double));
+    frame->nlines[iproc] = nlines;
+    offset += (bigint) nlines*size_one;
+  }
+
+  pthread_mutex_lock(&writer_mutex);
+  frame->queued = 1;
+  pthread_cond_broadcast(&writer_cond);
+  pthread_mutex_unlock(&writer_mutex);
+
+  iframe = 1 - iframe;
+#endif
+}
+
+/* ----------------------------------------------------------------------
+   async output: block until all queued frames are written
+------------------------------------------------------------------------- */
+
+void Dump::wait_writer()
+{
+#if defined(LAMMPS_ASYNC_DUMP)
+  if (!writer_active) return;
+
+  pthread_mutex_lock(&writer_mutex);
+  while (frames[0].queued || frames[1].queued)
+    pthread_cond_wait(&writer_cond,&writer_mutex);
+  pthread_mutex_unlock(&writer_mutex);
+#endif
+}
+
+/* ----------------------------------------------------------------------
+   async output: write queued frames, then end writer thread
+------------------------------------------------------------------------- */
+
+void Dump::stop_writer()
+{
+#if defined(LAMMPS_ASYNC_DUMP)
+  if (!writer_active) return;
+
+  pthread_mutex_lock(&writer_mutex);
+  writer_stop = 1;
+  pthread_cond_broadcast(&writer_cond);
+  pthread_mutex_unlock(&writer_mutex);
+
+  pthread_join(writer,NULL);
+  pthread_mutex_destroy(&writer_mutex);
+  pthread_cond_destroy(&writer_cond);
+  writer_active = 0;
+
+  for (int i = 0; i < 2; i++) {
+    delete [] frames[i].nlines;
+    memory->sfree(frames[i].buf);
+    frames[i].nlines = NULL;
+    frames[i].buf = NULL;
+    frames[i].maxbuf = 0;
+  }
+#endif
+}
+
+#if defined(LAMMPS_ASYNC_DUMP)
+
+/* ----------------------------------------------------------------------
+   async output: launch writer thread on a filewriter proc
+------------------------------------------------------------------------- */
+
+void Dump::start_writer()
+{
+  for (int i = 0; i < 2; i++) {
+    frames[i].queued = 0;
+    frames[i].nlines = new int[nclusterprocs];
+  }
+  iframe = 0;
+  writer_stop = 0;
+
+  pthread_mutex_init(&writer_mutex,NULL);
+  pthread_cond_init(&writer_cond,NULL);
+  pthread_create(&writer,NULL,&Dump::writer_loop,this);
+  writer_active = 1;
+}
+
+/* ----------------------------------------------------------------------
+   async output: body of writer thread
+   frames are taken in the order the main thread fills them
+------------------------------------------------------------------------- */
+
+void *Dump::writer_loop(void *ptr)
+{
+  Dump *dump = (Dump *) ptr;
+  int iwrite = 0;
+
+  pthread_mutex_lock(&dump->writer_mutex);
+  while (1) {
+    Frame *frame = &dump->frames[iwrite];
+    while (!frame->queued && !dump->writer_stop)
+      pthread_cond_wait(&dump->writer_cond,&dump->writer_mutex);
+    if (!frame->queued) break;
+    pthread_mutex_unlock(&dump->writer_mutex);
+
+    dump->write_frame(frame);
+
+    pthread_mutex_lock(&dump->writer_mutex);
+    frame->queued = 0;
+    pthread_cond_broadcast(&dump->writer_cond);
+    iwrite = 1 - iwrite;
+  }
+  pthread_mutex_unlock(&dump->writer_mutex);
+
+  return NULL;
+}
+
+/* ----------------------------------------------------------------------
+   async output: write one frame, called by writer thread
+   header uses box and timestep stored with the frame
+   text is converted in slices of MAXCONVERT lines so sbuf stays small
+------------------------------------------------------------------------- */
+
+void Dump::write_frame(Frame *frame)
+{
+  dumpstep = frame->ntimestep;
+  boxxlo = frame->box[0];
+  boxxhi = frame->box[1];
+  boxylo = frame->box[2];
+  boxyhi = frame->box[3];
+  boxzlo = frame->box[4];
+  boxzhi = frame->box[5];
+  boxxy = frame->box[6];
+  boxxz = frame->box[7];
+  boxyz = frame->box[8];
+
+  write_header(frame->nheader);
+
+  double *mybuf = frame->buf;
+  for (int iproc = 0; iproc < nclusterprocs; iproc++) {
+    int nlines = frame->nlines[iproc];
+    if (buffer_flag && !binary) {
+      for (int i = 0; i < nlines; i += MAXCONVERT) {
+        int n = MIN(MAXCONVERT,nlines-i);
+        int nchars = convert_string(n,&mybuf[(bigint) i*size_one]);
+        write_data(nchars,(double *) sbuf);
+      }
+    } else write_data(nlines,mybuf);
+    mybuf += (bigint) nlines*size_one;
+  }
+
+  if (flush_flag && fp) fflush(fp);
+}
+
+#endif
+
+/* ----------------------------------------------------------------------
+   fast replacements for sprintf() of an integer with "%d" and
+   a double with "%g" when a dump uses its default format
+   write to str, return ptr to end of string, no trailing NULL
+   fmt_g() falls back to sprintf() outside 1e-5 to 1e15 and
+     when rounding to 6 digits is too close to call
+------------------------------------------------------------------------- */
+
+char *Dump::fmt_int(char *str, bigint value)
+{
+  char digits[24];
+  int n = 0;
+
+  if (value < 0) *str++ = '-';
+  uint64_t uvalue = value < 0 ? -(uint64_t) value : (uint64_t) value;
+  do {
+    digits[n++] = '0' + uvalue % 10;
+    uvalue /= 10;
+  } while (uvalue);
+  while (n) *str++ = digits[--n];
+
+  return str;
+}
+
+/* ---------------------------------------------------------------------- */
+
+char *Dump::fmt_g(char *str, double value)
+{
+  static const double powers[] =
+    {1.0e0,1.0e1,1.0e2,1.0e3,1.0e4,1.0e5,1.0e6,1.0e7,1.0e8,1.0e9,1.0e10};
+
+  double avalue = fabs(value);
+  if (!(avalue >= 1.0e-5 && avalue < 1.0e15))
+    return str + sprintf(str,"%g",value);
+
+  // exponent e with 10^e <= avalue < 10^(e+1)
+  // mantissa = avalue scaled to 6 digits, 10^5 <= mantissa < 10^6
+
+  int e = static_cast<int> (floor(log10(avalue)));
+  e = MAX(e,-5);
+  e = MIN(e,14);
+  double mantissa;
+  if (e <= 5) mantissa = avalue * powers[5-e];
+  else mantissa = avalue / powers[e-5];
+  if (mantissa < 1.0e5) {
+    e--;
+    mantissa *= 10.0;
+  } else if (mantissa >= 1.0e6) {
+    e++;
+    mantissa *= 0.1;
+  }
+
+  int m = static_cast<int> (mantissa);
+  double frac = mantissa - m;
+  if (fabs(frac-0.5) < 1.0e-6) return str + sprintf(str,"%g",value);
+  if (frac > 0.5 && ++m == 1000000) {
+    m = 100000;
+    e++;
+  }
+
+  char digits[6];
+  for (int i = 5; i >= 0; i--) {
+    digits[i] = '0' + m % 10;
+    m /= 10;
+  }
+  int ndigits = 6;
+  while (ndigits > 1 && digits[ndigits-1] == '0') ndigits--;
+
+  if (value < 0.0) *str++ = '-';
+
+  if (e < -4 || e >= 6) {
+    *str++ = digits[0];
+    if (ndigits > 1) {
+      *str++ = '.';
+      for (int i = 1; i < ndigits; i++) *str++ = digits[i];
+    }
+    *str++ = 'e';
+    *str++ = e < 0 ? '-' : '+';
+    if (e < 0) e = -e;
+    *str++ = '0' + e/10;
+    *str++ = '0' + e%10;
+  } else if (e >= 0) {
+    for (int i = 0; i <= e; i++) *str++ = digits[i];
+    if (ndigits > e+1) {
+      *str++ = '.';
+      for (int i = e+1; i < ndigits; i++) *str++ = digits[i];
+    }
+  } else {
+    *str++ = '0';
+    *str++ = '.';
+    for (int i = 0; i < -e-1; i++) *str++ = '0';
+    for (int i = 0; i < ndigits; i++) *str++ = digits[i];
+  }
+
+  return str;
+}
+
 /* ----------------------------------------------------------------------
    generic opening of a dump file
    ASCII or binary or gzipped
@@ -858,6 +1198,10 @@ void Dump::modify_params(int narg, char **arg)
 {
   if (narg == 0) error->all(FLERR,"Illegal dump_modify command");
 
+  // settings may be in use by the async writer, let it finish first
+
+  wait_writer();
+
   int iarg = 0;
   while (iarg < narg) {
     if (strcmp(arg[iarg],"append") == 0) {
@@ -867,6 +1211,24 @@ void Dump::modify_params(int narg, char **arg)
       else error->all(FLERR,"Illegal dump_modify command");
       iarg += 2;
 
+    } else if (strcmp(arg[iarg],"async") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal dump_modify command");
+      if (strcmp(arg[iarg+1],"yes") == 0) async_flag = 1;
+      else if (strcmp(arg[iarg+1],"no") == 0) async_flag = 0;
+      else error->all(FLERR,"Illegal dump_modify command");
+      if (async_flag && async_allow == 0)
+        error->all(FLERR,"Dump_modify async yes not allowed for this style");
+      if (async_flag && multifile)
+        error->all(FLERR,
+                   "Dump_modify async yes not allowed with * in dump file name");
+#if !defined(LAMMPS_ASYNC_DUMP)
+      if (async_flag)
+        error->all(FLERR,"Dump_modify async yes requires "
+                   "LAMMPS built with -DLAMMPS_ASYNC_DUMP");
+#endif
+      if (!async_flag) stop_writer();
+      iarg += 2;
+
     } else if (strcmp(arg[iarg],"buffer") == 0) {
       if (iarg+2 > narg) error->all(FLERR,"Illegal dump_modify command");
       if (strcmp(arg[iarg+1],"yes") == 0) buffer_flag = 1;
@@ -1079,5 +1441,8 @@ bigint Dump::memory_usage()
     bytes += 6*maxpbc * sizeof(double);
     bytes += maxpbc * sizeof(imageint);
   }
+#if defined(LAMMPS_ASYNC_DUMP)
+  bytes += (frames[0].maxbuf + frames[1].maxbuf) * sizeof(double);
+#endif
   return bytes;
 }
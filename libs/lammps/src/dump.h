@@ -18,6 +18,10 @@
 #include <stdio.h>
 #include "pointers.h"
 
+#if defined(LAMMPS_ASYNC_DUMP)
+#include <pthread.h>
+#endif
+
 namespace LAMMPS_NS {
 
 class Dump : protected Pointers {
@@ -50,6 +54,7 @@ class Dump : protected Pointers {
 
   void modify_params(int, char **);
   virtual bigint memory_usage();
+  void wait_writer();        // block until async snapshots are written
 
  protected:
   int me,nprocs;             // proc info
@@ -71,6 +76,9 @@ class Dump : protected Pointers {
   int append_flag;           // 1 if open file in append mode, 0 if not
   int buffer_allow;          // 1 if style allows for buffer_flag, 0 if not
   int buffer_flag;           // 1 if buffer output as one big string, 0 if not
+  int async_allow;           // 1 if style allows for async_flag, 0 if not
+  int async_flag;            // 1 if a thread formats and writes snapshots
+  int fastformat;            // 1 if default format, converted w/out sprintf
   int padflag;               // timestep padding in filename
   int pbcflag;               // 1 if remap dumped atoms via PBC, 0 if not
   int singlefile_opened;     // 1 = one big file, already opened, else 0
@@ -98,6 +106,7 @@ class Dump : protected Pointers {
   double boxylo,boxyhi;      // lo/hi are bounding box for triclinic
   double boxzlo,boxzhi;
   double boxxy,boxxz,boxyz;
+  bigint dumpstep;           // timestep of snapshot in header
 
   bigint ntotal;             // total # of per-atom lines in snapshot
   int reorderflag;           // 1 if OK to reorder instead of sort
@@ -124,6 +133,30 @@ class Dump : protected Pointers {
 
   class Irregular *irregular;
 
+#if defined(LAMMPS_ASYNC_DUMP)
+  struct Frame {             // snapshot handed to the writer thread
+    int queued;              // 1 if waiting for or being written, 0 if free
+    bigint ntimestep;        // timestep of snapshot
+    bigint nheader;          // # of lines in snapshot
+    double box[9];           // box bounds and tilt factors
+    int *nlines;             // # of lines from each proc in my cluster
+    bigint maxbuf;           // size of buf
+    double *buf;             // per-atom quantities of all procs in cluster
+  };
+
+  Frame frames[2];           // double buffer, one filled while other written
+  int iframe;                // frame the next snapshot is stored in
+  int writer_active;         // 1 if writer thread is running
+  int writer_stop;           // 1 if writer thread should exit when idle
+  pthread_t writer;
+  pthread_mutex_t writer_mutex;
+  pthread_cond_t writer_cond;
+
+  void start_writer();
+  void write_frame(Frame *);
+  static void *writer_loop(void *);
+#endif
+
   virtual void init_style() = 0;
   virtual void openfile();
   virtual int modify_param(int, char **) {return 0;}
@@ -133,6 +166,10 @@ class Dump : protected Pointers {
   virtual int convert_string(int, double *) {return 0;}
   virtual void write_data(int, double *) = 0;
   void pbc_allocate();
+  void gather_frame(bigint);
+  void stop_writer();
+  static char *fmt_int(char *, bigint);
+  static char *fmt_g(char *, double);
 
   void sort();
 #if defined(LMP_QSORT)
@@ -203,6 +240,20 @@ E: Dump_modify buffer yes not allowed for this style
 
 Self-explanatory.
 
+E: Dump_modify async yes not allowed for this style
+
+Self-explanatory.
+
+E: Dump_modify async yes not allowed with * in dump file name
+
+Each snapshot is written to its own file, which is opened and closed
+by the main thread.
+
+E: Dump_modify async yes requires LAMMPS built with -DLAMMPS_ASYNC_DUMP
+
+The asynchronous writer uses a POSIX thread, which is only compiled
+in when LAMMPS is built with this setting.
+
 E: Cannot use dump_modify fileper without % in dump file name
 
 Self-explanatory.
@@ -36,6 +36,19 @@ DumpAtom::DumpAtom(LAMMPS *lmp, int narg, char **arg) : Dump(lmp, narg, arg)
   buffer_allow = 1;
   buffer_flag = 1;
   format_default = NULL;
+
+  // derived styles write headers and data their own way
+
+  async_allow = (strcmp(style,"atom") == 0);
+}
+
+/* ---------------------------------------------------------------------- */
+
+DumpAtom::~DumpAtom()
+{
+  // async writer calls the header and data functions of this class, finish it first
+
+  stop_writer();
 }
 
 /* ---------------------------------------------------------------------- */
@@ -49,6 +62,7 @@ void DumpAtom::init_style()
   // default depends on image flags
 
   delete [] format;
+  fastformat = (format_line_user == NULL);
   if (format_line_user) {
     int n = strlen(format_line_user) + 2;
     format = new char[n];
@@ -169,7 +183,7 @@ void DumpAtom::write_data(int n, double *mybuf)
 
 void DumpAtom::header_binary(bigint ndump)
 {
-  fwrite(&update->ntimestep,sizeof(bigint),1,fp);
+  fwrite(&dumpstep,sizeof(bigint),1,fp);
   fwrite(&ndump,sizeof(bigint),1,fp);
   fwrite(&domain->triclinic,sizeof(int),1,fp);
   fwrite(&domain->boundary[0][0],6*sizeof(int),1,fp);
@@ -188,7 +202,7 @@ void DumpAtom::header_binary(bigint ndump)
 
 void DumpAtom::header_binary_triclinic(bigint ndump)
 {
-  fwrite(&update->ntimestep,sizeof(bigint),1,fp);
+  fwrite(&dumpstep,sizeof(bigint),1,fp);
   fwrite(&ndump,sizeof(bigint),1,fp);
   fwrite(&domain->triclinic,sizeof(int),1,fp);
   fwrite(&domain->boundary[0][0],6*sizeof(int),1,fp);
@@ -211,7 +225,7 @@ void DumpAtom::header_binary_triclinic(bigint ndump)
 void DumpAtom::header_item(bigint ndump)
 {
   fprintf(fp,"ITEM: TIMESTEP\n");
-  fprintf(fp,BIGINT_FORMAT "\n",update->ntimestep);
+  fprintf(fp,BIGINT_FORMAT "\n",dumpstep);
   fprintf(fp,"ITEM: NUMBER OF ATOMS\n");
   fprintf(fp,BIGINT_FORMAT "\n",ndump);
   fprintf(fp,"ITEM: BOX BOUNDS %s\n",boundstr);
@@ -226,7 +240,7 @@ void DumpAtom::header_item(bigint ndump)
 void DumpAtom::header_item_triclinic(bigint ndump)
 {
   fprintf(fp,"ITEM: TIMESTEP\n");
-  fprintf(fp,BIGINT_FORMAT "\n",update->ntimestep);
+  fprintf(fp,BIGINT_FORMAT "\n",dumpstep);
   fprintf(fp,"ITEM: NUMBER OF ATOMS\n");
   fprintf(fp,BIGINT_FORMAT "\n",ndump);
   fprintf(fp,"ITEM: BOX BOUNDS xy xz yz %s\n",boundstr);
@@ -252,15 +266,16 @@ void DumpAtom::pack_scale_image(tagint *ids)
   double invxprd = 1.0/domain->xprd;
   double invyprd = 1.0/domain->yprd;
   double invzprd = 1.0/domain->zprd;
+  double *boxlo = domain->boxlo;
 
   m = n = 00;
   for (int i = 0; i < nlocal; i++)
     if (mask[i] & groupbit) {
       buf[m++] = tag[i];
       buf[m++] = type[i];
-      buf[m++] = (x[i][0] - boxxlo) * invxprd;
-      buf[m++] = (x[i][1] - boxylo) * invyprd;
-      buf[m++] = (x[i][2] - boxzlo) * invzprd;
+      buf[m++] = (x[i][0] - boxlo[0]) * invxprd;
+      buf[m++] = (x[i][1] - boxlo[1]) * invyprd;
+      buf[m++] = (x[i][2] - boxlo[2]) * invzprd;
       buf[m++] = (image[i] & IMGMASK) - IMGMAX;
       buf[m++] = (image[i] >> IMGBITS & IMGMASK) - IMGMAX;
       buf[m++] = (image[i] >> IMG2BITS) - IMGMAX;
@@ -283,15 +298,16 @@ void DumpAtom::pack_scale_noimage(tagint *ids)
   double invxprd = 1.0/domain->xprd;
   double invyprd = 1.0/domain->yprd;
   double invzprd = 1.0/domain->zprd;
+  double *boxlo = domain->boxlo;
 
   m = n = 0;
   for (int i = 0; i < nlocal; i++)
     if (mask[i] & groupbit) {
       buf[m++] = tag[i];
       buf[m++] = type[i];
-      buf[m++] = (x[i][0] - boxxlo) * invxprd;
-      buf[m++] = (x[i][1] - boxylo) * invyprd;
-      buf[m++] = (x[i][2] - boxzlo) * invzprd;
+      buf[m++] = (x[i][0] - boxlo[0]) * invxprd;
+      buf[m++] = (x[i][1] - boxlo[1]) * invyprd;
+      buf[m++] = (x[i][2] - boxlo[2]) * invzprd;
       if (ids) ids[n++] = tag[i];
     }
 }
@@ -422,13 +438,29 @@ int DumpAtom::convert_image(int n, double *mybuf)
       memory->grow(sbuf,maxsbuf,"dump:sbuf");
     }
 
-    offset += sprintf(&sbuf[offset],format,
-                      static_cast<tagint> (mybuf[m]),
-                      static_cast<int> (mybuf[m+1]),
-                      mybuf[m+2],mybuf[m+3],mybuf[m+4],
-                      static_cast<int> (mybuf[m+5]),
-                      static_cast<int> (mybuf[m+6]),
-                      static_cast<int> (mybuf[m+7]));
+    if (fastformat) {
+      char *str = &sbuf[offset];
+      str = fmt_int(str,static_cast<tagint> (mybuf[m]));
+      *str++ = ' ';
+      str = fmt_int(str,static_cast<int> (mybuf[m+1]));
+      for (int j = 2; j < 5; j++) {
+        *str++ = ' ';
+        str = fmt_g(str,mybuf[m+j]);
+      }
+      for (int j = 5; j < 8; j++) {
+        *str++ = ' ';
+        str = fmt_int(str,static_cast<int> (mybuf[m+j]));
+      }
+      *str++ = '\n';
+      offset = str - sbuf;
+    } else
+      offset += sprintf(&sbuf[offset],format,
+                        static_cast<tagint> (mybuf[m]),
+                        static_cast<int> (mybuf[m+1]),
+                        mybuf[m+2],mybuf[m+3],mybuf[m+4],
+                        static_cast<int> (mybuf[m+5]),
+                        static_cast<int> (mybuf[m+6]),
+                        static_cast<int> (mybuf[m+7]));
     m += size_one;
   }
 
@@ -448,10 +480,22 @@ int DumpAtom::convert_noimage(int n, double *mybuf)
       memory->grow(sbuf,maxsbuf,"dump:sbuf");
     }
 
-    offset += sprintf(&sbuf[offset],format,
-                      static_cast<tagint> (mybuf[m]),
-                      static_cast<int> (mybuf[m+1]),
-                      mybuf[m+2],mybuf[m+3],mybuf[m+4]);
+    if (fastformat) {
+      char *str = &sbuf[offset];
+      str = fmt_int(str,static_cast<tagint> (mybuf[m]));
+      *str++ = ' ';
+      str = fmt_int(str,static_cast<int> (mybuf[m+1]));
+      for (int j = 2; j < 5; j++) {
+        *str++ = ' ';
+        str = fmt_g(str,mybuf[m+j]);
+      }
+      *str++ = '\n';
+      offset = str - sbuf;
+    } else
+      offset += sprintf(&sbuf[offset],format,
+                        static_cast<tagint> (mybuf[m]),
+                        static_cast<int> (mybuf[m+1]),
+                        mybuf[m+2],mybuf[m+3],mybuf[m+4]);
     m += size_one;
   }
 
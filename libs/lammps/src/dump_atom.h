@@ -27,6 +27,7 @@ namespace LAMMPS_NS {
 class DumpAtom : public Dump {
  public:
   DumpAtom(LAMMPS *, int, char**);
+  virtual ~DumpAtom();
 
  protected:
   int scale_flag;            // 1 if atom coords are scaled, 0 if no
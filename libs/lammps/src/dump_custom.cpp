@@ -87,6 +87,7 @@ DumpCustom::DumpCustom(LAMMPS *lmp, int narg, char **arg) :
 
   buffer_allow = 1;
   buffer_flag = 1;
+  async_allow = (strcmp(style,"custom") == 0);
   iregion = -1;
   idregion = NULL;
 
@@ -190,6 +191,10 @@ DumpCustom::DumpCustom(LAMMPS *lmp, int narg, char **arg) :
 
 DumpCustom::~DumpCustom()
 {
+  // async writer converts with vformat and typenames, finish it first
+
+  stop_writer();
+
   // if wildcard expansion occurred, free earg memory from expand_args()
   // could not do in constructor, b/c some derived classes process earg
 
@@ -276,6 +281,9 @@ void DumpCustom::init_style()
   // if user-specified int/float format exists, use it instead
   // if user-specified column format exists, use it instead
   // lo priority = line, medium priority = int/float, hi priority = column
+  // fastformat = 1 if no user-specified format is used
+
+  fastformat = (format_line_user == NULL);
 
   char *ptr;
   for (int i = 0; i < size_one; i++) {
@@ -285,15 +293,19 @@ void DumpCustom::init_style()
     delete [] vformat[i];
 
     if (format_column_user[i]) {
+      fastformat = 0;
       vformat[i] = new char[strlen(format_column_user[i]) + 2];
       strcpy(vformat[i],format_column_user[i]);
     } else if (vtype[i] == INT && format_int_user) {
+      fastformat = 0;
       vformat[i] = new char[strlen(format_int_user) + 2];
       strcpy(vformat[i],format_int_user);
     } else if (vtype[i] == DOUBLE && format_float_user) {
+      fastformat = 0;
       vformat[i] = new char[strlen(format_float_user) + 2];
       strcpy(vformat[i],format_float_user);
     } else if (vtype[i] == BIGINT && format_bigint_user) {
+      fastformat = 0;
       vformat[i] = new char[strlen(format_bigint_user) + 2];
       strcpy(vformat[i],format_bigint_user);
     } else {
@@ -382,7 +394,7 @@ void DumpCustom::write_header(bigint ndump)
 
 void DumpCustom::header_binary(bigint ndump)
 {
-  fwrite(&update->ntimestep,sizeof(bigint),1,fp);
+  fwrite(&dumpstep,sizeof(bigint),1,fp);
   fwrite(&ndump,sizeof(bigint),1,fp);
   fwrite(&domain->triclinic,sizeof(int),1,fp);
   fwrite(&domain->boundary[0][0],6*sizeof(int),1,fp);
@@ -401,7 +413,7 @@ void DumpCustom::header_binary(bigint ndump)
 
 void DumpCustom::header_binary_triclinic(bigint ndump)
 {
-  fwrite(&update->ntimestep,sizeof(bigint),1,fp);
+  fwrite(&dumpstep,sizeof(bigint),1,fp);
   fwrite(&ndump,sizeof(bigint),1,fp);
   fwrite(&domain->triclinic,sizeof(int),1,fp);
   fwrite(&domain->boundary[0][0],6*sizeof(int),1,fp);
@@ -424,7 +436,7 @@ void DumpCustom::header_binary_triclinic(bigint ndump)
 void DumpCustom::header_item(bigint ndump)
 {
   fprintf(fp,"ITEM: TIMESTEP\n");
-  fprintf(fp,BIGINT_FORMAT "\n",update->ntimestep);
+  fprintf(fp,BIGINT_FORMAT "\n",dumpstep);
   fprintf(fp,"ITEM: NUMBER OF ATOMS\n");
   fprintf(fp,BIGINT_FORMAT "\n",ndump);
   fprintf(fp,"ITEM: BOX BOUNDS %s\n",boundstr);
@@ -439,7 +451,7 @@ void DumpCustom::header_item(bigint ndump)
 void DumpCustom::header_item_triclinic(bigint ndump)
 {
   fprintf(fp,"ITEM: TIMESTEP\n");
-  fprintf(fp,BIGINT_FORMAT "\n",update->ntimestep);
+  fprintf(fp,BIGINT_FORMAT "\n",dumpstep);
   fprintf(fp,"ITEM: NUMBER OF ATOMS\n");
   fprintf(fp,BIGINT_FORMAT "\n",ndump);
   fprintf(fp,"ITEM: BOX BOUNDS xy xz yz %s\n",boundstr);
@@ -1086,6 +1098,24 @@ int DumpCustom::convert_string(int n, double *mybuf)
       memory->grow(sbuf,maxsbuf,"dump:sbuf");
     }
 
+    if (fastformat) {
+      char *str = &sbuf[offset];
+      for (j = 0; j < size_one; j++) {
+        if (vtype[j] == INT) str = fmt_int(str,static_cast<int> (mybuf[m]));
+        else if (vtype[j] == DOUBLE) str = fmt_g(str,mybuf[m]);
+        else if (vtype[j] == STRING) {
+          const char *name = typenames[(int) mybuf[m]];
+          while (*name) *str++ = *name++;
+        } else if (vtype[j] == BIGINT)
+          str = fmt_int(str,static_cast<bigint> (mybuf[m]));
+        *str++ = ' ';
+        m++;
+      }
+      *str++ = '\n';
+      offset = str - sbuf;
+      continue;
+    }
+
     for (j = 0; j < size_one; j++) {
       if (vtype[j] == INT)
         offset += sprintf(&sbuf[offset],vformat[j],static_cast<int> (mybuf[m]));
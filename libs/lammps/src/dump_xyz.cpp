@@ -36,6 +36,7 @@ DumpXYZ::DumpXYZ(LAMMPS *lmp, int narg, char **arg) : Dump(lmp, narg, arg),
 
   buffer_allow = 1;
   buffer_flag = 1;
+  async_allow = (strcmp(style,"xyz") == 0);
   sort_flag = 1;
   sortcol = 0;
 
@@ -54,6 +55,10 @@ DumpXYZ::DumpXYZ(LAMMPS *lmp, int narg, char **arg) : Dump(lmp, narg, arg),
 
 DumpXYZ::~DumpXYZ()
 {
+  // async writer converts with typenames, finish it first
+
+  stop_writer();
+
   delete[] format_default;
   format_default = NULL;
 
@@ -72,6 +77,7 @@ void DumpXYZ::init_style()
   // format = copy of default or user-specified line format
 
   delete [] format;
+  fastformat = (format_line_user == NULL);
   char *str;
   if (format_line_user) str = format_line_user;
   else str = format_default;
@@ -137,7 +143,7 @@ void DumpXYZ::write_header(bigint n)
 {
   if (me == 0) {
     fprintf(fp,BIGINT_FORMAT "\n",n);
-    fprintf(fp,"Atoms. Timestep: " BIGINT_FORMAT "\n",update->ntimestep);
+    fprintf(fp,"Atoms. Timestep: " BIGINT_FORMAT "\n",dumpstep);
   }
 }
 
@@ -182,9 +188,22 @@ int DumpXYZ::convert_string(int n, double *mybuf)
       memory->grow(sbuf,maxsbuf,"dump:sbuf");
     }
 
-    offset += sprintf(&sbuf[offset],format,
-                      typenames[static_cast<int> (mybuf[m+1])],
-                      mybuf[m+2],mybuf[m+3],mybuf[m+4]);
+    if (fastformat) {
+      char *str = &sbuf[offset];
+      const char *name = typenames[static_cast<int> (mybuf[m+1])];
+      while (*name) *str++ = *name++;
+      *str++ = ' ';
+      str = fmt_g(str,mybuf[m+2]);
+      *str++ = ' ';
+      str = fmt_g(str,mybuf[m+3]);
+      *str++ = ' ';
+      str = fmt_g(str,mybuf[m+4]);
+      *str++ = '\n';
+      offset = str - sbuf;
+    } else
+      offset += sprintf(&sbuf[offset],format,
+                        typenames[static_cast<int> (mybuf[m+1])],
+                        mybuf[m+2],mybuf[m+3],mybuf[m+4]);
     m += size_one;
   }
 
@@ -81,6 +81,10 @@ void Finish::end(int flag)
   bigint nblocal = atom->nlocal;
   MPI_Allreduce(&nblocal,&atom->natoms,1,MPI_LMP_BIGINT,MPI_SUM,world);
 
+  // last snapshots of async dumps are on disk before the run returns
+
+  output->wait_dumps();
+
   // choose flavors of statistical output
   // flag determines caller
   // flag = 0 = just loop summary
@@ -17,9 +17,6 @@
 #include "fix_atomify.h"
 #include "atom.h"
 #include "comm.h"
-#include "neighbor.h"
-#include "neigh_request.h"
-#include "neigh_list.h"
 #include "memory.h"
 #include "compute.h"
 #include "modify.h"
@@ -35,10 +32,11 @@ using namespace FixConst;
 
 FixAtomify::FixAtomify(LAMMPS *lmp, int narg, char **arg)
     : Fix(lmp, narg, arg)
-    , list(NULL)
     , callback(NULL)
     , ptr_caller(NULL)
-    , build_neighborlist(false)
+    , tally_policy(TALLY_EVERY_STEP)
+    , tally_next_step(false)
+    , forced_tallies(0)
 {
 }
 
@@ -62,18 +60,9 @@ void FixAtomify::init()
 {
     if (callback == NULL)
         error->all(FLERR,"Fix atomify callback function not set");
-    int irequest = neighbor->request(this,instance_me);
-    neighbor->requests[irequest]->pair = 0;
-    neighbor->requests[irequest]->fix = 1;
-    neighbor->requests[irequest]->occasional = 1;
-    neighbor->requests[irequest]->half = 1;
-    neighbor->requests[irequest]->full = 0;
 }
 
-void FixAtomify::init_list(int id, NeighList *ptr)
-{
-  list = ptr;
-}
+/* ---------------------------------------------------------------------- */
 
 void FixAtomify::lost_atoms()
 {
@@ -102,19 +91,22 @@ void FixAtomify::update_compute(const char computeId[])
 
 void FixAtomify::update_computes()
 {
+    if(tally_policy == TALLY_REQUESTED && !tally_next_step) return;
+    tally_next_step = false;
+
+    bool forced = false;
     for(int i=0; i<modify->ncompute; i++) {
         Compute *compute = modify->compute[i];
         if(compute->peatomflag || compute->peflag || compute->pressatomflag || compute->pressflag) {
             compute->addstep(update->ntimestep+1);
+            forced = true;
         }
     }
+    if(forced) forced_tallies++;
 }
 
 void FixAtomify::end_of_step()
 {
-    if(build_neighborlist) {
-        neighbor->build_one(list);
-    }
     lost_atoms();
     (this->callback)(ptr_caller,END_OF_STEP);
     update_computes();
@@ -124,11 +116,9 @@ void FixAtomify::end_of_step()
 
 void FixAtomify::min_post_force(int vflag)
 {
-    if(build_neighborlist) {
-        neighbor->build_one(list);
-    }
     lost_atoms();
     (this->callback)(ptr_caller,MIN_POST_FORCE);
+    update_computes();
 }
 
 /* ---------------------------------------------------------------------- */
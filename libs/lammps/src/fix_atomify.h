@@ -35,15 +35,18 @@ class FixAtomify : public Fix {
   void min_post_force(int);
   void update_compute(const char computeId[]);
   void update_computes();
-  void init_list(int, class NeighList *);
 
   typedef void (*FnPtr)(void *, int);
   void set_callback(FnPtr, void *);
   
-  class NeighList *list; // half neighbor list
   FnPtr callback;
   void *ptr_caller;
-  bool build_neighborlist;
+
+  // Energy/virial tallies on the next step: always, or only when the callback sets tally_next_step
+  enum { TALLY_EVERY_STEP, TALLY_REQUESTED };
+  int tally_policy;
+  bool tally_next_step;
+  bigint forced_tallies; // steps this fix requested a tally on
 };
 
 }
@@ -45,6 +45,11 @@ enum{LT,LE,GT,GE,EQ,NEQ,BETWEEN};
 
 #define BIG 1.0e20
 
+// generation counters continue where the previous Group left off, e.g. after
+// a clear command recreated it, so a counter cached together with a pointer
+// or index by a library caller can never match a newer Group
+static bigint last_generation = 0;
+
 /* ----------------------------------------------------------------------
    initialize group memory
 ------------------------------------------------------------------------- */
@@ -70,6 +75,7 @@ Group::Group(LAMMPS *lmp) : Pointers(lmp)
   names[0] = new char[n];
   strcpy(names[0],str);
   ngroup = 1;
+  generation = last_generation + 1;
 }
 
 /* ----------------------------------------------------------------------
@@ -78,6 +84,7 @@ Group::Group(LAMMPS *lmp) : Pointers(lmp)
 
 Group::~Group()
 {
+  if (generation > last_generation) last_generation = generation;
   for (int i = 0; i < MAX_GROUP; i++) delete [] names[i];
   delete [] names;
   delete [] bitmask;
@@ -134,6 +141,7 @@ void Group::assign(int narg, char **arg)
     names[igroup] = NULL;
     dynamic[igroup] = 0;
     ngroup--;
+    generation++;
 
     return;
   }
@@ -165,6 +173,7 @@ void Group::assign(int narg, char **arg)
     names[igroup] = new char[n];
     strcpy(names[igroup],arg[0]);
     ngroup++;
+    generation++;
   }
 
   double **x = atom->x;
@@ -563,6 +572,7 @@ void Group::create(char *name, int *flag)
     names[igroup] = new char[n];
     strcpy(names[igroup],name);
     ngroup++;
+    generation++;
   }
 
   // add atoms to group whose flags are set
@@ -602,6 +612,7 @@ int Group::find_or_create(const char *name)
   names[igroup] = new char[n];
   strcpy(names[igroup],name);
   ngroup++;
+  generation++;
 
   return igroup;
 }
@@ -720,6 +731,7 @@ void Group::read_restart(FILE *fp)
   // atom masks will be overwritten by reading of restart file
 
   for (i = 0; i < MAX_GROUP; i++) delete [] names[i];
+  generation++;
 
   if (me == 0) fread(&ngroup,sizeof(int),1,fp);
   MPI_Bcast(&ngroup,1,MPI_INT,0,world);
@@ -27,6 +27,7 @@ class Group : protected Pointers {
   int *bitmask;                // one-bit mask for each group
   int *inversemask;            // inverse mask for each group
   int *dynamic;                // 1 if dynamic, 0 if not
+  bigint generation;           // incremented whenever a group is added/deleted
 
   Group(class LAMMPS *);
   ~Group();
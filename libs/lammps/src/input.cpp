@@ -881,6 +881,7 @@ void Input::clear()
   int fix_atomify_idx = lmp->modify->find_fix("atomify");
   FixAtomify::FnPtr callback = NULL;
   void *ptr_caller = NULL;
+  int tally_policy = FixAtomify::TALLY_EVERY_STEP;
   bool atomifyMode = fix_atomify_idx >= 0;
   // If atomify mode is activated, we need to readd the fix after clearing.
   // Store the pointer to LammpsController and the callback
@@ -888,18 +889,25 @@ void Input::clear()
     FixAtomify *fix = dynamic_cast<FixAtomify *>(lmp->modify->fix[fix_atomify_idx]);
     callback = fix->callback;
     ptr_caller = fix->ptr_caller;
+    tally_policy = fix->tally_policy;
   }
 
   lmp->destroy();
   lmp->create();
   lmp->post_create();
 
+  // variables survive a clear, but their compiled programs point into the old
+  // computes, fixes and thermo output
+
+  variable->invalidate_programs();
+
   if(atomifyMode) {
     one("fix atomify all atomify");
     fix_atomify_idx = lmp->modify->find_fix("atomify");
     if(fix_atomify_idx >= 0) {
       FixAtomify *fix = dynamic_cast<FixAtomify *>(lmp->modify->fix[fix_atomify_idx]);
       fix->set_callback(callback, ptr_caller);
+      fix->tally_policy = tally_policy;
     } else {
       error->all(FLERR,"Could not readd fix atomify during clear.");
     }
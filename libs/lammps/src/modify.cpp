@@ -36,11 +36,17 @@ using namespace FixConst;
 #define BIG 1.0e20
 #define NEXCEPT 8       // change when add to exceptions in add_fix()
 
+// generation counters continue where the previous Modify left off, e.g. after
+// a clear command recreated it, so a counter cached together with a pointer
+// or index by a library caller can never match a newer Modify
+static bigint last_generation = 0;
+
 /* ---------------------------------------------------------------------- */
 
 Modify::Modify(LAMMPS *lmp) : Pointers(lmp)
 {
   nfix = maxfix = 0;
+  fix_generation = compute_generation = last_generation + 1;
   n_initial_integrate = n_post_integrate = 0;
   n_pre_exchange = n_pre_neighbor = n_post_neighbor = 0;
   n_pre_force = n_pre_reverse = n_post_force = 0;
@@ -118,6 +124,9 @@ Modify::~Modify()
   for (int i = 0; i < ncompute; i++) delete compute[i];
   memory->sfree(compute);
 
+  if (fix_generation > last_generation) last_generation = fix_generation;
+  if (compute_generation > last_generation) last_generation = compute_generation;
+
   delete [] list_initial_integrate;
   delete [] list_post_integrate;
   delete [] list_pre_exchange;
@@ -941,6 +950,7 @@ void Modify::add_fix(int narg, char **arg, int trysuffix)
   //   post_constructor() will see updated nfix
 
   if (newflag) nfix++;
+  fix_generation++;
   fmask[ifix] = fix[ifix]->setmask();
   fix[ifix]->post_constructor();
 }
@@ -995,6 +1005,7 @@ void Modify::delete_fix(int ifix)
   for (int i = ifix+1; i < nfix; i++) fix[i-1] = fix[i];
   for (int i = ifix+1; i < nfix; i++) fmask[i-1] = fmask[i];
   nfix--;
+  fix_generation++;
 }
 
 /* ----------------------------------------------------------------------
@@ -1195,6 +1206,7 @@ void Modify::add_compute(int narg, char **arg, int trysuffix)
   }
 
   ncompute++;
+  compute_generation++;
 }
 
 /* ----------------------------------------------------------------------
@@ -1240,6 +1252,7 @@ void Modify::delete_compute(const char *id)
 
   for (int i = icompute+1; i < ncompute; i++) compute[i-1] = compute[i];
   ncompute--;
+  compute_generation++;
 }
 
 /* ----------------------------------------------------------------------
@@ -48,6 +48,9 @@ class Modify : protected Pointers {
   int ncompute,maxcompute;   // list of computes
   class Compute **compute;
 
+  bigint fix_generation;     // incremented whenever a fix is added/replaced/deleted
+  bigint compute_generation; // incremented whenever a compute is added/deleted
+
   Modify(class LAMMPS *);
   virtual ~Modify();
   virtual void init();
@@ -412,6 +412,16 @@ void Output::write_dump(bigint ntimestep)
   }
 }
 
+/* ----------------------------------------------------------------------
+   block until all dumps wrote their queued snapshots
+   called at the end of a run or minimization, however it ended
+------------------------------------------------------------------------- */
+
+void Output::wait_dumps()
+{
+  for (int idump = 0; idump < ndump; idump++) dump[idump]->wait_writer();
+}
+
 /* ----------------------------------------------------------------------
    force restart file(s) to be written
    called from PRD and TAD
@@ -46,11 +46,18 @@
 #include "error.h"
 #include "memory.h"
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 using namespace LAMMPS_NS;
 
 #define MAXLINE 256
 #define LB_FACTOR 1.1
-#define CHUNK 1024
+#define CHUNK 8192
 #define DELTA 4            // must be 2 or larger
 #define MAXBODY 32         // max # of lines in one body
 
@@ -80,6 +87,9 @@ ReadData::ReadData(LAMMPS *lmp) : Pointers(lmp)
   narg = maxarg = 0;
   arg = NULL;
   fp = NULL;
+  mapflag = 0;
+  mapdata = NULL;
+  mapsize = 0;
 
   // customize for new sections
   // pointers to atom styles that store extra info
@@ -104,6 +114,7 @@ ReadData::~ReadData()
   delete [] style;
   delete [] buffer;
   memory->sfree(arg);
+  if (fp) close();
 
   for (int i = 0; i < nfix; i++) {
     delete [] fix_header[i];
@@ -402,6 +413,7 @@ void ReadData::command(int narg, char **arg)
       if (firstpass && screen) fprintf(screen,"Reading data file ...\n");
       open(arg[0]);
     } else fp = NULL;
+    MPI_Bcast(&mapflag,1,MPI_INT,0,world);
 
     // read header info
 
@@ -706,11 +718,7 @@ void ReadData::command(int narg, char **arg)
 
     // close file
 
-    if (me == 0) {
-      if (compressed) pclose(fp);
-      else fclose(fp);
-      fp = NULL;
-    }
+    if (me == 0) close();
 
     // done if this was 2nd pass
 
@@ -1135,7 +1143,7 @@ void ReadData::atoms()
 
   while (nread < natoms) {
     nchunk = MIN(natoms-nread,CHUNK);
-    eof = comm->read_lines_from_file(fp,nchunk,MAXLINE,buffer);
+    eof = read_lines(nchunk);
     if (eof) error->all(FLERR,"Unexpected end of data file");
     atom->data_atoms(nchunk,buffer,id_offset,toffset,shiftflag,shift);
     nread += nchunk;
@@ -1193,7 +1201,7 @@ void ReadData::velocities()
 
   while (nread < natoms) {
     nchunk = MIN(natoms-nread,CHUNK);
-    eof = comm->read_lines_from_file(fp,nchunk,MAXLINE,buffer);
+    eof = read_lines(nchunk);
     if (eof) error->all(FLERR,"Unexpected end of data file");
     atom->data_vels(nchunk,buffer,id_offset);
     nread += nchunk;
@@ -1243,7 +1251,7 @@ void ReadData::bonds(int firstpass)
 
   while (nread < nbonds) {
     nchunk = MIN(nbonds-nread,CHUNK);
-    eof = comm->read_lines_from_file(fp,nchunk,MAXLINE,buffer);
+    eof = read_lines(nchunk);
     if (eof) error->all(FLERR,"Unexpected end of data file");
     atom->data_bonds(nchunk,buffer,count,id_offset,boffset);
     nread += nchunk;
@@ -1326,7 +1334,7 @@ void ReadData::angles(int firstpass)
 
   while (nread < nangles) {
     nchunk = MIN(nangles-nread,CHUNK);
-    eof = comm->read_lines_from_file(fp,nchunk,MAXLINE,buffer);
+    eof = read_lines(nchunk);
     if (eof) error->all(FLERR,"Unexpected end of data file");
     atom->data_angles(nchunk,buffer,count,id_offset,aoffset);
     nread += nchunk;
@@ -1409,7 +1417,7 @@ void ReadData::dihedrals(int firstpass)
 
   while (nread < ndihedrals) {
     nchunk = MIN(ndihedrals-nread,CHUNK);
-    eof = comm->read_lines_from_file(fp,nchunk,MAXLINE,buffer);
+    eof = read_lines(nchunk);
     if (eof) error->all(FLERR,"Unexpected end of data file");
     atom->data_dihedrals(nchunk,buffer,count,id_offset,doffset);
     nread += nchunk;
@@ -1492,7 +1500,7 @@ void ReadData::impropers(int firstpass)
 
   while (nread < nimpropers) {
     nchunk = MIN(nimpropers-nread,CHUNK);
-    eof = comm->read_lines_from_file(fp,nchunk,MAXLINE,buffer);
+    eof = read_lines(nchunk);
     if (eof) error->all(FLERR,"Unexpected end of data file");
     atom->data_impropers(nchunk,buffer,count,id_offset,ioffset);
     nread += nchunk;
@@ -1563,7 +1571,7 @@ void ReadData::bonus(bigint nbonus, AtomVec *ptr, const char *type)
 
   while (nread < natoms) {
     nchunk = MIN(natoms-nread,CHUNK);
-    eof = comm->read_lines_from_file(fp,nchunk,MAXLINE,buffer);
+    eof = read_lines(nchunk);
     if (eof) error->all(FLERR,"Unexpected end of data file");
     atom->data_bonus(nchunk,buffer,ptr,id_offset);
     nread += nchunk;
@@ -1870,7 +1878,7 @@ void ReadData::fix(int ifix, char *keyword)
   bigint nread = 0;
   while (nread < nline) {
     nchunk = MIN(nline-nread,CHUNK);
-    eof = comm->read_lines_from_file(fp,nchunk,MAXLINE,buffer);
+    eof = read_lines(nchunk);
     if (eof) error->all(FLERR,"Unexpected end of data file");
     modify->fix[ifix]->read_data_section(keyword,nchunk,buffer,id_offset);
     nread += nchunk;
@@ -1923,6 +1931,93 @@ void ReadData::open(char *file)
     sprintf(str,"Cannot open file %s",file);
     error->one(FLERR,str);
   }
+
+  // also map an uncompressed file into memory
+  // large sections are then read by read_lines() and skip_lines()
+  //   directly from the mapping, fp is kept positioned after them
+  // if mapping is not possible, all reads go through fp
+
+  mapflag = 0;
+  mapdata = NULL;
+  mapsize = 0;
+
+#if !defined(_WIN32)
+  if (!compressed) {
+    int fd = ::open(file,O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd,&st) == 0 && S_ISREG(st.st_mode) &&
+        st.st_size > 0) {
+      void *ptr = mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+      if (ptr != MAP_FAILED) {
+        madvise(ptr,st.st_size,MADV_SEQUENTIAL);
+        mapdata = (char *) ptr;
+        mapsize = st.st_size;
+        mapflag = 1;
+      }
+    }
+    if (fd >= 0) ::close(fd);
+  }
+#endif
+}
+
+/* ----------------------------------------------------------------------
+   proc 0 closes data file and releases its mapping
+------------------------------------------------------------------------- */
+
+void ReadData::close()
+{
+#if !defined(_WIN32)
+  if (mapdata) munmap(mapdata,mapsize);
+#endif
+  mapdata = NULL;
+  mapsize = 0;
+
+  if (compressed) pclose(fp);
+  else fclose(fp);
+  fp = NULL;
+}
+
+/* ----------------------------------------------------------------------
+   proc 0 reads N lines from file into buffer and bcasts it to all procs
+   same as Comm::read_lines_from_file(), but if file is mapped,
+     proc 0 finds line ends with memchr() and copies all N lines at once
+   return 0 if successful, 1 if get EOF error before read is complete
+------------------------------------------------------------------------- */
+
+int ReadData::read_lines(int n)
+{
+  if (!mapflag) return comm->read_lines_from_file(fp,n,MAXLINE,buffer);
+
+  int m = 0;
+
+  if (me == 0) {
+    char *start = mapdata + ftell(fp);
+    char *end = mapdata + mapsize;
+    char *ptr = start;
+    char *next;
+    int i;
+
+    for (i = 0; i < n && ptr < end; i++) {
+      next = (char *) memchr(ptr,'\n',end-ptr);
+      ptr = next ? next+1 : end;
+    }
+
+    if (i == n) {
+      bigint nbytes = ptr - start;
+      if (nbytes + 2 > (bigint) CHUNK*MAXLINE)
+        error->one(FLERR,"Data file lines are too long");
+      m = nbytes;
+      memcpy(buffer,start,m);
+      if (buffer[m-1] != '\n') buffer[m++] = '\n';
+      buffer[m++] = '\0';
+    }
+    fseek(fp,ptr-mapdata,SEEK_SET);
+  }
+
+  MPI_Bcast(&m,1,MPI_INT,0,world);
+  if (m == 0) return 1;
+  MPI_Bcast(buffer,m,MPI_CHAR,0,world);
+  return 0;
 }
 
 /* ----------------------------------------------------------------------
@@ -2006,6 +2101,21 @@ void ReadData::skip_lines(bigint n)
 {
   if (me) return;
   if (n <= 0) return;
+
+  if (mapflag) {
+    char *ptr = mapdata + ftell(fp);
+    char *end = mapdata + mapsize;
+    char *next;
+    bigint i;
+    for (i = 0; i < n && ptr < end; i++) {
+      next = (char *) memchr(ptr,'\n',end-ptr);
+      ptr = next ? next+1 : end;
+    }
+    fseek(fp,ptr-mapdata,SEEK_SET);
+    if (i < n) error->one(FLERR,"Unexpected end of data file");
+    return;
+  }
+
   char *eof = NULL;
   for (bigint i = 0; i < n; i++) eof = fgets(line,MAXLINE,fp);
   if (eof == NULL) error->one(FLERR,"Unexpected end of data file");
@@ -35,6 +35,9 @@ class ReadData : protected Pointers {
   int me,compressed;
   char *line,*copy,*keyword,*buffer,*style;
   FILE *fp;
+  int mapflag;              // 1 if data file is memory-mapped on proc 0
+  char *mapdata;            // proc 0 mapping of uncompressed data file
+  bigint mapsize;           // # of bytes in mapdata
   char **arg;
   int narg,maxarg;
   char argoffset1[8],argoffset2[8];
@@ -80,6 +83,8 @@ class ReadData : protected Pointers {
   // methods
 
   void open(char *);
+  void close();
+  int read_lines(int);
   void scan(int &, int &, int &, int &);
   int reallocate(int **, int, int);
   void header(int);
@@ -423,6 +428,12 @@ E: Unexpected end of data file
 LAMMPS hit the end of the data file while attempting to read a
 section.  Something is wrong with the format of the data file.
 
+E: Data file lines are too long
+
+A chunk of lines read from a section of the data file does not fit
+into the read buffer.  Lines in the data file are much longer than
+expected, which usually means the format of the data file is wrong.
+
 E: No ellipsoids allowed with this atom style
 
 Self-explanatory.  Check data file.
@@ -48,6 +48,9 @@ using namespace MathConst;
 #define CHUNK 1024
 #define VALUELENGTH 64               // also in python.cpp
 #define MAXFUNCARG 6
+#define MAXCOMPILE 16                // nesting of parens and functions
+#define MAXSTACK 32                  // operand stack of compiled formula
+#define ATOMBLOCK 128                // atoms per compiled peratom step
 
 #define MYROUND(a) (( a-floor(a) ) >= .5) ? ceil(a) : floor(a)
 
@@ -65,7 +68,9 @@ enum{DONE,ADD,SUBTRACT,MULTIPLY,DIVIDE,CARAT,MODULO,UNARY,
      RANDOM,NORMAL,CEIL,FLOOR,ROUND,RAMP,STAGGER,LOGFREQ,LOGFREQ2,
      STRIDE,STRIDE2,VDISPLACE,SWIGGLE,CWIGGLE,GMASK,RMASK,GRMASK,
      IS_ACTIVE,IS_DEFINED,IS_AVAILABLE,
-     VALUE,ATOMARRAY,TYPEARRAY,INTARRAY,BIGINTARRAY,VECTORARRAY};
+     VALUE,ATOMARRAY,TYPEARRAY,INTARRAY,BIGINTARRAY,VECTORARRAY,
+     CSCALAR,CVECTOR,CARRAY,CPERATOM,FSCALAR,FVECTOR,FARRAY,FPERATOM,
+     VINTERNAL,VRETRIEVE,VATOMFILE,ATOMVECTOR,THERMOKEY,SLOTLOAD,SLOTSTORE};
 
 // customize by adding a special function
 
@@ -78,6 +83,11 @@ enum{SUM,XMIN,XMAX,AVE,TRAP,SLOPE};
 
 #define BIG 1.0e20
 
+// generation counters continue where the previous Variable left off, e.g.
+// in a new LAMMPS instance, so a variable index cached together with its
+// generation by a library caller can never match a newer Variable
+static bigint last_generation = 0;
+
 /* ---------------------------------------------------------------------- */
 
 Variable::Variable(LAMMPS *lmp) : Pointers(lmp)
@@ -85,6 +95,7 @@ Variable::Variable(LAMMPS *lmp) : Pointers(lmp)
   MPI_Comm_rank(world,&me);
 
   nvar = maxvar = 0;
+  generation = last_generation + 1;
   names = NULL;
   style = NULL;
   num = NULL;
@@ -97,6 +108,11 @@ Variable::Variable(LAMMPS *lmp) : Pointers(lmp)
 
   eval_in_progress = NULL;
 
+  programs = NULL;
+  formula_generation = 0;
+  nodes = NULL;
+  nnode = maxnode = 0;
+
   randomequal = NULL;
   randomatom = NULL;
 
@@ -117,6 +133,7 @@ Variable::Variable(LAMMPS *lmp) : Pointers(lmp)
 
 Variable::~Variable()
 {
+  if (generation > last_generation) last_generation = generation;
   for (int i = 0; i < nvar; i++) {
     delete [] names[i];
     delete reader[i];
@@ -124,6 +141,7 @@ Variable::~Variable()
     else for (int j = 0; j < num[i]; j++) delete [] data[i][j];
     delete [] data[i];
     if (style[i] == VECTOR) memory->destroy(vecs[i].values);
+    free_program(&programs[i]);
   }
   memory->sfree(names);
   memory->destroy(style);
@@ -136,6 +154,8 @@ Variable::~Variable()
   memory->sfree(vecs);
 
   memory->destroy(eval_in_progress);
+  memory->sfree(programs);
+  memory->sfree(nodes);
 
   delete randomequal;
   delete randomatom;
@@ -509,6 +529,9 @@ void Variable::set(int narg, char **arg)
   // set name of variable, if not replacing one flagged with replaceflag
   // name must be all alphanumeric chars or underscores
 
+  // compiled formulas of all variables may depend on this one
+
+  formula_generation++;
   if (replaceflag) return;
 
   int n = strlen(arg[0]) + 1;
@@ -520,6 +543,7 @@ void Variable::set(int narg, char **arg)
       error->all(FLERR,"Variable name must be alphanumeric or "
                  "underscore characters");
   nvar++;
+  generation++;
 }
 
 /* ----------------------------------------------------------------------
@@ -844,7 +868,7 @@ char *Variable::retrieve(char *name)
     strcpy(data[ivar][0],result);
     str = data[ivar][0];
   } else if (style[ivar] == EQUAL) {
-    double answer = evaluate(data[ivar][0],NULL);
+    double answer = evaluate_equal(ivar);
     sprintf(data[ivar][1],"%.15g",answer);
     str = data[ivar][1];
   } else if (style[ivar] == FORMAT) {
@@ -899,7 +923,7 @@ double Variable::compute_equal(int ivar)
   eval_in_progress[ivar] = 1;
 
   double value = 0.0;
-  if (style[ivar] == EQUAL) value = evaluate(data[ivar][0],NULL);
+  if (style[ivar] == EQUAL) value = evaluate_equal(ivar);
   else if (style[ivar] == INTERNAL) value = dvalue[ivar];
   else if (style[ivar] == PYTHON) {
     int ifunc = python->find(data[ivar][0]);
@@ -935,18 +959,26 @@ void Variable::compute_atom(int ivar, int igroup,
 {
   Tree *tree;
   double *vstore;
+  Program *p = NULL;
 
   if (eval_in_progress[ivar])
     error->all(FLERR,"Variable has circular dependency");
   eval_in_progress[ivar] = 1;
 
   if (style[ivar] == ATOM) {
-    treetype = ATOM;
-    evaluate(data[ivar][0],&tree);
-    collapse_tree(tree);
+    p = program(ivar,1);
+    if (p) {
+      run_scalar(p,1);
+      resolve_peratom(p);
+    } else {
+      treetype = ATOM;
+      evaluate(data[ivar][0],&tree);
+      collapse_tree(tree);
+    }
   } else vstore = reader[ivar]->fixstore->vstore;
 
   if (result == NULL) {
+    if (style[ivar] == ATOM && !p) free_tree(tree);
     eval_in_progress[ivar] = 0;
     return;
   }
@@ -955,7 +987,31 @@ void Variable::compute_atom(int ivar, int igroup,
   int *mask = atom->mask;
   int nlocal = atom->nlocal;
 
-  if (style[ivar] == ATOM) {
+  // compiled formula is evaluated for blocks of atoms,
+  // checks in its steps only apply to atoms in group
+
+  if (p) {
+    int select[ATOMBLOCK];
+    int m = 0;
+    for (int ifirst = 0; ifirst < nlocal; ifirst += ATOMBLOCK) {
+      int n = MIN(ATOMBLOCK,nlocal-ifirst);
+      for (int k = 0; k < n; k++) select[k] = mask[ifirst+k] & groupbit;
+      double *values = run_peratom(p,ifirst,n,select);
+
+      if (sumflag == 0) {
+        for (int k = 0; k < n; k++) {
+          result[m] = select[k] ? values[k] : 0.0;
+          m += stride;
+        }
+      } else {
+        for (int k = 0; k < n; k++) {
+          if (select[k]) result[m] += values[k];
+          m += stride;
+        }
+      }
+    }
+
+  } else if (style[ivar] == ATOM) {
     if (sumflag == 0) {
       int m = 0;
       for (int i = 0; i < nlocal; i++) {
@@ -990,7 +1046,7 @@ void Variable::compute_atom(int ivar, int igroup,
     }
   }
 
-  if (style[ivar] == ATOM) free_tree(tree);
+  if (style[ivar] == ATOM && !p) free_tree(tree);
   eval_in_progress[ivar] = 0;
 }
 
@@ -1064,6 +1120,7 @@ void Variable::remove(int n)
   else for (int i = 0; i < num[n]; i++) delete [] data[n][i];
   delete [] data[n];
   delete reader[n];
+  free_program(&programs[n]);
 
   for (int i = n+1; i < nvar; i++) {
     names[i-1] = names[i];
@@ -1073,8 +1130,14 @@ void Variable::remove(int n)
     pad[i-1] = pad[i];
     reader[i-1] = reader[i];
     data[i-1] = data[i];
+    programs[i-1] = programs[i];
   }
+  programs[nvar-1].status = 0;
+  programs[nvar-1].scalar = programs[nvar-1].peratom = NULL;
+  programs[nvar-1].slots = programs[nvar-1].stack = NULL;
   nvar--;
+  generation++;
+  formula_generation++;
 }
 
 /* ----------------------------------------------------------------------
@@ -1107,6 +1170,16 @@ void Variable::grow()
 
   memory->grow(eval_in_progress,maxvar,"var:eval_in_progress");
   for (int i = 0; i < maxvar; i++) eval_in_progress[i] = 0;
+
+  programs = (Program *)
+    memory->srealloc(programs,maxvar*sizeof(Program),"var:programs");
+  for (int i = old; i < maxvar; i++) {
+    programs[i].status = 0;
+    programs[i].scalar = programs[i].peratom = NULL;
+    programs[i].nscalar = programs[i].nperatom = 0;
+    programs[i].slots = programs[i].stack = NULL;
+    programs[i].nslot = programs[i].depth = 0;
+  }
 }
 
 /* ----------------------------------------------------------------------
@@ -1123,6 +1196,980 @@ void Variable::copy(int narg, char **from, char **to)
   }
 }
 
+/* ----------------------------------------------------------------------
+   return index of paren matching the one at str[i], -1 if none
+------------------------------------------------------------------------- */
+
+static int compile_paren(char *str, int i)
+{
+  int level = 1;
+  for (i++; str[i]; i++) {
+    if (str[i] == '(') level++;
+    else if (str[i] == ')') level--;
+    if (level == 0) return i;
+  }
+  return -1;
+}
+
+/* ----------------------------------------------------------------------
+   parse zero, one or two brackets with positive integers at str[i]
+   point i beyond last bracket, return # of brackets
+   return -1 for anything else, e.g. a variable name as index
+------------------------------------------------------------------------- */
+
+static int compile_brackets(char *str, int &i, tagint *index)
+{
+  int nbracket = 0;
+  while (str[i] == '[' && nbracket < 2) {
+    int istart = ++i;
+    while (isdigit(str[i])) i++;
+    if (str[i] != ']' || i == istart) return -1;
+    str[i] = '\0';
+    index[nbracket] = ATOTAGINT(&str[istart]);
+    str[i++] = ']';
+    if (index[nbracket] <= 0) return -1;
+    nbracket++;
+  }
+  if (str[i] == '[') return -1;
+  return nbracket;
+}
+
+/* ----------------------------------------------------------------------
+   evaluate equal-style variable ivar
+   use its compiled program if the formula compiles, else parse string
+------------------------------------------------------------------------- */
+
+double Variable::evaluate_equal(int ivar)
+{
+  Program *p = program(ivar,0);
+  if (p) return run_scalar(p,0);
+  return evaluate(data[ivar][0],NULL);
+}
+
+/* ----------------------------------------------------------------------
+   return compiled program for equal-style or atom-style variable ivar
+   (re)compile if never compiled or if a variable, compute or fix changed
+   return NULL if formula uses something only evaluate() handles,
+     e.g. group or special functions, or if formula is invalid,
+     evaluate() then parses the string and reports any error
+------------------------------------------------------------------------- */
+
+Variable::Program *Variable::program(int ivar, int atomflag)
+{
+  Program *p = &programs[ivar];
+
+  if (p->status && p->generation == formula_generation &&
+      p->compute_generation == modify->compute_generation &&
+      p->fix_generation == modify->fix_generation)
+    return (p->status > 0) ? p : NULL;
+
+  free_program(p);
+
+  // compute and fix IDs and thermo keywords are only valid with a box
+
+  if (domain->box_exist == 0) return NULL;
+
+  p->generation = formula_generation;
+  p->compute_generation = modify->compute_generation;
+  p->fix_generation = modify->fix_generation;
+  p->status = -1;
+
+  nnode = 0;
+  int root = compile(data[ivar][0],atomflag,0);
+
+  if (root >= 0) {
+    p->scalar = new Instr[2*nnode];
+    p->peratom = new Instr[2*nnode];
+    emit(p,root,atomflag);
+    if (stack_depth(p->scalar,p->nscalar) <= MAXSTACK) {
+      p->depth = stack_depth(p->peratom,p->nperatom);
+      p->status = 1;
+    }
+  }
+
+  // keywords are owned by the program once it is complete
+
+  if (p->status < 0) {
+    for (int m = 0; m < nnode; m++) delete [] nodes[m].keyword;
+    free_program(p);
+    p->status = -1;
+    return NULL;
+  }
+
+  if (p->nslot) memory->create(p->slots,p->nslot,"variable:slots");
+  if (atomflag) memory->create(p->stack,p->depth*ATOMBLOCK,"variable:stack");
+  return p;
+}
+
+/* ----------------------------------------------------------------------
+   recompile all programs before their next evaluation
+   called when the clear command recreated the computes and fixes they use
+------------------------------------------------------------------------- */
+
+void Variable::invalidate_programs()
+{
+  formula_generation++;
+}
+
+/* ----------------------------------------------------------------------
+   release steps and buffers of a program, mark it as not compiled
+------------------------------------------------------------------------- */
+
+void Variable::free_program(Program *p)
+{
+  if (p->status > 0)
+    for (int m = 0; m < p->nscalar; m++) delete [] p->scalar[m].keyword;
+  delete [] p->scalar;
+  delete [] p->peratom;
+  memory->destroy(p->slots);
+  memory->destroy(p->stack);
+
+  p->status = 0;
+  p->scalar = p->peratom = NULL;
+  p->nscalar = p->nperatom = 0;
+  p->slots = p->stack = NULL;
+  p->nslot = p->depth = 0;
+}
+
+/* ----------------------------------------------------------------------
+   append a parse tree node of type, return its index
+------------------------------------------------------------------------- */
+
+int Variable::add_node(int type)
+{
+  if (nnode == maxnode) {
+    maxnode += CHUNK;
+    nodes = (Instr *) memory->srealloc(nodes,maxnode*sizeof(Instr),
+                                       "variable:nodes");
+  }
+
+  Instr *node = &nodes[nnode];
+  memset(node,0,sizeof(Instr));
+  node->type = type;
+  node->first = node->second = -1;
+  return nnode++;
+}
+
+/* ----------------------------------------------------------------------
+   compile formula str into parse tree nodes, return index of root node
+   same grammar and operator precedence as evaluate()
+   return -1 for anything evaluate() has to handle, never error here
+   str is restored if temporarily modified
+------------------------------------------------------------------------- */
+
+int Variable::compile(char *str, int atomflag, int level)
+{
+  if (level > MAXCOMPILE) return -1;
+
+  int nodestack[MAXLEVEL];
+  int opstack[MAXLEVEL];
+  int nnodestack = 0;
+  int nopstack = 0;
+  char word[MAXLINE];
+  int op,inode;
+
+  int i = 0;
+  int expect = ARG;
+
+  while (1) {
+    char onechar = str[i];
+
+    if (isspace(onechar)) i++;
+
+    // parentheses: compile contents
+
+    else if (onechar == '(') {
+      if (expect == OP || nnodestack == MAXLEVEL) return -1;
+      expect = OP;
+
+      int istop = compile_paren(str,i);
+      if (istop < 0) return -1;
+      str[istop] = '\0';
+      inode = compile(&str[i+1],atomflag,level+1);
+      str[istop] = ')';
+      if (inode < 0) return -1;
+      nodestack[nnodestack++] = inode;
+      i = istop+1;
+
+    // number
+
+    } else if (isdigit(onechar) || onechar == '.') {
+      if (expect == OP || nnodestack == MAXLEVEL) return -1;
+      expect = OP;
+
+      int istart = i;
+      while (isdigit(str[i]) || str[i] == '.') i++;
+      if (str[i] == 'e' || str[i] == 'E') {
+        i++;
+        if (str[i] == '+' || str[i] == '-') i++;
+        while (isdigit(str[i])) i++;
+      }
+
+      int n = i - istart;
+      if (n >= MAXLINE) return -1;
+      strncpy(word,&str[istart],n);
+      word[n] = '\0';
+
+      inode = add_node(VALUE);
+      nodes[inode].value = atof(word);
+      nodestack[nnodestack++] = inode;
+
+    // compute, fix, variable, function, atom vector, constant, thermo keyword
+
+    } else if (isalpha(onechar)) {
+      if (expect == OP || nnodestack == MAXLEVEL) return -1;
+      expect = OP;
+
+      int istart = i;
+      while (isalnum(str[i]) || str[i] == '_') i++;
+
+      int n = i - istart;
+      if (n >= MAXLINE) return -1;
+      strncpy(word,&str[istart],n);
+      word[n] = '\0';
+
+      inode = compile_word(word,str,i,atomflag,level);
+      if (inode < 0) return -1;
+      nodestack[nnodestack++] = inode;
+
+    // math operator, including end-of-string
+
+    } else if (strchr("+-*/^<>=!&|%\0",onechar)) {
+      if (onechar == '+') op = ADD;
+      else if (onechar == '-') op = SUBTRACT;
+      else if (onechar == '*') op = MULTIPLY;
+      else if (onechar == '/') op = DIVIDE;
+      else if (onechar == '%') op = MODULO;
+      else if (onechar == '^') op = CARAT;
+      else if (onechar == '=') {
+        if (str[i+1] != '=') return -1;
+        op = EQ;
+        i++;
+      } else if (onechar == '!') {
+        if (str[i+1] == '=') {
+          op = NE;
+          i++;
+        } else op = NOT;
+      } else if (onechar == '<') {
+        if (str[i+1] != '=') op = LT;
+        else {
+          op = LE;
+          i++;
+        }
+      } else if (onechar == '>') {
+        if (str[i+1] != '=') op = GT;
+        else {
+          op = GE;
+          i++;
+        }
+      } else if (onechar == '&') {
+        if (str[i+1] != '&') return -1;
+        op = AND;
+        i++;
+      } else if (onechar == '|') {
+        if (str[i+1] == '|') op = OR;
+        else if (str[i+1] == '^') op = XOR;
+        else return -1;
+        i++;
+      } else op = DONE;
+
+      i++;
+
+      if ((op == SUBTRACT || op == NOT) && expect == ARG) {
+        if (nopstack == MAXLEVEL) return -1;
+        opstack[nopstack++] = (op == SUBTRACT) ? UNARY : NOT;
+        continue;
+      }
+
+      if (expect == ARG) return -1;
+      expect = ARG;
+
+      while (nopstack && precedence[opstack[nopstack-1]] >= precedence[op]) {
+        inode = add_node(opstack[--nopstack]);
+        Instr *node = &nodes[inode];
+        if (node->type == UNARY || node->type == NOT) {
+          if (nnodestack < 1) return -1;
+          node->first = nodestack[--nnodestack];
+          node->peratom = nodes[node->first].peratom;
+        } else {
+          if (nnodestack < 2) return -1;
+          node->second = nodestack[--nnodestack];
+          node->first = nodestack[--nnodestack];
+          node->peratom = nodes[node->first].peratom ||
+            nodes[node->second].peratom;
+        }
+        nodestack[nnodestack++] = inode;
+      }
+
+      if (op == DONE) break;
+
+      if (nopstack == MAXLEVEL) return -1;
+      opstack[nopstack++] = op;
+
+    } else return -1;
+  }
+
+  if (nopstack || nnodestack != 1) return -1;
+  return nodestack[0];
+}
+
+/* ----------------------------------------------------------------------
+   compile operand word starting a formula item, i points beyond word
+   advance i beyond any brackets or function arguments
+   return index of new node, -1 if evaluate() has to handle it
+------------------------------------------------------------------------- */
+
+int Variable::compile_word(char *word, char *str, int &i,
+                           int atomflag, int level)
+{
+  int inode;
+  tagint index[2];
+
+  // compute: global scalar, vector or array element, or per-atom values
+
+  if (strncmp(word,"c_",2) == 0 || strncmp(word,"C_",2) == 0) {
+    int lowercase = (word[0] == 'c');
+    int icompute = modify->find_compute(word+2);
+    if (icompute < 0) return -1;
+    Compute *compute = modify->compute[icompute];
+    int nbracket = compile_brackets(str,i,index);
+    if (nbracket < 0) return -1;
+
+    if (nbracket == 0 && compute->scalar_flag && lowercase)
+      inode = add_node(CSCALAR);
+    else if (nbracket == 1 && compute->vector_flag && lowercase)
+      inode = add_node(CVECTOR);
+    else if (nbracket == 2 && compute->array_flag && lowercase) {
+      if (index[1] > compute->size_array_cols) return -1;
+      inode = add_node(CARRAY);
+    } else if (nbracket == 0 && compute->vector_flag) return -1;
+    else if (nbracket == 1 && compute->array_flag) return -1;
+    else if (atomflag && nbracket == 0 && compute->peratom_flag &&
+             compute->size_peratom_cols == 0) {
+      inode = add_node(CPERATOM);
+      nodes[inode].iarg = 0;
+      nodes[inode].peratom = 1;
+    } else if (atomflag && nbracket == 1 && compute->peratom_flag &&
+               compute->size_peratom_cols > 0) {
+      if (index[0] > compute->size_peratom_cols) return -1;
+      inode = add_node(CPERATOM);
+      nodes[inode].iarg = index[0];
+      nodes[inode].peratom = 1;
+    } else return -1;
+
+    nodes[inode].ptr = compute;
+    if (nbracket > 0) nodes[inode].index1 = index[0];
+    if (nbracket > 1) nodes[inode].index2 = index[1];
+    return inode;
+  }
+
+  // fix: global scalar, vector or array element, or per-atom values
+
+  if (strncmp(word,"f_",2) == 0 || strncmp(word,"F_",2) == 0) {
+    int lowercase = (word[0] == 'f');
+    int ifix = modify->find_fix(word+2);
+    if (ifix < 0) return -1;
+    Fix *fix = modify->fix[ifix];
+    int nbracket = compile_brackets(str,i,index);
+    if (nbracket < 0) return -1;
+
+    if (nbracket == 0 && fix->scalar_flag && lowercase)
+      inode = add_node(FSCALAR);
+    else if (nbracket == 1 && fix->vector_flag && lowercase)
+      inode = add_node(FVECTOR);
+    else if (nbracket == 2 && fix->array_flag && lowercase) {
+      if (index[1] > fix->size_array_cols) return -1;
+      inode = add_node(FARRAY);
+    } else if (nbracket == 0 && fix->vector_flag) return -1;
+    else if (nbracket == 1 && fix->array_flag) return -1;
+    else if (atomflag && nbracket == 0 && fix->peratom_flag &&
+             fix->size_peratom_cols == 0) {
+      inode = add_node(FPERATOM);
+      nodes[inode].iarg = 0;
+      nodes[inode].peratom = 1;
+    } else if (atomflag && nbracket == 1 && fix->peratom_flag &&
+               fix->size_peratom_cols > 0) {
+      if (index[0] > fix->size_peratom_cols) return -1;
+      inode = add_node(FPERATOM);
+      nodes[inode].iarg = index[0];
+      nodes[inode].peratom = 1;
+    } else return -1;
+
+    nodes[inode].ptr = fix;
+    if (nbracket > 0) nodes[inode].index1 = index[0];
+    if (nbracket > 1) nodes[inode].index2 = index[1];
+    return inode;
+  }
+
+  // variable: any scalar-valued style, or atom-style formula compiled inline
+
+  if (strncmp(word,"v_",2) == 0) {
+    int ivar = find(word+2);
+    if (ivar < 0 || str[i] == '[') return -1;
+
+    if (style[ivar] == INTERNAL) inode = add_node(VINTERNAL);
+    else if (style[ivar] != ATOM && style[ivar] != ATOMFILE &&
+             style[ivar] != VECTOR) inode = add_node(VRETRIEVE);
+    else if (atomflag && style[ivar] == ATOM)
+      return compile(data[ivar][0],atomflag,level+1);
+    else if (atomflag && style[ivar] == ATOMFILE) {
+      inode = add_node(VATOMFILE);
+      nodes[inode].peratom = 1;
+    } else return -1;
+
+    nodes[inode].iarg = ivar;
+    return inode;
+  }
+
+  // math function without side effects
+
+  if (str[i] == '(') {
+    static const char *functions[] = {"sqrt","exp","ln","log","abs",
+                                      "sin","cos","tan","asin","acos",
+                                      "atan","atan2","ceil","floor","round"};
+    static const int ops[] = {SQRT,EXP,LN,LOG,ABS,SIN,COS,TAN,ASIN,ACOS,
+                              ATAN,ATAN2,CEIL,FLOOR,ROUND};
+
+    int ifunc;
+    for (ifunc = 0; ifunc < 15; ifunc++)
+      if (strcmp(word,functions[ifunc]) == 0) break;
+    if (ifunc == 15) return -1;
+    inode = add_node(ops[ifunc]);
+    int narg = (ops[ifunc] == ATAN2) ? 2 : 1;
+
+    int istop = compile_paren(str,i);
+    if (istop < 0) return -1;
+
+    int n = istop - i - 1;
+    char *contents = new char[n+1];
+    strncpy(contents,&str[i+1],n);
+    contents[n] = '\0';
+    char *args[MAXFUNCARG];
+    int nfound = parse_args(contents,args);
+
+    int first = -1,second = -1;
+    if (nfound == narg) {
+      first = compile(args[0],atomflag,level+1);
+      if (narg == 2 && first >= 0) second = compile(args[1],atomflag,level+1);
+    }
+
+    for (int m = 0; m < nfound; m++) delete [] args[m];
+    delete [] contents;
+
+    if (first < 0 || (narg == 2 && second < 0)) return -1;
+    nodes[inode].first = first;
+    nodes[inode].second = second;
+    nodes[inode].peratom = nodes[first].peratom ||
+      (second >= 0 && nodes[second].peratom);
+    i = istop+1;
+    return inode;
+  }
+
+  // atom value x[i] is a global reduction, left to evaluate()
+
+  if (str[i] == '[') return -1;
+
+  if (is_atom_vector(word)) {
+    if (!atomflag) return -1;
+    if (strcmp(word,"mol") == 0 && !atom->molecule_flag) return -1;
+    if (strcmp(word,"q") == 0 && !atom->q_flag) return -1;
+    static const char *vectors[] = {"id","mass","type","mol","x","y","z",
+                                    "vx","vy","vz","fx","fy","fz","q"};
+    inode = add_node(ATOMVECTOR);
+    for (int m = 0; m < 14; m++)
+      if (strcmp(word,vectors[m]) == 0) nodes[inode].iarg = m;
+    nodes[inode].peratom = 1;
+    return inode;
+  }
+
+  if (is_constant(word)) {
+    inode = add_node(VALUE);
+    nodes[inode].value = constant(word);
+    return inode;
+  }
+
+  // thermo keyword, validity is checked when evaluated
+
+  inode = add_node(THERMOKEY);
+  nodes[inode].keyword = new char[strlen(word)+1];
+  strcpy(nodes[inode].keyword,word);
+  return inode;
+}
+
+/* ----------------------------------------------------------------------
+   append steps of parse tree below node inode to program p
+   equal-style: everything is a scalar step
+   atom-style: largest subtrees without per-atom operands become scalar
+     steps whose result is stored into a slot, the rest are peratom steps
+------------------------------------------------------------------------- */
+
+void Variable::emit(Program *p, int inode, int atomflag)
+{
+  Instr &node = nodes[inode];
+
+  if (atomflag && (node.peratom || node.type == VALUE)) {
+    if (node.first >= 0) emit(p,node.first,atomflag);
+    if (node.second >= 0) emit(p,node.second,atomflag);
+    p->peratom[p->nperatom++] = node;
+    return;
+  }
+
+  emit_scalar(p,inode);
+  if (!atomflag) return;
+
+  Instr *step = &p->scalar[p->nscalar++];
+  memset(step,0,sizeof(Instr));
+  step->type = SLOTSTORE;
+  step->first = step->second = -1;
+  step->iarg = p->nslot;
+
+  step = &p->peratom[p->nperatom++];
+  memset(step,0,sizeof(Instr));
+  step->type = SLOTLOAD;
+  step->first = step->second = -1;
+  step->iarg = p->nslot++;
+}
+
+/* ----------------------------------------------------------------------
+   append steps of parse tree below node inode to scalar steps of p
+------------------------------------------------------------------------- */
+
+void Variable::emit_scalar(Program *p, int inode)
+{
+  Instr &node = nodes[inode];
+  if (node.first >= 0) emit_scalar(p,node.first);
+  if (node.second >= 0) emit_scalar(p,node.second);
+  p->scalar[p->nscalar++] = node;
+}
+
+/* ----------------------------------------------------------------------
+   return max # of values on operand stack while running n steps
+------------------------------------------------------------------------- */
+
+int Variable::stack_depth(Instr *steps, int n)
+{
+  int depth = 0, maxdepth = 0;
+  for (int m = 0; m < n; m++) {
+    if (steps[m].type == SLOTSTORE) depth--;
+    else if (steps[m].first < 0) depth++;
+    else if (steps[m].second >= 0) depth--;
+    if (depth > maxdepth) maxdepth = depth;
+  }
+  return maxdepth;
+}
+
+/* ----------------------------------------------------------------------
+   run scalar steps of program p
+   atomflag = 0: equal-style, same checks and errors as evaluate()
+   atomflag = 1: atom-style, same checks and errors as collapse_tree()
+   return value left on stack, 0.0 if none
+------------------------------------------------------------------------- */
+
+double Variable::run_scalar(Program *p, int atomflag)
+{
+  double stack[MAXSTACK];
+  double value1,value2;
+  int n = 0;
+
+  for (int m = 0; m < p->nscalar; m++) {
+    Instr *step = &p->scalar[m];
+    int type = step->type;
+
+    // operands
+
+    if (type == VALUE) {
+      stack[n++] = step->value;
+      continue;
+    }
+
+    if (type == SLOTSTORE) {
+      p->slots[step->iarg] = stack[--n];
+      continue;
+    }
+
+    if (type == CSCALAR || type == CVECTOR || type == CARRAY) {
+      Compute *compute = (Compute *) step->ptr;
+      int index1 = step->index1;
+
+      if (type == CSCALAR) {
+        if (update->whichflag == 0) {
+          if (compute->invoked_scalar != update->ntimestep)
+            error->all(FLERR,"Compute used in variable between runs "
+                       "is not current");
+        } else if (!(compute->invoked_flag & INVOKED_SCALAR)) {
+          compute->compute_scalar();
+          compute->invoked_flag |= INVOKED_SCALAR;
+        }
+        stack[n++] = compute->scalar;
+
+      } else if (type == CVECTOR) {
+        if (index1 > compute->size_vector &&
+            compute->size_vector_variable == 0)
+          error->all(FLERR,"Variable formula compute vector "
+                     "is accessed out-of-range");
+        if (update->whichflag == 0) {
+          if (compute->invoked_vector != update->ntimestep)
+            error->all(FLERR,"Compute used in variable between runs "
+                       "is not current");
+        } else if (!(compute->invoked_flag & INVOKED_VECTOR)) {
+          compute->compute_vector();
+          compute->invoked_flag |= INVOKED_VECTOR;
+        }
+        if (compute->size_vector_variable &&
+            index1 > compute->size_vector) stack[n++] = 0.0;
+        else stack[n++] = compute->vector[index1-1];
+
+      } else {
+        if (index1 > compute->size_array_rows &&
+            compute->size_array_rows_variable == 0)
+          error->all(FLERR,"Variable formula compute array "
+                     "is accessed out-of-range");
+        if (update->whichflag == 0) {
+          if (compute->invoked_array != update->ntimestep)
+            error->all(FLERR,"Compute used in variable between runs "
+                       "is not current");
+        } else if (!(compute->invoked_flag & INVOKED_ARRAY)) {
+          compute->compute_array();
+          compute->invoked_flag |= INVOKED_ARRAY;
+        }
+        if (compute->size_array_rows_variable &&
+            index1 > compute->size_array_rows) stack[n++] = 0.0;
+        else stack[n++] = compute->array[index1-1][step->index2-1];
+      }
+      continue;
+    }
+
+    if (type == FSCALAR || type == FVECTOR || type == FARRAY) {
+      Fix *fix = (Fix *) step->ptr;
+      int index1 = step->index1;
+
+      if (type == FVECTOR && index1 > fix->size_vector &&
+          fix->size_vector_variable == 0)
+        error->all(FLERR,"Variable formula fix vector is "
+                   "accessed out-of-range");
+      if (type == FARRAY && index1 > fix->size_array_rows &&
+          fix->size_array_rows_variable == 0)
+        error->all(FLERR,
+                   "Variable formula fix array is accessed out-of-range");
+      if (update->whichflag > 0 && update->ntimestep % fix->global_freq)
+        error->all(FLERR,"Fix in variable not computed at compatible time");
+
+      if (type == FSCALAR) stack[n++] = fix->compute_scalar();
+      else if (type == FVECTOR) stack[n++] = fix->compute_vector(index1-1);
+      else stack[n++] = fix->compute_array(index1-1,step->index2-1);
+      continue;
+    }
+
+    if (type == VINTERNAL || type == VRETRIEVE) {
+      int ivar = step->iarg;
+      if (eval_in_progress[ivar])
+        error->all(FLERR,"Variable has circular dependency");
+      if (type == VINTERNAL) stack[n++] = dvalue[ivar];
+      else {
+        char *var = retrieve(names[ivar]);
+        if (var == NULL)
+          error->all(FLERR,"Invalid variable evaluation in variable formula");
+        stack[n++] = atof(var);
+      }
+      continue;
+    }
+
+    if (type == THERMOKEY) {
+      if (output->thermo->evaluate_keyword(step->keyword,&value1))
+        error->all(FLERR,"Invalid thermo keyword in variable formula");
+      stack[n++] = value1;
+      continue;
+    }
+
+    // operations
+
+    value2 = stack[--n];
+    if (step->second >= 0) value1 = stack[--n];
+
+    if (type == ADD) value1 = value1 + value2;
+    else if (type == SUBTRACT) value1 = value1 - value2;
+    else if (type == MULTIPLY) value1 = value1 * value2;
+    else if (type == DIVIDE) {
+      if (value2 == 0.0) {
+        if (atomflag) error->one(FLERR,"Divide by 0 in variable formula");
+        else error->all(FLERR,"Divide by 0 in variable formula");
+      }
+      value1 = value1 / value2;
+    } else if (type == MODULO) {
+      if (value2 == 0.0) {
+        if (atomflag) error->one(FLERR,"Modulo 0 in variable formula");
+        else error->all(FLERR,"Modulo 0 in variable formula");
+      }
+      value1 = fmod(value1,value2);
+    } else if (type == CARAT) {
+      if (atomflag) {
+        if (value2 == 0.0)
+          error->one(FLERR,"Power by 0 in variable formula");
+        value1 = pow(value1,value2);
+      } else if (value2 == 0.0) value1 = 1.0;
+      else if ((value1 == 0.0) && (value2 < 0.0))
+        error->all(FLERR,"Invalid power expression in variable formula");
+      else value1 = pow(value1,value2);
+    } else if (type == UNARY) value1 = -value2;
+    else if (type == NOT) value1 = (value2 == 0.0) ? 1.0 : 0.0;
+    else if (type == EQ) value1 = (value1 == value2) ? 1.0 : 0.0;
+    else if (type == NE) value1 = (value1 != value2) ? 1.0 : 0.0;
+    else if (type == LT) value1 = (value1 < value2) ? 1.0 : 0.0;
+    else if (type == LE) value1 = (value1 <= value2) ? 1.0 : 0.0;
+    else if (type == GT) value1 = (value1 > value2) ? 1.0 : 0.0;
+    else if (type == GE) value1 = (value1 >= value2) ? 1.0 : 0.0;
+    else if (type == AND)
+      value1 = (value1 != 0.0 && value2 != 0.0) ? 1.0 : 0.0;
+    else if (type == OR)
+      value1 = (value1 != 0.0 || value2 != 0.0) ? 1.0 : 0.0;
+    else if (type == XOR)
+      value1 = ((value1 == 0.0 && value2 != 0.0) ||
+                (value1 != 0.0 && value2 == 0.0)) ? 1.0 : 0.0;
+
+    // math functions have their single argument in value2
+
+    else if (type == ATAN2) value1 = atan2(value1,value2);
+    else {
+      if (type == SQRT) {
+        if (value2 < 0.0) {
+          if (atomflag)
+            error->one(FLERR,"Sqrt of negative value in variable formula");
+          else
+            error->all(FLERR,"Sqrt of negative value in variable formula");
+        }
+        value1 = sqrt(value2);
+      } else if (type == EXP) value1 = exp(value2);
+      else if (type == LN || type == LOG) {
+        if (value2 <= 0.0) {
+          if (atomflag)
+            error->one(FLERR,"Log of zero/negative value in variable formula");
+          else
+            error->all(FLERR,"Log of zero/negative value in variable formula");
+        }
+        value1 = (type == LN) ? log(value2) : log10(value2);
+      } else if (type == ABS) value1 = fabs(value2);
+      else if (type == SIN) value1 = sin(value2);
+      else if (type == COS) value1 = cos(value2);
+      else if (type == TAN) value1 = tan(value2);
+      else if (type == ASIN || type == ACOS) {
+        if (value2 < -1.0 || value2 > 1.0) {
+          const char *msg = (type == ASIN) ?
+            "Arcsin of invalid value in variable formula" :
+            "Arccos of invalid value in variable formula";
+          if (atomflag) error->one(FLERR,msg);
+          else error->all(FLERR,msg);
+        }
+        value1 = (type == ASIN) ? asin(value2) : acos(value2);
+      } else if (type == ATAN) value1 = atan(value2);
+      else if (type == CEIL) value1 = ceil(value2);
+      else if (type == FLOOR) value1 = floor(value2);
+      else if (type == ROUND) value1 = MYROUND(value2);
+    }
+
+    stack[n++] = value1;
+  }
+
+  if (n) return stack[n-1];
+  return 0.0;
+}
+
+/* ----------------------------------------------------------------------
+   look up per-atom operands of program p for this evaluation
+   invoke computes and check fixes like evaluate() does
+------------------------------------------------------------------------- */
+
+void Variable::resolve_peratom(Program *p)
+{
+  for (int m = 0; m < p->nperatom; m++) {
+    Instr *step = &p->peratom[m];
+    int type = step->type;
+    step->rtype = ATOMARRAY;
+    step->nstride = 1;
+
+    if (type == CPERATOM) {
+      Compute *compute = (Compute *) step->ptr;
+      if (update->whichflag == 0) {
+        if (compute->invoked_peratom != update->ntimestep)
+          error->all(FLERR,"Compute used in variable between runs "
+                     "is not current");
+      } else if (!(compute->invoked_flag & INVOKED_PERATOM)) {
+        compute->compute_peratom();
+        compute->invoked_flag |= INVOKED_PERATOM;
+      }
+      if (step->iarg == 0) step->array = compute->vector_atom;
+      else {
+        if (compute->array_atom)
+          step->array = &compute->array_atom[0][step->iarg-1];
+        else step->array = NULL;
+        step->nstride = compute->size_peratom_cols;
+      }
+
+    } else if (type == FPERATOM) {
+      Fix *fix = (Fix *) step->ptr;
+      if (update->whichflag > 0 && update->ntimestep % fix->peratom_freq)
+        error->all(FLERR,"Fix in variable not computed at compatible time");
+      if (step->iarg == 0) step->array = fix->vector_atom;
+      else {
+        if (fix->array_atom) step->array = &fix->array_atom[0][step->iarg-1];
+        else step->array = NULL;
+        step->nstride = fix->size_peratom_cols;
+      }
+
+    } else if (type == VATOMFILE) {
+      step->array = reader[step->iarg]->fixstore->vstore;
+
+    } else if (type == ATOMVECTOR) {
+      int which = step->iarg;
+      if (which == 0 || which == 3) {
+        tagint *ids = (which == 0) ? atom->tag : atom->molecule;
+        if (sizeof(tagint) == sizeof(smallint)) {
+          step->rtype = INTARRAY;
+          step->iarray = (int *) ids;
+        } else {
+          step->rtype = BIGINTARRAY;
+          step->barray = (bigint *) ids;
+        }
+      } else if (which == 1) {
+        if (atom->rmass) step->array = atom->rmass;
+        else {
+          step->rtype = TYPEARRAY;
+          step->array = atom->mass;
+        }
+      } else if (which == 2) {
+        step->rtype = INTARRAY;
+        step->iarray = atom->type;
+      } else if (which == 13) {
+        step->array = atom->q;
+      } else {
+        double **xvf = (which < 7) ? atom->x : (which < 10) ? atom->v : atom->f;
+        step->array = xvf ? &xvf[0][(which-4) % 3] : NULL;
+        step->nstride = 3;
+      }
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   run peratom steps of program p for n atoms starting at ifirst
+   select = flag per atom, errors are only raised for selected atoms,
+     same checks and errors as eval_tree()
+   return ptr to n values
+------------------------------------------------------------------------- */
+
+double *Variable::run_peratom(Program *p, int ifirst, int n, int *select)
+{
+  double *top = p->stack - ATOMBLOCK;
+  int *type = atom->type;
+  int k;
+
+  for (int m = 0; m < p->nperatom; m++) {
+    Instr *step = &p->peratom[m];
+    int op = step->type;
+
+    // operands
+
+    if (step->first < 0) {
+      top += ATOMBLOCK;
+      if (op == VALUE || op == SLOTLOAD) {
+        double value = (op == VALUE) ? step->value : p->slots[step->iarg];
+        for (k = 0; k < n; k++) top[k] = value;
+      } else if (step->rtype == ATOMARRAY) {
+        const double *array = step->array + (bigint) ifirst*step->nstride;
+        const int nstride = step->nstride;
+        for (k = 0; k < n; k++) top[k] = array[k*nstride];
+      } else if (step->rtype == TYPEARRAY) {
+        for (k = 0; k < n; k++) top[k] = step->array[type[ifirst+k]];
+      } else if (step->rtype == INTARRAY) {
+        for (k = 0; k < n; k++) top[k] = (double) step->iarray[ifirst+k];
+      } else {
+        for (k = 0; k < n; k++) top[k] = (double) step->barray[ifirst+k];
+      }
+      continue;
+    }
+
+    // binary operations combine top into the operand below it
+
+    if (step->second >= 0) {
+      double *a = top - ATOMBLOCK;
+      const double *b = top;
+      top = a;
+
+      if (op == ADD) for (k = 0; k < n; k++) a[k] = a[k] + b[k];
+      else if (op == SUBTRACT) for (k = 0; k < n; k++) a[k] = a[k] - b[k];
+      else if (op == MULTIPLY) for (k = 0; k < n; k++) a[k] = a[k] * b[k];
+      else if (op == DIVIDE) {
+        for (k = 0; k < n; k++)
+          if (b[k] == 0.0 && select[k])
+            error->one(FLERR,"Divide by 0 in variable formula");
+        for (k = 0; k < n; k++) a[k] = a[k] / b[k];
+      } else if (op == MODULO) {
+        for (k = 0; k < n; k++)
+          if (b[k] == 0.0 && select[k])
+            error->one(FLERR,"Modulo 0 in variable formula");
+        for (k = 0; k < n; k++) a[k] = fmod(a[k],b[k]);
+      } else if (op == CARAT) {
+        for (k = 0; k < n; k++)
+          if (b[k] == 0.0 && select[k])
+            error->one(FLERR,"Power by 0 in variable formula");
+        for (k = 0; k < n; k++) a[k] = pow(a[k],b[k]);
+      }
+      else if (op == EQ) for (k = 0; k < n; k++) a[k] = (a[k] == b[k]) ? 1.0 : 0.0;
+      else if (op == NE) for (k = 0; k < n; k++) a[k] = (a[k] != b[k]) ? 1.0 : 0.0;
+      else if (op == LT) for (k = 0; k < n; k++) a[k] = (a[k] < b[k]) ? 1.0 : 0.0;
+      else if (op == LE) for (k = 0; k < n; k++) a[k] = (a[k] <= b[k]) ? 1.0 : 0.0;
+      else if (op == GT) for (k = 0; k < n; k++) a[k] = (a[k] > b[k]) ? 1.0 : 0.0;
+      else if (op == GE) for (k = 0; k < n; k++) a[k] = (a[k] >= b[k]) ? 1.0 : 0.0;
+      else if (op == AND)
+        for (k = 0; k < n; k++) a[k] = (a[k] != 0.0 && b[k] != 0.0) ? 1.0 : 0.0;
+      else if (op == OR)
+        for (k = 0; k < n; k++) a[k] = (a[k] != 0.0 || b[k] != 0.0) ? 1.0 : 0.0;
+      else if (op == XOR)
+        for (k = 0; k < n; k++)
+          a[k] = ((a[k] == 0.0 && b[k] != 0.0) ||
+                  (a[k] != 0.0 && b[k] == 0.0)) ? 1.0 : 0.0;
+      else if (op == ATAN2) for (k = 0; k < n; k++) a[k] = atan2(a[k],b[k]);
+      continue;
+    }
+
+    // unary operations and math functions replace top
+
+    double *a = top;
+
+    if (op == SQRT || op == LN || op == LOG || op == ASIN || op == ACOS) {
+      for (k = 0; k < n; k++) {
+        if (!select[k]) continue;
+        if (op == SQRT && a[k] < 0.0)
+          error->one(FLERR,"Sqrt of negative value in variable formula");
+        if ((op == LN || op == LOG) && a[k] <= 0.0)
+          error->one(FLERR,"Log of zero/negative value in variable formula");
+        if (op == ASIN && (a[k] < -1.0 || a[k] > 1.0))
+          error->one(FLERR,"Arcsin of invalid value in variable formula");
+        if (op == ACOS && (a[k] < -1.0 || a[k] > 1.0))
+          error->one(FLERR,"Arccos of invalid value in variable formula");
+      }
+    }
+
+    if (op == UNARY) for (k = 0; k < n; k++) a[k] = -a[k];
+    else if (op == NOT) for (k = 0; k < n; k++) a[k] = (a[k] == 0.0) ? 1.0 : 0.0;
+    else if (op == SQRT) for (k = 0; k < n; k++) a[k] = sqrt(a[k]);
+    else if (op == EXP) for (k = 0; k < n; k++) a[k] = exp(a[k]);
+    else if (op == LN) for (k = 0; k < n; k++) a[k] = log(a[k]);
+    else if (op == LOG) for (k = 0; k < n; k++) a[k] = log10(a[k]);
+    else if (op == ABS) for (k = 0; k < n; k++) a[k] = fabs(a[k]);
+    else if (op == SIN) for (k = 0; k < n; k++) a[k] = sin(a[k]);
+    else if (op == COS) for (k = 0; k < n; k++) a[k] = cos(a[k]);
+    else if (op == TAN) for (k = 0; k < n; k++) a[k] = tan(a[k]);
+    else if (op == ASIN) for (k = 0; k < n; k++) a[k] = asin(a[k]);
+    else if (op == ACOS) for (k = 0; k < n; k++) a[k] = acos(a[k]);
+    else if (op == ATAN) for (k = 0; k < n; k++) a[k] = atan(a[k]);
+    else if (op == CEIL) for (k = 0; k < n; k++) a[k] = ceil(a[k]);
+    else if (op == FLOOR) for (k = 0; k < n; k++) a[k] = floor(a[k]);
+    else if (op == ROUND) for (k = 0; k < n; k++) a[k] = MYROUND(a[k]);
+  }
+
+  return top;
+}
+
 /* ----------------------------------------------------------------------
    recursive evaluation of a string str
    str is an equal-style or atom-style or vector-style formula
@@ -2116,7 +3163,7 @@ double Variable::evaluate(char *str, Tree **tree)
         if (tree) {
           Tree *newtree = new Tree();
           newtree->type = opprevious;
-          if (opprevious == UNARY) {
+          if (opprevious == UNARY || opprevious == NOT) {
             newtree->first = treestack[--ntreestack];
             newtree->second = NULL;
             newtree->nextra = 0;
@@ -22,6 +22,8 @@ namespace LAMMPS_NS {
 class Variable : protected Pointers {
  friend class Info;
  public:
+  bigint generation;       // incremented whenever a variable is added/removed
+
   Variable(class LAMMPS *);
   ~Variable();
   void set(int, char **);
@@ -48,6 +50,7 @@ class Variable : protected Pointers {
 
   tagint int_between_brackets(char *&, int);
   double evaluate_boolean(char *);
+  void invalidate_programs();
 
  private:
   int me;
@@ -93,7 +96,57 @@ class Variable : protected Pointers {
     Tree **extra;          // ptrs further down tree for nextra args
   };
 
+  // equal-style and atom-style formulas compiled once into steps,
+  // recompiled after variables, computes or fixes change
+
+  struct Instr {           // parsed node or evaluation step of a formula
+    int type;              // operation or operand, see enum{} in variable.cpp
+    int first,second;      // operand nodes while compiling, -1 if none
+    int peratom;           // 1 if value differs between atoms
+    int iarg;              // variable, atom vector, slot or per-atom column
+    int index1,index2;     // 1-based indices into global vector or array
+    double value;          // constant
+    void *ptr;             // Compute or Fix
+    char *keyword;         // thermo keyword
+    int rtype;             // ATOMARRAY, TYPEARRAY, INTARRAY or BIGINTARRAY
+    double *array;         // per-atom values, looked up on each evaluation
+    int *iarray;
+    bigint *barray;
+    int nstride;
+  };
+
+  struct Program {
+    int status;            // 0 = not compiled, 1 = compiled, -1 = use evaluate()
+    bigint generation;     // formula_generation when compiled
+    bigint compute_generation,fix_generation;
+    Instr *scalar;         // steps evaluated once per call
+    int nscalar;
+    Instr *peratom;        // steps evaluated on blocks of atoms
+    int nperatom;
+    double *slots;         // scalar results read by peratom steps
+    int nslot;
+    double *stack;         // operand stack for peratom steps
+    int depth;
+  };
+  Program *programs;
+  bigint formula_generation;   // incremented whenever any variable changes
+
+  Instr *nodes;                // parse tree while compiling a formula
+  int nnode,maxnode;
+
   int compute_python(int);
+  double evaluate_equal(int);
+  Program *program(int, int);
+  void free_program(Program *);
+  int compile(char *, int, int);
+  int compile_word(char *, char *, int &, int, int);
+  int add_node(int);
+  void emit(Program *, int, int);
+  void emit_scalar(Program *, int);
+  int stack_depth(Instr *, int);
+  double run_scalar(Program *, int);
+  void resolve_peratom(Program *);
+  double *run_peratom(Program *, int, int, int *);
   void remove(int);
   void grow();
   void copy(int, char **, char **);
@@ -0,0 +1,287 @@
+#include "atomculler.h"
+#include "atomdata.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+static const int atomsPerCell = 64;
+static const int maxCellsPerDimension = 128;
+// A cell is opaque when a ray through it is expected to hit this many atoms, so less than
+// e^-3 = 5% of the atoms behind it show through
+static const float opaqueDepth = 3.0;
+
+static bool sphereInFrustum(const QVector4D *planes, const QVector3D &center, float radius)
+{
+    for(int p=0; p<6; p++) {
+        if(QVector3D::dotProduct(planes[p].toVector3D(), center) + planes[p].w() < -radius) return false;
+    }
+    return true;
+}
+
+static bool boxInFrustum(const QVector4D *planes, const QVector3D &minimum, const QVector3D &maximum)
+{
+    for(int p=0; p<6; p++) {
+        // The corner furthest along the plane normal
+        QVector3D corner;
+        for(int d=0; d<3; d++) corner[d] = planes[p][d] >= 0 ? maximum[d] : minimum[d];
+        if(QVector3D::dotProduct(planes[p].toVector3D(), corner) + planes[p].w() < 0) return false;
+    }
+    return true;
+}
+
+static void extractPlanes(const QMatrix4x4 &viewProjection, QVector4D *planes)
+{
+    // Clip space is -w <= x, y, z <= w, each inequality is a plane in world space
+    const QVector4D row0 = viewProjection.row(0);
+    const QVector4D row1 = viewProjection.row(1);
+    const QVector4D row2 = viewProjection.row(2);
+    const QVector4D row3 = viewProjection.row(3);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+    for(int p=0; p<6; p++) {
+        // Normalized so the distance to a plane can be compared with a radius
+        const float length = planes[p].toVector3D().length();
+        if(length > 0) planes[p] /= length;
+    }
+}
+
+void AtomCuller::setCamera(const QMatrix4x4 &viewProjection, const QVector3D &cameraPosition)
+{
+    m_enabled = !viewProjection.isIdentity();
+    m_cameraPosition = cameraPosition;
+    extractPlanes(viewProjection, m_planes);
+}
+
+void AtomCuller::buildCells(const AtomData &atomData, float radius)
+{
+    const int numberOfAtoms = atomData.size();
+    const int numberOfVisibleAtoms = atomData.visible.count();
+
+    // Bounding box of the rendered positions
+    float minX = 1e30, minY = 1e30, minZ = 1e30;
+    float maxX = -1e30, maxY = -1e30, maxZ = -1e30;
+    #pragma omp parallel for reduction(min:minX,minY,minZ) reduction(max:maxX,maxY,maxZ)
+    for(int i=0; i<numberOfAtoms; i++) {
+        if(!atomData.visible.test(i)) continue;
+        const QVector3D position = atomData.position(i);
+        minX = std::min(minX, position[0]); maxX = std::max(maxX, position[0]);
+        minY = std::min(minY, position[1]); maxY = std::max(maxY, position[1]);
+        minZ = std::min(minZ, position[2]); maxZ = std::max(maxZ, position[2]);
+    }
+
+    // Roughly cubic cells with atomsPerCell atoms on average
+    m_origin = QVector3D(minX, minY, minZ);
+    QVector3D extent = QVector3D(maxX, maxY, maxZ) - m_origin;
+    for(int d=0; d<3; d++) extent[d] = std::max(extent[d], 2*radius);
+    const float cellLength = std::cbrt(extent[0]*extent[1]*extent[2]*atomsPerCell / numberOfVisibleAtoms);
+    for(int d=0; d<3; d++) {
+        m_numCells[d] = std::max(1, std::min(maxCellsPerDimension, int(std::ceil(extent[d] / cellLength))));
+        // Slightly larger so the atoms on the maximum edge fall inside the last cell
+        m_cellSize[d] = 1.0001f*extent[d] / m_numCells[d];
+    }
+
+    const int totalCells = m_numCells[0]*m_numCells[1]*m_numCells[2];
+    const QVector3D oneOverCellSize = QVector3D(1, 1, 1) / m_cellSize;
+    m_cellCount.fill(0, totalCells);
+    m_cellOfAtom.resize(numberOfAtoms);
+    int *cellOfAtom = m_cellOfAtom.data();
+    // Each thread counts in its own cells, merged at the end
+    #pragma omp parallel
+    {
+        QVector<int> localCounts(totalCells, 0);
+        #pragma omp for nowait
+        for(int i=0; i<numberOfAtoms; i++) {
+            if(!atomData.visible.test(i)) {
+                cellOfAtom[i] = -1;
+                continue;
+            }
+            const QVector3D position = atomData.position(i);
+            int cell[3];
+            for(int d=0; d<3; d++) {
+                cell[d] = std::max(0, std::min(m_numCells[d] - 1, int((position[d] - m_origin[d]) * oneOverCellSize[d])));
+            }
+            const int index = cellIndex(cell[0], cell[1], cell[2]);
+            cellOfAtom[i] = index;
+            localCounts[index]++;
+        }
+        #pragma omp critical
+        for(int cell=0; cell<totalCells; cell++) m_cellCount[cell] += localCounts[cell];
+    }
+}
+
+bool AtomCuller::isOccluded(int cx, int cy, int cz, float radius) const
+{
+    // Cells on the edge of the grid can be seen from outside
+    if(cx == 0 || cy == 0 || cz == 0) return false;
+    if(cx == m_numCells[0]-1 || cy == m_numCells[1]-1 || cz == m_numCells[2]-1) return false;
+
+    // Nor can they be hidden when the camera is in or next to them
+    const QVector3D camera = (m_cameraPosition - m_origin) / m_cellSize;
+    if(std::abs(std::floor(camera[0]) - cx) <= 1 && std::abs(std::floor(camera[1]) - cy) <= 1 && std::abs(std::floor(camera[2]) - cz) <= 1) return false;
+
+    // Expected number of atoms a ray crossing a neighbor cell hits is count*pi*r^2*length/volume
+    const float minimumLength = std::min(m_cellSize[0], std::min(m_cellSize[1], m_cellSize[2]));
+    const float volume = m_cellSize[0]*m_cellSize[1]*m_cellSize[2];
+    const float opaqueCount = opaqueDepth*volume / (M_PI*radius*radius*minimumLength);
+    for(int dz=-1; dz<=1; dz++) {
+        for(int dy=-1; dy<=1; dy++) {
+            for(int dx=-1; dx<=1; dx++) {
+                if(m_cellCount[cellIndex(cx+dx, cy+dy, cz+dz)] < opaqueCount) return false;
+            }
+        }
+    }
+    return true;
+}
+
+void AtomCuller::cull(const AtomData &atomData, float radius, BitMask &keep, QVector<SphereVBOData> &splats)
+{
+    keep = atomData.visible;
+    splats.clear();
+    m_culledCount = 0;
+    const int numberOfVisibleAtoms = keep.count();
+    if(!m_enabled || numberOfVisibleAtoms == 0) return;
+
+    buildCells(atomData, radius);
+    const int totalCells = m_numCells[0]*m_numCells[1]*m_numCells[2];
+    m_cellState.resize(totalCells);
+    CellState *cellState = m_cellState.data();
+    #pragma omp parallel for
+    for(int cell=0; cell<totalCells; cell++) {
+        if(m_cellCount[cell] == 0) {
+            cellState[cell] = Culled;
+            continue;
+        }
+        const int cx = cell % m_numCells[0];
+        const int cy = (cell / m_numCells[0]) % m_numCells[1];
+        const int cz = cell / (m_numCells[0]*m_numCells[1]);
+        const QVector3D minimum = m_origin + QVector3D(cx, cy, cz)*m_cellSize;
+        const QVector3D maximum = minimum + m_cellSize;
+        const QVector3D padding(radius, radius, radius);
+        const float distance = (0.5f*(minimum + maximum) - m_cameraPosition).length();
+
+        if(!boxInFrustum(m_planes, minimum - padding, maximum + padding)) cellState[cell] = Culled;
+        else if(m_occlusionCulling && isOccluded(cx, cy, cz, radius)) cellState[cell] = Culled;
+        else if(m_lodDistance > 0 && distance > m_lodDistance && m_cellCount[cell] > 1) cellState[cell] = Splat;
+        else cellState[cell] = Visible;
+    }
+
+    const int *cellOfAtom = m_cellOfAtom.constData();
+    keep.keepIf([&](int i) { return cellState[cellOfAtom[i]] == Visible; });
+    m_culledCount = numberOfVisibleAtoms - keep.count();
+
+    if(m_lodDistance <= 0) return;
+    // One splat per distant cell with the average position and color of its atoms
+    QVector<int> splatOfCell(totalCells, -1);
+    for(int cell=0; cell<totalCells; cell++) {
+        if(m_cellState[cell] != Splat) continue;
+        splatOfCell[cell] = splats.size();
+        splats.append(SphereVBOData{QVector3D(), QVector3D(), 0});
+    }
+    for(int i=0; i<atomData.size(); i++) {
+        if(m_cellOfAtom[i] < 0) continue;
+        const int splat = splatOfCell[m_cellOfAtom[i]];
+        if(splat < 0) continue;
+        splats[splat].position += atomData.position(i);
+        splats[splat].color += atomData.colors[i];
+    }
+    // Same volume as the atoms it replaces, but no larger than the cell
+    const float maximumRadius = 0.5f*m_cellSize.length();
+    for(int cell=0; cell<totalCells; cell++) {
+        const int splat = splatOfCell[cell];
+        if(splat < 0) continue;
+        const float count = m_cellCount[cell];
+        splats[splat].position /= count;
+        splats[splat].color /= count;
+        splats[splat].radius = std::min(maximumRadius, radius*std::cbrt(count));
+    }
+}
+
+long AtomCuller::memoryUsage() const
+{
+    return m_cellOfAtom.capacity()*sizeof(int) + m_cellCount.capacity()*sizeof(int) +
+           m_cellState.capacity()*sizeof(CellState);
+}
+
+void AtomCuller::cullBruteForce(const AtomData &atomData, float radius, const QMatrix4x4 &viewProjection, BitMask &keep)
+{
+    QVector4D planes[6];
+    extractPlanes(viewProjection, planes);
+    keep = atomData.visible;
+    keep.keepIf([&](int i) {
+        return sphereInFrustum(planes, atomData.position(i), radius);
+    });
+}
+
+void AtomCuller::benchmark(int numberOfAtoms)
+{
+    // Uniform bulk with unit density, seen from just outside one of the faces
+    AtomData atomData;
+    atomData.resize(numberOfAtoms);
+    const float length = std::cbrt(float(std::max(1, numberOfAtoms)));
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(0.0, length);
+    for(int i=0; i<numberOfAtoms; i++) {
+        atomData.setPosition(i, QVector3D(distribution(generator), distribution(generator), distribution(generator)));
+        atomData.colors[i] = QVector3D(1.0, 0.5, 0.0);
+    }
+    atomData.visible.resize(numberOfAtoms, true);
+
+    const float radius = 0.6;
+    const QVector3D center(0.5*length, 0.5*length, 0.5*length);
+    const QVector3D cameraPosition = center + QVector3D(0.9, 0.3, 0.2)*length;
+    QMatrix4x4 viewProjection;
+    viewProjection.perspective(50, 1.6, 0.1, 10*length);
+    viewProjection.lookAt(cameraPosition, center, QVector3D(0, 0, 1));
+
+    const int repetitions = 10;
+    BitMask reference;
+    BitMask keep;
+    QVector<SphereVBOData> splats;
+    QElapsedTimer timer;
+    timer.start();
+    for(int repetition=0; repetition<repetitions; repetition++) {
+        cullBruteForce(atomData, radius, viewProjection, reference);
+    }
+    const qint64 bruteForceTime = timer.nsecsElapsed();
+
+    AtomCuller culler;
+    culler.setCamera(viewProjection, cameraPosition);
+    culler.setOcclusionCulling(false);
+    timer.start();
+    for(int repetition=0; repetition<repetitions; repetition++) {
+        culler.cull(atomData, radius, keep, splats);
+    }
+    const qint64 frustumTime = timer.nsecsElapsed();
+
+    // The grid test is conservative, every atom the reference keeps must be kept
+    int missed = 0;
+    for(int i=0; i<numberOfAtoms; i++) {
+        if(reference.test(i) && !keep.test(i)) missed++;
+    }
+    const int frustumCount = keep.count();
+
+    culler.setOcclusionCulling(true);
+    timer.start();
+    for(int repetition=0; repetition<repetitions; repetition++) {
+        culler.cull(atomData, radius, keep, splats);
+    }
+    const qint64 occlusionTime = timer.nsecsElapsed();
+    const int occlusionCount = keep.count();
+
+    culler.setLodDistance(0.9*length);
+    culler.cull(atomData, radius, keep, splats);
+
+    const double nanosecondsPerAtom = 1.0 / (double(repetitions) * std::max(1, numberOfAtoms));
+    qDebug() << "Atom culling with" << numberOfAtoms << "atoms (ns/atom)";
+    qDebug() << "  brute force frustum:" << bruteForceTime*nanosecondsPerAtom << "keeps" << reference.count();
+    qDebug() << "  grid frustum:       " << frustumTime*nanosecondsPerAtom << "keeps" << frustumCount << "missed" << missed;
+    qDebug() << "  grid with occlusion:" << occlusionTime*nanosecondsPerAtom << "keeps" << occlusionCount;
+    qDebug() << "  with splats:        " << "keeps" << keep.count() << "plus" << splats.size() << "splats";
+    if(missed > 0) qWarning() << "AtomCuller: Grid culling dropped" << missed << "atoms inside the frustum";
+}
@@ -0,0 +1,57 @@
+#ifndef ATOMCULLER_H
+#define ATOMCULLER_H
+#include <QMatrix4x4>
+#include <QVector4D>
+#include <QVector>
+#include <QVector3D>
+#include <SimVis/SphereData>
+
+class AtomData;
+class BitMask;
+
+// Drops atoms that can not be seen before they are packed into the sphere VBO. Visible atoms
+// are binned in a coarse uniform grid and whole cells are tested at once:
+// - cells whose bounding box (padded by the sphere radius) is outside the view frustum,
+// - cells in the bulk, where all 26 neighbors are dense enough to be opaque,
+// - cells further from the camera than lodDistance are replaced by a single splat with the
+//   average position and color of their atoms.
+// The frustum test is conservative, every atom that intersects the frustum is kept.
+class AtomCuller
+{
+public:
+    // viewProjection maps world coordinates to clip coordinates. The identity disables culling.
+    void setCamera(const QMatrix4x4 &viewProjection, const QVector3D &cameraPosition);
+    void setOcclusionCulling(bool occlusionCulling) { m_occlusionCulling = occlusionCulling; }
+    void setLodDistance(float lodDistance) { m_lodDistance = lodDistance; }
+    // Clears the bit in keep of every culled atom or atom merged into a splat, keep starts as atomData.visible
+    void cull(const AtomData &atomData, float radius, BitMask &keep, QVector<SphereVBOData> &splats);
+    int culledCount() const { return m_culledCount; }
+    long memoryUsage() const;
+
+    // Frustum test of each atom on its own, the reference for the grid version
+    static void cullBruteForce(const AtomData &atomData, float radius, const QMatrix4x4 &viewProjection, BitMask &keep);
+    // Compares against cullBruteForce and prints the time per atom, for atomify --benchmark
+    static void benchmark(int numberOfAtoms);
+
+private:
+    enum CellState : char { Culled, Visible, Splat };
+    void buildCells(const AtomData &atomData, float radius);
+    bool isOccluded(int cx, int cy, int cz, float radius) const;
+    int cellIndex(int cx, int cy, int cz) const { return cx + m_numCells[0]*(cy + m_numCells[1]*cz); }
+
+    QVector4D m_planes[6]; // Frustum planes, a point p is inside when dot(plane, (p, 1)) >= 0 for all
+    QVector3D m_cameraPosition;
+    bool m_enabled = false;
+    bool m_occlusionCulling = true;
+    float m_lodDistance = 0; // 0 disables splats
+    int m_culledCount = 0;
+
+    QVector<int> m_cellOfAtom; // -1 for hidden atoms
+    QVector<int> m_cellCount;
+    QVector<CellState> m_cellState;
+    int m_numCells[3] = {0, 0, 0};
+    QVector3D m_origin;
+    QVector3D m_cellSize;
+};
+
+#endif // ATOMCULLER_H
@@ -1,8 +1,94 @@
 #include "atomdata.h"
 #include <QDebug>
+#include <QtAlgorithms>
+#include <QElapsedTimer>
+#include <atomic>
+
+void BitMask::resize(int size, bool value)
+{
+    // Existing bits are kept, new bits get value
+    int oldSize = m_size;
+    m_size = size;
+    m_words.resize((size + 63) / 64);
+    for(int index=oldSize; index<size; index++) {
+        setValue(index, value);
+    }
+    clearUnusedBits();
+}
+
+void BitMask::fill(bool value)
+{
+    m_words.fill(value ? ~quint64(0) : quint64(0));
+    clearUnusedBits();
+}
+
+void BitMask::clearUnusedBits()
+{
+    // Keep the unused bits of the last word cleared so count() is correct
+    if(m_size & 63) {
+        m_words.last() &= (quint64(1) << (m_size & 63)) - 1;
+    }
+}
+
+int BitMask::count() const
+{
+    int count = 0;
+    for(const quint64 &word : m_words) {
+        count += qPopulationCount(word);
+    }
+    return count;
+}
+
+void BitMask::clear()
+{
+    m_words.clear();
+    m_size = 0;
+}
+
+void AtomData::touch(int channels)
+{
+    static std::atomic<quint64> nextGeneration(1);
+    for(int channel=0; channel<NumberOfChannels; channel++) {
+        if(channels & (1 << channel)) generations[channel] = nextGeneration++;
+    }
+}
+
+bool AtomData::hasChanged(int channels, const quint64 *previousGenerations) const
+{
+    for(int channel=0; channel<NumberOfChannels; channel++) {
+        if((channels & (1 << channel)) && generations[channel] != previousGenerations[channel]) return true;
+    }
+    return false;
+}
+
+void AtomData::copyChannels(const AtomData &other, int channels)
+{
+    // Implicitly shared, so this only copies references
+    if(channels & Positions) { x = other.x; y = other.y; z = other.z; }
+    if(channels & Images) std::copy(other.images, other.images + 3, images);
+    if(channels & Colors) colors = other.colors;
+    if(channels & Radii) radii = other.radii;
+    if(channels & OriginalIndex) originalIndex = other.originalIndex;
+    if(channels & Bitmask) bitmask = other.bitmask;
+    if(channels & Types) types = other.types;
+    if(channels & Visible) visible = other.visible;
+    for(int channel=0; channel<NumberOfChannels; channel++) {
+        if(channels & (1 << channel)) generations[channel] = other.generations[channel];
+    }
+}
+
+void AtomData::setPosition(int index, const QVector3D &position)
+{
+    x[index] = position[0];
+    y[index] = position[1];
+    z[index] = position[2];
+}
+
 bool AtomData::isValid()
 {
-    return positions.size() == colors.size() &&
+    return x.size() == y.size() &&
+            y.size() == z.size() &&
+            z.size() == colors.size() &&
             colors.size() == radii.size() &&
             radii.size() == types.size() &&
             types.size() == originalIndex.size() &&
@@ -12,8 +98,9 @@ bool AtomData::isValid()
 
 void AtomData::resize(int size)
 {
-    positions.resize(size);
-    deltaPositions.resize(size);
+    x.resize(size);
+    y.resize(size);
+    z.resize(size);
     colors.resize(size);
     radii.resize(size);
     types.resize(size);
@@ -22,32 +109,72 @@ void AtomData::resize(int size)
     visible.resize(size);
 }
 
-int AtomData::size()
+int AtomData::size() const
 {
-    return positions.size();
+    return x.size();
 }
 
 void AtomData::reset()
 {
-    positions.clear();
-    deltaPositions.clear();
+    x.clear();
+    y.clear();
+    z.clear();
     colors.clear();
     radii.clear();
     types.clear();
     originalIndex.clear();
     bitmask.clear();
     visible.clear();
+    properties.clear();
+    replayed = false;
+    std::fill(images, images + 3, 1);
 }
 
 long AtomData::memoryUsage()
 {
-    return (positions.capacity() + deltaPositions.capacity() + colors.capacity())*sizeof(QVector3D)
-            +(radii.capacity())*sizeof(float)
+    return colors.capacity()*sizeof(QVector3D)
+            +(x.capacity() + y.capacity() + z.capacity() + radii.capacity())*sizeof(float)
             +(originalIndex.capacity() + types.capacity() + bitmask.capacity())*sizeof(int)
-            +visible.capacity()*sizeof(bool);
+            +visible.memoryUsage();
 }
 
 AtomData::~AtomData()
 {
     reset();
 }
+
+void AtomData::benchmark(int numberOfAtoms)
+{
+    // One synchronized frame: the modifier caches still share the channels of the previous one
+    AtomData atomData;
+    atomData.resize(numberOfAtoms);
+    const int repetitions = 10;
+    QElapsedTimer timer;
+    qint64 detachTime = 0, overwriteTime = 0;
+    for(int repetition=0; repetition<repetitions; repetition++) {
+        AtomData cached = atomData;
+        timer.start();
+        float *x = atomData.x.data();
+        float *y = atomData.y.data();
+        float *z = atomData.z.data();
+        for(int i=0; i<numberOfAtoms; i++) {
+            x[i] = i; y[i] = i; z[i] = i;
+        }
+        detachTime += timer.nsecsElapsed();
+
+        cached = atomData;
+        timer.start();
+        x = overwrite(atomData.x);
+        y = overwrite(atomData.y);
+        z = overwrite(atomData.z);
+        for(int i=0; i<numberOfAtoms; i++) {
+            x[i] = i; y[i] = i; z[i] = i;
+        }
+        overwriteTime += timer.nsecsElapsed();
+    }
+
+    const double nanosecondsPerAtom = 1.0 / (double(repetitions) * std::max(1, numberOfAtoms));
+    qDebug() << "Writing shared positions with" << numberOfAtoms << "atoms (ns/atom)";
+    qDebug() << "  detach and write:    " << detachTime*nanosecondsPerAtom;
+    qDebug() << "  new buffer and write:" << overwriteTime*nanosecondsPerAtom;
+}
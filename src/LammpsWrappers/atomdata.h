@@ -2,28 +2,110 @@
 #define ATOMDATA_H
 #include <QVector3D>
 #include <QVector>
+#include <QHash>
+#include <QString>
+#include <algorithm>
 #include "neighborlist.h"
 
+// Packed bit per atom, stored in 64 bit words so kernels can work on whole words in parallel
+// without two threads touching the same word.
+class BitMask {
+public:
+    void resize(int size, bool value = true);
+    void fill(bool value);
+    int size() const { return m_size; }
+    int count() const;
+    bool test(int index) const { return (m_words[index >> 6] >> (index & 63)) & 1; }
+    void set(int index) { m_words[index >> 6] |= (quint64(1) << (index & 63)); }
+    void reset(int index) { m_words[index >> 6] &= ~(quint64(1) << (index & 63)); }
+    void setValue(int index, bool value) { if(value) set(index); else reset(index); }
+    int wordCount() const { return m_words.size(); }
+    quint64 *words() { return m_words.data(); }
+    const quint64 *constWords() const { return m_words.constData(); }
+    long memoryUsage() const { return m_words.capacity()*sizeof(quint64); }
+    void clear();
+
+    // Resets the bit of every atom for which keep(index) is false, parallel over words
+    template<typename Predicate>
+    void keepIf(Predicate keep) {
+        quint64 *words = m_words.data();
+        const int numWords = m_words.size();
+        const int size = m_size;
+        #pragma omp parallel for
+        for(int word=0; word<numWords; word++) {
+            quint64 bits = words[word];
+            if(!bits) continue;
+            const int begin = word*64;
+            const int end = std::min(begin + 64, size);
+            for(int index=begin; index<end; index++) {
+                if(!keep(index)) bits &= ~(quint64(1) << (index - begin));
+            }
+            words[word] = bits;
+        }
+    }
+
+private:
+    void clearUnusedBits();
+    QVector<quint64> m_words;
+    int m_size = 0;
+};
+
+// Structure of arrays. All channels are implicitly shared QVectors, so copying an AtomData
+// is cheap and a modifier only pays for copying the channels it actually writes to.
 class AtomData {
 public:
+    // Channels, used by modifiers to declare what they read and write
+    enum Channel {
+        Positions = 1 << 0,
+        Images = 1 << 1,
+        Colors = 1 << 2,
+        Radii = 1 << 3,
+        OriginalIndex = 1 << 4,
+        Bitmask = 1 << 5,
+        Types = 1 << 6,
+        Visible = 1 << 7,
+        AllChannels = (1 << 8) - 1
+    };
+    enum { NumberOfChannels = 8 };
+
     bool dirty = false;
     bool paused = false;
     bool radiiFromLAMMPS = false;
-    QVector<QVector3D> positions;
-    QVector<QVector3D> deltaPositions; // For periodic copies
+    bool replayed = false; // A frame from TrajectoryRecorder, colored by its recorded properties
+    QVector<float> x;
+    QVector<float> y;
+    QVector<float> z;
     QVector<QVector3D> colors;
     QVector<float> radii;
     QVector<int> originalIndex;
     QVector<int> bitmask; // For detecting group membership
     QVector<int> types;
-    QVector<bool> visible;
+    BitMask visible;
+    QHash<QString, QVector<double>> properties; // Per atom values of controls by identifier, only on replayed frames
+    int images[3] = {1, 1, 1}; // Periodic images along each cell vector, drawn by instancing
+    quint64 generations[NumberOfChannels] = {}; // Changes whenever the content of a channel changes
+    QVector3D position(int index) const { return QVector3D(x[index], y[index], z[index]); }
+    void setPosition(int index, const QVector3D &position);
     bool isValid();
     void resize(int size);
-    int size();
+    int size() const;
+    int imageCount() const { return images[0]*images[1]*images[2]; }
     void reset();
-    void sort(QVector3D cameraPosition);
+    void touch(int channels);
+    bool hasChanged(int channels, const quint64 *previousGenerations) const;
+    void copyChannels(const AtomData &other, int channels);
     ~AtomData();
     long memoryUsage();
+    // Prints the time per atom of writing a shared channel, for atomify --benchmark
+    static void benchmark(int numberOfAtoms);
+
+    // Writable pointer to a channel whose every element is about to be overwritten. A channel
+    // still shared with a modifier cache gets a new buffer instead of a detaching copy.
+    template<typename T>
+    static T *overwrite(QVector<T> &channel) {
+        if(!channel.isDetached()) channel = QVector<T>(channel.size());
+        return channel.data();
+    }
 };
 
 #endif // ATOMDATA_H
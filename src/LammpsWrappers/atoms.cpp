@@ -1,21 +1,25 @@
 #include "atoms.h"
 #include <algorithm>
-#include <fix_atomify.h>
+#include <cmath>
 #include <atom.h>
 #include <domain.h>
 #include <neighbor.h>
 #include <neigh_request.h>
-#include <neigh_list.h>
 #include <force.h>
+#include <update.h>
 #include <QDir>
 #include <QStandardPaths>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QElapsedTimer>
 #include "modifiers/modifiers.h"
 #include "mysimulator.h"
 #include "bonds.h"
 #include "system.h"
+#include "trajectoryreader.h"
+#include "simulatorcontrols/simulatorcontrol.h"
+#include "../performance.h"
 using namespace LAMMPS_NS;
 
 Atoms::Atoms(AtomifySimulator *simulator)
@@ -27,6 +31,7 @@ Atoms::Atoms(AtomifySimulator *simulator)
     m_sphereData = new SphereData(simulator);
     m_bondData = new BondData(simulator);
     m_bonds = new Bonds();
+    m_recorder = new TrajectoryRecorder(this);
 
     for(int i=0; i<200; i++) {
         m_atomStyles.push_back(m_atomStyleTypes["hydrogen"]);
@@ -63,95 +68,269 @@ void Atoms::synchronize(LAMMPSController *lammpsController)
     LAMMPS *lammps = lammpsController->lammps();
     if(!lammps) { return; }
 
+    ProfilerScope profilerScope(lammpsController->system->performance()->profiler(), "Atoms::synchronize");
+    QElapsedTimer timer;
+    timer.start();
     Atom *atom = lammps->atom;
     Domain *domain = lammps->domain;
-    int *types = lammps->atom->type;
-    int numberOfAtoms = atom->natoms;
-
-    if(m_atomData.positions.size() != numberOfAtoms) {
-        m_atomData.positions.resize(numberOfAtoms);
-    }
-    if(m_atomData.deltaPositions.size() != numberOfAtoms) {
-        m_atomData.deltaPositions.resize(numberOfAtoms);
-        for(QVector3D &delta : m_atomData.deltaPositions) delta = QVector3D(); // Reset delta
+    const int numberOfAtoms = atom->natoms;
+
+    if(m_replayedFrame >= 0) {
+        // Back to live data, the recorded frame shown while paused is replaced below
+        m_replayedFrame = -1;
+        m_liveAtomData = AtomData();
+        m_atomData.properties.clear();
+        m_atomData.replayed = false;
     }
-    if(m_atomData.types.size() != numberOfAtoms) {
-        m_atomData.types.resize(numberOfAtoms);
+    resizeAtomData(numberOfAtoms);
+
+    m_atomData.radiiFromLAMMPS = atom->radius_flag;
+    if(numberOfAtoms == 0) {
+        // Still a new (empty) frame, otherwise the last atoms stay on screen
+        m_atomData.dirty = true;
+        m_atomData.paused = false;
+        return;
     }
-    if(m_atomData.bitmask.size() != numberOfAtoms) {
-        m_atomData.bitmask.resize(numberOfAtoms);
+
+    // Remap into system boundaries with PBC. Same result as Domain::remap, but done in reduced
+    // (lamda) coordinates for both orthogonal and triclinic boxes so the loop has no branches
+    // and can be vectorized and threaded.
+    const double *boxlo = domain->boxlo;
+    const double *h = domain->h;
+    const double *h_inv = domain->h_inv;
+    const double periodic[3] = {double(domain->xperiodic), double(domain->yperiodic), double(domain->zperiodic)};
+    const double scale = m_globalScale;
+    const double *x = atom->x[0];
+    const int *type = atom->type;
+    const int *mask = atom->mask;
+    float *positionX = AtomData::overwrite(m_atomData.x);
+    float *positionY = AtomData::overwrite(m_atomData.y);
+    float *positionZ = AtomData::overwrite(m_atomData.z);
+    int *types = AtomData::overwrite(m_atomData.types);
+    int *bitmask = AtomData::overwrite(m_atomData.bitmask);
+
+    #pragma omp parallel for
+    for(int i=0; i<numberOfAtoms; i++) {
+        const double dx = x[3*i+0] - boxlo[0];
+        const double dy = x[3*i+1] - boxlo[1];
+        const double dz = x[3*i+2] - boxlo[2];
+        double lamda0 = h_inv[0]*dx + h_inv[5]*dy + h_inv[4]*dz;
+        double lamda1 = h_inv[1]*dy + h_inv[3]*dz;
+        double lamda2 = h_inv[2]*dz;
+        lamda0 -= periodic[0]*floor(lamda0);
+        lamda1 -= periodic[1]*floor(lamda1);
+        lamda2 -= periodic[2]*floor(lamda2);
+
+        positionX[i] = (h[0]*lamda0 + h[5]*lamda1 + h[4]*lamda2 + boxlo[0])*scale;
+        positionY[i] = (h[1]*lamda1 + h[3]*lamda2 + boxlo[1])*scale;
+        positionZ[i] = (h[2]*lamda2 + boxlo[2])*scale;
+        types[i] = type[i];
+        bitmask[i] = mask[i];
     }
-    if(m_atomData.visible.size() != numberOfAtoms) {
-        m_atomData.visible.resize(numberOfAtoms);
+
+    if(m_atomData.radiiFromLAMMPS) {
+        const double *radius = atom->radius;
+        float *radii = AtomData::overwrite(m_atomData.radii);
+        #pragma omp parallel for
+        for(int i=0; i<numberOfAtoms; i++) {
+            radii[i] = radius[i];
+        }
+        m_atomData.touch(AtomData::Radii);
     }
-    if(m_atomData.colors.size() != numberOfAtoms) {
-        m_atomData.colors.resize(numberOfAtoms);
-        for(QVector3D &color : m_atomData.colors) color = QVector3D(0.9, 0.2, 0.1);
+    m_atomData.touch(AtomData::Positions | AtomData::Types | AtomData::Bitmask);
+
+    m_atomData.dirty = true;
+    m_atomData.paused = false;
+
+    Performance *performance = lammpsController->system->performance();
+    double nanosecondsPerAtom = double(timer.nsecsElapsed()) / numberOfAtoms;
+    nanosecondsPerAtom = 0.9*performance->synchronizationNanosecondsPerAtom() + 0.1*nanosecondsPerAtom; // low pass filter
+    performance->setSynchronizationNanosecondsPerAtom(nanosecondsPerAtom);
+
+    if(m_recorder->recording()) {
+        ProfilerScope profilerScope(performance->profiler(), "TrajectoryRecorder::record");
+        // Per atom values are only sampled on frames for hovered controls and open histograms
+        QHash<QString, QVector<double>> properties;
+        for(SimulatorControl *control : lammpsController->system->simulatorControls()) {
+            if(!control->isPerAtom() || !(control->hovered() || control->window())) continue;
+            const std::vector<double> &values = control->atomData();
+            if(int(values.size()) != numberOfAtoms) continue;
+            properties.insert(control->identifier(), QVector<double>(values.begin(), values.end()));
+        }
+        m_recorder->record(m_atomData, lammps->update->ntimestep, properties);
     }
-    if(m_atomData.originalIndex.size() != numberOfAtoms) {
-        m_atomData.originalIndex.resize(numberOfAtoms);
+}
+
+void Atoms::resizeAtomData(int numberOfAtoms)
+{
+    if(m_atomData.size() == numberOfAtoms) return;
+    m_atomData.resize(numberOfAtoms);
+    m_atomData.colors.fill(QVector3D(0.9, 0.2, 0.1));
+    m_atomData.radii.fill(1.0);
+    m_atomData.visible.fill(true);
+    for(int i=0; i<numberOfAtoms; i++) m_atomData.originalIndex[i] = i;
+    m_atomData.touch(AtomData::AllChannels);
+}
+
+void Atoms::replayRecordedFrame()
+{
+    // Called on the LAMMPS thread while paused, shows the frame picked on the timeline
+    // instead of the live one without touching LAMMPS
+    const int frame = m_recorder->playbackFrame();
+    if(frame == m_replayedFrame) return;
+    if(m_replayedFrame < 0) m_liveAtomData = m_atomData;
+
+    const int numberOfAtoms = m_recorder->numberOfAtoms(frame);
+    if(numberOfAtoms >= 0) {
+        resizeAtomData(numberOfAtoms);
+        m_recorder->decode(frame, m_atomData);
+        m_replayedFrame = frame;
+    } else {
+        m_atomData = m_liveAtomData;
+        m_atomData.touch(AtomData::AllChannels);
+        m_liveAtomData = AtomData();
+        m_replayedFrame = -1;
     }
-    if(m_atomData.radii.size() != numberOfAtoms) {
-        m_atomData.radii.resize(numberOfAtoms);
-        for(float &radii : m_atomData.radii) radii = 1.0;
+    m_atomData.dirty = true;
+}
+
+bool Atoms::renderingStateChanged(System *system)
+{
+    // Called on the GUI thread while paused. Everything the drawn frame depends on besides
+    // the atoms and the camera, so unchanged frames are not processed again.
+    QVector<double> state;
+    state << m_recorder->playbackFrame() << system->trajectoryReader()->playbackFrame();
+    state << m_sort << m_culling << m_lodDistance << m_globalScale << m_bondScale << m_sphereScale;
+    state << qHash(m_renderingMode) << m_bonds->enabled() << m_modifiers.size();
+    for(QVariant &variant : m_modifiers) {
+        for(float value : variant.value<Modifier*>()->fingerprint()) state << value;
     }
+    bool changed = state != m_renderingState;
+    m_renderingState = state;
+    return changed;
+}
 
-    m_atomData.radiiFromLAMMPS = lammps->atom->radius_flag;
+void Atoms::synchronizeTrajectoryFrame(const TrajectoryFrame &frame)
+{
+    // A frame read from a trajectory file instead of LAMMPS. Positions are already inside the box.
+    const int numberOfAtoms = frame.size();
+    m_replayedFrame = -1;
+    m_liveAtomData = AtomData();
+    resizeAtomData(numberOfAtoms);
+    m_atomData.radiiFromLAMMPS = false;
+
+    // XYZ files name their elements, use the matching styles for those types
+    for(int type=1; type<frame.typeNames.size() && type<m_atomStyles.size(); type++) {
+        const QString shortName = QString::fromUtf8(frame.typeNames[type]);
+        for(AtomStyle *atomStyle : m_atomStyleTypes) {
+            if(atomStyle->shortName.compare(shortName, Qt::CaseInsensitive) != 0) continue;
+            m_atomStyles[type] = atomStyle;
+            break;
+        }
+    }
 
+    const float scale = m_globalScale;
+    const int maximumType = m_atomStyles.size() - 1;
+    const float *x = frame.x.constData();
+    const float *y = frame.y.constData();
+    const float *z = frame.z.constData();
+    const int *type = frame.types.constData();
+    float *positionX = AtomData::overwrite(m_atomData.x);
+    float *positionY = AtomData::overwrite(m_atomData.y);
+    float *positionZ = AtomData::overwrite(m_atomData.z);
+    int *types = AtomData::overwrite(m_atomData.types);
+    int *bitmask = AtomData::overwrite(m_atomData.bitmask);
+
+    #pragma omp parallel for
     for(int i=0; i<numberOfAtoms; i++) {
-        m_atomData.types[i] = types[i];
-        m_atomData.originalIndex[i] = i;
-
-        double position[3];
-        position[0] = atom->x[i][0];
-        position[1] = atom->x[i][1];
-        position[2] = atom->x[i][2];
-        if(m_atomData.radiiFromLAMMPS) {
-            m_atomData.radii[i] = atom->radius[i];
-        }
-        domain->remap(position); // remap into system boundaries with PBC
-
-        m_atomData.positions[i][0] = position[0]*m_globalScale;
-        m_atomData.positions[i][1] = position[1]*m_globalScale;
-        m_atomData.positions[i][2] = position[2]*m_globalScale;
-        m_atomData.bitmask[i] = atom->mask[i];
-        m_atomData.visible[i] = true;
-        m_atomData.deltaPositions[i] = QVector3D();
+        positionX[i] = x[i]*scale;
+        positionY[i] = y[i]*scale;
+        positionZ[i] = z[i]*scale;
+        types[i] = std::max(0, std::min(type[i], maximumType));
+        bitmask[i] = 1; // Only the group all
     }
+    m_atomData.touch(AtomData::Positions | AtomData::Types | AtomData::Bitmask);
+
     m_atomData.dirty = true;
     m_atomData.paused = false;
 }
 
 void Atoms::processModifiers(System *system)
 {
-    m_atomDataProcessed = m_atomData;
-    if(!m_atomDataProcessed.isValid()) {
+    if(!m_atomData.isValid()) {
         qDebug() << "Atom data is not valid before modifiers.";
         exit(1);
     }
 
+    // Each modifier caches its output and is only rerun when its input channels or its
+    // state changed, so e.g. moving a slice plane only reruns the slice.
+    Profiler *profiler = system->performance()->profiler();
+    QVariantMap timings;
+    AtomData input = m_atomData;
     for(QVariant &modifier_ : m_modifiers) {
         Modifier *modifier = modifier_.value<Modifier*>();
         modifier->setSystem(system);
-        modifier->apply(m_atomDataProcessed);
+
+        // Keyed per instance, two modifiers of the same class must not share an entry
+        QString name = modifier->objectName();
+        if(name.isEmpty()) name = modifier->metaObject()->className();
+        if(timings.contains(name)) name += QString("#%1").arg(timings.size());
+        qint64 start = profiler->now();
+        modifier->process(input, m_atomDataProcessed);
+        qint64 duration = profiler->now() - start;
+        profiler->record(profiler->intern(name), start, duration);
+        timings[name] = duration*1e-6;
+
         if(!m_atomDataProcessed.isValid()) {
-            // TODO: insert modifier name to debug message
-            qDebug() << "Atom data is not valid after modifier.";
+            qDebug() << "Atom data is not valid after modifier " << modifier->metaObject()->className();
             exit(1);
         }
+        input = m_atomDataProcessed;
     }
+    m_atomDataProcessed = input;
+    system->performance()->setModifierTimings(timings);
 }
 
 void Atoms::createRenderererData(LAMMPSController *lammpsController) {
-    generateSphereData(m_atomDataProcessed);
-    generateBondData(m_atomDataProcessed, lammpsController);
+    if(!m_atomDataProcessed.dirty) return;
+
+    Profiler *profiler = lammpsController->system->performance()->profiler();
+    {
+        ProfilerScope profilerScope(profiler, "Atoms::generateSphereData");
+        generateSphereData(m_atomDataProcessed, lammpsController->system);
+    }
+    {
+        ProfilerScope profilerScope(profiler, "Atoms::generateBondData");
+        generateBondData(m_atomDataProcessed, lammpsController);
+    }
+
+    // Periodic images are drawn by instancing, the buffers only hold the original cell
+    ImageTranslations images;
+    const QMatrix3x3 cellMatrix = lammpsController->system->cellMatrix();
+    for(int d=0; d<3; d++) {
+        images.counts[d] = m_atomDataProcessed.images[d];
+        images.cellVectors[d] = QVector3D(cellMatrix(0, d), cellMatrix(1, d), cellMatrix(2, d));
+    }
+    m_sphereData->staging().setImages(images);
+    m_bondData->staging().setImages(images);
+
+    // Both halves of the frame carry its id, the render thread only draws matching pairs
+    const quint64 frame = ++m_committedFrames;
+    m_bondData->staging().commit(frame);
+    bool overwritten = m_sphereData->staging().commit(frame);
+    if(overwritten) {
+        // The render thread did not pick up the previous frame before this one replaced it
+        Performance *performance = lammpsController->system->performance();
+        performance->setDroppedFrames(performance->droppedFrames() + 1);
+    }
 }
 
 long Atoms::memoryUsage()
 {
     return m_atomData.memoryUsage() + m_atomDataProcessed.memoryUsage() +
-           (m_bondsDataRaw.capacity() + m_sphereDataRaw.capacity())*sizeof(char) +
-           bondsDataRaw.size()*sizeof(BondVBOData);
+           m_sphereData->staging().memoryUsage() + m_bondData->staging().memoryUsage() +
+           m_bondFinder.memoryUsage() + m_culler.memoryUsage() + m_notCulled.memoryUsage() +
+           m_depthSorter.memoryUsage();
 }
 
 float Atoms::globalScale() const
@@ -175,56 +354,71 @@ QString Atoms::renderingMode() const
 }
 
 void Atoms::synchronizeRenderer() {
-    if(!dirtyData()) return;
-
-    int numSpheres = m_sphereDataRaw.size() / sizeof(SphereVBOData);
-    m_sphereData->setData(m_sphereDataRaw, numSpheres);
-
-    int numBonds = m_bondsDataRaw.size() / sizeof(BondVBOData);
-    m_bondData->setData(m_bondsDataRaw, numBonds);
-    setDirtyData(false);
-}
-
-void Atoms::generateSphereData(AtomData &atomData) {
-    if(!atomData.dirty) return;
-    int visibleAtomCount = 0;
-
+    // Called on the render thread. Picks up the newest frame committed by the LAMMPS thread, if any.
+    // Spheres and bonds are separate stagings, so one of them can be a frame ahead. That one is
+    // held back until the other catches up instead of drawing atoms and bonds of different frames.
+    VertexStaging<SphereVBOData> &spheres = m_sphereData->staging();
+    VertexStaging<BondVBOData> &bonds = m_bondData->staging();
+    spheres.consume();
+    bonds.consume();
+    if(spheres.frame() != bonds.frame()) return;
+    m_sphereData->uploadStaging();
+    m_bondData->uploadStaging();
+}
+
+void Atoms::generateSphereData(AtomData &atomData, System *system) {
     float radius = 0.2f * m_bondScale;
     if (m_renderingMode == "Sticks" || m_renderingMode == "Wireframe") {
         radius = 0.1f * m_bondScale;
     }
+    atomData.radii.fill(radius);
+
+    // Without culling (or before the visualizer reported its camera) this keeps all visible atoms
+    const BitMask *drawn = &atomData.visible;
+    m_splats.clear();
+    if(m_culling && atomData.imageCount() == 1) {
+        // Atoms outside the view can still be visible in one of their periodic images
+        ProfilerScope profilerScope(system->performance()->profiler(), "Atoms::cull");
+        m_culler.setCamera(system->renderViewProjectionMatrix(), system->renderCameraPosition());
+        m_culler.setLodDistance(m_lodDistance);
+        m_culler.cull(atomData, radius*m_sphereScale, m_notCulled, m_splats);
+        drawn = &m_notCulled;
+    }
 
-    for(int i = 0; i<atomData.size(); i++) {
-        if(atomData.visible[i]) {
-            atomData.positions[visibleAtomCount] = atomData.positions[i];
-            atomData.colors[visibleAtomCount] = atomData.colors[i];
-            atomData.radii[visibleAtomCount] = atomData.radii[i];
-            atomData.deltaPositions[visibleAtomCount] = atomData.deltaPositions[i];
-            atomData.radii[visibleAtomCount] = radius;
-            visibleAtomCount++;
+    int drawnAtomCount = drawn->count();
+    SphereVBOData *vboData = m_sphereData->staging().resize(drawnAtomCount + m_splats.size());
+    // The channels are shared with the modifier caches, non-const access would detach them
+    const float *x = atomData.x.constData();
+    const float *y = atomData.y.constData();
+    const float *z = atomData.z.constData();
+    const QVector3D *colors = atomData.colors.constData();
+
+    if(m_sort) {
+        // Nearest first, so the depth test rejects most fragments of the spheres behind
+        ProfilerScope profilerScope(system->performance()->profiler(), "Atoms::sort");
+        m_depthSorter.sort(atomData, *drawn, system->renderCameraPosition());
+        const int *order = m_depthSorter.order().constData();
+        #pragma omp parallel for
+        for(int k = 0; k<drawnAtomCount; k++) {
+            const int i = order[k];
+            SphereVBOData &vbo = vboData[k];
+            vbo.position = QVector3D(x[i], y[i], z[i]);
+            vbo.color = colors[i];
+            vbo.radius = radius*m_sphereScale;
+        }
+    } else {
+        m_depthSorter.clear();
+        // Pack visible atoms straight into the VBO, no compaction of the atom data first
+        int vboIndex = 0;
+        for(int i = 0; i<atomData.size(); i++) {
+            if(!drawn->test(i)) continue;
+            SphereVBOData &vbo = vboData[vboIndex++];
+            vbo.position = QVector3D(x[i], y[i], z[i]);
+            vbo.color = colors[i];
+            vbo.radius = radius*m_sphereScale;
         }
     }
-    atomData.resize(visibleAtomCount);
-
-    m_sphereDataRaw.resize(visibleAtomCount * sizeof(SphereVBOData));
-    SphereVBOData *vboData = reinterpret_cast<SphereVBOData *>(m_sphereDataRaw.data());
-    for(int i=0; i<visibleAtomCount; i++) {
-        SphereVBOData &vbo = vboData[i];
-        vbo.position = atomData.positions[i] + atomData.deltaPositions[i];
-        vbo.color = atomData.colors[i];
-        vbo.radius = atomData.radii[i]*m_sphereScale;
-    }
-    setDirtyData(true);
-}
-
-bool Atoms::dirtyData() const
-{
-    return m_dirtyData;
-}
-
-void Atoms::setDirtyData(bool dirtyData)
-{
-    m_dirtyData = dirtyData;
+    std::copy(m_splats.constBegin(), m_splats.constEnd(), vboData + drawnAtomCount);
 }
 
 int Atoms::numberOfBonds() const
@@ -232,74 +426,16 @@ int Atoms::numberOfBonds() const
     return m_numberOfBonds;
 }
 
-bool Atoms::generateBondDataFromNeighborList(AtomData &atomData, LAMMPSController *controller)
+bool Atoms::generateBondDataFromCellList(AtomData &atomData, System *system)
 {
-
-    FixAtomify *fixAtomify = dynamic_cast<FixAtomify*>(controller->findFixByIdentifier("atomify"));
-    if(!fixAtomify) {
-        qDebug() << "Error, could not find fix_atomify.";
-        return false;
-    }
-    fixAtomify->build_neighborlist = m_bonds->active();
     if(!m_bonds->active()) {
         return false;
     }
 
-    NeighList *list = fixAtomify->list;
-    const int inum = list->inum;
-    int *numneigh = list->numneigh;
-    int **firstneigh = list->firstneigh;
-
-    bondsDataRaw.reserve(atomData.positions.size());
-    for(int ii=0; ii<atomData.size(); ii++) {
-        if(!atomData.visible[ii]) continue;
-        int i = atomData.originalIndex[ii];
-
-        const QVector3D deltaPosition_i = atomData.deltaPositions[ii];
-        const QVector3D position_i = atomData.positions[ii] + deltaPosition_i;
-        const int atomType_i = atomData.types[ii];
-        if(m_bonds->bondLengths().size()<=atomType_i) continue; // We only store atom bonds between atom types < 32
-
-        const QVector<float> &bondLengths = m_bonds->bondLengths()[atomType_i];
-        const float sphereRadius_i = atomData.radii[ii];
-
-        if(i >= inum) continue; // Atom i is outside the neighbor list. Will probably not happen, but let's skip in that case.
-
-        int *jlist = firstneigh[i];
-        int jnum = numneigh[i];
-        for (int jj = 0; jj < jnum; jj++) {
-            int j = jlist[jj];
-            j &= NEIGHMASK;
-            if(j >= atomData.size()) continue; // Probably a ghost atom from LAMMPS
-            if(!atomData.visible[j]) continue; // Don't show bond if not both atoms are visible.
-
-            const int &atomType_j = atomData.types[j];
-            if(bondLengths.size()<=atomType_j) continue; // We only store atom bonds between atom types < 32
-
-            QVector3D position_j = atomData.positions[j];
-            position_j += deltaPosition_i;
-
-            float dx = position_i[0] - position_j[0];
-            float dy = position_i[1] - position_j[1];
-            float dz = position_i[2] - position_j[2];
-            float rsq = dx*dx + dy*dy + dz*dz; // Componentwise has 10% lower execution time than (position_i - position_j).lengthSquared()
-            if(rsq < bondLengths[atomType_j]*bondLengths[atomType_j]*m_globalScale*m_globalScale ) {
-                BondVBOData bond;
-                bond.vertex1[0] = position_i[0];
-                bond.vertex1[1] = position_i[1];
-                bond.vertex1[2] = position_i[2];
-                bond.vertex2[0] = position_j[0];
-                bond.vertex2[1] = position_j[1];
-                bond.vertex2[2] = position_j[2];
-                float bondRadius = 0.1*m_bondScale; // TODO: move this magic number to a variable
-                bond.radius1 = bondRadius;
-                bond.radius2 = bondRadius;
-                bond.sphereRadius1 = sphereRadius_i*m_sphereScale;
-                bond.sphereRadius2 = atomData.radii[j]*m_sphereScale;
-                bondsDataRaw.push_back(bond);
-            }
-        }
-    }
+    float bondRadius = 0.1*m_bondScale; // TODO: move this magic number to a variable
+    m_bondFinder.setBondLengths(m_bonds->bondLengths(), m_globalScale);
+    m_bondFinder.setCell(system->cellMatrix(), system->origin()*m_globalScale);
+    m_bondFinder.findBonds(atomData, bondRadius, m_sphereScale, m_bondData->staging());
     return true;
 }
 
@@ -307,18 +443,38 @@ bool Atoms::generateBondDataFromBondList(AtomData &atomData, LAMMPSController *c
 {
     Atom *atom = controller->lammps()->atom;
     if(atom->nbonds==0) return false;
+    VertexStaging<BondVBOData> &bondStaging = m_bondData->staging();
+
+    // Bonds across the cell boundary are drawn to the nearest periodic image of the partner
+    // when images are shown along that cell vector
+    const bool periodicImages = atomData.imageCount() > 1;
+    QMatrix4x4 cell;
+    const QMatrix3x3 cellMatrix = controller->system->cellMatrix();
+    for(int d=0; d<3; d++) {
+        cell.setColumn(d, QVector4D(cellMatrix(0, d), cellMatrix(1, d), cellMatrix(2, d), 0));
+    }
+    const QMatrix4x4 cellInverse = cell.inverted();
+
     for(int ii=0; ii<atomData.size(); ii++) {
+        if(!atomData.visible.test(ii)) continue;
         int i = atomData.originalIndex[ii];
-        QVector3D position_i = atomData.positions[ii];
-        const QVector3D deltaPosition = atomData.deltaPositions[ii];
-        position_i += deltaPosition;
+        const QVector3D position_i = atomData.position(ii);
 
         for(int jj=0; jj<atom->num_bond[i]; jj++) {
             int j = atom->map(atom->bond_atom[i][jj]);
             if(j < 0 || j>=atomData.size()) continue;
+            if(!atomData.visible.test(j)) continue;
             if(!controller->lammps()->force->newton_bond && i<j) continue;
 
-            QVector3D position_j = atomData.positions[j] + deltaPosition;
+            QVector3D position_j = atomData.position(j);
+            QVector3D image_j;
+            if(periodicImages) {
+                const QVector3D fractional = cellInverse.mapVector(position_j - position_i);
+                for(int d=0; d<3; d++) {
+                    if(atomData.images[d] > 1) image_j[d] = -std::round(fractional[d]);
+                }
+                position_j += cell.mapVector(image_j);
+            }
             float dx = fabs(position_i[0] - position_j[0]);
             float dy = fabs(position_i[1] - position_j[1]);
             float dz = fabs(position_i[2] - position_j[2]);
@@ -342,7 +498,8 @@ bool Atoms::generateBondDataFromBondList(AtomData &atomData, LAMMPSController *c
             bond.radius2 = bondRadius;
             bond.sphereRadius1 = atomData.radii[i]*m_sphereScale;
             bond.sphereRadius2 = atomData.radii[j]*m_sphereScale;
-            bondsDataRaw.push_back(bond);
+            bond.vertex2Image = image_j;
+            bondStaging.append(bond);
         }
     }
 
@@ -350,25 +507,17 @@ bool Atoms::generateBondDataFromBondList(AtomData &atomData, LAMMPSController *c
 }
 
 void Atoms::generateBondData(AtomData &atomData, LAMMPSController *controller) {
-    if(!atomData.dirty) return;
-    bondsDataRaw.resize(0);
+    // Bonds are appended straight into the staging buffer of the bond VBO
+    m_bondData->staging().clear();
 
-    bool didCreateFromNeighborList = generateBondDataFromNeighborList(atomData, controller);
+    bool didCreateFromCellList = generateBondDataFromCellList(atomData, controller->system);
     bool didCreateFromBondList = generateBondDataFromBondList(atomData, controller);
 
-    if(!didCreateFromBondList && !didCreateFromNeighborList) {
-        m_bondsDataRaw.clear();
+    if(!didCreateFromBondList && !didCreateFromCellList) {
         return;
     }
 
-    setNumberOfBonds(bondsDataRaw.size());
-    m_bondsDataRaw.resize(bondsDataRaw.size() * sizeof(BondVBOData));
-    BondVBOData *posData = reinterpret_cast<BondVBOData*>(m_bondsDataRaw.data());
-    // TODO can we just set the address here? Instead of copying.
-    for(const BondVBOData &pos : bondsDataRaw) {
-        *posData++ = pos;
-    }
-    setDirtyData(true);
+    setNumberOfBonds(m_bondData->staging().count());
 }
 
 SphereData *Atoms::sphereData() const
@@ -426,18 +575,30 @@ AtomData &Atoms::atomData()
     return m_atomData;
 }
 
+const AtomData &Atoms::atomDataProcessed() const
+{
+    return m_atomDataProcessed;
+}
+
 void Atoms::reset()
 {
     QVector<SphereVBOData> emptySphereVBOData;
     QVector<BondVBOData> emptyBondVBOData;
     m_sphereData->setData(emptySphereVBOData);
     m_bondData->setData(emptyBondVBOData);
+    m_sphereData->setImages(ImageTranslations());
+    m_bondData->setImages(ImageTranslations());
     m_atomData.reset();
     m_atomDataProcessed.reset();
+    m_liveAtomData.reset();
+    m_replayedFrame = -1;
+    m_recorder->clear();
+    m_recorder->setPlaybackFrame(-1);
     m_bonds->reset();
     m_atomStyles.clear();
-    m_bondsDataRaw.clear();
-    m_sphereDataRaw.clear();
+    m_sphereData->staging().reset();
+    m_bondData->staging().reset();
+    m_committedFrames = 0;
     setNumberOfBonds(0);
 
     m_atomStyleTypes["helium"]->radius = 1.40;          m_atomStyleTypes["helium"]->color = QColor("#D9FFFF");
@@ -584,3 +745,36 @@ void Atoms::readAtomTypesFromFile()
         m_atomStyleTypes.insert(fullName, new AtomStyle(shortName, fullName, radius, color));
     }
 }
+
+TrajectoryRecorder *Atoms::recorder() const
+{
+    return m_recorder;
+}
+
+bool Atoms::culling() const
+{
+    return m_culling;
+}
+
+float Atoms::lodDistance() const
+{
+    return m_lodDistance;
+}
+
+void Atoms::setCulling(bool culling)
+{
+    if (m_culling == culling)
+        return;
+
+    m_culling = culling;
+    emit cullingChanged(culling);
+}
+
+void Atoms::setLodDistance(float lodDistance)
+{
+    if (m_lodDistance == lodDistance)
+        return;
+
+    m_lodDistance = lodDistance;
+    emit lodDistanceChanged(lodDistance);
+}
@@ -11,6 +11,10 @@
 #include <mpi.h>
 #include <lammps.h>
 #include "atomdata.h"
+#include "bondfinder.h"
+#include "atomculler.h"
+#include "depthsorter.h"
+#include "trajectoryrecorder.h"
 
 struct AtomStyle {
     QColor color;
@@ -31,6 +35,7 @@ class Atoms : public QObject
     Q_PROPERTY(SphereData* sphereData READ sphereData NOTIFY sphereDataChanged)
     Q_PROPERTY(BondData* bondData READ bondData NOTIFY bondDataChanged)
     Q_PROPERTY(Bonds* bonds READ bonds NOTIFY bondsChanged)
+    Q_PROPERTY(TrajectoryRecorder* recorder READ recorder NOTIFY recorderChanged)
     Q_PROPERTY(QVariantList modifiers READ modifiers WRITE setModifiers NOTIFY modifiersChanged)
     Q_PROPERTY(bool sort READ sort WRITE setSort NOTIFY sortChanged)
     Q_PROPERTY(float bondScale READ bondScale WRITE setBondScale NOTIFY bondScaleChanged)
@@ -38,9 +43,12 @@ class Atoms : public QObject
     Q_PROPERTY(QString renderingMode READ renderingMode WRITE setRenderingMode NOTIFY renderingModeChanged)
     Q_PROPERTY(int numberOfBonds READ numberOfBonds WRITE setNumberOfBonds NOTIFY numberOfBondsChanged)
     Q_PROPERTY(float globalScale READ globalScale WRITE setGlobalScale NOTIFY globalScaleChanged)
+    Q_PROPERTY(bool culling READ culling WRITE setCulling NOTIFY cullingChanged)
+    Q_PROPERTY(float lodDistance READ lodDistance WRITE setLodDistance NOTIFY lodDistanceChanged)
 public:
     Atoms(class AtomifySimulator *simulator = nullptr);
     void synchronize(class LAMMPSController *lammpsController);
+    void synchronizeTrajectoryFrame(const struct TrajectoryFrame &frame);
     void processModifiers(class System *system);
     SphereData* sphereData() const;
     QVariantList modifiers() const;
@@ -50,20 +58,24 @@ public:
     void setAtomColor(int atomType, QColor color);
     BondData* bondData() const;
     class Bonds* bonds() const;
+    TrajectoryRecorder* recorder() const;
     AtomData &atomData();
+    const AtomData &atomDataProcessed() const;
     void reset();
     bool sort() const;
     void synchronizeRenderer();
     void createRenderererData(LAMMPSController *lammpsController);
+    void replayRecordedFrame();
+    bool renderingStateChanged(class System *system);
     float bondScale() const;
     float sphereScale() const;
     QString renderingMode() const;
-    bool dirtyData() const;
-    void setDirtyData(bool dirtyData);
     int numberOfBonds() const;
     void setAtomSize(int atomType, float radius);
     long memoryUsage();
     float globalScale() const;
+    bool culling() const;
+    float lodDistance() const;
 
 public slots:
     void setModifiers(QVariantList modifiers);
@@ -73,11 +85,14 @@ public slots:
     void setRenderingMode(QString renderingMode);
     void setNumberOfBonds(int numberOfBonds);
     void setGlobalScale(float globalScale);
+    void setCulling(bool culling);
+    void setLodDistance(float lodDistance);
 
 signals:
     void sphereDataChanged(SphereData* sphereData);
     void bondDataChanged(BondData* bondData);
     void bondsChanged(class Bonds* bonds);
+    void recorderChanged(TrajectoryRecorder* recorder);
     void modifiersChanged(QVariantList modifiers);
     void sortChanged(bool sort);
     void bondScaleChanged(float bondScale);
@@ -85,32 +100,43 @@ signals:
     void renderingModeChanged(QString renderingMode);
     void numberOfBondsChanged(int numberOfBonds);
     void globalScaleChanged(float globalScale);
+    void cullingChanged(bool culling);
+    void lodDistanceChanged(float lodDistance);
 
 private:
     AtomData m_atomData;
     AtomData m_atomDataProcessed;
-    QVector<BondVBOData> bondsDataRaw;
-    QByteArray m_bondsDataRaw;
-    QByteArray m_sphereDataRaw;
+    AtomData m_liveAtomData; // Kept while a recorded frame is shown
+    int m_replayedFrame = -1;
+    QVector<double> m_renderingState;
+    BondFinder m_bondFinder;
+    AtomCuller m_culler;
+    DepthSorter m_depthSorter;
+    BitMask m_notCulled;
+    QVector<SphereVBOData> m_splats;
     QMap<QString, AtomStyle*> m_atomStyleTypes;
     QVector<AtomStyle*> m_atomStyles;
+    quint64 m_committedFrames = 0; // Id of the last frame committed to the stagings
     SphereData* m_sphereData = nullptr;
     BondData* m_bondData = nullptr;
     class Bonds* m_bonds = nullptr;
+    TrajectoryRecorder* m_recorder = nullptr;
     QVariantList m_modifiers;
     bool m_sort = false;
-    bool m_dirtyData = false;
     float m_bondScale = 1.0;
     float m_sphereScale = 1.0;
     QString m_renderingMode = "Ball and stick";
     int m_numberOfBonds = 0;
     float m_globalScale = 1.0;
+    bool m_culling = false;
+    float m_lodDistance = 0; // Atoms further away are drawn as one splat per grid cell, 0 disables
     void readAtomTypesFromFile();
+    void resizeAtomData(int numberOfAtoms);
     void generateBondData(AtomData &atomData, LAMMPSController *controller);
     void generateBondDataFromLammpsNeighborlist(AtomData &atomData, LAMMPSController *controller);
-    bool generateBondDataFromNeighborList(AtomData &atomData, class LAMMPSController *controller);
+    bool generateBondDataFromCellList(AtomData &atomData, class System *system);
     bool generateBondDataFromBondList(AtomData &atomData, LAMMPSController *controller);
-    void generateSphereData(AtomData &atomData);
+    void generateSphereData(AtomData &atomData, class System *system);
     bool doWeHavefullNeighborList(class LAMMPS_NS::Neighbor *neighbor);
 };
 
@@ -0,0 +1,254 @@
+#include "bondfinder.h"
+#include "atomdata.h"
+#include <QMatrix4x4>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void BondFinder::setBondLengths(const QVector<QVector<float>> &bondLengths, float scale)
+{
+    m_numTypes = bondLengths.size();
+    m_maxBondLength = 0;
+    m_bondLengthsSquared.resize(m_numTypes*m_numTypes);
+    for(int i=0; i<m_numTypes; i++) {
+        for(int j=0; j<m_numTypes; j++) {
+            float length = j < bondLengths[i].size() ? bondLengths[i][j]*scale : 0;
+            m_bondLengthsSquared[i*m_numTypes + j] = length*length;
+            m_maxBondLength = std::max(m_maxBondLength, length);
+        }
+    }
+}
+
+void BondFinder::setCell(const QMatrix3x3 &cellMatrix, const QVector3D &origin)
+{
+    for(int d=0; d<3; d++) {
+        m_cellVectors[d] = QVector3D(cellMatrix(0, d), cellMatrix(1, d), cellMatrix(2, d));
+    }
+    m_cellOrigin = origin;
+}
+
+void BondFinder::addGhosts(const AtomData &atomData)
+{
+    // The shifts whose last nonzero component is positive, along cell vectors with images.
+    // Index 0 is no shift, used by all atoms that are no ghosts.
+    m_shiftVectors.resize(1);
+    for(int shiftZ=-1; shiftZ<=1; shiftZ++) {
+        for(int shiftY=-1; shiftY<=1; shiftY++) {
+            for(int shiftX=-1; shiftX<=1; shiftX++) {
+                const int shift[3] = {shiftX, shiftY, shiftZ};
+                bool hasImages = true;
+                int lastNonzero = 0;
+                for(int d=0; d<3; d++) {
+                    if(shift[d] == 0) continue;
+                    hasImages &= atomData.images[d] > 1;
+                    lastNonzero = shift[d];
+                }
+                if(hasImages && lastNonzero > 0) m_shiftVectors.push_back(QVector3D(shiftX, shiftY, shiftZ));
+            }
+        }
+    }
+    if(m_shiftVectors.size() == 1) return;
+
+    QMatrix4x4 cell;
+    for(int d=0; d<3; d++) cell.setColumn(d, QVector4D(m_cellVectors[d], 0));
+    bool invertible = false;
+    const QMatrix4x4 cellInverse = cell.inverted(&invertible);
+    if(!invertible) return;
+
+    // A bond shorter than margin along a cell vector, in units of that cell vector, can only
+    // reach an atom whose fractional coordinate is within margin of the boundary
+    const float volume = fabs(QVector3D::dotProduct(m_cellVectors[0], QVector3D::crossProduct(m_cellVectors[1], m_cellVectors[2])));
+    float margin[3];
+    for(int d=0; d<3; d++) {
+        const QVector3D faceNormal = QVector3D::crossProduct(m_cellVectors[(d+1)%3], m_cellVectors[(d+2)%3]);
+        margin[d] = m_maxBondLength*faceNormal.length()/volume;
+    }
+
+    const int numberOfAtoms = m_unsortedPositions.size();
+    for(int a=0; a<numberOfAtoms; a++) {
+        const QVector3D fractional = cellInverse.mapVector(m_unsortedPositions[a] - m_cellOrigin);
+        for(int shift=1; shift<m_shiftVectors.size(); shift++) {
+            const QVector3D &shiftVector = m_shiftVectors[shift];
+            // Shifted up by one cell vector, the ghost must come from just above the lower boundary
+            bool nearBoundary = true;
+            for(int d=0; d<3; d++) {
+                if(shiftVector[d] > 0) nearBoundary &= fractional[d] < margin[d];
+                else if(shiftVector[d] < 0) nearBoundary &= fractional[d] > 1 - margin[d];
+            }
+            if(!nearBoundary) continue;
+            m_unsortedPositions.push_back(m_unsortedPositions[a] + cell.mapVector(shiftVector));
+            m_unsortedIndices.push_back(m_unsortedIndices[a]);
+            m_unsortedShifts.push_back(shift);
+        }
+    }
+}
+
+void BondFinder::buildCells(const AtomData &atomData)
+{
+    const int numberOfAtoms = atomData.size();
+
+    m_unsortedPositions.resize(0);
+    m_unsortedIndices.resize(0);
+    m_unsortedShifts.resize(0);
+    for(int i=0; i<numberOfAtoms; i++) {
+        if(!atomData.visible.test(i)) continue;
+        m_unsortedPositions.push_back(atomData.position(i));
+        m_unsortedIndices.push_back(i);
+        m_unsortedShifts.push_back(0);
+    }
+    addGhosts(atomData);
+
+    // Bounding box of the atoms and ghosts
+    const int numberOfGridAtoms = m_unsortedPositions.size();
+    m_cellOfAtom.resize(numberOfGridAtoms);
+    QVector3D minimum(1e30, 1e30, 1e30);
+    QVector3D maximum(-1e30, -1e30, -1e30);
+    for(const QVector3D &position : m_unsortedPositions) {
+        for(int d=0; d<3; d++) {
+            minimum[d] = std::min(minimum[d], position[d]);
+            maximum[d] = std::max(maximum[d], position[d]);
+        }
+    }
+
+    // Cells at least as large as the longest bond, so all partners are in the 27 surrounding cells.
+    // Grow the cells if the grid would have far more cells than atoms.
+    m_origin = minimum;
+    m_cellSize = m_maxBondLength;
+    QVector3D extent = maximum - minimum;
+    while(true) {
+        qint64 totalCells = 1;
+        for(int d=0; d<3; d++) {
+            m_numCells[d] = std::max(1, int(std::min(double(extent[d] / m_cellSize), 1048576.0)));
+            totalCells *= m_numCells[d];
+        }
+        if(totalCells <= 2*qint64(numberOfGridAtoms) + 64) break;
+        m_cellSize *= 1.25;
+    }
+
+    const int totalCells = m_numCells[0]*m_numCells[1]*m_numCells[2];
+    m_cellStart.fill(0, totalCells + 1);
+    for(int a=0; a<numberOfGridAtoms; a++) {
+        int cell[3];
+        for(int d=0; d<3; d++) {
+            cell[d] = std::min(m_numCells[d] - 1, int((m_unsortedPositions[a][d] - m_origin[d]) / m_cellSize));
+        }
+        m_cellOfAtom[a] = cellIndex(cell[0], cell[1], cell[2]);
+        m_cellStart[m_cellOfAtom[a] + 1]++;
+    }
+    for(int c=0; c<totalCells; c++) {
+        m_cellStart[c+1] += m_cellStart[c];
+    }
+
+    // Stable counting sort by cell
+    m_cellOffset = m_cellStart;
+    m_positions.resize(numberOfGridAtoms);
+    m_atomIndices.resize(numberOfGridAtoms);
+    m_shifts.resize(numberOfGridAtoms);
+    for(int a=0; a<numberOfGridAtoms; a++) {
+        int target = m_cellOffset[m_cellOfAtom[a]]++;
+        m_positions[target] = m_unsortedPositions[a];
+        m_atomIndices[target] = m_unsortedIndices[a];
+        m_shifts[target] = m_unsortedShifts[a];
+    }
+}
+
+void BondFinder::findBonds(const AtomData &atomData, float bondRadius, float sphereScale, VertexStaging<BondVBOData> &bonds)
+{
+    if(m_maxBondLength <= 0 || atomData.visible.count() == 0) return;
+    buildCells(atomData);
+
+    const int totalCells = m_numCells[0]*m_numCells[1]*m_numCells[2];
+    const int numChunks = std::min(totalCells, 256);
+    m_chunkBonds.resize(numChunks);
+
+    const QVector3D *positions = m_positions.constData();
+    const int *atomIndices = m_atomIndices.constData();
+    const qint8 *shifts = m_shifts.constData();
+    const QVector3D *shiftVectors = m_shiftVectors.constData();
+    const int *cellStart = m_cellStart.constData();
+    const int *types = atomData.types.constData();
+    const float *radii = atomData.radii.constData();
+    const float *bondLengthsSquared = m_bondLengthsSquared.constData();
+    const int numTypes = m_numTypes;
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int chunk=0; chunk<numChunks; chunk++) {
+        QVector<BondVBOData> &chunkBonds = m_chunkBonds[chunk];
+        chunkBonds.resize(0);
+        const int firstCell = qint64(chunk)*totalCells/numChunks;
+        const int lastCell = qint64(chunk+1)*totalCells/numChunks;
+
+        for(int cell=firstCell; cell<lastCell; cell++) {
+            const int cx = cell % m_numCells[0];
+            const int cy = (cell / m_numCells[0]) % m_numCells[1];
+            const int cz = cell / (m_numCells[0]*m_numCells[1]);
+
+            for(int a=cellStart[cell]; a<cellStart[cell+1]; a++) {
+                const int i = atomIndices[a];
+                const int type_i = types[i];
+                if(type_i >= numTypes) continue;
+                const QVector3D &position_i = positions[a];
+
+                for(int dz=-1; dz<=1; dz++) {
+                    const int nz = cz + dz;
+                    if(nz < 0 || nz >= m_numCells[2]) continue;
+                    for(int dy=-1; dy<=1; dy++) {
+                        const int ny = cy + dy;
+                        if(ny < 0 || ny >= m_numCells[1]) continue;
+                        for(int dx=-1; dx<=1; dx++) {
+                            const int nx = cx + dx;
+                            if(nx < 0 || nx >= m_numCells[0]) continue;
+                            const int neighborCell = cellIndex(nx, ny, nz);
+
+                            // Every pair is found once, from the atom that comes first in cell order
+                            for(int b=std::max(a+1, cellStart[neighborCell]); b<cellStart[neighborCell+1]; b++) {
+                                const int j = atomIndices[b];
+                                const int type_j = types[j];
+                                if(type_j >= numTypes) continue;
+                                if(shifts[a] && shifts[b]) continue; // Found between the atoms themselves
+                                const float bondLengthSquared = bondLengthsSquared[type_i*numTypes + type_j];
+                                const QVector3D &position_j = positions[b];
+                                const float deltaX = position_i[0] - position_j[0];
+                                const float deltaY = position_i[1] - position_j[1];
+                                const float deltaZ = position_i[2] - position_j[2];
+                                const float rsq = deltaX*deltaX + deltaY*deltaY + deltaZ*deltaZ;
+                                if(rsq >= bondLengthSquared) continue;
+
+                                // Ghosts always end up as vertex2, drawn in the neighboring image
+                                const bool ghost_i = shifts[a] != 0;
+                                BondVBOData bond;
+                                bond.vertex1 = ghost_i ? position_j : position_i;
+                                bond.vertex2 = ghost_i ? position_i : position_j;
+                                bond.radius1 = bondRadius;
+                                bond.radius2 = bondRadius;
+                                bond.sphereRadius1 = radii[ghost_i ? j : i]*sphereScale;
+                                bond.sphereRadius2 = radii[ghost_i ? i : j]*sphereScale;
+                                bond.vertex2Image = shiftVectors[ghost_i ? shifts[a] : shifts[b]];
+                                chunkBonds.push_back(bond);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    int numberOfBonds = 0;
+    for(const QVector<BondVBOData> &chunkBonds : m_chunkBonds) numberOfBonds += chunkBonds.size();
+    const int offset = bonds.count();
+    BondVBOData *output = bonds.resize(offset + numberOfBonds) + offset;
+    for(const QVector<BondVBOData> &chunkBonds : m_chunkBonds) {
+        memcpy(output, chunkBonds.constData(), chunkBonds.size()*sizeof(BondVBOData));
+        output += chunkBonds.size();
+    }
+}
+
+long BondFinder::memoryUsage() const
+{
+    long bytes = (m_positions.capacity() + m_unsortedPositions.capacity())*sizeof(QVector3D) +
+            (m_atomIndices.capacity() + m_unsortedIndices.capacity() + m_cellStart.capacity() + m_cellOffset.capacity() + m_cellOfAtom.capacity())*sizeof(int) +
+            m_shifts.capacity() + m_unsortedShifts.capacity() +
+            m_bondLengthsSquared.capacity()*sizeof(float);
+    for(const QVector<BondVBOData> &chunkBonds : m_chunkBonds) bytes += chunkBonds.capacity()*sizeof(BondVBOData);
+    return bytes;
+}
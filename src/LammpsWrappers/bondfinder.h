@@ -0,0 +1,51 @@
+#ifndef BONDFINDER_H
+#define BONDFINDER_H
+#include <QVector>
+#include <QVector3D>
+#include <QMatrix3x3>
+#include <SimVis/BondData>
+
+class AtomData;
+
+// Finds bonds between visible atoms using a uniform grid with cell size equal to the longest
+// bond length. Independent of LAMMPS neighbor lists. When periodic images are shown, atoms
+// within one bond length of the cell boundary are also added to the grid as ghosts shifted by
+// a cell vector, so bonds across the boundary are found with their image shift. Only half of
+// the 26 shifts are used, which finds every such bond exactly once.
+class BondFinder
+{
+public:
+    // bondLengths[typeI][typeJ] in LAMMPS units, any number of types. Scale converts to rendered units.
+    void setBondLengths(const QVector<QVector<float>> &bondLengths, float scale);
+    // Columns are the cell vectors, in rendered units like the origin
+    void setCell(const QMatrix3x3 &cellMatrix, const QVector3D &origin);
+    void findBonds(const AtomData &atomData, float bondRadius, float sphereScale, VertexStaging<BondVBOData> &bonds);
+    long memoryUsage() const;
+
+private:
+    int cellIndex(int cx, int cy, int cz) const { return cx + m_numCells[0]*(cy + m_numCells[1]*cz); }
+    void buildCells(const AtomData &atomData);
+    void addGhosts(const AtomData &atomData);
+
+    int m_numTypes = 0;
+    float m_maxBondLength = 0;
+    QVector<float> m_bondLengthsSquared; // m_numTypes x m_numTypes
+    QVector<QVector3D> m_positions; // Rendered position of each visible atom, sorted by cell
+    QVector<int> m_atomIndices; // Index into AtomData, sorted by cell
+    QVector<qint8> m_shifts; // Index into m_shiftVectors, 0 for atoms that are no ghosts, sorted by cell
+    QVector<QVector3D> m_shiftVectors; // Cell vector shift of each ghost kind, in cell vectors
+    QVector<int> m_cellStart; // Atoms in cell c are [m_cellStart[c], m_cellStart[c+1])
+    QVector<int> m_cellOffset;
+    QVector<int> m_cellOfAtom;
+    QVector<QVector3D> m_unsortedPositions;
+    QVector<int> m_unsortedIndices;
+    QVector<qint8> m_unsortedShifts;
+    QVector<QVector<BondVBOData>> m_chunkBonds; // Per chunk output, merged in order so results are deterministic
+    int m_numCells[3] = {0, 0, 0};
+    QVector3D m_origin;
+    float m_cellSize = 1.0;
+    QVector3D m_cellVectors[3];
+    QVector3D m_cellOrigin;
+};
+
+#endif // BONDFINDER_H
@@ -29,6 +29,23 @@ QVector<QVector<float> > &Bonds::bondLengths()
     return m_bondLengths;
 }
 
+bool Bonds::setBondLength(int atomType1, int atomType2, float bondLength)
+{
+    // The table grows to fit the atom types, LAMMPS types start at 1
+    if(atomType1 < 1 || atomType2 < 1) return false;
+    if(atomType1 > maxAtomType || atomType2 > maxAtomType) return false;
+    int numTypes = std::max(m_bondLengths.size(), std::max(atomType1, atomType2) + 1);
+    if(numTypes > m_bondLengths.size()) {
+        m_bondLengths.resize(numTypes);
+        for(QVector<float> &vec : m_bondLengths) {
+            vec.resize(numTypes); // New entries are zero
+        }
+    }
+    m_bondLengths[atomType1][atomType2] = bondLength;
+    m_bondLengths[atomType2][atomType1] = bondLength;
+    return true;
+}
+
 float Bonds::maxBondLength()
 {
     float maxBondLength = 0;
@@ -42,14 +59,7 @@ float Bonds::maxBondLength()
 
 void Bonds::reset()
 {
-    int numTypes = 32;
-    m_bondLengths.resize(numTypes);
-    for(QVector<float> &vec : m_bondLengths) {
-        vec.resize(numTypes);
-        for(float &length : vec) {
-            length = 0.0;
-        }
-    }
+    m_bondLengths.clear();
 }
 
 void Bonds::setEnabled(bool enabled)
@@ -10,9 +10,12 @@ class Bonds : public QObject
     Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
 
 public:
+    // Bond lengths are stored in a dense table, atom types above this are ignored
+    static const int maxAtomType = 1024;
     Bonds();
     bool enabled() const;
     QVector<QVector<float>> &bondLengths();
+    bool setBondLength(int atomType1, int atomType2, float bondLength);
     float maxBondLength();
     bool active() const;
     void reset();
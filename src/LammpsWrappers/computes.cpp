@@ -36,13 +36,16 @@ void Computes::reset() {
         removeCompute(compute->identifier());
     }
     data.clear();
+    m_generation.invalidate();
     setModel(QVariant::fromValue(m_data));
     setCount(0);
 }
 
 bool Computes::addOrRemove(LAMMPSController *lammpsController) {
-    bool anyChanges = false;
     Modify *modify = lammpsController->lammps()->modify;
+    if(!m_generation.update(lammpsController->lammps(), modify->compute_generation)) return false;
+
+    bool anyChanges = false;
 
     for(int computeIndex=0; computeIndex<modify->ncompute; computeIndex++) {
         Compute *compute = modify->compute[computeIndex];
@@ -98,6 +101,7 @@ void Computes::synchronizeQML(LAMMPSController *lammpsController)
     for(QObject *obj : m_data) {
         SimulatorControl *control = qobject_cast<SimulatorControl*>(obj);
         control->updateData1D();
+        control->updateSampling();
     }
 }
 
@@ -7,6 +7,7 @@
 #include <modify.h>
 #include <QMap>
 #include <QVariant>
+#include "lammpsgeneration.h"
 
 class Computes : public QObject
 {
@@ -41,6 +42,7 @@ private:
     QMap<QString, QObject*> m_dataMap;
     QVariant m_model;
     int m_count = 0;
+    LammpsGeneration m_generation; // Modify::compute_generation when we last scanned
 };
 
 #endif // COMPUTES_H
@@ -0,0 +1,219 @@
+#include "depthsorter.h"
+#include "atomdata.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+static const int maximumMovesPerAtom = 4;
+
+void DepthSorter::sort(const AtomData &atomData, const BitMask &drawn, const QVector3D &cameraPosition)
+{
+    const int numberOfDrawnAtoms = drawn.count();
+    const bool sameAtoms = m_order.size() == numberOfDrawnAtoms && m_previousDrawn.size() == drawn.wordCount() &&
+            std::equal(m_previousDrawn.constBegin(), m_previousDrawn.constEnd(), drawn.constWords());
+    // Moving the camera by d shifts keys by about d/range*65536 steps, each step passing
+    // numberOfDrawnAtoms/65536 atoms. Insertion sort only pays off for a few moves per atom.
+    const float cameraDistance = (cameraPosition - m_previousCameraPosition).length();
+    const bool cameraBarelyMoved = cameraDistance*numberOfDrawnAtoms <= maximumMovesPerAtom*m_previousDistanceRange;
+
+    if(!sameAtoms) {
+        m_order.resize(numberOfDrawnAtoms);
+        int orderIndex = 0;
+        const quint64 *words = drawn.constWords();
+        for(int word=0; word<drawn.wordCount(); word++) {
+            for(quint64 bits = words[word]; bits; bits &= bits - 1) {
+                m_order[orderIndex++] = 64*word + qCountTrailingZeroBits(bits);
+            }
+        }
+        m_previousDrawn.resize(drawn.wordCount());
+        std::copy(drawn.constWords(), drawn.constWords() + drawn.wordCount(), m_previousDrawn.begin());
+    }
+
+    computeKeys(atomData, drawn, cameraPosition);
+    // Atoms move a little each timestep too, so give up on the fixups if they are not cheap
+    m_wasIncremental = sameAtoms && cameraBarelyMoved && insertionSort(maximumMovesPerAtom*qint64(numberOfDrawnAtoms));
+    if(!m_wasIncremental) radixSort();
+    m_previousCameraPosition = cameraPosition;
+}
+
+void DepthSorter::computeKeys(const AtomData &atomData, const BitMask &drawn, const QVector3D &cameraPosition)
+{
+    // Distances are computed in atom order so positions are read sequentially, the previous
+    // order would make every read a cache miss
+    const int numberOfAtoms = atomData.size();
+    m_distances.resize(numberOfAtoms);
+    float *distances = m_distances.data();
+    float minimum = 1e30;
+    float maximum = 0;
+    #pragma omp parallel for reduction(min:minimum) reduction(max:maximum)
+    for(int i=0; i<numberOfAtoms; i++) {
+        if(!drawn.test(i)) continue;
+        const float distance = (atomData.position(i) - cameraPosition).length();
+        distances[i] = distance;
+        minimum = std::min(minimum, distance);
+        maximum = std::max(maximum, distance);
+    }
+
+    m_previousDistanceRange = std::max(0.0f, maximum - minimum);
+    const float scale = maximum > minimum ? 65535.0f / (maximum - minimum) : 0.0f;
+    const int count = m_order.size();
+    const int *order = m_order.constData();
+    m_keys.resize(count);
+    quint16 *keys = m_keys.data();
+    #pragma omp parallel for
+    for(int k=0; k<count; k++) {
+        keys[k] = quint16((distances[order[k]] - minimum)*scale);
+    }
+}
+
+void DepthSorter::radixSort()
+{
+    // Two stable passes over the 8 bit digits. Each chunk counts its digits, the prefix sum over
+    // (digit, chunk) gives every chunk its own output range per digit, so the scatter is parallel.
+    const int count = m_order.size();
+    const int numChunks = std::max(1, std::min(64, count / 16384));
+    const int chunkSize = (count + numChunks - 1) / numChunks;
+    m_scratchOrder.resize(count);
+    m_scratchKeys.resize(count);
+    QVector<int> offsets(numChunks*256);
+
+    for(int shift=0; shift<16; shift+=8) {
+        const int *order = m_order.constData();
+        const quint16 *keys = m_keys.constData();
+        int *sortedOrder = m_scratchOrder.data();
+        quint16 *sortedKeys = m_scratchKeys.data();
+        int *chunkOffsets = offsets.data();
+        offsets.fill(0);
+
+        #pragma omp parallel for
+        for(int chunk=0; chunk<numChunks; chunk++) {
+            int *digitCount = chunkOffsets + 256*chunk;
+            const int end = std::min(count, (chunk+1)*chunkSize);
+            for(int k=chunk*chunkSize; k<end; k++) digitCount[(keys[k] >> shift) & 255]++;
+        }
+
+        int sum = 0;
+        for(int digit=0; digit<256; digit++) {
+            for(int chunk=0; chunk<numChunks; chunk++) {
+                const int digitCount = chunkOffsets[256*chunk + digit];
+                chunkOffsets[256*chunk + digit] = sum;
+                sum += digitCount;
+            }
+        }
+
+        #pragma omp parallel for
+        for(int chunk=0; chunk<numChunks; chunk++) {
+            int *offset = chunkOffsets + 256*chunk;
+            const int end = std::min(count, (chunk+1)*chunkSize);
+            for(int k=chunk*chunkSize; k<end; k++) {
+                const int target = offset[(keys[k] >> shift) & 255]++;
+                sortedOrder[target] = order[k];
+                sortedKeys[target] = keys[k];
+            }
+        }
+        m_order.swap(m_scratchOrder);
+        m_keys.swap(m_scratchKeys);
+    }
+}
+
+bool DepthSorter::insertionSort(qint64 maximumMoves)
+{
+    // Linear in the number of atoms that are out of order. Returns false if that was too many,
+    // order and keys are still consistent then and a radix sort can take over.
+    const int count = m_order.size();
+    int *order = m_order.data();
+    quint16 *keys = m_keys.data();
+    qint64 moves = 0;
+    for(int k=1; k<count; k++) {
+        const quint16 key = keys[k];
+        if(keys[k-1] <= key) continue;
+        const int index = order[k];
+        int j = k;
+        while(j > 0 && keys[j-1] > key) {
+            keys[j] = keys[j-1];
+            order[j] = order[j-1];
+            j--;
+        }
+        keys[j] = key;
+        order[j] = index;
+        moves += k - j;
+        if(moves > maximumMoves) return false;
+    }
+    return true;
+}
+
+void DepthSorter::clear()
+{
+    m_order.clear();
+    m_keys.clear();
+    m_previousDrawn.clear();
+    m_previousDistanceRange = 0;
+}
+
+long DepthSorter::memoryUsage() const
+{
+    return (m_order.capacity() + m_scratchOrder.capacity())*sizeof(int) +
+           (m_keys.capacity() + m_scratchKeys.capacity())*sizeof(quint16) +
+           m_distances.capacity()*sizeof(float) + m_previousDrawn.capacity()*sizeof(quint64);
+}
+
+void DepthSorter::benchmark(int numberOfAtoms)
+{
+    AtomData atomData;
+    atomData.resize(numberOfAtoms);
+    atomData.visible.resize(numberOfAtoms, true);
+    const float length = std::cbrt(float(std::max(1, numberOfAtoms)));
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(0.0, length);
+    for(int i=0; i<numberOfAtoms; i++) {
+        atomData.setPosition(i, QVector3D(distribution(generator), distribution(generator), distribution(generator)));
+    }
+
+    auto isSorted = [](const DepthSorter &sorter) {
+        return std::is_sorted(sorter.m_keys.constBegin(), sorter.m_keys.constEnd());
+    };
+
+    const int repetitions = 10;
+    DepthSorter sorter;
+    QVector3D cameraPosition(2*length, 1.5*length, length);
+    QElapsedTimer timer;
+    qint64 fullTime = 0, pausedTime = 0, runningTime = 0;
+    int pausedIncremental = 0, runningIncremental = 0;
+    bool sorted = true;
+    std::normal_distribution<float> jitter(0.0, 0.01);
+    for(int repetition=0; repetition<repetitions; repetition++) {
+        sorter.clear();
+        timer.start();
+        sorter.sort(atomData, atomData.visible, cameraPosition);
+        fullTime += timer.nsecsElapsed();
+        sorted &= isSorted(sorter);
+
+        // Next frame while paused, only the camera moved a little
+        cameraPosition += QVector3D(0.001*length, 0, 0);
+        timer.start();
+        sorter.sort(atomData, atomData.visible, cameraPosition);
+        pausedTime += timer.nsecsElapsed();
+        pausedIncremental += sorter.wasIncremental();
+        sorted &= isSorted(sorter);
+
+        // Next frame while running, the atoms moved too
+        for(int i=0; i<numberOfAtoms; i++) {
+            atomData.x[i] += jitter(generator);
+        }
+        timer.start();
+        sorter.sort(atomData, atomData.visible, cameraPosition);
+        runningTime += timer.nsecsElapsed();
+        runningIncremental += sorter.wasIncremental();
+        sorted &= isSorted(sorter);
+    }
+
+    const double nanosecondsPerAtom = 1.0 / (double(repetitions) * std::max(1, numberOfAtoms));
+    qDebug() << "Depth sort with" << numberOfAtoms << "atoms (ns/atom)";
+    qDebug() << "  radix sort:          " << fullTime*nanosecondsPerAtom;
+    qDebug() << "  next frame, paused: " << pausedTime*nanosecondsPerAtom << "incremental" << pausedIncremental << "of" << repetitions;
+    qDebug() << "  next frame, running:" << runningTime*nanosecondsPerAtom << "incremental" << runningIncremental << "of" << repetitions;
+    if(!sorted) qWarning() << "DepthSorter: Atoms are not sorted by distance";
+}
@@ -0,0 +1,41 @@
+#ifndef DEPTHSORTER_H
+#define DEPTHSORTER_H
+#include <QVector>
+#include <QVector3D>
+
+class AtomData;
+class BitMask;
+
+// Orders the drawn atoms by distance to the camera, nearest first, so opaque spheres benefit
+// from early depth rejection (or back to front for blending by reading the order backwards).
+// Distances are quantized to 16 bits and sorted with a parallel LSD radix sort. Between frames
+// the previous order is usually almost right, so when the same atoms are drawn and the camera
+// barely moved the previous order is fixed up with insertion sort instead.
+class DepthSorter
+{
+public:
+    void sort(const AtomData &atomData, const BitMask &drawn, const QVector3D &cameraPosition);
+    const QVector<int> &order() const { return m_order; } // Indices into AtomData
+    bool wasIncremental() const { return m_wasIncremental; }
+    void clear();
+    long memoryUsage() const;
+    // Prints the time per atom of full and incremental sorts, for atomify --benchmark
+    static void benchmark(int numberOfAtoms);
+
+private:
+    void computeKeys(const AtomData &atomData, const BitMask &drawn, const QVector3D &cameraPosition);
+    void radixSort();
+    bool insertionSort(qint64 maximumMoves);
+
+    QVector<int> m_order;
+    QVector<quint16> m_keys; // Quantized distance of m_order[k]
+    QVector<float> m_distances; // Per atom in AtomData
+    QVector<int> m_scratchOrder;
+    QVector<quint16> m_scratchKeys;
+    QVector<quint64> m_previousDrawn; // The set of atoms m_order was built for
+    QVector3D m_previousCameraPosition;
+    float m_previousDistanceRange = 0;
+    bool m_wasIncremental = false;
+};
+
+#endif // DEPTHSORTER_H
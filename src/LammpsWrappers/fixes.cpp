@@ -41,6 +41,7 @@ void Fixes::reset() {
         remove(fix->identifier());
     }
     data.clear();
+    m_generation.invalidate();
     setModel(QVariant::fromValue(m_data));
     setCount(0);
 }
@@ -48,6 +49,8 @@ void Fixes::reset() {
 bool Fixes::addOrRemove(LAMMPSController *lammpsController)
 {
     LAMMPS_NS::Modify *modify = lammpsController->lammps()->modify;
+    if(!m_generation.update(lammpsController->lammps(), modify->fix_generation)) return false;
+
     bool anyChanges = false;
     for(int fixIndex=0; fixIndex<modify->nfix; fixIndex++) {
 
@@ -88,6 +91,7 @@ void Fixes::synchronizeQML(LAMMPSController *lammpsController)
     for(QObject *obj : m_data) {
         SimulatorControl *control = qobject_cast<SimulatorControl*>(obj);
         control->updateData1D();
+        control->updateSampling();
         CPFixIndent *fixIndent = qobject_cast<CPFixIndent*>(obj);
         if(fixIndent) {
             if(fixIndent->hovered()) {
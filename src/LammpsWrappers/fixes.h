@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QVariant>
+#include "lammpsgeneration.h"
 
 class Fixes : public QObject
 {
@@ -39,6 +40,7 @@ private:
     QMap<QString, QObject *> m_dataMap;
     class CPFixIndent* m_activeFixIndent = nullptr;
     int m_count = 0;
+    LammpsGeneration m_generation; // Modify::fix_generation when we last scanned
 
     void add(QString identifier, class LAMMPSController *lammpsController);
     void remove(QString identifier);
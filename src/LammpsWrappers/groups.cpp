@@ -1,6 +1,8 @@
 #include "groups.h"
 #include "../mysimulator.h"
 #include <group.h>
+#include <atom.h>
+#include <QtAlgorithms>
 using namespace LAMMPS_NS;
 
 Groups::Groups(AtomifySimulator *simulator)
@@ -30,9 +32,13 @@ bool Groups::addOrRemove(LAMMPSController *lammpsController)
     Group *lammpsGroup = lammpsController->lammps()->group;
     int numGroups = lammpsGroup->ngroup;
     setCount(numGroups);
+    if(!m_generation.update(lammpsController->lammps(), lammpsGroup->generation)) return false;
 
+    // Deleted groups leave holes in the name list, so look at every group bit
+    const int maxGroups = 8*sizeof(int);
     bool anyChanges = false;
-    for(int groupIndex=0; groupIndex<numGroups; groupIndex++) {
+    for(int groupIndex=0; groupIndex<maxGroups; groupIndex++) {
+        if(!lammpsGroup->names[groupIndex]) continue;
         QString groupName = QString::fromUtf8(lammpsGroup->names[groupIndex]);
         if(!m_dataMap.contains(groupName)) {
             anyChanges = true;
@@ -67,9 +73,36 @@ void Groups::synchronizeQML(LAMMPSController *lammpsController)
 
 void Groups::synchronize(LAMMPSController *lammpsController)
 {
+    countMembers(lammpsController->lammps());
     for(QObject *obj : m_data) {
         CPGroup *group = static_cast<CPGroup*>(obj);
-        group->update(lammpsController->lammps());
+        group->update(lammpsController->lammps(), m_memberCounts);
+    }
+}
+
+void Groups::countMembers(LAMMPS *lammps)
+{
+    // Each group in LAMMPS is a bit in atom->mask, so one pass over the masks counts all groups
+    // instead of one Group::count pass per group.
+    const int maxGroups = 8*sizeof(int);
+    m_memberCounts.fill(0, maxGroups);
+    const int *mask = lammps->atom->mask;
+    const int numAtoms = lammps->atom->nlocal;
+    if(!mask) return;
+
+#pragma omp parallel
+    {
+        int localCounts[maxGroups] = {0};
+#pragma omp for nowait
+        for(int atomIndex=0; atomIndex<numAtoms; atomIndex++) {
+            uint bits = mask[atomIndex];
+            while(bits) {
+                localCounts[qCountTrailingZeroBits(bits)]++;
+                bits &= bits - 1; // Clear the lowest set bit
+            }
+        }
+#pragma omp critical
+        for(int i=0; i<maxGroups; i++) m_memberCounts[i] += localCounts[i];
     }
 }
 
@@ -107,6 +140,7 @@ void Groups::reset()
     }
     m_data.clear();
     m_dataMap.clear();
+    m_generation.invalidate();
     setModel(QVariant::fromValue(m_data));
 }
 
@@ -210,11 +244,14 @@ void CPGroup::setIdentifier(QString identifier)
     emit identifierChanged(identifier);
 }
 
-void CPGroup::update(LAMMPS *lammps)
+void CPGroup::update(LAMMPS *lammps, const QVector<int> &memberCounts)
 {
     Group *group = lammps->group;
-    QByteArray identifierBytes = m_identifier.toUtf8();
-    int index = group->find(identifierBytes.constData());
-    setBitmask(group->bitmask[index]);
-    setCount(group->count(index));
+    if(m_generation.update(lammps, group->generation)) {
+        QByteArray identifierBytes = m_identifier.toUtf8();
+        m_index = group->find(identifierBytes.constData());
+    }
+    if(m_index < 0) return;
+    setBitmask(group->bitmask[m_index]);
+    setCount(memberCounts[m_index]); // bitmask is 1 << index
 }
@@ -6,6 +6,8 @@
 #include <QVariantList>
 #include <QMap>
 #include <QList>
+#include <QVector>
+#include "lammpsgeneration.h"
 
 class CPGroup : public QObject
 {
@@ -17,7 +19,7 @@ class CPGroup : public QObject
     Q_PROPERTY(bool visible READ visible WRITE setVisible NOTIFY visibleChanged)
 public:
     CPGroup(QObject *parent = nullptr);
-    void update(LAMMPS_NS::LAMMPS *lammps);
+    void update(LAMMPS_NS::LAMMPS *lammps, const QVector<int> &memberCounts);
     QString identifier() const;
     int count() const;
     int bitmask() const;
@@ -44,6 +46,8 @@ private:
     int m_count = 0;
     int m_bitmask = 0;
     QString m_identifier;
+    int m_index = -1; // Index in LAMMPS' group list, looked up when Group::generation changes
+    LammpsGeneration m_generation;
 };
 
 class Groups : public QObject
@@ -78,6 +82,9 @@ private:
     QVariant m_model;
     int m_count = 0;
     bool m_active = false;
+    QVector<int> m_memberCounts; // Number of atoms per group bit
+    LammpsGeneration m_generation; // Group::generation when we last scanned
+    void countMembers(LAMMPS_NS::LAMMPS *lammps);
     void remove(QString identifier);
     void add(QString identifier);
     bool addOrRemove(LAMMPSController *lammpsController);
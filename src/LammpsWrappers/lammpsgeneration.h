@@ -0,0 +1,30 @@
+#ifndef LAMMPSGENERATION_H
+#define LAMMPSGENERATION_H
+#include <mpi.h>
+#include <lmptype.h>
+
+namespace LAMMPS_NS { class LAMMPS; }
+
+// LAMMPS increments a generation counter in Modify, Variable, Group and Domain whenever a compute,
+// fix, variable, group or region is added or deleted. Everything we derive from those tables (our
+// lists, the pointer or index of a named object, which handler copies its data) stays valid until
+// the counter or the LAMMPS instance changes, so it is looked up again only then. The counters
+// keep increasing when a clear command recreates Modify, Group and Domain, so that is noticed too.
+class LammpsGeneration
+{
+public:
+    // Returns true if the counter or instance changed since the last call, and remembers them
+    bool update(LAMMPS_NS::LAMMPS *lammps, LAMMPS_NS::bigint generation) {
+        if(m_lammps == lammps && m_generation == generation) return false;
+        m_lammps = lammps;
+        m_generation = generation;
+        return true;
+    }
+    void invalidate() { m_lammps = nullptr; }
+
+private:
+    LAMMPS_NS::LAMMPS *m_lammps = nullptr;
+    LAMMPS_NS::bigint m_generation = -1;
+};
+
+#endif // LAMMPSGENERATION_H
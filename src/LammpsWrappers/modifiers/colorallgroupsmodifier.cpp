@@ -84,3 +84,12 @@ void ColorAllGroupsModifier::apply(AtomData &atomData)
         }
     }
 }
+
+QVector<float> ColorAllGroupsModifier::externalState()
+{
+    QVector<float> state;
+    for(CPGroup *group : m_system->groups()->groups()) {
+        state << group->bitmask();
+    }
+    return state;
+}
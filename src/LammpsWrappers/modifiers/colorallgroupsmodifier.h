@@ -12,6 +12,11 @@ class ColorAllGroupsModifier : public Modifier
 public:
     ColorAllGroupsModifier();
     void apply(AtomData &atomData) override;
+    int reads() const override { return AtomData::Bitmask | AtomData::Colors; }
+    int writes() const override { return AtomData::Colors; }
+
+protected:
+    QVector<float> externalState() override;
 
 private:
     QVector<QVector3D> m_colors;
@@ -70,16 +70,9 @@ ColorAllRegionsModifier::ColorAllRegionsModifier()
 
 void ColorAllRegionsModifier::apply(AtomData &atomData)
 {
-    QList<CPRegion*> regions = m_system->regions()->regions();
-    for(CPRegion *region : regions) {
-        region->setDoUpdate(false);
-    }
-
     if(!enabled()) return;
 
-    for(CPRegion *region : regions) {
-        region->setDoUpdate(true);
-    }
+    QList<CPRegion*> regions = m_system->regions()->regions();
 
     for(int i=0; i<atomData.size(); i++) {
         for(int j=0; j<regions.size(); j++) {
@@ -92,3 +85,13 @@ void ColorAllRegionsModifier::apply(AtomData &atomData)
         }
     }
 }
+
+QVector<float> ColorAllRegionsModifier::externalState()
+{
+    // The count changes when the region membership list is updated
+    QVector<float> state;
+    for(CPRegion *region : m_system->regions()->regions()) {
+        state << region->count();
+    }
+    return state;
+}
@@ -12,6 +12,11 @@ class ColorAllRegionsModifier : public Modifier
 public:
     ColorAllRegionsModifier();
     void apply(AtomData &atomData) override;
+    int reads() const override { return AtomData::Positions | AtomData::Colors; }
+    int writes() const override { return AtomData::Colors; }
+
+protected:
+    QVector<float> externalState() override;
 
 private:
     QVector<QVector3D> m_colors;
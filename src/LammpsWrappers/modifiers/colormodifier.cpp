@@ -21,3 +21,12 @@ void ColorModifier::apply(AtomData &atomData)
         atomData.colors[i] = QVector3D(color.redF(), color.greenF(), color.blueF());
     }
 }
+
+QVector<float> ColorModifier::externalState()
+{
+    QVector<float> state;
+    for(AtomStyle *atomStyle : m_system->atoms()->atomStyles()) {
+        state << atomStyle->color.redF() << atomStyle->color.greenF() << atomStyle->color.blueF() << atomStyle->radius;
+    }
+    return state;
+}
@@ -9,6 +9,11 @@ class ColorModifier : public Modifier
 public:
     ColorModifier();
     virtual void apply(AtomData &atomData) override;
+    int reads() const override { return AtomData::Types | AtomData::Radii; }
+    int writes() const override { return AtomData::Colors | AtomData::Radii; }
+
+protected:
+    QVector<float> externalState() override;
 private:
     float m_scale = 0.3;
 };
@@ -1,4 +1,3 @@
-#include <QApplication>
 #include "groupmodifier.h"
 #include "LammpsWrappers/groups.h"
 #include "../system.h"
@@ -12,19 +11,19 @@ GroupModifier::GroupModifier()
 void GroupModifier::apply(AtomData &atomData)
 {
     if(!enabled()) return;
-    auto modifiers = QApplication::queryKeyboardModifiers();
+    const bool altModifier = m_system->altModifier();
     QList<CPGroup*> groups = m_system->groups()->groups();
     for(int i=0; i<atomData.size(); i++) {
         for(CPGroup* group : groups) {
             bool isMemberOfGroup = atomData.bitmask[i] & group->bitmask(); // Each group in LAMMPS is represented as a bit in an int. Bitwise or to check membership.
             if(isMemberOfGroup) {
                 if(group->hovered()) atomData.colors[i] = QVector3D(1.0, 0.0, 0.0);
-                if(!group->visible()) atomData.visible[i] = false;
+                if(!group->visible()) atomData.visible.reset(i);
             } else {
                 if(group->hovered()) {
                     // Remove atoms if alt also is pressed
-                    if(modifiers &= Qt::AltModifier) {
-                         atomData.visible[i] = false;
+                    if(altModifier) {
+                         atomData.visible.reset(i);
                     } else {
                         atomData.colors[i] = QVector3D(1.0, 1.0, 1.0);
                     }
@@ -33,3 +32,13 @@ void GroupModifier::apply(AtomData &atomData)
         }
     }
 }
+
+QVector<float> GroupModifier::externalState()
+{
+    QVector<float> state;
+    state << m_system->altModifier();
+    for(CPGroup *group : m_system->groups()->groups()) {
+        state << group->bitmask() << group->hovered() << group->visible();
+    }
+    return state;
+}
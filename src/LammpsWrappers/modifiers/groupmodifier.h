@@ -11,6 +11,11 @@ public:
     // Modifier interface
 public:
     virtual void apply(class AtomData &atomData) override;
+    int reads() const override { return AtomData::Bitmask | AtomData::Colors | AtomData::Visible; }
+    int writes() const override { return AtomData::Colors | AtomData::Visible; }
+
+protected:
+    QVector<float> externalState() override;
 };
 
 #endif // GROUPMODIFIER_H
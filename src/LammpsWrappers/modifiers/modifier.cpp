@@ -1,12 +1,75 @@
 #include "modifier.h"
 #include "../atomdata.h"
 #include "../system.h"
+#include <QMetaProperty>
 
 Modifier::Modifier()
 {
 
 }
 
+bool Modifier::process(const AtomData &input, AtomData &output)
+{
+    watchProperties();
+    output = input;
+    if(!enabled()) {
+        apply(output); // Lets modifiers reset their own state
+        invalidate();
+        return false;
+    }
+
+    QVector<float> externalState = this->externalState();
+    // Cleared before apply() so a property change made while it runs is not lost
+    bool stateChanged = m_dirty.exchange(false);
+    stateChanged = stateChanged || externalState != m_externalState;
+    bool inputChanged = !m_hasCache || input.size() != m_cachedInputSize || input.hasChanged(reads(), m_cachedInputGenerations);
+
+    if(!stateChanged && !inputChanged) {
+        output.copyChannels(m_cachedOutput, writes());
+        return false;
+    }
+
+    apply(output);
+    output.touch(writes());
+
+    m_externalState = externalState;
+    m_hasCache = true;
+    m_cachedInputSize = input.size();
+    std::copy(input.generations, input.generations + AtomData::NumberOfChannels, m_cachedInputGenerations);
+    m_cachedOutput = output; // Implicitly shared, no copy
+    return true;
+}
+
+void Modifier::invalidate()
+{
+    m_hasCache = false;
+    m_cachedOutput.reset();
+}
+
+QVector<float> Modifier::fingerprint()
+{
+    // Property changes are only counted once process() connected them, which happens on the first frame
+    QVector<float> state;
+    state << m_revision << m_enabled;
+    if(m_enabled && m_system) state << externalState();
+    return state;
+}
+
+void Modifier::watchProperties()
+{
+    // Any property change, including those of subclasses, invalidates the cached output
+    if(m_watchingProperties) return;
+    m_watchingProperties = true;
+    const QMetaObject *meta = metaObject();
+    QMetaMethod markDirtyMethod = meta->method(meta->indexOfSlot("markDirty()"));
+    for(int i=0; i<meta->propertyCount(); i++) {
+        QMetaProperty property = meta->property(i);
+        if(property.hasNotifySignal()) {
+            connect(this, property.notifySignal(), this, markDirtyMethod, Qt::DirectConnection);
+        }
+    }
+}
+
 bool Modifier::enabled() const
 {
     return m_enabled;
@@ -25,3 +88,9 @@ void Modifier::setEnabled(bool enabled)
     m_enabled = enabled;
     emit enabledChanged(enabled);
 }
+
+void Modifier::markDirty()
+{
+    m_dirty = true;
+    m_revision++;
+}
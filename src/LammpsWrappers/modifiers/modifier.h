@@ -1,6 +1,9 @@
 #ifndef MODIFIER_H
 #define MODIFIER_H
 #include <QObject>
+#include <QVector>
+#include <atomic>
+#include "../atomdata.h"
 
 class Modifier : public QObject
 {
@@ -12,18 +15,43 @@ protected:
 public:
     Modifier();
     virtual void apply(class AtomData &atomData) = 0;
+    // The AtomData channels apply() reads and writes. A channel that is only partially
+    // overwritten must be listed as read too.
+    virtual int reads() const { return AtomData::AllChannels; }
+    virtual int writes() const { return AtomData::AllChannels; }
+    // Runs apply() only if a channel it reads, its properties or its external state changed.
+    // Otherwise the cached output channels are reused. Returns true if apply() was run.
+    bool process(const AtomData &input, AtomData &output);
+    void invalidate();
+    // Changes whenever process() would rerun apply() on the same input. Called on the GUI thread.
+    QVector<float> fingerprint();
     bool enabled() const;
     void setSystem(class System *system);
     Q_INVOKABLE virtual void parseCommand(QString cmd) {}
 
 public slots:
     void setEnabled(bool enabled);
+    void markDirty();
 
 signals:
     void enabledChanged(bool enabled);
 protected:
+    // Fingerprint of any state outside the modifier's own properties that apply() depends on,
+    // like group visibility or atom styles. apply() is rerun when it changes.
+    virtual QVector<float> externalState() { return QVector<float>(); }
 
     bool m_enabled = false;
+
+private:
+    void watchProperties();
+    std::atomic<bool> m_dirty {true}; // Set from the GUI thread, read on the LAMMPS thread
+    std::atomic<unsigned int> m_revision {0}; // Counts property changes, read on the GUI thread
+    bool m_watchingProperties = false;
+    bool m_hasCache = false;
+    int m_cachedInputSize = 0;
+    quint64 m_cachedInputGenerations[AtomData::NumberOfChannels] = {};
+    AtomData m_cachedOutput;
+    QVector<float> m_externalState;
 };
 
 #endif // MODIFIER_H
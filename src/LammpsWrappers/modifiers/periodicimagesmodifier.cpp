@@ -1,5 +1,4 @@
 #include "periodicimagesmodifier.h"
-#include "../system.h"
 #include "../atomdata.h"
 PeriodicImages::PeriodicImages()
 {
@@ -11,52 +10,12 @@ void PeriodicImages::apply(AtomData &atomData)
 {
     if(!enabled()) return;
 
-    int numImages[3];
-    numImages[0] = m_showImagesX ? std::max(m_numberOfCopiesX, 1) : 1;
-    numImages[1] = m_showImagesY ? std::max(m_numberOfCopiesY, 1) : 1;
-    numImages[2] = m_showImagesZ ? std::max(m_numberOfCopiesZ, 1) : 1;
-    int numberOfCopies = numImages[0]*numImages[1]*numImages[2];
-    if(numberOfCopies == 1) return; // No copies
-
-    int imageLow[3];
-    int imageHigh[3];
-    imageLow[0] = -(numImages[0]-1)/2;
-    imageLow[1] = -(numImages[1]-1)/2;
-    imageLow[2] = -(numImages[2]-1)/2;
-
-    imageHigh[0] = numImages[0]/2;
-    imageHigh[1] = numImages[1]/2;
-    imageHigh[2] = numImages[2]/2;
-
-    int nextIndex = atomData.size();
-    int originalCount = atomData.size();
-    atomData.resize(numberOfCopies*atomData.size());
-    for(int imageX = imageLow[0]; imageX <= imageHigh[0]; imageX++) {
-        for(int imageY = imageLow[1]; imageY <= imageHigh[1]; imageY++) {
-            for(int imageZ = imageLow[2]; imageZ <= imageHigh[2]; imageZ++) {
-                if(imageX == 0 && imageY == 0 && imageZ == 0) continue;
-
-                const QMatrix3x3 &T = m_system->cellMatrix();
-                const QVector3D deltaPosition(
-                            T(0,0)*imageX + T(0,1)*imageY + T(0,2)*imageZ,
-                            T(1,0)*imageX + T(1,1)*imageY + T(1,2)*imageZ,
-                            T(2,0)*imageX + T(2,1)*imageY + T(2,2)*imageZ
-                            );
-
-                for(int atomIndex = 0; atomIndex<originalCount; atomIndex++) {
-                    atomData.positions[nextIndex] = atomData.positions[atomIndex];
-                    atomData.deltaPositions[nextIndex] = deltaPosition;
-                    atomData.colors[nextIndex] = atomData.colors[atomIndex];
-                    atomData.radii[nextIndex] = atomData.radii[atomIndex];
-                    atomData.originalIndex[nextIndex] = atomIndex;
-                    atomData.bitmask[nextIndex] = atomData.bitmask[atomIndex];
-                    atomData.types[nextIndex] = atomData.types[atomIndex];
-                    atomData.visible[nextIndex] = atomData.visible[atomIndex];
-                    nextIndex++;
-                }
-            }
-        }
-    }
+    // Only records how many images to draw. The renderer draws every sphere and bond once per
+    // image and translates it by the cell vectors on the GPU, so nothing here scales with the
+    // number of images.
+    atomData.images[0] = m_showImagesX ? std::max(m_numberOfCopiesX, 1) : 1;
+    atomData.images[1] = m_showImagesY ? std::max(m_numberOfCopiesY, 1) : 1;
+    atomData.images[2] = m_showImagesZ ? std::max(m_numberOfCopiesZ, 1) : 1;
 }
 
 int PeriodicImages::numberOfCopiesX() const
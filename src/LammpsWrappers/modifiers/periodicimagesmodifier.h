@@ -48,6 +48,8 @@ signals:
     // Modifier interface
 public:
     virtual void parseCommand(QString cmd) override;
+    int reads() const override { return 0; }
+    int writes() const override { return AtomData::Images; }
 };
 
 #endif // PERIODICIMAGES_H
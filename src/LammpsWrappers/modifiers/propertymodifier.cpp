@@ -13,69 +13,20 @@ PropertyModifier::PropertyModifier()
 
 }
 
-void PropertyModifier::applyColors(AtomData &atomData, const std::vector<double> &values, int groupBit) {
-    if(m_previousHovered && atomData.paused) return; // No change
-
-    QVector<double> limits = {0, 0.15, 0.35, 0.65, 0.85, 1.0};
-    QVector<double> red = {0, 0, 0, 255./255, 255./255, 255./255};
-    QVector<double> green = {0, 50./255, 255./255, 255./255, 30./255, 0};
-    QVector<double> blue = {100./255, 255./255, 255./255, 0, 0, 0};
-    m_cleanPoints.clear();
-    m_cleanPoints.reserve(values.size());
-    for(double p : values) {
-        if(std::isnan(p) || std::isinf(p)) continue;
-        m_cleanPoints.push_back(p);
-    }
-
-    // Min amd max of dataset
-    double min = *std::min_element(std::begin(m_cleanPoints), std::end(m_cleanPoints));
-    double max = *std::max_element(std::begin(m_cleanPoints), std::end(m_cleanPoints));
-
+void PropertyModifier::applyColors(AtomData &atomData, const double *values, const PerAtomRange &range, int groupBit) {
     if(m_previousHovered == nullptr) {
         // We have just hovered a new variable/compute, always use these
-        setMin(min);
-        setMax(max);
+        setMin(range.min);
+        setMax(range.max);
     } else {
         // Keep old values if they are larger/smaller
-        double newMin = std::min(min, m_min);
-        double newMax = std::max(max, m_max);
+        double newMin = std::min(range.min, m_min);
+        double newMax = std::max(range.max, m_max);
         setMin(newMin);
         setMax(newMax);
     }
 
-
-    double range = m_max - m_min;
-    double oneOverRange = 1.0 / range;
-
-    for(int i=0; i<atomData.size(); i++) {
-        bool isMemberOfGroup = atomData.bitmask[i] & groupBit; // Each group in LAMMPS is represented as a bit in an int. Bitwise or to check membership.
-        if(!isMemberOfGroup) {
-            atomData.colors[i][0] = 0.1;
-            atomData.colors[i][1] = 0.1;
-            atomData.colors[i][2] = 0.1;
-            continue;
-        }
-        double value = values[i];
-
-        if(std::isnan(value) || std::isinf(value)) {
-            atomData.colors[i][0] = 1.0;
-            atomData.colors[i][1] = 1.0;
-            atomData.colors[i][2] = 1.0;
-            continue;
-        }
-
-        double scaled = (value - m_min) * oneOverRange; // between 0 and 1
-        for(int j=0; j<limits.size()-1; j++) {
-            if(limits[j] <= scaled && scaled <= limits[j+1]) {
-                // Found the two bins including this value
-                double dx = limits[j+1] - limits[j];
-                double fraction = 1.0 - (scaled - limits[j]) / dx; // where between these two values are we
-                atomData.colors[i][0] = red[j]*fraction + (1.0 - fraction)*red[j+1];
-                atomData.colors[i][1] = green[j]*fraction + (1.0 - fraction)*green[j+1];
-                atomData.colors[i][2] = blue[j]*fraction + (1.0 - fraction)*blue[j+1];
-            }
-        }
-    }
+    m_colorMap.apply(values, atomData.bitmask.constData(), groupBit, atomData.size(), m_min, m_max, atomData.colors.data());
 }
 
 void PropertyModifier::apply(AtomData &atomData)
@@ -92,10 +43,20 @@ void PropertyModifier::apply(AtomData &atomData)
         if(control->hovered() && control->isPerAtom()) {
 
             setActive(true);
+            if(atomData.replayed) {
+                // Recorded frames are colored by the values recorded with them, not the live ones
+                const QVector<double> values = atomData.properties.value(control->identifier());
+                if(values.size() != atomData.size()) break;
+                const PerAtomRange range = PerAtomKernels::range(values.constData(), values.size());
+                applyColors(atomData, values.constData(), range, control->groupBit());
+                m_previousHovered = control;
+                return;
+            }
+
             const std::vector<double> &values = control->atomData();
             if(values.size() == atomData.size()) {
                 // If we just hovered, the atomData array might not have been updated with values yet
-                applyColors(atomData, values, control->groupBit());
+                applyColors(atomData, values.data(), control->atomDataRange(), control->groupBit());
                 if(control != m_previousHovered) {
                     m_previousHovered = control;
                 }
@@ -149,3 +110,17 @@ void PropertyModifier::setMin(double min)
     m_min = min;
     emit minChanged(min);
 }
+
+QVector<float> PropertyModifier::externalState()
+{
+    // Which control is hovered, and whether its per atom values have arrived yet
+    QVector<float> state;
+    QVector<SimulatorControl*> simulatorControls = m_system->simulatorControls();
+    for(int i=0; i<simulatorControls.size(); i++) {
+        SimulatorControl *control = simulatorControls[i];
+        if(control->hovered() && control->isPerAtom()) {
+            state << i << control->groupBit() << control->atomData().size();
+        }
+    }
+    return state;
+}
@@ -2,6 +2,7 @@
 #define PROPERTYMODIFIER_H
 
 #include "modifier.h"
+#include "../../dataproviders/peratomkernels.h"
 #include <vector>
 
 class PropertyModifier : public Modifier
@@ -16,6 +17,8 @@ public:
     // Modifier interface
 public:
     virtual void apply(class AtomData &atomData) override;
+    int reads() const override { return AtomData::Positions | AtomData::Bitmask | AtomData::Colors; }
+    int writes() const override { return AtomData::Colors; }
     bool active() const;
     double max() const;
     double min() const;
@@ -30,11 +33,14 @@ signals:
     void maxChanged(double max);
     void minChanged(double min);
 
+protected:
+    QVector<float> externalState() override;
+
 private:
     class SimulatorControl *m_previousHovered = nullptr;
-    void applyColors(AtomData &atomData, const std::vector<double> &values, int groupBit);
+    void applyColors(AtomData &atomData, const double *values, const PerAtomRange &range, int groupBit);
     bool m_active = false;
-    std::vector<float> m_cleanPoints;
+    ColorMap m_colorMap;
     double m_max = 0;
     double m_min = 0;
 };
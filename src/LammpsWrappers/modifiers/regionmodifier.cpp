@@ -1,4 +1,3 @@
-#include <QApplication>
 #include "regionmodifier.h"
 #include "../regions.h"
 #include "../system.h"
@@ -13,17 +12,17 @@ void RegionModifier::apply(AtomData &atomData)
 {
     if(!enabled()) return;
     QList<CPRegion*> regions = m_system->regions()->regions();
-    auto modifiers = QApplication::queryKeyboardModifiers();
+    const bool altModifier = m_system->altModifier();
     for(int atomIndex=0; atomIndex<atomData.size(); atomIndex++) {
         for(CPRegion* region : regions) {
             bool isInsideRegion = region->containsAtom(atomIndex); // Each group in LAMMPS is represented as a bit in an int. Bitwise or to check membership.
             if(isInsideRegion) {
                 if(region->hovered()) atomData.colors[atomIndex] = QVector3D(1.0, 0.0, 0.0);
-                if(!region->visible()) atomData.visible[atomIndex] = false;
+                if(!region->visible()) atomData.visible.reset(atomIndex);
             } else {
                 if(region->hovered()) {
-                    if(modifiers &= Qt::AltModifier) {
-                        atomData.visible[atomIndex] = false;
+                    if(altModifier) {
+                        atomData.visible.reset(atomIndex);
                     }
                     else {
                         atomData.colors[atomIndex] = QVector3D(1.0, 1.0, 1.0);
@@ -33,3 +32,13 @@ void RegionModifier::apply(AtomData &atomData)
         }
     }
 }
+
+QVector<float> RegionModifier::externalState()
+{
+    QVector<float> state;
+    state << m_system->altModifier();
+    for(CPRegion *region : m_system->regions()->regions()) {
+        state << region->hovered() << region->visible() << region->count();
+    }
+    return state;
+}
@@ -32,11 +32,9 @@ void Slice::apply(AtomData &atomData)
 {
     if(!enabled() || m_normal.length()==0) return;
     m_normalizedNormal = m_normal.normalized();
-    for(int i=0; i<atomData.size(); i++) {
-        if(!vectorIsInside(atomData.positions[i])) {
-            atomData.visible[i] = false;
-        }
-    }
+    atomData.visible.keepIf([&](int i) {
+        return vectorIsInside(atomData.position(i));
+    });
 }
 
 float Slice::distance() const
@@ -22,6 +22,8 @@ private:
 public:
     Slice();
     virtual void apply(class AtomData &atomData) override;
+    int reads() const override { return AtomData::Positions | AtomData::Visible; }
+    int writes() const override { return AtomData::Visible; }
     float distance() const;
     QVector3D normal() const;
     float width() const;
@@ -56,6 +56,8 @@ bool Regions::addOrRemove(LAMMPSController *lammpsController)
     }
 
     /* END: NOT SURE IF THIS IS IMPORTANT */
+    if(!m_generation.update(lammps, lammpsDomain->region_generation)) return false;
+
     bool anyChanges = false;
     for(int regionIndex=0; regionIndex<numRegions; regionIndex++) {
         Region *lammpsRegion = regions[regionIndex];
@@ -124,6 +126,7 @@ void Regions::reset()
     }
     m_data.clear();
     m_dataMap.clear();
+    m_generation.invalidate();
     setModel(QVariant::fromValue(m_data));
 }
 
@@ -192,27 +195,46 @@ bool CPRegion::hovered() const
 
 void CPRegion::update(LAMMPS *lammps)
 {
-    QByteArray identifierBytes = m_identifier.toUtf8();
-    int index = lammps->domain->find_region(identifierBytes.data());
-    if(index < 0) return; // Should really not happen, but crash is bad :p
-
-    Region *region = lammps->domain->regions[index];
-    // lammps->update->whichflag = 1; // HACK. This tells lammps we're doing dynamics so we can compute values in there.
-    setCount(lammps->group->count(0,index));
-    if(doUpdate() || hovered() || !visible()) {
-        m_containsAtom.resize(lammps->atom->natoms);
-        for(int atomIndex=0; atomIndex<lammps->atom->natoms; atomIndex++) {
-            double r[3];
-            r[0] = lammps->atom->x[atomIndex][0];
-            r[1] = lammps->atom->x[atomIndex][1];
-            r[2] = lammps->atom->x[atomIndex][2];
-            lammps->domain->remap(r);
-
-            bool isInsideRegion = !region->inside(r[0], r[1], r[2])^region->interior;
-            m_containsAtom[atomIndex] = isInsideRegion;
+    // Runs once per frame. Membership is needed for the count anyway, so it replaces
+    // Group::count(0, region) and is kept for the region modifiers.
+    Domain *domain = lammps->domain;
+    if(m_generation.update(lammps, domain->region_generation)) {
+        QByteArray identifierBytes = m_identifier.toUtf8();
+        m_index = domain->find_region(identifierBytes.data());
+    }
+    if(m_index < 0) return; // Should really not happen, but crash is bad :p
+
+    Region *region = domain->regions[m_index];
+    double **x = lammps->atom->x;
+    const int numAtoms = lammps->atom->nlocal;
+    region->prematch();
+
+    // Atoms outside the bounding box of a static region are known without calling inside()
+    const bool useBoundingBox = region->bboxflag && !region->dynamic && !region->openflag;
+    const double boundingBoxLow[3] = {region->extent_xlo, region->extent_ylo, region->extent_zlo};
+    const double boundingBoxHigh[3] = {region->extent_xhi, region->extent_yhi, region->extent_zhi};
+    const int outsideBoundingBox = !region->interior; // The region is the outside of the box for side out
+
+    m_containsAtom.resize(numAtoms);
+    int *containsAtom = m_containsAtom.data();
+    int count = 0;
+#pragma omp parallel for reduction(+:count)
+    for(int atomIndex=0; atomIndex<numAtoms; atomIndex++) {
+        double r[3] = {x[atomIndex][0], x[atomIndex][1], x[atomIndex][2]};
+        domain->remap(r);
+
+        int isInsideRegion;
+        if(useBoundingBox && (r[0] < boundingBoxLow[0] || r[0] > boundingBoxHigh[0]
+                              || r[1] < boundingBoxLow[1] || r[1] > boundingBoxHigh[1]
+                              || r[2] < boundingBoxLow[2] || r[2] > boundingBoxHigh[2])) {
+            isInsideRegion = outsideBoundingBox;
+        } else {
+            isInsideRegion = region->match(r[0], r[1], r[2]);
         }
-        // lammps->update->whichflag = 0;
+        containsAtom[atomIndex] = isInsideRegion;
+        count += isInsideRegion;
     }
+    setCount(count);
 }
 
 bool CPRegion::containsAtom(int atomIndex)
@@ -256,13 +278,3 @@ void CPRegion::setHovered(bool hovered)
     m_hovered = hovered;
     emit hoveredChanged(hovered);
 }
-
-bool CPRegion::doUpdate() const
-{
-    return m_doUpdate;
-}
-
-void CPRegion::setDoUpdate(bool doUpdate)
-{
-    m_doUpdate = doUpdate;
-}
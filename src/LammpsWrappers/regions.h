@@ -7,6 +7,7 @@
 #include <QMap>
 #include <QVariant>
 #include <QVector>
+#include "lammpsgeneration.h"
 class CPRegion : public QObject
 {
     Q_OBJECT
@@ -22,8 +23,6 @@ public:
     bool hovered() const;
     void update(LAMMPS_NS::LAMMPS *lammps);
     bool containsAtom(int atomIndex);
-    bool doUpdate() const;
-    void setDoUpdate(bool doUpdate);
 
 public slots:
     void setCount(int count);
@@ -42,8 +41,9 @@ private:
     QString m_identifier;
     bool m_visible = true;
     bool m_hovered = false;
-    bool m_doUpdate = false;
     QVector<int> m_containsAtom;
+    int m_index = -1; // Index in Domain::regions, looked up when Domain::region_generation changes
+    LammpsGeneration m_generation;
 };
 
 class Regions : public QObject
@@ -83,6 +83,7 @@ private:
     QVariant m_model;
     int m_count = 0;
     bool m_active = false;
+    LammpsGeneration m_generation; // Domain::region_generation when we last scanned
 };
 
 #endif // REGIONS_H
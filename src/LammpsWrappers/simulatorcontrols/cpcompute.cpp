@@ -26,13 +26,13 @@ bool CPCompute::copyData(Compute *compute, LAMMPSController *lammpsController) {
 
     if(numCols == 0) {
         setNumPerAtomValues(1);
-        if(!window() && !hovered()) return true; // Skip copying data unless we need them
+        if(!needsAtomData(lammpsController)) return true; // Skip copying data unless we need them
 
         double *values = compute->vector_atom;
         m_atomData = std::vector<double>(values, values+numAtoms);
     } else {
         setNumPerAtomValues(numCols);
-        if(!window() && !hovered()) return true; // Skip copying data unless we need them
+        if(!needsAtomData(lammpsController)) return true; // Skip copying data unless we need them
 
         double **values = compute->array_atom;
         m_atomData.resize(numAtoms);
@@ -46,8 +46,9 @@ bool CPCompute::copyData(Compute *compute, LAMMPSController *lammpsController) {
         }
     }
 
+    updateAtomDataRange();
     if(window()) {
-        data->createHistogram(m_atomData);
+        data->createHistogram(m_atomData, m_atomDataRange);
     }
 
     return true;
@@ -251,28 +252,54 @@ bool CPCompute::validateStatus(Compute *compute, LAMMPS *lammps) {
     return true;
 }
 
+Compute *CPCompute::lammpsCompute(LAMMPSController *lammpsController)
+{
+    // The compute and its type can only change when LAMMPS adds or deletes computes
+    LAMMPS *lammps = lammpsController->lammps();
+    if(m_generation.update(lammps, lammps->modify->compute_generation)) {
+        resolve(lammpsController->findComputeByIdentifier(identifier()));
+    }
+    return m_compute;
+}
+
+void CPCompute::resolve(Compute *compute)
+{
+    m_compute = compute;
+    m_copyHandler = nullptr;
+    if(dynamic_cast<ComputePressure*>(compute)) m_copyHandler = &CPCompute::copyAs<ComputePressure>;
+    else if(dynamic_cast<ComputeTemp*>(compute)) m_copyHandler = &CPCompute::copyAs<ComputeTemp>;
+    else if(dynamic_cast<ComputeKE*>(compute)) m_copyHandler = &CPCompute::copyAs<ComputeKE>;
+    else if(dynamic_cast<ComputePE*>(compute)) m_copyHandler = &CPCompute::copyAs<ComputePE>;
+    else if(dynamic_cast<ComputeRDF*>(compute)) m_copyHandler = &CPCompute::copyAs<ComputeRDF>;
+    else if(dynamic_cast<ComputeMSD*>(compute)) m_copyHandler = &CPCompute::copyAs<ComputeMSD>;
+    else if(dynamic_cast<ComputeVACF*>(compute)) m_copyHandler = &CPCompute::copyAs<ComputeVACF>;
+    else if(dynamic_cast<ComputeCOM*>(compute)) m_copyHandler = &CPCompute::copyAs<ComputeCOM>;
+    else if(dynamic_cast<ComputeGyration*>(compute)) m_copyHandler = &CPCompute::copyAs<ComputeGyration>;
+}
+
 void CPCompute::computeInLAMMPS(LAMMPSController *lammpsController) {
-    Compute *compute = lammpsController->findComputeByIdentifier(identifier());
+    Compute *compute = lammpsCompute(lammpsController);
     if(!compute) return;
-    if(compute->scalar_flag == 1) {
+    const bool sampled = needsScalarData(lammpsController);
+    if(compute->scalar_flag == 1 && sampled) {
         if(validateStatus(compute, lammpsController->lammps())) {
             compute->compute_scalar();
         }
     }
 
-    if(compute->vector_flag == 1) {
+    if(compute->vector_flag == 1 && sampled) {
         if(validateStatus(compute, lammpsController->lammps())) {
             compute->compute_vector();
         }
     }
 
-    if(compute->array_flag == 1) {
+    if(compute->array_flag == 1 && sampled) {
         if(validateStatus(compute, lammpsController->lammps())) {
             compute->compute_array();
         }
     }
 
-    if(compute->peratom_flag == 1) {
+    if(compute->peratom_flag == 1 && needsAtomData(lammpsController)) {
         if(validateStatus(compute, lammpsController->lammps())) {
             compute->compute_peratom();
         }
@@ -281,23 +308,19 @@ void CPCompute::computeInLAMMPS(LAMMPSController *lammpsController) {
 
 void CPCompute::copyData(LAMMPSController *lammpsController)
 {
+    // Frames are always sampled, so per atom data copied below is never skipped by this
+    if(!needsScalarData(lammpsController)) return;
     if(m_lastUpdate != -1 && (lammpsController->system->currentTimestep()-m_lastUpdate) < m_frequency) return;
 
-    Compute *lmp_compute = lammpsController->findComputeByIdentifier(identifier());
+    Compute *lmp_compute = lammpsCompute(lammpsController);
     if(lmp_compute == nullptr) return; // Didn't find it...
 
     m_groupBit = lmp_compute->groupbit;
+    // Energy and virial are only tallied on the timesteps LAMMPSController asks FixAtomify for
+    if(!validateStatus(lmp_compute, lammpsController->lammps())) return;
     try {
         if(copyData(lmp_compute, lammpsController)) return;
-        if(copyData(dynamic_cast<ComputePressure*>(lmp_compute), lammpsController)) return;
-        if(copyData(dynamic_cast<ComputeTemp*>(lmp_compute), lammpsController)) return;
-        if(copyData(dynamic_cast<ComputeKE*>(lmp_compute), lammpsController)) return;
-        if(copyData(dynamic_cast<ComputePE*>(lmp_compute), lammpsController)) return;
-        if(copyData(dynamic_cast<ComputeRDF*>(lmp_compute), lammpsController)) return;
-        if(copyData(dynamic_cast<ComputeMSD*>(lmp_compute), lammpsController)) return;
-        if(copyData(dynamic_cast<ComputeVACF*>(lmp_compute), lammpsController)) return;
-        if(copyData(dynamic_cast<ComputeCOM*>(lmp_compute), lammpsController)) return;
-        if(copyData(dynamic_cast<ComputeGyration*>(lmp_compute), lammpsController)) return;
+        if(m_copyHandler && (this->*m_copyHandler)(lmp_compute, lammpsController)) return;
 
     } catch (LAMMPSException &exception) {
         qDebug() << "ERROR: LAMMPS threw an exception!";
@@ -3,6 +3,7 @@
 #include <vector>
 #include "simulatorcontrol.h"
 #include "datasource.h"
+#include "../lammpsgeneration.h"
 #include "../../dataproviders/dataprovider.h"
 #include <QVariantMap>
 #include <mpi.h>
@@ -20,12 +21,21 @@ public:
     void copyData(LAMMPSController *lammpsController);
     virtual bool existsInLammps(LAMMPSController *lammpsController) override;
     void computeInLAMMPS(LAMMPSController *lammpsController);
+    Compute *lammpsCompute(LAMMPSController *lammpsController);
 
 signals:
 
 public slots:
 
 private:
+    typedef bool (CPCompute::*CopyHandler)(Compute *compute, LAMMPSController *lammpsController);
+    Compute *m_compute = nullptr;
+    CopyHandler m_copyHandler = nullptr; // copyData overload for the concrete type of m_compute
+    LammpsGeneration m_generation;
+    void resolve(Compute *compute);
+    template<class T> bool copyAs(Compute *compute, LAMMPSController *lammpsController) {
+        return copyData(static_cast<T*>(compute), lammpsController);
+    }
     bool copyData(ComputePressure *compute, LAMMPSController *lammpsController);
     bool copyData(ComputeTemp *compute, LAMMPSController *lammpsController);
     bool copyData(ComputePE *compute, LAMMPSController *lammpsController);
@@ -145,7 +145,7 @@ bool CPFix::copyData(LAMMPS_NS::FixAveChunk *fix, LAMMPSController *lammpsContro
             }
         }
 
-        if(hovered()) {
+        if(hovered() && lammpsController->synchronizingFrame()) {
             // Even though we haven't updated contents for a while, atoms might have
             // reorganized in memory, so we need to copy the new data if hovered
             int numAtoms = lammpsController->system->numberOfAtoms();
@@ -157,6 +157,7 @@ bool CPFix::copyData(LAMMPS_NS::FixAveChunk *fix, LAMMPSController *lammpsContro
                 float value = fix->compute_array(chunkID-1, valueIndex);
                 m_atomData[i] = value;
             }
+            updateAtomDataRange();
         }
 
         m_nextValidTimestep = *nextValidTimestep;
@@ -180,8 +181,9 @@ bool CPFix::copyData(LAMMPS_NS::FixAveTime *fix, LAMMPSController *lammpsControl
     mode = *value;
 
     LAMMPS_NS::bigint *nextValidTimestep = reinterpret_cast<LAMMPS_NS::bigint*>(fix->extract("nvalid", dim));
-    if(m_nextValidTimestep+1 == lammpsController->system->currentTimestep()) {
-        // +1 because fix_atomify is invoked before all other fixes, so we need the next timestep
+    if(m_nextValidTimestep >= 0 && m_nextValidTimestep < lammpsController->system->currentTimestep()) {
+        // New values show up the timestep after nvalid since fix_atomify is invoked before all
+        // other fixes. If that timestep wasn't sampled, the fix still holds the latest values.
         if(mode == SCALAR) {
             // Time dependent solution with 1 or more values
             if(nvalues == 1) {
@@ -216,10 +218,13 @@ bool CPFix::copyData(LAMMPS_NS::FixAveTime *fix, LAMMPSController *lammpsControl
                 Data1D *data = ensureExists(key, true);
                 data->setLabel(key);
                 data->clear(true);
+                LAMMPS_NS::ComputeRDF *compute_rdf = nullptr;
+                if(type=="Compute RDF") {
+                    compute_rdf = dynamic_cast<LAMMPS_NS::ComputeRDF *>(lammpsController->findComputeByIdentifier(QString::fromUtf8(ids[i])));
+                }
                 for(int j=0; j<nrows; j++) {
                     double value = fix->compute_array(j, i);
-                    if(type=="Compute RDF") {
-                        LAMMPS_NS::ComputeRDF *compute_rdf = dynamic_cast<LAMMPS_NS::ComputeRDF *>(lammpsController->findComputeByIdentifier(QString::fromUtf8(ids[i])));
+                    if(compute_rdf) {
                         double binCenter = compute_rdf->array[j][0];
                         data->add(binCenter, value);
                     } else {
@@ -258,13 +263,31 @@ bool CPFix::copyData(LAMMPS_NS::FixAveHisto *fix, LAMMPSController *lammpsContro
     return true;
 }
 
+LAMMPS_NS::Fix *CPFix::lammpsFix(LAMMPSController *lammpsController)
+{
+    LAMMPS_NS::LAMMPS *lammps = lammpsController->lammps();
+    if(m_generation.update(lammps, lammps->modify->fix_generation)) {
+        resolve(lammpsController->findFixByIdentifier(identifier()));
+    }
+    return m_fix;
+}
+
+void CPFix::resolve(LAMMPS_NS::Fix *fix)
+{
+    // Runs when fixes were added or deleted, so the type is only inspected once per fix
+    m_fix = fix;
+    m_copyHandler = nullptr;
+    if(dynamic_cast<LAMMPS_NS::FixAveChunk*>(fix)) m_copyHandler = &CPFix::copyAs<LAMMPS_NS::FixAveChunk>;
+    else if(dynamic_cast<LAMMPS_NS::FixAveHisto*>(fix)) m_copyHandler = &CPFix::copyAs<LAMMPS_NS::FixAveHisto>;
+    else if(dynamic_cast<LAMMPS_NS::FixAveTime*>(fix)) m_copyHandler = &CPFix::copyAs<LAMMPS_NS::FixAveTime>;
+}
+
 void CPFix::copyData(LAMMPSController *lammpsController)
 {
-    LAMMPS_NS::Fix *lmp_fix = lammpsController->findFixByIdentifier(identifier());
-    if(lmp_fix == nullptr) return;
-    if(copyData(dynamic_cast<LAMMPS_NS::FixAveChunk*>(lmp_fix), lammpsController)) return;
-    if(copyData(dynamic_cast<LAMMPS_NS::FixAveHisto*>(lmp_fix), lammpsController)) return;
-    if(copyData(dynamic_cast<LAMMPS_NS::FixAveTime*>(lmp_fix), lammpsController)) return;
+    LAMMPS_NS::Fix *lmp_fix = lammpsFix(lammpsController);
+    if(lmp_fix == nullptr || !m_copyHandler) return;
+    if(!needsScalarData(lammpsController)) return;
+    (this->*m_copyHandler)(lmp_fix, lammpsController);
 }
 
 bool CPFix::existsInLammps(LAMMPSController *lammpsController)
@@ -2,6 +2,7 @@
 #define CPFIX_H
 #include "simulatorcontrol.h"
 #include "dataproviders/data2d.h"
+#include "../lammpsgeneration.h"
 
 struct _reax_list; // fix for compilation issues on linux
 #include <style_fix.h>
@@ -19,8 +20,20 @@ signals:
 
 public slots:
 
+protected:
+    // The LAMMPS fix with our identifier, looked up again only when Modify::fix_generation changes
+    LAMMPS_NS::Fix *lammpsFix(class LAMMPSController *lammpsController);
+    virtual void resolve(LAMMPS_NS::Fix *fix);
+
 private:
+    typedef bool (CPFix::*CopyHandler)(LAMMPS_NS::Fix *fix, class LAMMPSController *lammpsController);
+    LAMMPS_NS::Fix *m_fix = nullptr;
+    CopyHandler m_copyHandler = nullptr; // copyData overload for the concrete type of m_fix
+    LammpsGeneration m_generation;
     long m_nextValidTimestep = -1;
+    template<class T> bool copyAs(LAMMPS_NS::Fix *fix, class LAMMPSController *lammpsController) {
+        return copyData(static_cast<T*>(fix), lammpsController);
+    }
     bool copyData(LAMMPS_NS::FixAveChunk *fix, class LAMMPSController *lammpsController);
     bool copyData(LAMMPS_NS::FixAveHisto *fix, class LAMMPSController *lammpsController);
     bool copyData(LAMMPS_NS::FixAveTime *fix, class LAMMPSController *lammpsController);
@@ -16,10 +16,17 @@ CPFixIndent::~CPFixIndent()
 }
 
 
+void CPFixIndent::resolve(LAMMPS_NS::Fix *fix)
+{
+    CPFix::resolve(fix);
+    m_fixIndent = dynamic_cast<LAMMPS_NS::FixIndent *>(fix);
+}
+
 void CPFixIndent::copyData(LAMMPSController *lammpsController)
 {
     enum{NONE,SPHERE,CYLINDER,PLANE};
-    LAMMPS_NS::FixIndent *lmp_fix = dynamic_cast<LAMMPS_NS::FixIndent *>(lammpsController->findFixByIdentifier(identifier()));
+    lammpsFix(lammpsController);
+    LAMMPS_NS::FixIndent *lmp_fix = m_fixIndent;
     if(lmp_fix == nullptr) return;
     int dim;
     int    *istyle = static_cast<int*>(lmp_fix->extract("istyle", dim));
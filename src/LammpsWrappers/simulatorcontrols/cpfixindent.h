@@ -23,6 +23,10 @@ private:
     int m_dimension = 0;
     qreal m_radius = 1;
     QQuaternion m_rotation;
+    LAMMPS_NS::FixIndent *m_fixIndent = nullptr; // Null if the fix was replaced by another style
+
+protected:
+    virtual void resolve(LAMMPS_NS::Fix *fix) override;
 
 public:
     virtual void copyData(class LAMMPSController *lammpsController) override;
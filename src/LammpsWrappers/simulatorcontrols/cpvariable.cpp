@@ -23,10 +23,16 @@ void CPVariable::synchronize(LAMMPSController *lammpsController)
     LAMMPS *lammps = lammpsController->lammps();
     Variable *variable = lammps->input->variable;
 
-    QByteArray bytes = identifier().toLocal8Bit();
-    int ivar = variable->find(bytes.data());
+    if(m_generation.update(lammps, variable->generation)) {
+        QByteArray bytes = identifier().toLocal8Bit();
+        m_index = variable->find(bytes.data());
+    }
+    const int ivar = m_index;
     if (ivar < 0) return; // Didn't find it. Weird! TODO: handle this
+    // LAMMPS errors out if a formula uses energies or pressures that weren't tallied
+    if (!lammpsController->energyAndVirialTallied()) return;
     if (variable->equalstyle(ivar)) {
+        if(!needsScalarData(lammpsController)) return;
         Data1D *data = ensureExists("scalar", true);
         double value = variable->compute_equal(ivar);
         double time = lammpsController->system->simulationTime();
@@ -41,12 +47,13 @@ void CPVariable::synchronize(LAMMPSController *lammpsController)
         setIsPerAtom(true);
         Data1D *data = ensureExists("histogram", true);
 
-        if(!window() && !hovered()) return;
+        if(!needsAtomData(lammpsController)) return;
         m_atomData.resize(lammpsController->system->numberOfAtoms());
         double *vector = &m_atomData.front();
         variable->compute_atom(ivar,0 /* group index for all */,vector,1,0);
+        updateAtomDataRange();
         if(window()) {
-            data->createHistogram(m_atomData);
+            data->createHistogram(m_atomData, m_atomDataRange);
         }
     }
 }
@@ -2,6 +2,7 @@
 #define CPVARIABLE_H
 #include <vector>
 #include "simulatorcontrol.h"
+#include "../lammpsgeneration.h"
 class CPVariable : public SimulatorControl
 {
     Q_OBJECT
@@ -15,7 +16,8 @@ public slots:
 signals:
 
 private:
-
+    int m_index = -1; // Variable index in LAMMPS, looked up when Variable::generation changes
+    LammpsGeneration m_generation;
 };
 
 #endif // CPVARIABLE_H
@@ -1,6 +1,8 @@
 #include "simulatorcontrol.h"
 #include "lammpscontroller.h"
 #include "mysimulator.h"
+#include <algorithm>
+#include <limits>
 SimulatorControl::SimulatorControl(QObject *parent) : QObject(parent),
     m_qmlFileName("SimulatorControlItems/SimulatorControlItem.qml"),
     m_groupBit(1) // 1 is group all
@@ -236,6 +238,41 @@ const std::vector<double> &SimulatorControl::atomData() const
     return m_atomData;
 }
 
+const PerAtomRange &SimulatorControl::atomDataRange() const
+{
+    return m_atomDataRange;
+}
+
+bool SimulatorControl::needsAtomData(LAMMPSController *lammpsController) const
+{
+    // Per atom values are only shown in histograms and by PropertyModifier, both once per frame
+    return (m_window || m_hovered) && lammpsController->synchronizingFrame();
+}
+
+bool SimulatorControl::needsScalarData(LAMMPSController *lammpsController) const
+{
+    // Time series are only sampled every timestep while a plot shows them, otherwise once per
+    // frame for the value shown in the list of controls
+    return m_sampledEveryTimestep || lammpsController->synchronizingFrame();
+}
+
+void SimulatorControl::updateSampling()
+{
+    // m_window is set from the QML thread, so it is only read here where both threads agree
+    m_sampledEveryTimestep = m_window != nullptr;
+}
+
+bool SimulatorControl::sampledEveryTimestep() const
+{
+    return m_sampledEveryTimestep;
+}
+
+void SimulatorControl::updateAtomDataRange()
+{
+    // Shared by the histogram and PropertyModifier so the values are only scanned once for both
+    m_atomDataRange = PerAtomKernels::range(m_atomData.data(), m_atomData.size());
+}
+
 QString SimulatorControl::type() const
 {
     return m_type;
@@ -261,6 +298,28 @@ int SimulatorControl::groupBit() const
     return m_groupBit;
 }
 
+bool SimulatorControl::sharesXValues(const QVector<QVector<QPointF>> &points)
+{
+    // Older points are decimated per series, so two series only line up row by row
+    // when they have exactly the same x values
+    if(points.isEmpty()) return false;
+    for(const QVector<QPointF> &series : points) {
+        if(series.size() != points.first().size()) return false;
+        for(int i=0; i<series.size(); i++) {
+            if(series[i].x() != points.first()[i].x()) return false;
+        }
+    }
+    return true;
+}
+
+QString SimulatorControl::xName(QString key, bool sharedX) const
+{
+    // Variable name of the x values in the Python and Matlab exports
+    QString name = xLabel().toLower();
+    if(!sharedX) name += "_" + key.toLower().replace(" ", "_");
+    return name;
+}
+
 void SimulatorControl::exportToTextFile(QString fileName)
 {
     QFile file(fileName);
@@ -276,23 +335,39 @@ void SimulatorControl::exportToTextFile(QString fileName)
 
     QStringList keys = m_data1DRaw.keys();
 
-    // Print header with column names
-    out << "# " << xLabel() << " ";
+    // points() assembles the full history, so fetch each series once
+    QVector<QVector<QPointF>> points;
     for(QString key : keys) {
-        out << key << " ";
+        points.append(m_data1DRaw[key]->points());
     }
-    out << "\n";
-
-    int dataCount = m_data1DRaw[keys[0]]->points().size();
-    for(int i=0; i<dataCount; i++) {
-        float x = m_data1DRaw[keys[0]]->points()[i].x();
-        out << x << " ";
 
+    if(sharesXValues(points)) {
+        // Print header with column names
+        out << "# " << xLabel() << " ";
         for(QString key : keys) {
-            float y = m_data1DRaw[key]->points()[i].y();
-            out << y << " ";
+            out << key << " ";
         }
         out << "\n";
+
+        for(int i=0; i<points.first().size(); i++) {
+            float x = points[0][i].x();
+            out << x << " ";
+
+            for(const QVector<QPointF> &series : points) {
+                float y = series[i].y();
+                out << y << " ";
+            }
+            out << "\n";
+        }
+    } else {
+        // One x, y block per series, separated by two blank lines like gnuplot's index
+        for(int k=0; k<keys.size(); k++) {
+            if(k > 0) out << "\n\n";
+            out << "# " << xLabel() << " " << keys[k] << "\n";
+            for(const QPointF &point : points[k]) {
+                out << float(point.x()) << " " << float(point.y()) << "\n";
+            }
+        }
     }
     file.close();
 }
@@ -314,13 +389,18 @@ void SimulatorControl::exportToPythonFile(QString fileName)
     out << "import numpy as np\n";
 
     QStringList keys = m_data1DRaw.keys();
-    // Print arrays to variables
+    QVector<QVector<QPointF>> allPoints;
     for(QString key : keys) {
-        const QVector<QPointF> &points = m_data1DRaw[key]->points();
+        allPoints.append(m_data1DRaw[key]->points());
+    }
+    const bool sharedX = sharesXValues(allPoints);
+    // Print arrays to variables
+    for(int k=0; k<keys.size(); k++) {
+        const QString key = keys[k];
+        const QVector<QPointF> &points = allPoints[k];
 
-        if(key == keys[0]) {
-            qDebug() << "X label: " << xLabel().toLower();
-            out << xLabel().toLower() << " = np.asarray([";
+        if(k == 0 || !sharedX) {
+            out << xName(key, sharedX) << " = np.asarray([";
             for(auto iter = points.begin(); iter != points.end(); iter++) {
                 if (iter != points.begin()) out << ", ";
                 out << (*iter).x();
@@ -344,7 +424,7 @@ void SimulatorControl::exportToPythonFile(QString fileName)
             label.replace("<sup>", "^");
             label.replace("</sup>", "");
         }
-        out << "plt.plot(" << xLabel().toLower() << ", " << key.toLower().replace(" ", "_") << ", label=u'" << label << "')\n";
+        out << "plt.plot(" << xName(key, sharedX) << ", " << key.toLower().replace(" ", "_") << ", label=u'" << label << "')\n";
     }
     out << "plt.xlabel('" << xLabel() << "')\n"; // TODO: add units
     out << "plt.ylabel('" << yLabel() << "')\n";
@@ -368,12 +448,18 @@ void SimulatorControl::exportToMatlabFile(QString fileName)
     QTextStream out(&file);
 
     QStringList keys = m_data1DRaw.keys();
-    // Print arrays to variables
+    QVector<QVector<QPointF>> allPoints;
     for(QString key : keys) {
-        const QVector<QPointF> &points = m_data1DRaw[key]->points();
+        allPoints.append(m_data1DRaw[key]->points());
+    }
+    const bool sharedX = sharesXValues(allPoints);
+    // Print arrays to variables
+    for(int k=0; k<keys.size(); k++) {
+        const QString key = keys[k];
+        const QVector<QPointF> &points = allPoints[k];
 
-        if(key == keys[0]) {
-            out << xLabel().toLower() << " = [";
+        if(k == 0 || !sharedX) {
+            out << xName(key, sharedX) << " = [";
             for(auto iter = points.begin(); iter != points.end(); iter++) {
                 if (iter != points.begin()) out << ", ";
                 out << (*iter).x();
@@ -391,7 +477,7 @@ void SimulatorControl::exportToMatlabFile(QString fileName)
     out << "\n";
 
     for(QString key : keys) {
-        out << "plot(" << xLabel().toLower() << ", " << key.toLower().replace(" ", "_") << ", 'LineWidth',2);\n";
+        out << "plot(" << xName(key, sharedX) << ", " << key.toLower().replace(" ", "_") << ", 'LineWidth',2);\n";
         if(key==keys.first()) {
             out << "hold('on');\n";
         }
@@ -43,6 +43,7 @@ protected:
     int m_groupBit = 0;
     float m_scalarValue = 10;
     std::vector<double> m_atomData;
+    PerAtomRange m_atomDataRange;
     QString m_group;
     QString m_xLabel;
     QString m_yLabel;
@@ -51,7 +52,13 @@ protected:
     QVariantMap m_data1D;
     QMap<QString, class Data1D*> m_data1DRaw;
     QQuickWindow* m_window = nullptr;
+    bool m_sampledEveryTimestep = false; // Whether a plot was open at the last QML synchronization
     class Data1D *ensureExists(QString key, bool enabledByDefault);
+    void updateAtomDataRange(); // Call after changing m_atomData
+    bool needsAtomData(class LAMMPSController *lammpsController) const;
+    bool needsScalarData(class LAMMPSController *lammpsController) const;
+    static bool sharesXValues(const QVector<QVector<QPointF>> &points);
+    QString xName(QString key, bool sharedX) const;
 
 public:
     explicit SimulatorControl(QObject *parent = 0);
@@ -77,7 +84,10 @@ public:
     bool hovered() const;
     int groupBit() const;
     void updateData1D();
+    void updateSampling(); // Called while LAMMPS waits for the QML thread
+    bool sampledEveryTimestep() const;
     const std::vector<double> &atomData() const;
+    const PerAtomRange &atomDataRange() const; // Finite values of atomData()
     QString type() const;
     QUrl qmlFileName() const;
     QQuickWindow* window() const;
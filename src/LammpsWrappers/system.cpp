@@ -9,7 +9,9 @@
 #include "modifiers/modifier.h"
 #include "units.h"
 #include "../performance.h"
+#include "trajectoryreader.h"
 
+#include <QGuiApplication>
 #include <library.h>
 #include <input.h>
 #include <force.h>
@@ -31,6 +33,7 @@ System::System(AtomifySimulator *simulator)
     , m_fixes(std::make_unique<Fixes>(simulator))
     , m_variables(std::make_unique<Variables>(simulator))
     , m_performance(std::make_unique<Performance>(simulator))
+    , m_trajectoryReader(std::make_unique<TrajectoryReader>())
 {
     m_transformationMatrix.setToIdentity();
 }
@@ -39,43 +42,31 @@ System::~System()
 {
 }
 
-void System::computeCellMatrix(Domain *domain) {
-    domain->box_corners();
-    QVector3D a(domain->corners[1][0], domain->corners[1][1], domain->corners[1][2]);
-    QVector3D b(domain->corners[2][0], domain->corners[2][1], domain->corners[2][2]);
-    QVector3D c(domain->corners[4][0], domain->corners[4][1], domain->corners[4][2]);
-    QVector3D origo(domain->corners[0][0], domain->corners[0][1], domain->corners[0][2]);
-    a *= m_atoms->globalScale();
-    b *= m_atoms->globalScale();
-    c *= m_atoms->globalScale();
-    origo *= m_atoms->globalScale();
-
-    a -= origo;
-    b -= origo;
-    c -= origo;
+void System::computeCellMatrix(const double *h) {
+    // Columns are the box vectors a, b and c, see Domain::h
+    const float scale = m_atoms->globalScale();
     float values[] = {
-        a[0], b[0], c[0],
-        a[1], b[1], c[1],
-        a[2], b[2], c[2]
+        float(h[0]*scale), float(h[5]*scale), float(h[4]*scale),
+        0,                 float(h[1]*scale), float(h[3]*scale),
+        0,                 0,                 float(h[2]*scale)
     };
 
     setCellMatrix(QMatrix3x3(values));
 }
 
-void System::updateCenter(Domain *domain)
+void System::updateCenter(const double *boxlo, const double *h)
 {
-    QVector3D origo(domain->corners[0][0], domain->corners[0][1], domain->corners[0][2]);
-    QVector3D end(domain->corners[7][0], domain->corners[7][1], domain->corners[7][2]);
-    QVector3D newCenter = origo + 0.5*(end-origo);
+    QVector3D origo(boxlo[0], boxlo[1], boxlo[2]);
+    QVector3D diagonal(h[0] + h[5] + h[4], h[1] + h[3], h[2]);
+    QVector3D newCenter = origo + 0.5*diagonal;
     if( !(newCenter - m_center).isNull()) {
         m_center = newCenter;
         emit centerChanged(m_center);
     }
 }
 
-void System::updateTransformationMatrix(Domain *domain)
+void System::updateTransformationMatrix(const double *h)
 {
-    double *h = domain->h;
     float transformationMatrixValues[] = { // Must cast for clang
         float(h[0]*m_atoms->globalScale()), float(h[5]*m_atoms->globalScale()), float(h[4]*m_atoms->globalScale()), 0,
         0,    float(h[1]*m_atoms->globalScale()), float(h[3]*m_atoms->globalScale()), 0,
@@ -87,25 +78,25 @@ void System::updateTransformationMatrix(Domain *domain)
     emit transformationMatrixChanged(m_transformationMatrix);
 }
 
-void System::updateBoundaryStyle(Domain *domain)
+void System::updateBoundaryStyle(const int boundary[3][2], int dimension)
 {
     QString style;
-    for (int idim = 0; idim < domain->dimension; idim++) {
-        if(domain->boundary[idim][0] == 0) {
+    for (int idim = 0; idim < dimension; idim++) {
+        if(boundary[idim][0] == 0) {
             style += "p ";
             continue;
         } else {
             // Loop over the two sides and append only one letter if they are the same, append both if they differ
             for (int iside = 0; iside < 2; iside++) {
                 QString dimStyle = "";
-                if(domain->boundary[idim][iside] == 1) dimStyle = "f";
-                else if(domain->boundary[idim][iside] == 2) dimStyle = "s";
-                else if(domain->boundary[idim][iside] == 3) dimStyle = "m";
+                if(boundary[idim][iside] == 1) dimStyle = "f";
+                else if(boundary[idim][iside] == 2) dimStyle = "s";
+                else if(boundary[idim][iside] == 3) dimStyle = "m";
 
                 if(iside == 0) {
                     style += dimStyle;
                     continue;
-                } else if(domain->boundary[idim][0] != domain->boundary[idim][1]) {
+                } else if(boundary[idim][0] != boundary[idim][1]) {
                     style += dimStyle;
                 }
                 style += " ";
@@ -115,17 +106,17 @@ void System::updateBoundaryStyle(Domain *domain)
     setBoundaryStyle(style);
 }
 
-void System::updateSizeAndOrigin(Domain *domain)
+void System::updateSizeAndOrigin(const double *boxlo, const double *h)
 {
     bool originDidChange = false;
     bool sizeDidChange = false;
     for(int i=0; i<3; i++) {
-        if( fabs(m_origin[i] - domain->boxlo[i]) > 1e-4) {
-            m_origin[i] = domain->boxlo[i];
+        if( fabs(m_origin[i] - boxlo[i]) > 1e-4) {
+            m_origin[i] = boxlo[i];
             originDidChange  = true;
         }
-        if( fabs(m_size[i] - domain->prd[i]) > 1e-4) {
-            m_size[i] = domain->prd[i];
+        if( fabs(m_size[i] - h[i]) > 1e-4) {
+            m_size[i] = h[i];
             sizeDidChange = true;
         }
     }
@@ -149,7 +140,8 @@ void System::calculateCPURemain(LAMMPS *lammps)
 
 void System::calculateTimestepsPerSeconds(LAMMPS *lammps)
 {
-    if(m_currentTimestep % 10 == 0 && m_currentTimestep>0) {
+    // Called once per frame, spcpu is measured since the previous call
+    if(m_currentTimestep>0) {
         double value = lammps_get_thermo(lammps, "spcpu");
         if(value < 0) return;
         double oldValue = m_performance->timestepsPerSecond();
@@ -160,11 +152,14 @@ void System::calculateTimestepsPerSeconds(LAMMPS *lammps)
 
 void System::synchronize(LAMMPSController *lammpsController)
 {
+    // Runs every timestep, so only the cheap state and the time series of computes, fixes and
+    // variables. Everything that is only needed to show a frame is in synchronizeFrame.
     LAMMPS *lammps = lammpsController->lammps();
     if(!lammps) {
         reset();
         return;
     }
+    ProfilerScope profilerScope(m_performance->profiler(), "System::synchronize");
     setIsValid(true);
 
     if(lammps->input->lastLine()) {
@@ -185,18 +180,6 @@ void System::synchronize(LAMMPSController *lammpsController)
     Update *update = lammps->update;
     if(!domain || !atom || !update) return; // These may not be set in LAMMPS (they probably are, but an easy test).
 
-    updateTransformationMatrix(domain);
-    updateSizeAndOrigin(domain);
-    computeCellMatrix(domain);
-    updateBoundaryStyle(domain);
-    setTriclinic(domain->triclinic);
-    setPairStyle(QString(lammps->force->pair_style));
-    m_performance->setThreads(lammps->comm->nthreads);
-    updateCenter(domain);
-    setDensity(lammps_get_thermo(lammps, "density"));
-
-    setNumberOfDangerousNeighborlistBuilds(lammps_get_thermo(lammps, "ndanger"));
-
     if(m_numberOfAtoms != atom->natoms) {
         m_numberOfAtoms = atom->natoms;
         emit numberOfAtomsChanged(m_numberOfAtoms);
@@ -224,6 +207,38 @@ void System::synchronize(LAMMPSController *lammpsController)
         emit currentTimestepChanged(m_currentTimestep);
     }
 
+    setDt(lammps->update->dt);
+
+    m_computes->synchronize(lammpsController);
+    m_variables->synchronize(lammpsController);
+    m_fixes->synchronize(lammpsController);
+    m_performance->synchronize(lammpsController);
+}
+
+void System::synchronizeFrame(LAMMPSController *lammpsController)
+{
+    // Runs only for timesteps that will be shown, after synchronize
+    LAMMPS *lammps = lammpsController->lammps();
+    if(!lammps) return;
+    ProfilerScope profilerScope(m_performance->profiler(), "System::synchronizeFrame");
+
+    Domain *domain = lammps->domain;
+    Atom *atom = lammps->atom;
+    Update *update = lammps->update;
+    if(!domain || !atom || !update) return;
+
+    updateTransformationMatrix(domain->h);
+    updateSizeAndOrigin(domain->boxlo, domain->h);
+    computeCellMatrix(domain->h);
+    updateBoundaryStyle(domain->boundary, domain->dimension);
+    setTriclinic(domain->triclinic);
+    setPairStyle(QString(lammps->force->pair_style));
+    m_performance->setThreads(lammps->comm->nthreads);
+    updateCenter(domain->boxlo, domain->h);
+    setDensity(lammps_get_thermo(lammps, "density"));
+
+    setNumberOfDangerousNeighborlistBuilds(lammps_get_thermo(lammps, "ndanger"));
+
     for(QVariant modifier_ : m_atoms->modifiers()) {
         Modifier *modifier = modifier_.value<Modifier*>();
         modifier->setSystem(this);
@@ -231,7 +246,6 @@ void System::synchronize(LAMMPSController *lammpsController)
     m_volume = m_size[0]*m_size[1]*m_size[2];
     emit volumeChanged(m_volume);
 
-    setDt(lammps->update->dt);
     setLammpsVersion(QString(LAMMPS_VERSION));
 
 #ifdef MACAPPSTORE
@@ -246,13 +260,55 @@ void System::synchronize(LAMMPSController *lammpsController)
     m_regions->synchronize(lammpsController);
     m_groups->synchronize(lammpsController);
     m_atoms->synchronize(lammpsController);
-    m_computes->synchronize(lammpsController);
-    m_variables->synchronize(lammpsController);
-    m_fixes->synchronize(lammpsController);
-    m_performance->synchronize(lammpsController);
+    m_performance->synchronizeFrame(lammpsController);
     m_units->synchronize(lammps);
 }
 
+void System::synchronizeTrajectoryFrame(const TrajectoryFrame &frame)
+{
+    // Like synchronize and synchronizeFrame, but with the state a trajectory file has
+    ProfilerScope profilerScope(m_performance->profiler(), "System::synchronizeTrajectoryFrame");
+    setIsValid(true);
+    setState("Trajectory");
+
+    if(m_numberOfAtoms != frame.size()) {
+        m_numberOfAtoms = frame.size();
+        emit numberOfAtomsChanged(m_numberOfAtoms);
+    }
+
+    if(m_numberOfAtomTypes != frame.numberOfAtomTypes) {
+        m_numberOfAtomTypes = frame.numberOfAtomTypes;
+        emit numberOfAtomTypesChanged(m_numberOfAtomTypes);
+    }
+
+    // Dumps don't store the time, so the timestep is used as in rerun
+    if(m_simulationTime != frame.timestep) {
+        m_simulationTime = frame.timestep;
+        emit simulationTimeChanged(m_simulationTime);
+    }
+
+    if(m_currentTimestep != frame.timestep) {
+        m_currentTimestep = frame.timestep;
+        emit currentTimestepChanged(m_currentTimestep);
+    }
+
+    updateTransformationMatrix(frame.h);
+    updateSizeAndOrigin(frame.boxlo, frame.h);
+    computeCellMatrix(frame.h);
+    updateBoundaryStyle(frame.boundary, 3);
+    setTriclinic(frame.triclinic);
+    updateCenter(frame.boxlo, frame.h);
+
+    for(QVariant modifier_ : m_atoms->modifiers()) {
+        Modifier *modifier = modifier_.value<Modifier*>();
+        modifier->setSystem(this);
+    }
+    m_volume = m_size[0]*m_size[1]*m_size[2];
+    emit volumeChanged(m_volume);
+
+    m_atoms->synchronizeTrajectoryFrame(frame);
+}
+
 QVector3D System::origin() const
 {
     return m_origin;
@@ -313,6 +369,11 @@ Variables *System::variables() const
     return m_variables.get();
 }
 
+TrajectoryReader *System::trajectoryReader() const
+{
+    return m_trajectoryReader.get();
+}
+
 int System::numberOfAtomTypes() const
 {
     return m_numberOfAtomTypes;
@@ -327,6 +388,15 @@ void System::setCameraPosition(QVector3D cameraPosition)
     emit cameraPositionChanged(cameraPosition);
 }
 
+void System::setViewProjectionMatrix(QMatrix4x4 viewProjectionMatrix)
+{
+    if (m_viewProjectionMatrix == viewProjectionMatrix)
+        return;
+
+    m_viewProjectionMatrix = viewProjectionMatrix;
+    emit viewProjectionMatrixChanged(viewProjectionMatrix);
+}
+
 void System::reset()
 {
     setIsValid(false);
@@ -339,6 +409,7 @@ void System::reset()
     m_variables->reset();
     m_units->reset();
     m_performance->reset();
+    m_trajectoryReader->close();
     setDt(0);
     setDensity(0);
     setCpuremain(0);
@@ -462,11 +533,19 @@ float System::density() const
 
 void System::synchronizeQML(LAMMPSController *lammpsController)
 {
+    // Modifiers run on the LAMMPS thread where the keyboard can't be queried, and headless
+    // runs have no QGuiApplication and no keyboard at all
+    m_altModifier = qobject_cast<QGuiApplication*>(QCoreApplication::instance())
+            && (QGuiApplication::queryKeyboardModifiers() & Qt::AltModifier);
+    synchronizeCamera();
     m_computes->synchronizeQML(lammpsController);
     m_variables->synchronizeQML(lammpsController);
     m_fixes->synchronizeQML(lammpsController);
+    lammpsController->updateTallyRequirements(); // The controls just latched which plots are open
     m_regions->synchronizeQML(lammpsController);
     m_groups->synchronizeQML(lammpsController);
+    m_atoms->recorder()->synchronizeQML();
+    m_trajectoryReader->synchronizeQML();
 }
 
 void System::updateThreadOnDataObjects(QThread *thread)
@@ -481,11 +560,45 @@ QVector3D System::cameraPosition() const
     return m_cameraPosition;
 }
 
+QMatrix4x4 System::viewProjectionMatrix() const
+{
+    return m_viewProjectionMatrix;
+}
+
 QVector3D System::center() const
 {
     return m_center;
 }
 
+bool System::altModifier() const
+{
+    return m_altModifier;
+}
+
+bool System::synchronizeCamera()
+{
+    // QML moves the camera at any time, the LAMMPS thread culls and sorts with this copy
+    m_cameraMoved = m_renderCameraPosition != m_cameraPosition || m_renderViewProjectionMatrix != m_viewProjectionMatrix;
+    m_renderCameraPosition = m_cameraPosition;
+    m_renderViewProjectionMatrix = m_viewProjectionMatrix;
+    return m_cameraMoved;
+}
+
+bool System::cameraMoved() const
+{
+    return m_cameraMoved;
+}
+
+QVector3D System::renderCameraPosition() const
+{
+    return m_renderCameraPosition;
+}
+
+QMatrix4x4 System::renderViewProjectionMatrix() const
+{
+    return m_renderViewProjectionMatrix;
+}
+
 void System::setIsValid(bool isValid)
 {
     if (m_isValid == isValid)
@@ -19,6 +19,7 @@ class System : public QObject
     Q_PROPERTY(QVector3D size READ size NOTIFY sizeChanged)
     Q_PROPERTY(QVector3D origin READ origin NOTIFY originChanged)
     Q_PROPERTY(QVector3D cameraPosition READ cameraPosition WRITE setCameraPosition NOTIFY cameraPositionChanged)
+    Q_PROPERTY(QMatrix4x4 viewProjectionMatrix READ viewProjectionMatrix WRITE setViewProjectionMatrix NOTIFY viewProjectionMatrixChanged)
     Q_PROPERTY(QVector3D center READ center NOTIFY centerChanged)
     Q_PROPERTY(QMatrix4x4 transformationMatrix READ transformationMatrix NOTIFY transformationMatrixChanged)
     Q_PROPERTY(QMatrix3x3 cellMatrix READ cellMatrix WRITE setCellMatrix NOTIFY cellMatrixChanged)
@@ -40,6 +41,7 @@ class System : public QObject
     Q_PROPERTY(Variables* variables READ variables NOTIFY variablesChanged)
     Q_PROPERTY(Fixes* fixes READ fixes NOTIFY fixesChanged)
     Q_PROPERTY(Units* units READ units NOTIFY unitsChanged)
+    Q_PROPERTY(TrajectoryReader* trajectoryReader READ trajectoryReader NOTIFY trajectoryReaderChanged)
     Q_PROPERTY(bool isValid READ isValid WRITE setIsValid NOTIFY isValidChanged)
     Q_PROPERTY(QString state READ state WRITE setState NOTIFY stateChanged)
     Q_PROPERTY(QString lammpsVersion READ lammpsVersion WRITE setLammpsVersion NOTIFY lammpsVersionChanged)
@@ -60,6 +62,7 @@ public:
     class Units* units() const;
     class Fixes* fixes() const;
     class Variables* variables() const;
+    class TrajectoryReader* trajectoryReader() const;
     QVector3D origin() const;
     QVector3D size() const;
     int numberOfAtoms() const;
@@ -68,14 +71,22 @@ public:
     int numberOfAtomTypes() const;
     float volume() const;
     QVector3D cameraPosition() const;
+    QMatrix4x4 viewProjectionMatrix() const;
     QVector3D center() const;
 
     // Actions
-    void synchronize(class LAMMPSController *lammpsController);
+    void synchronize(class LAMMPSController *lammpsController); // Every timestep
+    void synchronizeFrame(class LAMMPSController *lammpsController); // Only timesteps that are shown
     void synchronizeQML(class LAMMPSController *lammpsController);
+    void synchronizeTrajectoryFrame(const struct TrajectoryFrame &frame); // Instead of synchronizeFrame when playing a trajectory
     void updateThreadOnDataObjects(QThread *thread);
     void reset();
     bool isValid() const;
+    bool altModifier() const; // Whether Alt was held at the last QML synchronization
+    bool synchronizeCamera(); // Latches the camera reported by QML, returns whether it moved
+    bool cameraMoved() const; // Whether the camera moved at the last synchronization
+    QVector3D renderCameraPosition() const; // The latched camera, read on the LAMMPS thread
+    QMatrix4x4 renderViewProjectionMatrix() const;
     QMatrix4x4 transformationMatrix() const;
     QMatrix3x3 cellMatrix() const;
     QString boundaryStyle() const;
@@ -97,6 +108,7 @@ public:
 public slots:
     void setIsValid(bool isValid);
     void setCameraPosition(QVector3D cameraPosition);
+    void setViewProjectionMatrix(QMatrix4x4 viewProjectionMatrix);
     void setCellMatrix(QMatrix3x3 cellMatrix);
     void setBoundaryStyle(QString boundaryStyle);
     void setTriclinic(bool triclinic);
@@ -124,10 +136,12 @@ signals:
     void fixesChanged(class Fixes* fixes);
     void computesChanged(class Computes* computes);
     void variablesChanged(class Variables* variables);
+    void trajectoryReaderChanged(class TrajectoryReader* trajectoryReader);
     void numberOfAtomTypesChanged(int numberOfAtomTypes);
     void volumeChanged(float volume);
     void isValidChanged(bool isValid);
     void cameraPositionChanged(QVector3D cameraPosition);
+    void viewProjectionMatrixChanged(QMatrix4x4 viewProjectionMatrix);
     void centerChanged(QVector3D center);
     void transformationMatrixChanged(QMatrix4x4 transformationMatrix);
     void cellMatrixChanged(QMatrix3x3 cellMatrix);
@@ -155,20 +169,27 @@ private:
     std::unique_ptr<class Fixes> m_fixes;
     std::unique_ptr<class Variables> m_variables;
     std::unique_ptr<class Performance> m_performance;
+    std::unique_ptr<class TrajectoryReader> m_trajectoryReader;
     QVector3D m_origin;
     QVector3D m_size;
     QVector3D m_cameraPosition;
+    QMatrix4x4 m_viewProjectionMatrix; // Identity until the visualizer reports its camera
+    QVector3D m_renderCameraPosition;
+    QMatrix4x4 m_renderViewProjectionMatrix;
+    bool m_cameraMoved = false;
     int m_numberOfAtoms = 0;
     float m_simulationTime = 0;
     int m_currentTimestep = 0;
     int m_numberOfAtomTypes = 0;
     float m_volume = 0;
     bool m_isValid = false;
-    void updateTransformationMatrix(LAMMPS_NS::Domain *domain);
-    void updateSizeAndOrigin(LAMMPS_NS::Domain *domain);
-    void computeCellMatrix(LAMMPS_NS::Domain *domain);
-    void updateBoundaryStyle(LAMMPS_NS::Domain *domain);
-    void updateCenter(LAMMPS_NS::Domain *domain);
+    bool m_altModifier = false;
+    // The box as in LAMMPS' Domain, h is xprd, yprd, zprd, yz, xz, xy
+    void updateTransformationMatrix(const double *h);
+    void updateSizeAndOrigin(const double *boxlo, const double *h);
+    void computeCellMatrix(const double *h);
+    void updateBoundaryStyle(const int boundary[3][2], int dimension);
+    void updateCenter(const double *boxlo, const double *h);
     QMatrix4x4 m_transformationMatrix;
     QMatrix3x3 m_cellMatrix;
     QString m_boundaryStyle = "None";
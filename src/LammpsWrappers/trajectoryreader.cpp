@@ -0,0 +1,1151 @@
+#include "trajectoryreader.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+static const qint64 prefetchMemory = 512*1024*1024; // Bytes of decoded frames kept ahead of the playhead
+static const int maximumPrefetchStep = 1000; // Larger jumps between reads are seeks, not playback
+
+// The indexer and the decoding workers, each runs one member function of the reader
+class FunctionThread : public QThread
+{
+public:
+    explicit FunctionThread(std::function<void()> function) : m_function(function) { }
+protected:
+    void run() override { m_function(); }
+private:
+    std::function<void()> m_function;
+};
+
+// Text parsing. Dumps are written with printf, so a simple parser that accumulates the digits
+// in an integer is exact enough for floats and several times faster than strtod.
+
+static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+static inline bool isDigit(char c) { return unsigned(c - '0') < 10; }
+
+static inline const char *skipSpaces(const char *p, const char *end)
+{
+    while(p < end && isSpace(*p)) p++;
+    return p;
+}
+
+static inline const char *skipToken(const char *p, const char *end)
+{
+    while(p < end && !isSpace(*p) && *p != '\n') p++;
+    return p;
+}
+
+static inline const char *lineEnd(const char *p, const char *end)
+{
+    const char *newline = static_cast<const char*>(memchr(p, '\n', end - p));
+    return newline ? newline : end;
+}
+
+static inline const char *nextLine(const char *p, const char *end)
+{
+    const char *newline = lineEnd(p, end);
+    return newline < end ? newline + 1 : end;
+}
+
+static double parseNumber(const char *&p, const char *end)
+{
+    p = skipSpaces(p, end);
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    // At most 19 significant digits fit in the mantissa, later ones are dropped
+    quint64 mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    for(; p < end && isDigit(*p); p++) {
+        if(digits < 19) {
+            mantissa = 10*mantissa + (*p - '0');
+            if(mantissa) digits++;
+        } else {
+            exponent++;
+        }
+    }
+    if(p < end && *p == '.') {
+        for(p++; p < end && isDigit(*p); p++) {
+            if(digits >= 19) continue;
+            mantissa = 10*mantissa + (*p - '0');
+            if(mantissa) digits++;
+            exponent--;
+        }
+    }
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if(p < end && (*p == '-' || *p == '+')) negativeExponent = *p++ == '-';
+        int value = 0;
+        for(; p < end && isDigit(*p); p++) value = std::min(10*value + (*p - '0'), 10000);
+        exponent += negativeExponent ? -value : value;
+    }
+
+    double value = mantissa;
+    if(exponent < 0) value = exponent >= -22 ? value / powersOfTen[-exponent] : value*std::pow(10.0, exponent);
+    else if(exponent > 0) value = exponent <= 22 ? value*powersOfTen[exponent] : value*std::pow(10.0, exponent);
+    return negative ? -value : value;
+}
+
+static quint32 packElement(const char *begin, const char *end)
+{
+    // Element names are short, four characters identify them
+    quint32 key = 0;
+    for(int k=0; k<4 && begin + k < end; k++) key |= quint32(uchar(begin[k])) << (8*k);
+    return key;
+}
+
+// Calls parseLine(line, begin, end) for the first numberOfLines lines in [begin, end). The text
+// is split in chunks at line breaks, the lines of each chunk are counted so every chunk knows the
+// number of its first line and then all chunks are parsed in parallel. Returns false if there
+// were fewer lines or parseLine failed.
+template<typename ParseLine>
+static bool parseLines(const char *begin, const char *end, int numberOfLines, bool parallel, ParseLine parseLine)
+{
+    const qint64 bytes = end - begin;
+    const int numberOfChunks = parallel ? int(std::max<qint64>(1, std::min<qint64>(256, bytes / (256*1024)))) : 1;
+    std::vector<const char*> chunkBegin(numberOfChunks + 1);
+    for(int chunk=0; chunk<numberOfChunks; chunk++) {
+        const char *p = begin + bytes*chunk/numberOfChunks;
+        chunkBegin[chunk] = chunk > 0 && p[-1] != '\n' ? nextLine(p, end) : p;
+    }
+    chunkBegin[numberOfChunks] = end;
+
+    std::vector<int> firstLine(numberOfChunks + 1, 0);
+    #pragma omp parallel for if(parallel)
+    for(int chunk=0; chunk<numberOfChunks; chunk++) {
+        int lines = 0;
+        for(const char *p = chunkBegin[chunk]; p < chunkBegin[chunk+1]; p = nextLine(p, end)) lines++;
+        firstLine[chunk+1] = lines;
+    }
+    for(int chunk=0; chunk<numberOfChunks; chunk++) firstLine[chunk+1] += firstLine[chunk];
+    if(firstLine[numberOfChunks] < numberOfLines) return false;
+
+    int failures = 0;
+    #pragma omp parallel for if(parallel) reduction(+:failures)
+    for(int chunk=0; chunk<numberOfChunks; chunk++) {
+        int line = firstLine[chunk];
+        for(const char *p = chunkBegin[chunk]; p < chunkBegin[chunk+1] && line < numberOfLines; line++) {
+            const char *next = nextLine(p, end);
+            if(!parseLine(line, p, lineEnd(p, next))) failures++;
+            p = next;
+        }
+    }
+    return failures == 0;
+}
+
+// Dumps store the bounding box of triclinic boxes, bounds[d] is lo, hi and the tilt (xy, xz, yz)
+static void setBox(TrajectoryFrame &frame, const double bounds[3][3], bool triclinic)
+{
+    double low[3] = {bounds[0][0], bounds[1][0], bounds[2][0]};
+    double high[3] = {bounds[0][1], bounds[1][1], bounds[2][1]};
+    const double xy = triclinic ? bounds[0][2] : 0;
+    const double xz = triclinic ? bounds[1][2] : 0;
+    const double yz = triclinic ? bounds[2][2] : 0;
+    if(triclinic) {
+        low[0] -= std::min(std::min(0.0, xy), std::min(xz, xy + xz));
+        high[0] -= std::max(std::max(0.0, xy), std::max(xz, xy + xz));
+        low[1] -= std::min(0.0, yz);
+        high[1] -= std::max(0.0, yz);
+    }
+    for(int d=0; d<3; d++) {
+        frame.boxlo[d] = low[d];
+        frame.h[d] = high[d] - low[d];
+    }
+    frame.h[3] = yz;
+    frame.h[4] = xz;
+    frame.h[5] = xy;
+    frame.triclinic = triclinic;
+}
+
+// For formats without a box, or to place a DCD unit cell around the atoms
+static void boundingBox(const TrajectoryFrame &frame, bool parallel, double low[3], double high[3])
+{
+    const int numberOfAtoms = frame.size();
+    const float *x = frame.x.constData();
+    const float *y = frame.y.constData();
+    const float *z = frame.z.constData();
+    float minimumX = 1e30, minimumY = 1e30, minimumZ = 1e30;
+    float maximumX = -1e30, maximumY = -1e30, maximumZ = -1e30;
+    #pragma omp parallel for if(parallel) reduction(min:minimumX,minimumY,minimumZ) reduction(max:maximumX,maximumY,maximumZ)
+    for(int i=0; i<numberOfAtoms; i++) {
+        minimumX = std::min(minimumX, x[i]); maximumX = std::max(maximumX, x[i]);
+        minimumY = std::min(minimumY, y[i]); maximumY = std::max(maximumY, y[i]);
+        minimumZ = std::min(minimumZ, z[i]); maximumZ = std::max(maximumZ, z[i]);
+    }
+    if(numberOfAtoms == 0) minimumX = minimumY = minimumZ = maximumX = maximumY = maximumZ = 0;
+    low[0] = minimumX; low[1] = minimumY; low[2] = minimumZ;
+    high[0] = maximumX; high[1] = maximumY; high[2] = maximumZ;
+}
+
+static void setBoundingBox(TrajectoryFrame &frame, bool parallel)
+{
+    double low[3], high[3];
+    boundingBox(frame, parallel, low, high);
+    const double bounds[3][3] = {{low[0], high[0], 0}, {low[1], high[1], 0}, {low[2], high[2], 0}};
+    setBox(frame, bounds, false);
+    for(int d=0; d<3; d++) frame.boundary[d][0] = frame.boundary[d][1] = 1;
+}
+
+static void countAtomTypes(TrajectoryFrame &frame, bool parallel)
+{
+    const int numberOfAtoms = frame.size();
+    const int *types = frame.types.constData();
+    int maximum = 0;
+    #pragma omp parallel for if(parallel) reduction(max:maximum)
+    for(int i=0; i<numberOfAtoms; i++) maximum = std::max(maximum, types[i]);
+    frame.numberOfAtomTypes = maximum;
+}
+
+// Dumps list atoms in the order the processors wrote them, which changes between frames. If the
+// ids are 1 to N they are used as index instead so every atom keeps its place.
+static void orderById(TrajectoryFrame &frame, const QVector<qint64> &ids, bool parallel)
+{
+    const int numberOfAtoms = frame.size();
+    QVector<int> index(numberOfAtoms, -1);
+    for(int i=0; i<numberOfAtoms; i++) {
+        const qint64 id = ids[i];
+        if(id < 1 || id > numberOfAtoms || index[id-1] >= 0) return; // Not a permutation, keep the file order
+        index[id-1] = i;
+    }
+
+    TrajectoryFrame ordered;
+    ordered.x.resize(numberOfAtoms);
+    ordered.y.resize(numberOfAtoms);
+    ordered.z.resize(numberOfAtoms);
+    ordered.types.resize(numberOfAtoms);
+    #pragma omp parallel for if(parallel)
+    for(int i=0; i<numberOfAtoms; i++) {
+        const int j = index[i];
+        ordered.x[i] = frame.x[j];
+        ordered.y[i] = frame.y[j];
+        ordered.z[i] = frame.z[j];
+        ordered.types[i] = frame.types[j];
+    }
+    frame.x.swap(ordered.x);
+    frame.y.swap(ordered.y);
+    frame.z.swap(ordered.z);
+    frame.types.swap(ordered.types);
+}
+
+static void resizeFrame(TrajectoryFrame &frame, int numberOfAtoms)
+{
+    frame.x.resize(numberOfAtoms);
+    frame.y.resize(numberOfAtoms);
+    frame.z.resize(numberOfAtoms);
+    frame.types.resize(numberOfAtoms);
+}
+
+// Text dumps
+
+struct TextHeader {
+    qint64 timestep = 0;
+    qint64 numberOfAtoms = -1;
+    double bounds[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    int boundary[3][2] = {{0, 0}, {0, 0}, {0, 0}};
+    bool triclinic = false;
+    QList<QByteArray> columns;
+    const char *atoms = nullptr; // First atom line
+};
+
+static int boundaryCode(char flag)
+{
+    switch(flag) {
+    case 'f': return 1;
+    case 's': return 2;
+    case 'm': return 3;
+    default: return 0;
+    }
+}
+
+static bool parseTextHeader(const char *p, const char *end, TextHeader &header)
+{
+    // ITEM: lines up to and including ITEM: ATOMS, each followed by its values
+    bool hasTimestep = false;
+    while(p < end) {
+        const QByteArray line = QByteArray(p, lineEnd(p, end) - p).trimmed();
+        p = nextLine(p, end);
+        if(!line.startsWith("ITEM:")) return false;
+        const QByteArray item = line.mid(5).trimmed();
+
+        if(item == "TIMESTEP") {
+            header.timestep = qint64(parseNumber(p, end));
+            hasTimestep = true;
+            p = nextLine(p, end);
+        } else if(item == "NUMBER OF ATOMS") {
+            header.numberOfAtoms = qint64(parseNumber(p, end));
+            p = nextLine(p, end);
+        } else if(item.startsWith("BOX BOUNDS")) {
+            const QList<QByteArray> flags = item.mid(10).simplified().split(' ');
+            header.triclinic = flags.first() == "xy";
+            for(int d=0; d<3; d++) {
+                for(int k=0; k<(header.triclinic ? 3 : 2); k++) header.bounds[d][k] = parseNumber(p, end);
+                p = nextLine(p, end);
+            }
+            // The last three flags are the boundary styles, e.g. pp pp fm
+            for(int d=0; d<3 && flags.size() >= 3; d++) {
+                const QByteArray &flag = flags[flags.size() - 3 + d];
+                if(flag.size() != 2) continue;
+                header.boundary[d][0] = boundaryCode(flag[0]);
+                header.boundary[d][1] = boundaryCode(flag[1]);
+            }
+        } else if(item.startsWith("ATOMS")) {
+            header.columns = item.mid(5).simplified().split(' ');
+            header.atoms = p;
+            return hasTimestep && header.numberOfAtoms >= 0 && header.numberOfAtoms < (1LL << 31);
+        } else {
+            // Single line items like TIME or UNITS
+            p = nextLine(p, end);
+        }
+    }
+    return false;
+}
+
+struct Columns {
+    int id = -1;
+    int type = -1;
+    int element = -1;
+    int position[3] = {-1, -1, -1};
+    bool scaled = false;
+    int count = 0; // Tokens to read on each line
+};
+
+static Columns findColumns(const QList<QByteArray> &names)
+{
+    Columns columns;
+    for(int column=0; column<names.size(); column++) {
+        const QByteArray &name = names[column];
+        int *index = nullptr;
+        if(name == "id") index = &columns.id;
+        else if(name == "type") index = &columns.type;
+        else if(name == "element") index = &columns.element;
+        else if(name == "x" || name == "xu" || name == "xs" || name == "xsu") index = &columns.position[0];
+        else if(name == "y" || name == "yu" || name == "ys" || name == "ysu") index = &columns.position[1];
+        else if(name == "z" || name == "zu" || name == "zs" || name == "zsu") index = &columns.position[2];
+        if(!index || *index >= 0) continue;
+        *index = column;
+        if(index == &columns.position[0]) columns.scaled = name.startsWith("xs");
+        columns.count = column + 1;
+    }
+    return columns;
+}
+
+// Scaled coordinates are fractions of the box vectors
+static void unscale(TrajectoryFrame &frame, bool parallel)
+{
+    const int numberOfAtoms = frame.size();
+    const double *lo = frame.boxlo;
+    const double *h = frame.h;
+    float *x = frame.x.data();
+    float *y = frame.y.data();
+    float *z = frame.z.data();
+    #pragma omp parallel for if(parallel)
+    for(int i=0; i<numberOfAtoms; i++) {
+        const double sx = x[i], sy = y[i], sz = z[i];
+        x[i] = lo[0] + h[0]*sx + h[5]*sy + h[4]*sz;
+        y[i] = lo[1] + h[1]*sy + h[3]*sz;
+        z[i] = lo[2] + h[2]*sz;
+    }
+}
+
+// Binary dumps, the format written by DumpCustom::header_binary and write_binary
+
+struct BinaryHeader {
+    qint64 timestep = 0;
+    qint64 numberOfAtoms = 0;
+    int triclinic = 0;
+    int boundary[3][2];
+    double box[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0}; // xlo xhi ylo yhi zlo zhi (xy xz yz)
+    int valuesPerAtom = 0;
+    int numberOfChunks = 0;
+    qint64 size = 0;
+};
+
+template<typename T>
+static inline bool readValue(const uchar *&p, const uchar *end, T &value)
+{
+    if(end - p < qint64(sizeof(T))) return false;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+static bool parseBinaryHeader(const uchar *begin, const uchar *end, BinaryHeader &header)
+{
+    // There is no magic number, so the header must look sane to be accepted
+    const uchar *p = begin;
+    if(!readValue(p, end, header.timestep) || !readValue(p, end, header.numberOfAtoms) || !readValue(p, end, header.triclinic)) return false;
+    if(header.timestep < 0 || header.numberOfAtoms < 0 || header.numberOfAtoms >= (1LL << 31)) return false;
+    if(header.triclinic != 0 && header.triclinic != 1) return false;
+    for(int d=0; d<3; d++) {
+        for(int side=0; side<2; side++) {
+            if(!readValue(p, end, header.boundary[d][side])) return false;
+            if(header.boundary[d][side] < 0 || header.boundary[d][side] > 3) return false;
+        }
+    }
+    for(int k=0; k<(header.triclinic ? 9 : 6); k++) {
+        if(!readValue(p, end, header.box[k]) || !std::isfinite(header.box[k])) return false;
+    }
+    for(int d=0; d<3; d++) {
+        if(header.box[2*d] > header.box[2*d+1]) return false;
+    }
+    if(!readValue(p, end, header.valuesPerAtom) || !readValue(p, end, header.numberOfChunks)) return false;
+    if(header.valuesPerAtom < 1 || header.valuesPerAtom > 1000 || header.numberOfChunks < 1 || header.numberOfChunks > (1 << 24)) return false;
+    header.size = p - begin;
+    return true;
+}
+
+// DCD files, the format written by DumpDCD
+
+static inline qint32 readInt32(const uchar *p)
+{
+    qint32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+TrajectoryReader::TrajectoryReader(QObject *parent) : QObject(parent)
+{
+
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    close();
+}
+
+long TrajectoryFrame::memoryUsage() const
+{
+    return (x.capacity() + y.capacity() + z.capacity())*sizeof(float) + types.capacity()*sizeof(int);
+}
+
+TrajectoryReader::Format TrajectoryReader::detectFormat(const uchar *data, qint64 size, const QString &fileName)
+{
+    const QByteArray start = QByteArray::fromRawData(reinterpret_cast<const char*>(data), int(std::min<qint64>(size, 64)));
+    if(start.startsWith("ITEM:")) return TextDump;
+    if(size >= 8 && readInt32(data) == 84 && memcmp(data + 4, "CORD", 4) == 0) return DCD;
+
+    if(QFileInfo(fileName).suffix().toLower() == "xyz") {
+        // First line is the number of atoms
+        const char *p = start.constData();
+        const char *end = p + start.size();
+        p = skipSpaces(p, end);
+        if(p < end && isDigit(*p)) return XYZ;
+    }
+
+    BinaryHeader header;
+    if(parseBinaryHeader(data, data + size, header)) return BinaryDump;
+    return Unknown;
+}
+
+bool TrajectoryReader::isTrajectoryFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray start = file.read(4096);
+    return detectFormat(reinterpret_cast<const uchar*>(start.constData()), start.size(), fileName) != Unknown;
+}
+
+bool TrajectoryReader::open(const QString &fileName)
+{
+    close();
+    m_file.reset(new QFile(fileName));
+    if(!m_file->open(QIODevice::ReadOnly)) {
+        m_error = QString("Could not open trajectory %1").arg(fileName);
+        close();
+        return false;
+    }
+
+    // Pages are only read once a frame is indexed or decoded, so mapping is cheap for any file size
+    m_size = m_file->size();
+    m_data = m_size > 0 ? m_file->map(0, m_size) : nullptr;
+    if(!m_data) {
+        m_error = QString("Could not map trajectory %1 (%2 bytes) into memory").arg(fileName).arg(m_size);
+        close();
+        return false;
+    }
+
+    m_format = detectFormat(m_data, m_size, fileName);
+    if(m_format == Unknown || (m_format == DCD && !readDCDHeader())) {
+        m_error = QString("%1 is not a LAMMPS dump, XYZ or DCD file").arg(fileName);
+        close();
+        return false;
+    }
+
+    // The first frame is indexed right away so a broken file fails here and not during playback
+    FrameIndex first;
+    if(!indexNextFrame(m_format == DCD ? m_dcdHeaderSize : 0, first)) {
+        m_error = QString("Could not read the first frame of %1").arg(fileName);
+        close();
+        return false;
+    }
+    m_index.append(first);
+    m_indexedFrames = 1;
+    m_path = fileName;
+
+    // Keep as many frames ahead of the playhead as there are workers to decode them, within the
+    // memory budget. Workers decode one frame each, so they use half of the cores and the
+    // other half is left for rendering.
+    const int numberOfWorkers = std::max(1, std::min(4, QThread::idealThreadCount()/2));
+    const qint64 bytesPerFrame = 16*qint64(first.numberOfAtoms) + 1;
+    m_prefetchDepth = int(std::max<qint64>(1, std::min<qint64>(2*numberOfWorkers, prefetchMemory / bytesPerFrame)));
+    m_stopping = false;
+    m_indexer.reset(new FunctionThread([this]() { index(); }));
+    m_indexer->start();
+    for(int worker=0; worker<numberOfWorkers; worker++) {
+        m_workers.emplace_back(new FunctionThread([this]() { decodeAhead(); }));
+        m_workers.back()->start();
+    }
+    return true;
+}
+
+void TrajectoryReader::close()
+{
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        m_stopping = true;
+    }
+    m_workAvailable.wakeAll();
+    for(std::unique_ptr<QThread> &worker : m_workers) worker->wait();
+    m_workers.clear();
+    if(m_indexer) m_indexer->wait();
+    m_indexer.reset();
+
+    if(m_file && m_data) m_file->unmap(const_cast<uchar*>(m_data));
+    m_file.reset();
+    m_data = nullptr;
+    m_size = 0;
+    m_format = Unknown;
+    m_index.clear();
+    m_indexedFrames = 0;
+    m_indexingFinished = false;
+    m_elementTypes.clear();
+    m_elements.clear();
+    m_cache.clear();
+    m_prefetch.clear();
+    m_decoding.clear();
+    m_readFrame = -1;
+    m_path.clear();
+}
+
+bool TrajectoryReader::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+QString TrajectoryReader::error() const
+{
+    return m_error;
+}
+
+int TrajectoryReader::indexedFrames() const
+{
+    return m_indexedFrames;
+}
+
+bool TrajectoryReader::indexingFinished() const
+{
+    return m_indexingFinished;
+}
+
+bool TrajectoryReader::readDCDHeader()
+{
+    // Fortran records: the CORD record with 20 control ints, the titles and the number of atoms
+    const uchar *p = m_data;
+    const uchar *end = m_data + m_size;
+    if(end - p < 92 || readInt32(p) != 84 || readInt32(p + 88) != 84) return false;
+    const uchar *control = p + 8;
+    m_dcdFirstTimestep = readInt32(control + 4);
+    m_dcdTimestepInterval = std::max(1, readInt32(control + 8));
+    m_dcdUnitCell = readInt32(control + 40) != 0;
+    p += 92;
+
+    if(end - p < 4) return false;
+    const qint32 titleSize = readInt32(p);
+    if(titleSize < 0 || end - p < titleSize + 8 + 12) return false;
+    p += titleSize + 8;
+
+    if(readInt32(p) != 4 || readInt32(p + 8) != 4) return false;
+    m_dcdNumberOfAtoms = readInt32(p + 4);
+    if(m_dcdNumberOfAtoms < 0) return false;
+    p += 12;
+
+    m_dcdHeaderSize = p - m_data;
+    m_dcdFrameSize = (m_dcdUnitCell ? 56 : 0) + 3*(8 + 4*qint64(m_dcdNumberOfAtoms));
+    return true;
+}
+
+bool TrajectoryReader::indexNextFrame(qint64 offset, FrameIndex &frame)
+{
+    // Finds the frame starting at offset. The last frame may still be written by a running
+    // simulation, it is only indexed once it is complete.
+    const char *text = reinterpret_cast<const char*>(m_data);
+    const char *end = text + m_size;
+    frame.offset = offset;
+    if(offset >= m_size) return false;
+
+    switch(m_format) {
+    case TextDump: {
+        TextHeader header;
+        if(!parseTextHeader(text + offset, end, header)) return false;
+        const char *p = header.atoms;
+        for(qint64 line=0; line<header.numberOfAtoms; line++) {
+            if(p >= end) return false;
+            p = nextLine(p, end);
+        }
+        frame.size = p - (text + offset);
+        frame.timestep = header.timestep;
+        frame.numberOfAtoms = header.numberOfAtoms;
+        return true;
+    }
+    case BinaryDump: {
+        BinaryHeader header;
+        const uchar *begin = m_data + offset;
+        if(!parseBinaryHeader(begin, m_data + m_size, header)) return false;
+        const uchar *p = begin + header.size;
+        qint64 values = 0;
+        for(int chunk=0; chunk<header.numberOfChunks; chunk++) {
+            qint32 count;
+            if(!readValue(p, m_data + m_size, count) || count < 0) return false;
+            if((m_data + m_size) - p < 8*qint64(count)) return false;
+            p += 8*qint64(count);
+            values += count;
+        }
+        if(values != header.numberOfAtoms*header.valuesPerAtom) return false;
+        frame.size = p - begin;
+        frame.timestep = header.timestep;
+        frame.numberOfAtoms = header.numberOfAtoms;
+        return true;
+    }
+    case XYZ: {
+        // Number of atoms, a comment and one line per atom. LAMMPS puts the timestep in the comment.
+        const char *p = text + offset;
+        const char *numberEnd = lineEnd(p, end);
+        const qint64 numberOfAtoms = qint64(parseNumber(p, numberEnd));
+        if(skipSpaces(p, numberEnd) != numberEnd || numberOfAtoms < 0 || numberOfAtoms >= (1LL << 31)) return false;
+        p = nextLine(p, end);
+        const QByteArray comment(p, lineEnd(p, end) - p);
+        const int timestepIndex = comment.indexOf("Timestep:");
+        frame.timestep = m_indexedFrames;
+        if(timestepIndex >= 0) {
+            const char *number = comment.constData() + timestepIndex + 9;
+            frame.timestep = qint64(parseNumber(number, comment.constData() + comment.size()));
+        }
+        p = nextLine(p, end);
+        for(qint64 line=0; line<numberOfAtoms; line++) {
+            if(p >= end) return false;
+            p = nextLine(p, end);
+        }
+        frame.size = p - (text + offset);
+        frame.numberOfAtoms = numberOfAtoms;
+        return true;
+    }
+    case DCD: {
+        // Fixed size frames, nothing to scan
+        if(offset + m_dcdFrameSize > m_size) return false;
+        const qint64 frameNumber = (offset - m_dcdHeaderSize) / m_dcdFrameSize;
+        frame.size = m_dcdFrameSize;
+        frame.timestep = m_dcdFirstTimestep + frameNumber*m_dcdTimestepInterval;
+        frame.numberOfAtoms = m_dcdNumberOfAtoms;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void TrajectoryReader::index()
+{
+    qint64 offset;
+    {
+        QMutexLocker locker(&m_indexMutex);
+        offset = m_index.last().offset + m_index.last().size;
+    }
+    FrameIndex frame;
+    while(!m_stopping && indexNextFrame(offset, frame)) {
+        {
+            QMutexLocker locker(&m_indexMutex);
+            m_index.append(frame);
+        }
+        m_indexedFrames++; // After the append, so nobody sees a frame before it is in the index
+        offset = frame.offset + frame.size;
+    }
+    m_indexingFinished = true;
+}
+
+std::shared_ptr<TrajectoryFrame> TrajectoryReader::decode(int frame, bool parallel)
+{
+    FrameIndex index;
+    {
+        QMutexLocker locker(&m_indexMutex);
+        if(frame < 0 || frame >= m_index.size()) return nullptr;
+        index = m_index[frame];
+    }
+
+    std::shared_ptr<TrajectoryFrame> decoded = std::make_shared<TrajectoryFrame>();
+    decoded->timestep = index.timestep;
+    bool success = false;
+    switch(m_format) {
+    case TextDump: success = decodeTextDump(index, *decoded, parallel); break;
+    case BinaryDump: success = decodeBinaryDump(index, *decoded, parallel); break;
+    case XYZ: success = decodeXYZ(index, *decoded, parallel); break;
+    case DCD: success = decodeDCD(index, *decoded, parallel); break;
+    default: break;
+    }
+    if(!success) return nullptr;
+    countAtomTypes(*decoded, parallel);
+    return decoded;
+}
+
+bool TrajectoryReader::decodeTextDump(const FrameIndex &index, TrajectoryFrame &frame, bool parallel)
+{
+    const char *begin = reinterpret_cast<const char*>(m_data) + index.offset;
+    const char *end = begin + index.size;
+    TextHeader header;
+    if(!parseTextHeader(begin, end, header)) return false;
+    const Columns columns = findColumns(header.columns);
+    if(columns.position[0] < 0 || columns.position[1] < 0 || columns.position[2] < 0) return false;
+
+    setBox(frame, header.bounds, header.triclinic);
+    memcpy(frame.boundary, header.boundary, sizeof(frame.boundary));
+    const int numberOfAtoms = header.numberOfAtoms;
+    resizeFrame(frame, numberOfAtoms);
+    QVector<qint64> ids(columns.id >= 0 ? numberOfAtoms : 0);
+    QVector<quint32> elements(columns.type < 0 && columns.element >= 0 ? numberOfAtoms : 0);
+    float *x = frame.x.data();
+    float *y = frame.y.data();
+    float *z = frame.z.data();
+    int *types = frame.types.data();
+    std::fill(types, types + numberOfAtoms, 1);
+
+    bool success = parseLines(header.atoms, end, numberOfAtoms, parallel, [&](int line, const char *p, const char *lineEnd) {
+        for(int column=0; column<columns.count; column++) {
+            p = skipSpaces(p, lineEnd);
+            if(p == lineEnd) return false;
+            const char *token = p;
+            if(column == columns.position[0]) x[line] = parseNumber(p, lineEnd);
+            else if(column == columns.position[1]) y[line] = parseNumber(p, lineEnd);
+            else if(column == columns.position[2]) z[line] = parseNumber(p, lineEnd);
+            else if(column == columns.type) types[line] = int(parseNumber(p, lineEnd));
+            else if(column == columns.id) ids[line] = qint64(parseNumber(p, lineEnd));
+            p = skipToken(p, lineEnd);
+            if(column == columns.element && !elements.isEmpty()) elements[line] = packElement(token, p);
+        }
+        return true;
+    });
+    if(!success) return false;
+
+    if(columns.scaled) unscale(frame, parallel);
+    if(!elements.isEmpty()) assignElementTypes(elements, frame);
+    if(!ids.isEmpty()) orderById(frame, ids, parallel);
+    return true;
+}
+
+bool TrajectoryReader::decodeBinaryDump(const FrameIndex &index, TrajectoryFrame &frame, bool parallel)
+{
+    // Binary dumps do not name their columns. They are taken to be those of dump custom with
+    // id type x y z, or dump atom with id type xs ys zs, told apart by whether all positions are
+    // inside the unit cube.
+    const uchar *begin = m_data + index.offset;
+    const uchar *end = begin + index.size;
+    BinaryHeader header;
+    if(!parseBinaryHeader(begin, end, header) || header.valuesPerAtom < 5) return false;
+
+    const double bounds[3][3] = {{header.box[0], header.box[1], header.box[6]},
+                                 {header.box[2], header.box[3], header.box[7]},
+                                 {header.box[4], header.box[5], header.box[8]}};
+    setBox(frame, bounds, header.triclinic);
+    memcpy(frame.boundary, header.boundary, sizeof(frame.boundary));
+    const int numberOfAtoms = header.numberOfAtoms;
+    const int valuesPerAtom = header.valuesPerAtom;
+    resizeFrame(frame, numberOfAtoms);
+    QVector<qint64> ids(numberOfAtoms);
+    float *x = frame.x.data();
+    float *y = frame.y.data();
+    float *z = frame.z.data();
+    int *types = frame.types.data();
+
+    const uchar *p = begin + header.size;
+    int firstAtom = 0;
+    for(int chunk=0; chunk<header.numberOfChunks; chunk++) {
+        qint32 count = 0;
+        readValue(p, end, count);
+        const int chunkAtoms = std::min(count / valuesPerAtom, numberOfAtoms - firstAtom);
+        const uchar *values = p;
+        #pragma omp parallel for if(parallel)
+        for(int k=0; k<chunkAtoms; k++) {
+            double atom[5];
+            memcpy(atom, values + 8*qint64(k)*valuesPerAtom, sizeof(atom)); // Not aligned in the file
+            const int i = firstAtom + k;
+            ids[i] = qint64(atom[0]);
+            types[i] = int(atom[1]);
+            x[i] = atom[2];
+            y[i] = atom[3];
+            z[i] = atom[4];
+        }
+        firstAtom += chunkAtoms;
+        p += 8*qint64(count);
+    }
+
+    double low[3], high[3];
+    boundingBox(frame, parallel, low, high);
+    bool scaled = true;
+    for(int d=0; d<3; d++) {
+        scaled &= low[d] >= -0.1 && high[d] <= 1.1 && frame.h[d] > 2.2;
+    }
+    if(scaled) unscale(frame, parallel);
+    orderById(frame, ids, parallel);
+    return true;
+}
+
+bool TrajectoryReader::decodeXYZ(const FrameIndex &index, TrajectoryFrame &frame, bool parallel)
+{
+    const char *begin = reinterpret_cast<const char*>(m_data) + index.offset;
+    const char *end = begin + index.size;
+    const char *atoms = nextLine(nextLine(begin, end), end);
+    const int numberOfAtoms = index.numberOfAtoms;
+    resizeFrame(frame, numberOfAtoms);
+    QVector<quint32> elements(numberOfAtoms);
+    float *x = frame.x.data();
+    float *y = frame.y.data();
+    float *z = frame.z.data();
+    int *types = frame.types.data();
+
+    // Element or type number followed by the position
+    bool success = parseLines(atoms, end, numberOfAtoms, parallel, [&](int line, const char *p, const char *lineEnd) {
+        p = skipSpaces(p, lineEnd);
+        const char *token = p;
+        p = skipToken(p, lineEnd);
+        if(p == token) return false;
+        if(std::all_of(token, p, isDigit)) {
+            const char *number = token;
+            types[line] = int(parseNumber(number, p));
+            elements[line] = 0;
+        } else {
+            elements[line] = packElement(token, p);
+        }
+        x[line] = parseNumber(p, lineEnd);
+        y[line] = parseNumber(p, lineEnd);
+        z[line] = parseNumber(p, lineEnd);
+        return true;
+    });
+    if(!success) return false;
+
+    assignElementTypes(elements, frame);
+    setBoundingBox(frame, parallel);
+    return true;
+}
+
+bool TrajectoryReader::decodeDCD(const FrameIndex &index, TrajectoryFrame &frame, bool parallel)
+{
+    const uchar *p = m_data + index.offset;
+    const int numberOfAtoms = index.numberOfAtoms;
+    resizeFrame(frame, numberOfAtoms);
+    frame.types.fill(1);
+
+    double cell[6] = {0, 0, 0, 0, 0, 0}; // a, cos(gamma), b, cos(beta), cos(alpha), c
+    if(m_dcdUnitCell) {
+        memcpy(cell, p + 4, sizeof(cell));
+        p += 56;
+    }
+    // One Fortran record of floats per coordinate
+    const qint64 recordSize = 8 + 4*qint64(numberOfAtoms);
+    memcpy(frame.x.data(), p + 4, 4*size_t(numberOfAtoms));
+    memcpy(frame.y.data(), p + recordSize + 4, 4*size_t(numberOfAtoms));
+    memcpy(frame.z.data(), p + 2*recordSize + 4, 4*size_t(numberOfAtoms));
+
+    if(!m_dcdUnitCell || cell[0] <= 0) {
+        setBoundingBox(frame, parallel);
+        return true;
+    }
+
+    // LAMMPS writes the cosines of the angles, other programs the angles in degrees
+    auto cosine = [](double value) { return std::abs(value) <= 1 ? value : std::cos(value*M_PI/180); };
+    const double a = cell[0], b = cell[2], c = cell[5];
+    const double xy = b*cosine(cell[1]);
+    const double xz = c*cosine(cell[3]);
+    const double ly = std::sqrt(std::max(0.0, b*b - xy*xy));
+    const double yz = ly > 0 ? (b*c*cosine(cell[4]) - xy*xz) / ly : 0;
+    const double lz = std::sqrt(std::max(0.0, c*c - xz*xz - yz*yz));
+
+    // The origin is not stored, so the cell is centered on the atoms
+    double low[3], high[3];
+    boundingBox(frame, parallel, low, high);
+    const double diagonal[3] = {a + xy + xz, ly + yz, lz};
+    for(int d=0; d<3; d++) frame.boxlo[d] = 0.5*(low[d] + high[d] - diagonal[d]);
+    frame.h[0] = a;
+    frame.h[1] = ly;
+    frame.h[2] = lz;
+    frame.h[3] = yz;
+    frame.h[4] = xz;
+    frame.h[5] = xy;
+    frame.triclinic = xy != 0 || xz != 0 || yz != 0;
+    return true;
+}
+
+void TrajectoryReader::assignElementTypes(const QVector<quint32> &elements, TrajectoryFrame &frame)
+{
+    // Types in order of first appearance in the file. Files list few elements, usually in runs,
+    // so remembering the last one avoids most lookups.
+    QMutexLocker locker(&m_elementMutex);
+    if(m_elements.isEmpty()) m_elements.append(QByteArray()); // Types start at 1
+    quint32 previousElement = 0;
+    int previousType = 0;
+    for(int i=0; i<elements.size(); i++) {
+        const quint32 element = elements[i];
+        if(!element) continue; // A type number
+        if(element != previousElement) {
+            auto type = m_elementTypes.find(element);
+            if(type == m_elementTypes.end()) {
+                QByteArray name;
+                for(quint32 bits = element; bits; bits >>= 8) name.append(char(bits & 0xff));
+                type = m_elementTypes.insert(element, m_elements.size());
+                m_elements.append(name);
+            }
+            previousElement = element;
+            previousType = type.value();
+        }
+        frame.types[i] = previousType;
+    }
+    frame.typeNames = m_elements;
+}
+
+std::shared_ptr<const TrajectoryFrame> TrajectoryReader::read(int frame)
+{
+    if(frame < 0 || frame >= indexedFrames()) return nullptr;
+    const int previousFrame = m_readFrame.exchange(frame);
+
+    // Decode ahead with the step and direction of playback, e.g. every 10th frame backwards
+    int step = frame - previousFrame;
+    if(previousFrame < 0 || step == 0 || std::abs(step) > maximumPrefetchStep) step = 1;
+    QMutexLocker locker(&m_cacheMutex);
+    schedulePrefetch(frame, step);
+
+    while(m_decoding.contains(frame)) m_frameDecoded.wait(&m_cacheMutex);
+    std::shared_ptr<const TrajectoryFrame> decoded = m_cache.value(frame);
+    if(!decoded) {
+        // Not decoded ahead, e.g. after a jump on the timeline. Use all cores for this one.
+        m_decoding.insert(frame);
+        locker.unlock();
+        decoded = decode(frame, true);
+        locker.relock();
+        m_decoding.remove(frame);
+        m_cache.insert(frame, decoded);
+        m_frameDecoded.wakeAll();
+    }
+    return decoded;
+}
+
+void TrajectoryReader::schedulePrefetch(int frame, int step)
+{
+    // Called with m_cacheMutex locked. Frames that are not shown next are dropped from the cache.
+    m_prefetch.clear();
+    const int numberOfFrames = indexedFrames();
+    for(int k=1; k<=m_prefetchDepth; k++) {
+        const qint64 next = frame + qint64(k)*step;
+        if(next < 0 || next >= numberOfFrames) break;
+        m_prefetch.append(int(next));
+    }
+    for(auto cached = m_cache.begin(); cached != m_cache.end();) {
+        if(cached.key() == frame || m_prefetch.contains(cached.key())) ++cached;
+        else cached = m_cache.erase(cached);
+    }
+    m_workAvailable.wakeAll();
+}
+
+void TrajectoryReader::decodeAhead()
+{
+    // Worker thread, each frame is decoded on one core
+    QMutexLocker locker(&m_cacheMutex);
+    while(!m_stopping) {
+        int frame = -1;
+        for(int candidate : m_prefetch) {
+            if(!m_cache.contains(candidate) && !m_decoding.contains(candidate)) {
+                frame = candidate;
+                break;
+            }
+        }
+        if(frame < 0) {
+            m_workAvailable.wait(&m_cacheMutex);
+            continue;
+        }
+
+        m_decoding.insert(frame);
+        locker.unlock();
+        std::shared_ptr<const TrajectoryFrame> decoded = decode(frame, false);
+        locker.relock();
+        m_decoding.remove(frame);
+        // The playhead may have jumped elsewhere in the meantime. Failed frames are cached too
+        // (as nullptr) so they are not retried over and over.
+        if(m_prefetch.contains(frame) || frame == m_readFrame) m_cache.insert(frame, decoded);
+        m_frameDecoded.wakeAll();
+    }
+}
+
+void TrajectoryReader::synchronizeQML()
+{
+    if(m_fileName != m_path) {
+        m_fileName = m_path;
+        emit fileNameChanged(m_fileName);
+    }
+    if(m_numberOfFrames != m_indexedFrames) {
+        m_numberOfFrames = m_indexedFrames;
+        emit numberOfFramesChanged(m_numberOfFrames);
+    }
+    const bool indexing = isOpen() && !m_indexingFinished;
+    if(m_indexing != indexing) {
+        m_indexing = indexing;
+        emit indexingChanged(m_indexing);
+    }
+    if(m_currentFrame != m_readFrame) {
+        m_currentFrame = m_readFrame;
+        emit currentFrameChanged(m_currentFrame);
+    }
+}
+
+qint64 TrajectoryReader::timestep(int frame) const
+{
+    QMutexLocker locker(&m_indexMutex);
+    if(frame < 0 || frame >= m_index.size()) return -1;
+    return m_index[frame].timestep;
+}
+
+long TrajectoryReader::memoryUsage() const
+{
+    long memoryUsage;
+    {
+        QMutexLocker locker(&m_indexMutex);
+        memoryUsage = m_index.capacity()*sizeof(FrameIndex);
+    }
+    QMutexLocker locker(&m_cacheMutex);
+    for(const std::shared_ptr<const TrajectoryFrame> &frame : m_cache) {
+        if(frame) memoryUsage += frame->memoryUsage();
+    }
+    return memoryUsage;
+}
+
+QString TrajectoryReader::fileName() const
+{
+    return m_fileName;
+}
+
+int TrajectoryReader::numberOfFrames() const
+{
+    return m_numberOfFrames;
+}
+
+bool TrajectoryReader::indexing() const
+{
+    return m_indexing;
+}
+
+int TrajectoryReader::currentFrame() const
+{
+    return m_currentFrame;
+}
+
+int TrajectoryReader::playbackFrame() const
+{
+    return m_playbackFrame;
+}
+
+void TrajectoryReader::setPlaybackFrame(int playbackFrame)
+{
+    if (m_playbackFrame == playbackFrame)
+        return;
+
+    m_playbackFrame = playbackFrame;
+    emit playbackFrameChanged(m_playbackFrame);
+}
+
+void TrajectoryReader::benchmark(int numberOfAtoms)
+{
+    // A text dump like dump custom id type x y z writes, with the atoms shuffled as from many processors
+    const int numberOfFrames = 16;
+    const float length = std::cbrt(float(std::max(1, numberOfAtoms)));
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(0.0, length);
+    QVector<float> x(numberOfAtoms), y(numberOfAtoms), z(numberOfAtoms);
+    for(int i=0; i<numberOfAtoms; i++) {
+        x[i] = distribution(generator);
+        y[i] = distribution(generator);
+        z[i] = distribution(generator);
+    }
+    QVector<int> order(numberOfAtoms);
+    for(int i=0; i<numberOfAtoms; i++) order[i] = i;
+
+    QTemporaryFile file(QDir::temp().absoluteFilePath("atomify-dump-XXXXXX"));
+    if(!file.open()) {
+        qWarning() << "TrajectoryReader: Could not create benchmark dump";
+        return;
+    }
+    std::vector<char> line(256);
+    for(int frame=0; frame<numberOfFrames; frame++) {
+        QByteArray bytes;
+        bytes.reserve(40*qint64(numberOfAtoms) + 256);
+        bytes.append(QString("ITEM: TIMESTEP\n%1\nITEM: NUMBER OF ATOMS\n%2\nITEM: BOX BOUNDS pp pp pp\n").arg(100*frame).arg(numberOfAtoms).toUtf8());
+        for(int d=0; d<3; d++) bytes.append(QString("0 %1\n").arg(length).toUtf8());
+        bytes.append("ITEM: ATOMS id type x y z\n");
+        std::shuffle(order.begin(), order.end(), generator);
+        for(int i : order) {
+            const int size = snprintf(line.data(), line.size(), "%d %d %g %g %g\n", i+1, 1 + i%3, x[i] + 0.01f*frame, y[i], z[i]);
+            bytes.append(line.data(), size);
+        }
+        file.write(bytes);
+    }
+    file.flush();
+    const double megabytes = file.size() / (1024.0*1024.0);
+
+    TrajectoryReader reader;
+    QElapsedTimer timer;
+    timer.start();
+    if(!reader.open(file.fileName())) {
+        qWarning() << "TrajectoryReader:" << reader.error();
+        return;
+    }
+    while(!reader.indexingFinished()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    const qint64 indexTime = timer.nsecsElapsed();
+
+    // Playback, the workers decode ahead of the frame shown
+    float maximumError = 0;
+    timer.start();
+    for(int frame=0; frame<reader.indexedFrames(); frame++) {
+        std::shared_ptr<const TrajectoryFrame> decoded = reader.read(frame);
+        if(!decoded) continue;
+        for(int i=0; i<numberOfAtoms; i++) {
+            maximumError = std::max(maximumError, std::abs(decoded->x[i] - x[i] - 0.01f*frame) / length);
+        }
+    }
+    const qint64 playbackTime = timer.nsecsElapsed();
+
+    // Jumps around on the timeline, nothing is decoded ahead
+    timer.start();
+    const int numberOfJumps = 8;
+    for(int jump=0; jump<numberOfJumps; jump++) {
+        reader.read((jump*7) % reader.indexedFrames());
+    }
+    const qint64 jumpTime = timer.nsecsElapsed();
+
+    const double seconds = 1e-9;
+    qDebug() << "Trajectory reader with a" << megabytes << "MB text dump of" << numberOfAtoms << "atoms and" << numberOfFrames << "frames";
+    qDebug() << "  indexing (MB/s):         " << megabytes / (indexTime*seconds);
+    qDebug() << "  playback (frames/s):     " << reader.indexedFrames() / (playbackTime*seconds);
+    qDebug() << "  jumps (frames/s):        " << numberOfJumps / (jumpTime*seconds);
+    qDebug() << "  largest relative error:  " << maximumError;
+    if(reader.indexedFrames() != numberOfFrames) qWarning() << "TrajectoryReader: Indexed" << reader.indexedFrames() << "of" << numberOfFrames << "frames";
+}
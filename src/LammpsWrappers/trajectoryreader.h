@@ -0,0 +1,151 @@
+#ifndef TRAJECTORYREADER_H
+#define TRAJECTORYREADER_H
+#include <QObject>
+#include <QVector>
+#include <QByteArray>
+#include <QMap>
+#include <QSet>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class QFile;
+class QThread;
+
+// One decoded frame of a trajectory file. The box follows the conventions of LAMMPS' Domain.
+struct TrajectoryFrame
+{
+    qint64 timestep = 0;
+    double boxlo[3] = {0, 0, 0};
+    double h[6] = {0, 0, 0, 0, 0, 0}; // xprd, yprd, zprd, yz, xz, xy
+    int boundary[3][2] = {{0, 0}, {0, 0}, {0, 0}}; // 0 periodic, 1 fixed, 2 shrink wrapped, 3 minimum
+    bool triclinic = false;
+    QVector<float> x;
+    QVector<float> y;
+    QVector<float> z;
+    QVector<int> types;
+    QVector<QByteArray> typeNames; // Element of each type in XYZ files, indexed by type
+    int numberOfAtomTypes = 0;
+    int size() const { return x.size(); }
+    long memoryUsage() const;
+};
+
+// Plays back trajectories that were written earlier instead of running a simulation: LAMMPS text
+// and binary dumps (dump atom and dump custom), XYZ and DCD files. The file is memory mapped and a
+// background thread indexes the frame offsets, so playback starts right away and the file is only
+// read as far as it is shown. A pool of worker threads decodes the frames ahead of the playhead
+// into a small cache. A frame that is not cached, e.g. after a jump on the timeline, is decoded on
+// the calling thread using all cores.
+// open and read are called on the LAMMPS thread, synchronizeQML while it waits for QML.
+class TrajectoryReader : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString fileName READ fileName NOTIFY fileNameChanged)
+    Q_PROPERTY(int numberOfFrames READ numberOfFrames NOTIFY numberOfFramesChanged)
+    Q_PROPERTY(bool indexing READ indexing NOTIFY indexingChanged)
+    Q_PROPERTY(int currentFrame READ currentFrame NOTIFY currentFrameChanged)
+    Q_PROPERTY(int playbackFrame READ playbackFrame WRITE setPlaybackFrame NOTIFY playbackFrameChanged)
+public:
+    enum Format { Unknown, TextDump, BinaryDump, XYZ, DCD };
+    explicit TrajectoryReader(QObject *parent = nullptr);
+    ~TrajectoryReader();
+    static bool isTrajectoryFile(const QString &fileName);
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const;
+    QString error() const;
+    // Frames indexed so far, grows while the indexer runs
+    int indexedFrames() const;
+    bool indexingFinished() const;
+    // Returns nullptr if the frame could not be decoded
+    std::shared_ptr<const TrajectoryFrame> read(int frame);
+    void synchronizeQML();
+    Q_INVOKABLE qint64 timestep(int frame) const;
+    long memoryUsage() const;
+    QString fileName() const;
+    int numberOfFrames() const;
+    bool indexing() const;
+    int currentFrame() const;
+    int playbackFrame() const;
+    // Prints indexing and decoding speed of a text dump, for atomify --benchmark
+    static void benchmark(int numberOfAtoms);
+
+public slots:
+    void setPlaybackFrame(int playbackFrame);
+
+signals:
+    void fileNameChanged(QString fileName);
+    void numberOfFramesChanged(int numberOfFrames);
+    void indexingChanged(bool indexing);
+    void currentFrameChanged(int currentFrame);
+    void playbackFrameChanged(int playbackFrame);
+
+private:
+    struct FrameIndex {
+        qint64 offset = 0;
+        qint64 size = 0;
+        qint64 timestep = 0;
+        int numberOfAtoms = 0;
+    };
+
+    static Format detectFormat(const uchar *data, qint64 size, const QString &fileName);
+    void index();
+    bool indexNextFrame(qint64 offset, FrameIndex &frame);
+    std::shared_ptr<TrajectoryFrame> decode(int frame, bool parallel);
+    bool decodeTextDump(const FrameIndex &index, TrajectoryFrame &frame, bool parallel);
+    bool decodeBinaryDump(const FrameIndex &index, TrajectoryFrame &frame, bool parallel);
+    bool decodeXYZ(const FrameIndex &index, TrajectoryFrame &frame, bool parallel);
+    bool decodeDCD(const FrameIndex &index, TrajectoryFrame &frame, bool parallel);
+    bool readDCDHeader();
+    void assignElementTypes(const QVector<quint32> &elements, TrajectoryFrame &frame);
+    void decodeAhead();
+    void schedulePrefetch(int frame, int step);
+
+    std::unique_ptr<QFile> m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    Format m_format = Unknown;
+    QString m_error;
+
+    // Written by the indexer thread
+    std::unique_ptr<QThread> m_indexer;
+    mutable QMutex m_indexMutex;
+    QVector<FrameIndex> m_index;
+    std::atomic<int> m_indexedFrames{0};
+    std::atomic<bool> m_indexingFinished{false};
+    qint64 m_dcdHeaderSize = 0;
+    qint64 m_dcdFrameSize = 0;
+    int m_dcdNumberOfAtoms = 0;
+    int m_dcdFirstTimestep = 0;
+    int m_dcdTimestepInterval = 1;
+    bool m_dcdUnitCell = false;
+
+    // Elements of XYZ files, shared by all decoders so types are the same in every frame
+    QMutex m_elementMutex;
+    QHash<quint32, int> m_elementTypes; // Up to four characters packed into an int
+    QVector<QByteArray> m_elements; // Indexed by type
+
+    // Decoded frames, the worker threads fill in the ones in m_prefetch
+    std::vector<std::unique_ptr<QThread>> m_workers;
+    mutable QMutex m_cacheMutex;
+    QWaitCondition m_workAvailable;
+    QWaitCondition m_frameDecoded;
+    QMap<int, std::shared_ptr<const TrajectoryFrame>> m_cache;
+    QVector<int> m_prefetch; // In the order they will be shown
+    QSet<int> m_decoding;
+    int m_prefetchDepth = 4;
+    std::atomic<bool> m_stopping{false};
+
+    QString m_path; // Of the open file, m_fileName follows it in synchronizeQML
+    QString m_fileName;
+    int m_numberOfFrames = 0;
+    bool m_indexing = false;
+    std::atomic<int> m_readFrame{-1}; // Last frame returned by read
+    int m_currentFrame = -1;
+    int m_playbackFrame = -1; // Frame picked on the timeline while paused, -1 for none
+};
+
+#endif // TRAJECTORYREADER_H
@@ -0,0 +1,589 @@
+#include "trajectoryrecorder.h"
+#include "atomdata.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static const int keyframeInterval = 32;
+static const int atomsPerChunk = 16384; // Chunks are encoded and decoded in parallel
+
+enum FrameFlags {
+    Keyframe = 1,
+    HasTypes = 2,
+    HasBitmask = 4
+};
+
+struct FrameHeader {
+    qint64 timestep;
+    qint32 numberOfAtoms;
+    qint32 flags;
+    float boxLow[3];
+    float boxHigh[3];
+    qint32 numberOfChunks;
+    qint32 typesSize; // Bytes of run length encoded types following the positions
+    qint32 bitmaskSize;
+    qint32 propertiesSize; // Bytes of per atom properties following the bitmask
+};
+
+static inline quint32 zigzag(qint16 value) { return (quint32(value) << 1) ^ quint32(value >> 15); }
+static inline qint16 unzigzag(quint32 value) { return qint16((value >> 1) ^ -qint32(value & 1)); }
+
+static inline void writeVarint(quint32 value, uchar *&out)
+{
+    while(value >= 0x80) {
+        *out++ = uchar(value) | 0x80;
+        value >>= 7;
+    }
+    *out++ = uchar(value);
+}
+
+static inline quint32 readVarint(const uchar *&in)
+{
+    quint32 value = 0;
+    int shift = 0;
+    while(*in & 0x80) {
+        value |= quint32(*in++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= quint32(*in++) << shift;
+    return value;
+}
+
+static void appendRuns(const QVector<int> &values, QByteArray &bytes)
+{
+    // (value, count) pairs
+    for(int i=0; i<values.size();) {
+        int j = i + 1;
+        while(j < values.size() && values[j] == values[i]) j++;
+        const qint32 run[2] = {values[i], j - i};
+        bytes.append(reinterpret_cast<const char*>(run), sizeof(run));
+        i = j;
+    }
+}
+
+static void readRuns(const uchar *in, int size, QVector<int> &values)
+{
+    int index = 0;
+    for(const uchar *end = in + size; in < end; in += 2*sizeof(qint32)) {
+        qint32 run[2];
+        memcpy(run, in, sizeof(run));
+        std::fill(values.begin() + index, values.begin() + std::min(values.size(), index + run[1]), run[0]);
+        index += run[1];
+    }
+}
+
+static void appendProperties(const QHash<QString, QVector<double>> &properties, QByteArray &bytes)
+{
+    // (name size, name, number of values, values as float) per property
+    for(auto property = properties.constBegin(); property != properties.constEnd(); ++property) {
+        const QByteArray name = property.key().toUtf8();
+        const QVector<double> &values = property.value();
+        const qint32 sizes[2] = {qint32(name.size()), qint32(values.size())};
+        bytes.append(reinterpret_cast<const char*>(&sizes[0]), sizeof(qint32));
+        bytes.append(name);
+        bytes.append(reinterpret_cast<const char*>(&sizes[1]), sizeof(qint32));
+        const int offset = bytes.size();
+        bytes.resize(offset + values.size()*sizeof(float));
+        float *out = reinterpret_cast<float*>(bytes.data() + offset);
+        for(int i=0; i<values.size(); i++) out[i] = values[i];
+    }
+}
+
+TrajectoryRecorder::TrajectoryRecorder(QObject *parent) : QObject(parent)
+{
+
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+
+}
+
+bool TrajectoryRecorder::openFile()
+{
+    // Pages of a mapped file are backed by the file, not swap, so a large ring does not
+    // count against the memory of the process
+    m_file.reset(new QTemporaryFile(QDir::temp().absoluteFilePath("atomify-trajectory-XXXXXX")));
+    m_ringSize = qint64(m_capacity)*1024*1024;
+    if(!m_file->open() || !m_file->resize(m_ringSize)) {
+        qWarning() << "TrajectoryRecorder: Could not create ring file of" << m_capacity << "MB";
+        m_file.reset();
+        return false;
+    }
+    m_ring = m_file->map(0, m_ringSize);
+    if(!m_ring) {
+        qWarning() << "TrajectoryRecorder: Could not map ring file";
+        m_file.reset();
+        return false;
+    }
+    return true;
+}
+
+void TrajectoryRecorder::clear()
+{
+    if(m_file && m_ring) m_file->unmap(m_ring);
+    m_ring = nullptr;
+    m_file.reset();
+    m_ringSize = 0;
+    m_writeOffset = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_frames.clear();
+        m_evictedFrames = 0;
+    }
+    m_encodedPositions.clear();
+    m_encodedTypes.clear();
+    m_encodedBitmask.clear();
+    m_framesSinceKeyframe = 0;
+    m_decodedPositions.clear();
+    m_decodedTypes.clear();
+    m_decodedBitmask.clear();
+    m_decodedId = -1;
+}
+
+bool TrajectoryRecorder::needsKeyframe(const AtomData &atomData) const
+{
+    if(m_frames.isEmpty() || m_framesSinceKeyframe >= keyframeInterval) return true;
+    const int numberOfAtoms = atomData.size();
+    if(m_encodedPositions.size() != 3*numberOfAtoms) return true;
+
+    // Atoms that left the quantization box of the keyframe
+    const float *x = atomData.x.constData();
+    const float *y = atomData.y.constData();
+    const float *z = atomData.z.constData();
+    const QVector3D low = m_boxLow;
+    const QVector3D high = m_boxHigh;
+    int outside = 0;
+    #pragma omp parallel for reduction(+:outside)
+    for(int i=0; i<numberOfAtoms; i++) {
+        outside += x[i] < low[0] || x[i] > high[0] || y[i] < low[1] || y[i] > high[1] || z[i] < low[2] || z[i] > high[2];
+    }
+    return outside > 0;
+}
+
+void TrajectoryRecorder::encode(const AtomData &atomData, qint64 timestep, const QByteArray &properties, bool keyframe, QByteArray &bytes)
+{
+    const int numberOfAtoms = atomData.size();
+    const float *x = atomData.x.constData();
+    const float *y = atomData.y.constData();
+    const float *z = atomData.z.constData();
+
+    if(keyframe) {
+        // Bounding box with some room so the next frames fit too
+        float minX = 1e30, minY = 1e30, minZ = 1e30;
+        float maxX = -1e30, maxY = -1e30, maxZ = -1e30;
+        #pragma omp parallel for reduction(min:minX,minY,minZ) reduction(max:maxX,maxY,maxZ)
+        for(int i=0; i<numberOfAtoms; i++) {
+            minX = std::min(minX, x[i]); maxX = std::max(maxX, x[i]);
+            minY = std::min(minY, y[i]); maxY = std::max(maxY, y[i]);
+            minZ = std::min(minZ, z[i]); maxZ = std::max(maxZ, z[i]);
+        }
+        const QVector3D padding = 0.05f*(QVector3D(maxX, maxY, maxZ) - QVector3D(minX, minY, minZ)) + QVector3D(1e-3, 1e-3, 1e-3);
+        m_boxLow = QVector3D(minX, minY, minZ) - padding;
+        m_boxHigh = QVector3D(maxX, maxY, maxZ) + padding;
+        m_encodedPositions.resize(3*numberOfAtoms);
+        m_framesSinceKeyframe = 0;
+    }
+    m_framesSinceKeyframe++;
+
+    const bool typesChanged = keyframe || atomData.types != m_encodedTypes;
+    const bool bitmaskChanged = keyframe || atomData.bitmask != m_encodedBitmask;
+    QByteArray types;
+    QByteArray bitmask;
+    if(typesChanged) {
+        appendRuns(atomData.types, types);
+        m_encodedTypes = atomData.types;
+    }
+    if(bitmaskChanged) {
+        appendRuns(atomData.bitmask, bitmask);
+        m_encodedBitmask = atomData.bitmask;
+    }
+
+    // Positions, chunk by chunk. Keyframes store the quantized values, other frames the
+    // difference to the previous frame which wraps around like the 16 bit values do.
+    const int numberOfChunks = (numberOfAtoms + atomsPerChunk - 1) / atomsPerChunk;
+    std::vector<QByteArray> chunks(numberOfChunks);
+    const QVector3D scale = QVector3D(65535, 65535, 65535) / (m_boxHigh - m_boxLow);
+    const QVector3D low = m_boxLow;
+    quint16 *previous = m_encodedPositions.data();
+    #pragma omp parallel for
+    for(int chunk=0; chunk<numberOfChunks; chunk++) {
+        const int begin = chunk*atomsPerChunk;
+        const int end = std::min(numberOfAtoms, begin + atomsPerChunk);
+        QByteArray &chunkBytes = chunks[chunk];
+        chunkBytes.resize((end - begin)*(keyframe ? 3*sizeof(quint16) : 3*3));
+        uchar *out = reinterpret_cast<uchar*>(chunkBytes.data());
+        for(int i=begin; i<end; i++) {
+            const float position[3] = {x[i], y[i], z[i]};
+            for(int d=0; d<3; d++) {
+                const float scaled = std::round((position[d] - low[d])*scale[d]);
+                const quint16 quantized = quint16(std::max(0.0f, std::min(65535.0f, scaled)));
+                if(keyframe) {
+                    memcpy(out, &quantized, sizeof(quint16));
+                    out += sizeof(quint16);
+                } else {
+                    writeVarint(zigzag(qint16(quint16(quantized - previous[3*i+d]))), out);
+                }
+                previous[3*i+d] = quantized;
+            }
+        }
+        chunkBytes.resize(out - reinterpret_cast<uchar*>(chunkBytes.data()));
+    }
+
+    FrameHeader header;
+    header.timestep = timestep;
+    header.numberOfAtoms = numberOfAtoms;
+    header.flags = (keyframe ? Keyframe : 0) | (typesChanged ? HasTypes : 0) | (bitmaskChanged ? HasBitmask : 0);
+    for(int d=0; d<3; d++) {
+        header.boxLow[d] = m_boxLow[d];
+        header.boxHigh[d] = m_boxHigh[d];
+    }
+    header.numberOfChunks = numberOfChunks;
+    header.typesSize = types.size();
+    header.bitmaskSize = bitmask.size();
+    header.propertiesSize = properties.size();
+
+    bytes.clear();
+    bytes.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    qint32 chunkEnd = 0;
+    for(const QByteArray &chunk : chunks) {
+        chunkEnd += chunk.size();
+        bytes.append(reinterpret_cast<const char*>(&chunkEnd), sizeof(chunkEnd));
+    }
+    for(const QByteArray &chunk : chunks) bytes.append(chunk);
+    bytes.append(types);
+    bytes.append(bitmask);
+    bytes.append(properties);
+}
+
+void TrajectoryRecorder::store(const QByteArray &bytes, const Frame &frame)
+{
+    // Frames are written one after the other and wrap around at the end. After a wrap the
+    // oldest frames can sit behind the write offset while newer ones start at 0, so every
+    // frame up to the newest one that gets overwritten is evicted, oldest first.
+    qint64 offset = m_writeOffset;
+    if(offset + bytes.size() > m_ringSize) offset = 0;
+    auto overlaps = [&](const Frame &other) { return other.offset < offset + bytes.size() && offset < other.offset + other.size; };
+    QMutexLocker locker(&m_mutex);
+    int evicted = 0;
+    for(int i=0; i<m_frames.size(); i++) {
+        if(overlaps(m_frames[i])) evicted = i + 1;
+    }
+    m_frames.remove(0, evicted);
+    m_evictedFrames += evicted;
+    // Frames before the first remaining keyframe can not be decoded anymore
+    while(!m_frames.isEmpty() && !m_frames.first().keyframe) {
+        m_frames.removeFirst();
+        m_evictedFrames++;
+    }
+
+    memcpy(m_ring + offset, bytes.constData(), bytes.size());
+    Frame stored = frame;
+    stored.offset = offset;
+    stored.size = bytes.size();
+    m_frames.append(stored);
+    m_writeOffset = offset + bytes.size();
+}
+
+void TrajectoryRecorder::record(const AtomData &atomData, qint64 timestep, const QHash<QString, QVector<double>> &properties)
+{
+    if(!m_ring && !openFile()) {
+        m_recording = false;
+        return;
+    }
+
+    bool keyframe = needsKeyframe(atomData);
+    QByteArray propertyBytes;
+    appendProperties(properties, propertyBytes);
+    QByteArray bytes;
+    encode(atomData, timestep, propertyBytes, keyframe, bytes);
+    // Delta frames larger than a keyframe mean the atoms were reordered or moved far
+    if(!keyframe && bytes.size() - propertyBytes.size() > qint64(sizeof(FrameHeader)) + 6*qint64(atomData.size())) {
+        keyframe = true;
+        encode(atomData, timestep, propertyBytes, keyframe, bytes);
+    }
+    if(bytes.size() > m_ringSize) {
+        qWarning() << "TrajectoryRecorder: Frame of" << bytes.size() << "bytes does not fit in the ring file";
+        m_framesSinceKeyframe = keyframeInterval; // The next frame can not be a delta on this one
+        return;
+    }
+
+    Frame frame;
+    frame.timestep = timestep;
+    frame.keyframe = keyframe;
+    frame.numberOfAtoms = atomData.size();
+    store(bytes, frame);
+    if(!m_frames.first().keyframe) {
+        // A single group of frames filled the whole ring, start over with a keyframe
+        // Frame ids keep counting, so a previously decoded frame is never mistaken for a new one
+        QMutexLocker locker(&m_mutex);
+        m_evictedFrames += m_frames.size();
+        m_frames.clear();
+        m_decodedId = -1;
+        m_framesSinceKeyframe = keyframeInterval;
+    }
+}
+
+void TrajectoryRecorder::decodeFrame(const Frame &frame)
+{
+    const uchar *data = m_ring + frame.offset;
+    FrameHeader header;
+    memcpy(&header, data, sizeof(header));
+    const int numberOfAtoms = header.numberOfAtoms;
+    const bool keyframe = header.flags & Keyframe;
+    const uchar *chunkEnds = data + sizeof(header);
+    const uchar *positions = chunkEnds + header.numberOfChunks*sizeof(qint32);
+    m_decodedPositions.resize(3*numberOfAtoms);
+    quint16 *decoded = m_decodedPositions.data();
+
+    #pragma omp parallel for
+    for(int chunk=0; chunk<header.numberOfChunks; chunk++) {
+        qint32 chunkBegin = 0;
+        if(chunk > 0) memcpy(&chunkBegin, chunkEnds + (chunk-1)*sizeof(qint32), sizeof(qint32));
+        const uchar *in = positions + chunkBegin;
+        const int begin = chunk*atomsPerChunk;
+        const int end = std::min(numberOfAtoms, begin + atomsPerChunk);
+        if(keyframe) {
+            memcpy(decoded + 3*begin, in, 3*(end - begin)*sizeof(quint16));
+        } else {
+            for(int k=3*begin; k<3*end; k++) decoded[k] += quint16(unzigzag(readVarint(in)));
+        }
+    }
+
+    qint32 positionsSize = 0;
+    if(header.numberOfChunks > 0) memcpy(&positionsSize, chunkEnds + (header.numberOfChunks-1)*sizeof(qint32), sizeof(qint32));
+    const uchar *channels = positions + positionsSize;
+    if(header.flags & HasTypes) {
+        m_decodedTypes.resize(numberOfAtoms);
+        readRuns(channels, header.typesSize, m_decodedTypes);
+        channels += header.typesSize;
+    }
+    if(header.flags & HasBitmask) {
+        m_decodedBitmask.resize(numberOfAtoms);
+        readRuns(channels, header.bitmaskSize, m_decodedBitmask);
+    }
+    m_decodedLow = QVector3D(header.boxLow[0], header.boxLow[1], header.boxLow[2]);
+    m_decodedHigh = QVector3D(header.boxHigh[0], header.boxHigh[1], header.boxHigh[2]);
+}
+
+void TrajectoryRecorder::decodeProperties(const Frame &frame, QHash<QString, QVector<double>> &properties) const
+{
+    // Stored as is in every frame, so only the frame that is shown is read
+    const uchar *data = m_ring + frame.offset;
+    FrameHeader header;
+    memcpy(&header, data, sizeof(header));
+    const uchar *chunkEnds = data + sizeof(header);
+    qint32 positionsSize = 0;
+    if(header.numberOfChunks > 0) memcpy(&positionsSize, chunkEnds + (header.numberOfChunks-1)*sizeof(qint32), sizeof(qint32));
+    const uchar *in = chunkEnds + header.numberOfChunks*sizeof(qint32) + positionsSize + header.typesSize + header.bitmaskSize;
+
+    properties.clear();
+    for(const uchar *end = in + header.propertiesSize; in < end;) {
+        qint32 nameSize, numberOfValues;
+        memcpy(&nameSize, in, sizeof(qint32));
+        in += sizeof(qint32);
+        const QString name = QString::fromUtf8(reinterpret_cast<const char*>(in), nameSize);
+        in += nameSize;
+        memcpy(&numberOfValues, in, sizeof(qint32));
+        in += sizeof(qint32);
+        QVector<double> &values = properties[name];
+        values.resize(numberOfValues);
+        for(int i=0; i<numberOfValues; i++) {
+            float value;
+            memcpy(&value, in + i*sizeof(float), sizeof(float));
+            values[i] = value;
+        }
+        in += numberOfValues*sizeof(float);
+    }
+}
+
+bool TrajectoryRecorder::decode(int frame, AtomData &atomData)
+{
+    if(frame < 0 || frame >= m_frames.size() || atomData.size() != m_frames[frame].numberOfAtoms) return false;
+
+    // Frames since the last keyframe are applied in order, continuing from the previously
+    // decoded frame when it is on the way
+    int first = frame;
+    while(!m_frames[first].keyframe) first--;
+    const qint64 id = m_evictedFrames + frame;
+    if(m_decodedId >= m_evictedFrames + first && m_decodedId <= id) {
+        first = m_decodedId - m_evictedFrames + 1;
+    }
+    for(int j=first; j<=frame; j++) {
+        decodeFrame(m_frames[j]);
+    }
+    m_decodedId = id;
+
+    // Back to positions with the quantization box of the frame
+    const int numberOfAtoms = atomData.size();
+    const quint16 *decoded = m_decodedPositions.constData();
+    const QVector3D low = m_decodedLow;
+    const QVector3D step = (m_decodedHigh - m_decodedLow) / 65535.0f;
+    float *x = AtomData::overwrite(atomData.x);
+    float *y = AtomData::overwrite(atomData.y);
+    float *z = AtomData::overwrite(atomData.z);
+    #pragma omp parallel for
+    for(int i=0; i<numberOfAtoms; i++) {
+        x[i] = low[0] + decoded[3*i+0]*step[0];
+        y[i] = low[1] + decoded[3*i+1]*step[1];
+        z[i] = low[2] + decoded[3*i+2]*step[2];
+    }
+    atomData.types = m_decodedTypes;
+    atomData.bitmask = m_decodedBitmask;
+    decodeProperties(m_frames[frame], atomData.properties);
+    atomData.replayed = true;
+    atomData.touch(AtomData::Positions | AtomData::Types | AtomData::Bitmask);
+    return true;
+}
+
+void TrajectoryRecorder::synchronizeQML()
+{
+    if(m_numberOfFrames != m_frames.size()) {
+        m_numberOfFrames = m_frames.size();
+        emit numberOfFramesChanged(m_numberOfFrames);
+    }
+    long memoryUsage = m_frames.isEmpty() ? 0 : m_writeOffset;
+    if(!m_frames.isEmpty() && m_frames.first().offset >= m_writeOffset) memoryUsage = m_ringSize; // Wrapped around
+    if(m_memoryUsage != memoryUsage) {
+        m_memoryUsage = memoryUsage;
+        emit memoryUsageChanged(memoryUsage);
+    }
+}
+
+qint64 TrajectoryRecorder::timestep(int frame) const
+{
+    // Called from QML while LAMMPS may be recording
+    QMutexLocker locker(&m_mutex);
+    if(frame < 0 || frame >= m_frames.size()) return -1;
+    return m_frames[frame].timestep;
+}
+
+int TrajectoryRecorder::numberOfAtoms(int frame) const
+{
+    QMutexLocker locker(&m_mutex);
+    if(frame < 0 || frame >= m_frames.size()) return -1;
+    return m_frames[frame].numberOfAtoms;
+}
+
+bool TrajectoryRecorder::recording() const
+{
+    return m_recording;
+}
+
+int TrajectoryRecorder::capacity() const
+{
+    return m_capacity;
+}
+
+int TrajectoryRecorder::numberOfFrames() const
+{
+    return m_numberOfFrames;
+}
+
+int TrajectoryRecorder::playbackFrame() const
+{
+    return m_playbackFrame;
+}
+
+long TrajectoryRecorder::memoryUsage() const
+{
+    return m_memoryUsage;
+}
+
+void TrajectoryRecorder::setRecording(bool recording)
+{
+    if (m_recording == recording)
+        return;
+
+    m_recording = recording;
+    emit recordingChanged(recording);
+}
+
+void TrajectoryRecorder::setCapacity(int capacity)
+{
+    // Used the next time the ring file is created, i.e. after a reset
+    if (m_capacity == capacity)
+        return;
+
+    m_capacity = capacity;
+    emit capacityChanged(capacity);
+}
+
+void TrajectoryRecorder::setPlaybackFrame(int playbackFrame)
+{
+    if (m_playbackFrame == playbackFrame)
+        return;
+
+    m_playbackFrame = playbackFrame;
+    emit playbackFrameChanged(playbackFrame);
+}
+
+void TrajectoryRecorder::benchmark(int numberOfAtoms)
+{
+    // Atoms on a random walk in a periodic box
+    AtomData atomData;
+    atomData.resize(numberOfAtoms);
+    const float length = std::cbrt(float(std::max(1, numberOfAtoms)));
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(0.0, length);
+    std::normal_distribution<float> step(0.0, 0.02);
+    for(int i=0; i<numberOfAtoms; i++) {
+        atomData.setPosition(i, QVector3D(distribution(generator), distribution(generator), distribution(generator)));
+        atomData.types[i] = 1 + i % 2;
+        atomData.bitmask[i] = 1;
+    }
+
+    const int numberOfFrames = 64;
+    QVector<QVector<float>> originalX;
+    TrajectoryRecorder recorder;
+    recorder.setCapacity(std::max(64, int(qint64(numberOfFrames)*numberOfAtoms*8/(1024*1024))));
+    QElapsedTimer timer;
+    qint64 recordTime = 0;
+    for(int frame=0; frame<numberOfFrames; frame++) {
+        timer.start();
+        recorder.record(atomData, frame);
+        recordTime += timer.nsecsElapsed();
+        originalX.append(atomData.x);
+        for(int i=0; i<numberOfAtoms; i++) {
+            float &x = atomData.x[i];
+            x += step(generator);
+            x -= length*std::floor(x / length);
+        }
+    }
+    recorder.synchronizeQML();
+
+    // Playing forward only applies one delta per frame, jumping back decodes from a keyframe
+    AtomData decoded;
+    decoded.resize(numberOfAtoms);
+    float maximumError = 0;
+    timer.start();
+    for(int frame=0; frame<recorder.numberOfFrames(); frame++) {
+        recorder.decode(frame, decoded);
+    }
+    const qint64 forwardTime = timer.nsecsElapsed();
+    timer.start();
+    for(int frame=recorder.numberOfFrames()-1; frame>=0; frame--) {
+        recorder.decode(frame, decoded);
+        const qint64 original = recorder.timestep(frame);
+        for(int i=0; i<numberOfAtoms; i++) {
+            maximumError = std::max(maximumError, std::abs(decoded.x[i] - originalX[original][i]));
+        }
+    }
+    const qint64 backwardTime = timer.nsecsElapsed();
+
+    const double seconds = 1e-9;
+    qDebug() << "Trajectory recorder with" << numberOfAtoms << "atoms and" << numberOfFrames << "frames";
+    qDebug() << "  bytes per atom per frame:" << double(recorder.m_writeOffset) / (double(numberOfFrames)*std::max(1, numberOfAtoms))
+             << "( raw positions, types and masks are 20 )";
+    qDebug() << "  record (ns/atom):        " << recordTime / (double(numberOfFrames)*std::max(1, numberOfAtoms));
+    qDebug() << "  decode forward (frames/s):" << recorder.numberOfFrames() / (forwardTime*seconds);
+    qDebug() << "  decode backward (frames/s):" << recorder.numberOfFrames() / (backwardTime*seconds);
+    qDebug() << "  largest position error:  " << maximumError << "of box" << length;
+}
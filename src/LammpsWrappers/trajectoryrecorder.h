@@ -0,0 +1,109 @@
+#ifndef TRAJECTORYRECORDER_H
+#define TRAJECTORYRECORDER_H
+#include <QObject>
+#include <QVector>
+#include <QVector3D>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <memory>
+
+class AtomData;
+class QTemporaryFile;
+
+// Keeps the most recent rendered frames so they can be replayed while paused. Frames are
+// written to a memory mapped temporary file used as a ring buffer, the oldest frames are
+// overwritten when it is full. Positions are quantized to 16 bits within the bounding box of
+// the atoms. Every keyframeInterval frames (or when the atoms changed too much) a keyframe
+// stores them as is, the frames in between store the change since the previous frame as
+// variable length integers, usually one byte per coordinate. Types and group bitmasks are run
+// length encoded and only stored when they changed. Per atom values of the controls that were
+// sampled for a frame are stored as floats in that frame, so it is colored by its own values.
+// record and decode are called on the LAMMPS thread, synchronizeQML while it waits for QML.
+// The list of frames only changes on the LAMMPS thread under m_mutex, other threads lock it to read.
+class TrajectoryRecorder : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool recording READ recording WRITE setRecording NOTIFY recordingChanged)
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity NOTIFY capacityChanged)
+    Q_PROPERTY(int numberOfFrames READ numberOfFrames NOTIFY numberOfFramesChanged)
+    Q_PROPERTY(int playbackFrame READ playbackFrame WRITE setPlaybackFrame NOTIFY playbackFrameChanged)
+    Q_PROPERTY(long memoryUsage READ memoryUsage NOTIFY memoryUsageChanged)
+public:
+    explicit TrajectoryRecorder(QObject *parent = nullptr);
+    ~TrajectoryRecorder();
+    void record(const AtomData &atomData, qint64 timestep, const QHash<QString, QVector<double>> &properties = QHash<QString, QVector<double>>());
+    // Overwrites positions, types, bitmask and properties of atomData with a recorded frame
+    bool decode(int frame, AtomData &atomData);
+    void synchronizeQML();
+    void clear();
+    Q_INVOKABLE qint64 timestep(int frame) const;
+    int numberOfAtoms(int frame) const;
+    bool recording() const;
+    int capacity() const;
+    int numberOfFrames() const;
+    int playbackFrame() const;
+    long memoryUsage() const;
+    // Prints size per atom and encode/decode speed, for atomify --benchmark
+    static void benchmark(int numberOfAtoms);
+
+public slots:
+    void setRecording(bool recording);
+    void setCapacity(int capacity);
+    void setPlaybackFrame(int playbackFrame);
+
+signals:
+    void recordingChanged(bool recording);
+    void capacityChanged(int capacity);
+    void numberOfFramesChanged(int numberOfFrames);
+    void playbackFrameChanged(int playbackFrame);
+    void memoryUsageChanged(long memoryUsage);
+
+private:
+    struct Frame {
+        qint64 offset = 0; // In the ring file
+        qint64 size = 0;
+        qint64 timestep = 0;
+        int numberOfAtoms = 0;
+        bool keyframe = false;
+    };
+
+    bool openFile();
+    void encode(const AtomData &atomData, qint64 timestep, const QByteArray &properties, bool keyframe, QByteArray &bytes);
+    bool needsKeyframe(const AtomData &atomData) const;
+    void store(const QByteArray &bytes, const Frame &frame);
+    void decodeFrame(const Frame &frame);
+    void decodeProperties(const Frame &frame, QHash<QString, QVector<double>> &properties) const;
+
+    mutable QMutex m_mutex; // Guards m_frames
+    std::unique_ptr<QTemporaryFile> m_file;
+    uchar *m_ring = nullptr;
+    qint64 m_ringSize = 0;
+    qint64 m_writeOffset = 0;
+    QVector<Frame> m_frames; // Oldest first, the oldest is always a keyframe
+    qint64 m_evictedFrames = 0; // Frames that ever fell out of the ring, so frame ids stay stable
+
+    // Encoder state, the previous recorded frame
+    QVector<quint16> m_encodedPositions; // x, y, z per atom
+    QVector<int> m_encodedTypes;
+    QVector<int> m_encodedBitmask;
+    QVector3D m_boxLow; // Quantization box of the current keyframe and its delta frames
+    QVector3D m_boxHigh;
+    int m_framesSinceKeyframe = 0;
+
+    // Decoder state, so stepping forward only applies one delta
+    QVector<quint16> m_decodedPositions;
+    QVector<int> m_decodedTypes;
+    QVector<int> m_decodedBitmask;
+    QVector3D m_decodedLow;
+    QVector3D m_decodedHigh;
+    qint64 m_decodedId = -1;
+
+    bool m_recording = false;
+    int m_capacity = 1024; // MB
+    int m_numberOfFrames = 0;
+    int m_playbackFrame = -1; // -1 shows the live simulation
+    long m_memoryUsage = 0;
+};
+
+#endif // TRAJECTORYRECORDER_H
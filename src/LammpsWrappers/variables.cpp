@@ -25,17 +25,18 @@ bool Variables::addOrRemove(LAMMPSController *lammpsController)
 {
     LAMMPS *lammps = lammpsController->lammps();
     Variable *variable = lammps->input->variable;
+    if(!m_generation.update(lammps, variable->generation)) return false;
+
     int nvar;
     Info info(lammps);
     char **names = info.get_variable_names(nvar);
     bool anyChanges = false;
-    if(names == nullptr) return false; // Maybe next time
+    if(names == nullptr) nvar = 0; // No variables (left) in LAMMPS
 
-    // First loop through all variables in LAMMPS to find new variables
-    for(int i=0; i<nvar; i++) {
-        char *name = names[i];
-        int ivar = variable->find(name);
-        if(ivar<0) continue; // Should never happen since we got the list from lammps just now, but prevents segfaults.
+    // First loop through all variables in LAMMPS to find new variables. The name list is
+    // LAMMPS' own, so the position in it is the variable index.
+    for(int ivar=0; ivar<nvar; ivar++) {
+        char *name = names[ivar];
         if(isSupported(lammpsController, ivar)) {
             QString identifier = QString::fromUtf8(name);
             if(!m_dataMap.contains(identifier)) {
@@ -78,6 +79,7 @@ void Variables::synchronizeQML(LAMMPSController *lammpsController)
     for(QObject *obj : m_data) {
         SimulatorControl *control = qobject_cast<SimulatorControl*>(obj);
         control->updateData1D();
+        control->updateSampling();
     }
 }
 
@@ -163,6 +165,7 @@ void Variables::reset()
         remove(variable->identifier());
     }
     data.clear();
+    m_generation.invalidate();
     setModel(QVariant::fromValue(m_data));
     setCount(0);
 }
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QVariant>
+#include "lammpsgeneration.h"
 
 class Variables : public QObject
 {
@@ -32,6 +33,7 @@ private:
     QMap<QString, QObject*> m_dataMap;
     QVariant m_model;
     int m_count = 0;
+    LammpsGeneration m_generation; // Variable::generation when we last scanned
     void add(QString identifier, class LAMMPSController *lammpsController);
     void remove(QString identifier);
     bool isSupported(class LAMMPSController *lammpsController, int ivar);
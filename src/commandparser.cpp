@@ -195,11 +195,8 @@ void CommandParser::bond(QString command) {
     if(!castOk) return;
 
     Bonds *bonds = m_simulator->system()->atoms()->bonds();
-    if(bonds->bondLengths().size() > std::max(atomType1, atomType2)) {
-        bonds->bondLengths()[atomType1][atomType2] = bondLength;
-        bonds->bondLengths()[atomType2][atomType1] = bondLength;
-        bonds->setEnabled(true);
-    }
+    if(!bonds->setBondLength(atomType1, atomType2, bondLength)) return;
+    bonds->setEnabled(true);
 }
 
 void CommandParser::atomColorAndSize(QString command) {
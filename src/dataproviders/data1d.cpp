@@ -36,23 +36,16 @@ void Data1D::updateLimits()
     QMutexLocker locker(&m_mutex);
     if(!m_minMaxValuesDirty) return;
 
-    if(m_points.size() == 0) {
+    if(m_points.isEmpty()) {
         m_minMaxValuesDirty = false;
         return;
     }
 
-    // Assume that max/min values are in first value, test for all other values. This is guaranteed to be correct.
-    qreal xMax = m_points.first().x();
-    qreal xMin = m_points.first().x();
-    qreal yMax = m_points.first().y();
-    qreal yMin = m_points.first().y();
-
-    for(const QPointF &p : m_points) {
-        xMax = std::max(p.x(), xMax);
-        xMin = std::min(p.x(), xMin);
-        yMax = std::max(p.y(), yMax);
-        yMin = std::min(p.y(), yMin);
-    }
+    // Kept up to date in add, so this is constant time
+    qreal xMax = m_dataXMax;
+    qreal xMin = m_dataXMin;
+    qreal yMax = m_dataYMax;
+    qreal yMin = m_dataYMin;
     m_minMaxValuesDirty = false; // in case signals below trigger new calculation
 
     bool anyChanges = false;
@@ -86,11 +79,12 @@ void Data1D::updateLimits()
 
 }
 
-void Data1D::updateXYSeries(QAbstractSeries *series)
+void Data1D::updateXYSeries(QAbstractSeries *series, int maximumCount)
 {
     QXYSeries *xySeries = qobject_cast<QXYSeries*>(series);
     if(xySeries) {
-        xySeries->replace(m_points);
+        QMutexLocker locker(&m_mutex);
+        xySeries->replace(m_points.points(maximumCount));
     }
 }
 
@@ -136,9 +130,10 @@ bool Data1D::enabled() const
     return m_enabled;
 }
 
-const QVector<QPointF> &Data1D::points()
+QVector<QPointF> Data1D::points()
 {
-    return m_points;
+    QMutexLocker locker(&m_mutex);
+    return m_points.points();
 }
 
 void Data1D::clear(bool silent)
@@ -146,40 +141,29 @@ void Data1D::clear(bool silent)
     QMutexLocker locker(&m_mutex);
     m_minMaxValuesDirty = true;
     m_points.clear();
-    m_cleanHistogramPoints.clear();
+    locker.unlock(); // updateXYSeries takes the (non-recursive) mutex itself
     if(!silent && m_xySeries) {
         updateXYSeries(m_xySeries);
     }
 }
 
-void Data1D::createHistogram(const std::vector<double> &points)
+void Data1D::createHistogram(const std::vector<double> &values, const PerAtomRange &range)
 {
     QMutexLocker locker(&m_mutex);
+    if(range.count == 0) return; // Only inf and NaN
 
-    m_cleanHistogramPoints.clear();
-    m_cleanHistogramPoints.reserve(points.size());
-    for(double p : points) {
-        if(std::isnan(p) || std::isinf(p)) continue;
-        m_cleanHistogramPoints.push_back(p);
-    }
-
-    double min = *std::min_element(std::begin(m_cleanHistogramPoints), std::end(m_cleanHistogramPoints));
-    double max = *std::max_element(std::begin(m_cleanHistogramPoints), std::end(m_cleanHistogramPoints));
-
+    double min = range.min;
+    double max = range.max;
     if(max == min) {
         // Ensure dx is not zero
         max = min+1;
     }
     double dx = (max-min) / m_bins;
-    std::vector<int> counts(m_bins, 0);
-    for(double p : m_cleanHistogramPoints) {
-        int bin = (p-min) / dx;
-        if(bin >= m_bins) bin = m_bins-1; // The very last number is exactly on the edge, put it in last bin
-        counts[bin]++;
-    }
+    QVector<int> &counts = m_histogramCounts;
+    counts.resize(m_bins);
+    PerAtomKernels::histogram(values.data(), values.size(), min, max, counts);
 
     m_points.clear();
-    m_points.reserve(3*m_bins+1);
     m_points.append(QPointF(min, 0));
     double maxCount = 0;
     for(int bin = 0; bin<m_bins; bin++) {
@@ -192,7 +176,6 @@ void Data1D::createHistogram(const std::vector<double> &points)
         m_points.append(QPointF(binMax, value));
         m_points.append(QPointF(binMax, 0));
     }
-    counts.clear();
     m_xMin = min;
     m_xMax = max;
     m_yMin = 0;
@@ -206,7 +189,7 @@ void Data1D::add(float x, float y, bool silent)
     // start computing dynamics. During minimization, we use a different
     // time measure, so it will append time values starting from zero again.
     // TODO: rethink this.
-    if(m_points.size() && x < m_points.last().x()) {
+    if(!m_points.isEmpty() && x < m_points.last().x()) {
         clear(true);
     }
     add(QPointF(x,y), silent);
@@ -216,10 +199,19 @@ void Data1D::add(const QPointF &point, bool silent)
 {
     QMutexLocker locker(&m_mutex);
     m_points.append(point);
+    if(m_points.size() == 1) {
+        m_dataXMin = m_dataXMax = point.x();
+        m_dataYMin = m_dataYMax = point.y();
+    } else {
+        m_dataXMin = std::min(m_dataXMin, point.x());
+        m_dataXMax = std::max(m_dataXMax, point.x());
+        m_dataYMin = std::min(m_dataYMin, point.y());
+        m_dataYMax = std::max(m_dataYMax, point.y());
+    }
     m_minMaxValuesDirty = true;
+    // The series itself is refreshed by updateXYSeries with only as many points as it can show
     if(!silent && m_xySeries) {
         updateMinMaxWithPoint(point);
-        m_xySeries->append(point.x(), point.y());
     }
 }
 
@@ -302,3 +294,19 @@ int Data1D::bins() const
 {
     return m_bins;
 }
+
+bool Data1D::spillToDisk() const
+{
+    return m_points.spillToDisk();
+}
+
+void Data1D::setSpillToDisk(bool spillToDisk)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_points.spillToDisk() == spillToDisk)
+        return;
+
+    m_points.setSpillToDisk(spillToDisk);
+    locker.unlock();
+    emit spillToDiskChanged(spillToDisk);
+}
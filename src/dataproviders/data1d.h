@@ -5,6 +5,8 @@
 #include <QXYSeries>
 #include <QLineSeries>
 #include <QMutex>
+#include "decimatedseries.h"
+#include "peratomkernels.h"
 
 using namespace QtCharts;
 class Data1D : public QObject
@@ -18,25 +20,29 @@ class Data1D : public QObject
     Q_PROPERTY(QXYSeries* xySeries READ xySeries WRITE setXySeries NOTIFY xySeriesChanged)
     Q_PROPERTY(QString label READ label WRITE setLabel NOTIFY labelChanged)
     Q_PROPERTY(int bins READ bins WRITE setBins NOTIFY binsChanged)
+    Q_PROPERTY(bool spillToDisk READ spillToDisk WRITE setSpillToDisk NOTIFY spillToDiskChanged)
 
 public:
     explicit Data1D(QObject *parent = 0);
     Q_INVOKABLE void updateLimits();
-    Q_INVOKABLE void updateXYSeries(QAbstractSeries *series);
+    // Replaces the points of the series with at most maximumCount points covering the full history
+    Q_INVOKABLE void updateXYSeries(QAbstractSeries *series, int maximumCount = 2000);
     Q_INVOKABLE void add(float x, float y, bool silent = true);
     Q_INVOKABLE void clear(bool silent = false);
-    void createHistogram(const std::vector<double> &points);
+    // values are per atom with NaN for atoms outside the group, range from PerAtomKernels::range
+    void createHistogram(const std::vector<double> &values, const PerAtomRange &range);
     void add(const QPointF &point, bool silent = true);
     qreal xMin();
     qreal xMax();
     qreal yMin();
     qreal yMax();
     bool enabled() const;
-    const QVector<QPointF> &points();
+    QVector<QPointF> points(); // Full history, see DecimatedSeries
     QXYSeries* xySeries() const;
     void copyHistogram(const QVector<QPointF> &points);
     QString label() const;
     int bins() const;
+    bool spillToDisk() const;
 signals:
     void xMinChanged(qreal xMin);
     void xMaxChanged(qreal xMax);
@@ -49,21 +55,28 @@ signals:
     void updatedHistogram(Data1D *data);
     void labelChanged(QString label);
     void binsChanged(int bins);
+    void spillToDiskChanged(bool spillToDisk);
 
 public slots:
     void setEnabled(bool enabled);
     void setXySeries(QXYSeries* xySeries);
     void setLabel(QString label);
     void setBins(int bins);
+    void setSpillToDisk(bool spillToDisk);
 
 private:
     QXYSeries* m_xySeries = nullptr;
-    QVector<QPointF> m_points;
-    std::vector<double> m_cleanHistogramPoints; // without inf and NaN
+    DecimatedSeries m_points;
+    QVector<int> m_histogramCounts;
     qreal m_xMin = 0;
     qreal m_xMax = 0;
     qreal m_yMin = 0;
     qreal m_yMax = 0;
+    // Running limits of all points, published to xMin etc. by updateLimits
+    qreal m_dataXMin = 0;
+    qreal m_dataXMax = 0;
+    qreal m_dataYMin = 0;
+    qreal m_dataYMax = 0;
     bool m_minMaxValuesDirty = false;
     bool m_enabled = false;
     void updateMinMaxWithPoint(const QPointF &point);
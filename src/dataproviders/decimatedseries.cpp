@@ -0,0 +1,234 @@
+#include "decimatedseries.h"
+#include <QFile>
+#include <QTemporaryFile>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void DecimatedSeries::Bucket::add(const QPointF &point)
+{
+    if(count == 0 || point.y() < minimum.y()) minimum = point;
+    if(count == 0 || point.y() > maximum.y()) maximum = point;
+    count++;
+}
+
+void DecimatedSeries::Bucket::add(const Bucket &bucket)
+{
+    if(bucket.count == 0) return;
+    if(count == 0 || bucket.minimum.y() < minimum.y()) minimum = bucket.minimum;
+    if(count == 0 || bucket.maximum.y() > maximum.y()) maximum = bucket.maximum;
+    count += bucket.count;
+}
+
+DecimatedSeries::DecimatedSeries(int capacity, int factor, int numberOfLevels)
+{
+    m_factor = factor;
+    m_raw.setCapacity(capacity);
+    m_levels.resize(numberOfLevels + 1);
+    qint64 bucketSize = 1;
+    for(int level=1; level<m_levels.size(); level++) {
+        bucketSize *= factor;
+        m_levels[level].bucketSize = bucketSize;
+        m_levels[level].buckets.setCapacity(std::max(2, capacity/8));
+    }
+}
+
+DecimatedSeries::~DecimatedSeries()
+{
+
+}
+
+void DecimatedSeries::append(const QPointF &point)
+{
+    m_size++;
+    m_last = point;
+
+    if(m_raw.isFull()) {
+        m_rawEvicted = true;
+        if(m_spillToDisk) {
+            if(!m_spillFile) {
+                m_spillFile.reset(new QTemporaryFile());
+                if(!m_spillFile->open()) {
+                    qWarning() << "DecimatedSeries: Could not create spill file, keeping decimated history only";
+                    m_spillFile.reset();
+                    m_spillToDisk = false;
+                }
+            }
+            if(m_spillFile) {
+                const QPointF &oldest = m_raw.at(0);
+                m_spillFile->write(reinterpret_cast<const char*>(&oldest), sizeof(QPointF));
+                m_spilledCount++;
+            }
+        }
+    }
+    m_raw.push(point);
+
+    const int topLevel = m_levels.size() - 1;
+    for(int levelIndex=1; levelIndex<m_levels.size(); levelIndex++) {
+        Level &level = m_levels[levelIndex];
+        level.pending.add(point);
+        if(level.pending.count < level.bucketSize) continue;
+
+        if(level.buckets.isFull()) {
+            if(levelIndex == topLevel) {
+                // Doubles the bucket size, so the pending bucket is only half full now
+                compactTopLevel();
+                continue;
+            }
+            level.evicted = true;
+        }
+        level.buckets.push(level.pending);
+        level.pending = Bucket();
+    }
+}
+
+void DecimatedSeries::compactTopLevel()
+{
+    // The top level never evicts, so its ring starts at index 0 and can be merged in place
+    Level &level = m_levels.last();
+    const int count = level.buckets.count();
+    for(int i=0; i<count/2; i++) {
+        Bucket merged = level.buckets[2*i];
+        merged.add(level.buckets[2*i+1]);
+        level.buckets[i] = merged;
+    }
+    if(count % 2) level.buckets[count/2] = level.buckets[count-1];
+    level.buckets.truncate((count+1)/2);
+    level.bucketSize *= 2;
+}
+
+void DecimatedSeries::clear()
+{
+    m_raw.clear();
+    qint64 bucketSize = 1;
+    for(Level &level : m_levels) {
+        level.buckets.clear();
+        level.pending = Bucket();
+        level.evicted = false;
+        level.bucketSize = bucketSize; // The top level may have grown its buckets
+        bucketSize *= m_factor;
+    }
+    m_size = 0;
+    m_last = QPointF();
+    m_rawEvicted = false;
+    m_spillFile.reset();
+    m_spilledCount = 0;
+}
+
+void DecimatedSeries::setSpillToDisk(bool spillToDisk)
+{
+    m_spillToDisk = spillToDisk;
+    if(!spillToDisk) {
+        m_spillFile.reset();
+        m_spilledCount = 0;
+    }
+}
+
+void DecimatedSeries::appendBucket(const Bucket &bucket, double beforeX, QVector<QPointF> &points)
+{
+    if(bucket.count == 0) return;
+    // Minimum and maximum in the order they were added so the line is drawn correctly
+    const QPointF &first = bucket.minimum.x() <= bucket.maximum.x() ? bucket.minimum : bucket.maximum;
+    const QPointF &second = bucket.minimum.x() <= bucket.maximum.x() ? bucket.maximum : bucket.minimum;
+    if(first.x() < beforeX) points.append(first);
+    if(second != first && second.x() < beforeX) points.append(second);
+}
+
+void DecimatedSeries::collectSpilled(QVector<QPointF> &points) const
+{
+    m_spillFile->flush();
+    QFile file(m_spillFile->fileName());
+    if(!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "DecimatedSeries: Could not read spill file" << file.fileName();
+        return;
+    }
+    const int offset = points.size();
+    points.resize(offset + m_spilledCount);
+    file.read(reinterpret_cast<char*>(points.data() + offset), m_spilledCount*sizeof(QPointF));
+}
+
+void DecimatedSeries::collect(int levelIndex, double beforeX, bool useSpilled, QVector<QPointF> &points) const
+{
+    // Everything with x < beforeX, using levelIndex as the finest level. History this level
+    // has forgotten comes from the spill file or the next coarser level.
+    if(levelIndex == 0) {
+        if(m_rawEvicted) {
+            if(useSpilled && m_spillFile) {
+                collectSpilled(points);
+            } else if(m_levels.size() > 1) {
+                collect(1, m_raw.at(0).x(), useSpilled, points);
+            }
+        }
+        for(int i=0; i<m_raw.count(); i++) {
+            const QPointF &point = m_raw.at(i);
+            if(point.x() >= beforeX) break;
+            points.append(point);
+        }
+        return;
+    }
+
+    const Level &level = m_levels[levelIndex];
+    if(level.evicted) {
+        const Bucket &oldest = level.buckets.at(0);
+        collect(levelIndex + 1, std::min(oldest.minimum.x(), oldest.maximum.x()), useSpilled, points);
+    }
+    for(int i=0; i<level.buckets.count(); i++) {
+        appendBucket(level.buckets.at(i), beforeX, points);
+    }
+    appendBucket(level.pending, beforeX, points);
+}
+
+qint64 DecimatedSeries::estimatedCount(int levelIndex) const
+{
+    if(levelIndex == 0) {
+        qint64 count = m_raw.count();
+        if(m_rawEvicted && m_levels.size() > 1) count += estimatedCount(1);
+        return count;
+    }
+    const Level &level = m_levels[levelIndex];
+    qint64 count = 2*(level.buckets.count() + 1);
+    if(level.evicted) count += estimatedCount(levelIndex + 1);
+    return count;
+}
+
+QVector<QPointF> DecimatedSeries::points() const
+{
+    QVector<QPointF> points;
+    collect(0, std::numeric_limits<double>::infinity(), true, points);
+    return points;
+}
+
+QVector<QPointF> DecimatedSeries::points(int maximumCount) const
+{
+    // The finest level that fits, falling back to the coarsest one
+    int levelIndex = 0;
+    while(levelIndex < m_levels.size() - 1 && estimatedCount(levelIndex) > maximumCount) levelIndex++;
+
+    QVector<QPointF> points;
+    collect(levelIndex, std::numeric_limits<double>::infinity(), false, points);
+    if(points.size() > maximumCount) return decimate(points, maximumCount);
+    return points;
+}
+
+QVector<QPointF> DecimatedSeries::decimate(const QVector<QPointF> &points, int maximumCount)
+{
+    // Minimum and maximum of every group of consecutive points
+    const int groupSize = std::ceil(points.size() / std::max(1.0, 0.5*maximumCount));
+    QVector<QPointF> decimated;
+    decimated.reserve(2*(points.size()/groupSize + 1));
+    for(int start=0; start<points.size(); start+=groupSize) {
+        Bucket bucket;
+        const int end = std::min(start + groupSize, points.size());
+        for(int i=start; i<end; i++) bucket.add(points[i]);
+        appendBucket(bucket, std::numeric_limits<double>::infinity(), decimated);
+    }
+    return decimated;
+}
+
+long DecimatedSeries::memoryUsage() const
+{
+    long bytes = m_raw.memoryUsage();
+    for(const Level &level : m_levels) bytes += level.buckets.memoryUsage();
+    return bytes;
+}
@@ -0,0 +1,99 @@
+#ifndef DECIMATEDSERIES_H
+#define DECIMATEDSERIES_H
+#include <QPointF>
+#include <QVector>
+#include <memory>
+
+class QTemporaryFile;
+
+// Append only time series with bounded memory. The newest points are kept at full resolution
+// in a ring buffer. Coarser levels keep the minimum and maximum of every bucket of factor^level
+// points, so peaks survive decimation. The coarsest level never forgets, it merges neighboring
+// buckets when it is full. Points older than the ring buffer can optionally be spilled to a
+// temporary file so the full history is still available for export.
+// Appending is O(number of levels) and x is assumed to be non-decreasing.
+class DecimatedSeries
+{
+public:
+    explicit DecimatedSeries(int capacity = 32768, int factor = 8, int numberOfLevels = 4);
+    ~DecimatedSeries();
+    void append(const QPointF &point);
+    void clear();
+    qint64 size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    const QPointF &last() const { return m_last; }
+    // The full history, at full resolution where available
+    QVector<QPointF> points() const;
+    // The full history with at most maximumCount points, for plotting
+    QVector<QPointF> points(int maximumCount) const;
+    bool spillToDisk() const { return m_spillToDisk; }
+    void setSpillToDisk(bool spillToDisk);
+    long memoryUsage() const;
+
+private:
+    struct Bucket {
+        QPointF minimum;
+        QPointF maximum;
+        qint64 count = 0;
+        void add(const QPointF &point);
+        void add(const Bucket &bucket);
+    };
+
+    template<typename T>
+    class Ring {
+    public:
+        void setCapacity(int capacity) { m_capacity = capacity; }
+        int capacity() const { return m_capacity; }
+        int count() const { return m_count; }
+        bool isFull() const { return m_count == m_capacity; }
+        const T &at(int index) const { return m_items[(m_start + index) % m_capacity]; }
+        T &operator[](int index) { return m_items[(m_start + index) % m_capacity]; }
+        void push(const T &item) {
+            if(m_items.size() < m_capacity) {
+                m_items.append(item);
+                m_count++;
+            } else if(m_count < m_capacity) {
+                m_items[(m_start + m_count) % m_capacity] = item;
+                m_count++;
+            } else {
+                // Full, overwrite the oldest
+                m_items[m_start] = item;
+                m_start = (m_start + 1) % m_capacity;
+            }
+        }
+        void truncate(int count) { m_count = count; }
+        void clear() { m_items.clear(); m_start = 0; m_count = 0; }
+        long memoryUsage() const { return m_items.capacity()*sizeof(T); }
+    private:
+        QVector<T> m_items;
+        int m_capacity = 0;
+        int m_start = 0;
+        int m_count = 0;
+    };
+
+    struct Level {
+        Ring<Bucket> buckets;
+        Bucket pending;
+        qint64 bucketSize = 1;
+        bool evicted = false;
+    };
+
+    void compactTopLevel();
+    void collect(int level, double beforeX, bool useSpilled, QVector<QPointF> &points) const;
+    qint64 estimatedCount(int level) const;
+    void collectSpilled(QVector<QPointF> &points) const;
+    static void appendBucket(const Bucket &bucket, double beforeX, QVector<QPointF> &points);
+    static QVector<QPointF> decimate(const QVector<QPointF> &points, int maximumCount);
+
+    Ring<QPointF> m_raw;
+    QVector<Level> m_levels; // m_levels[0] is unused, the raw ring is level 0
+    QPointF m_last;
+    qint64 m_size = 0;
+    int m_factor = 8;
+    bool m_rawEvicted = false;
+    bool m_spillToDisk = false; // Opt in, it writes temporary files of unbounded size
+    std::unique_ptr<QTemporaryFile> m_spillFile;
+    qint64 m_spilledCount = 0;
+};
+
+#endif // DECIMATEDSERIES_H
@@ -0,0 +1,136 @@
+#include "peratomkernels.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+// True for finite values. Unlike std::isfinite this vectorizes: inf - inf and NaN - NaN are NaN.
+static inline bool isFinite(double value) { return value - value == 0; }
+
+PerAtomRange PerAtomKernels::range(const double *values, int size)
+{
+    double minimum = std::numeric_limits<double>::infinity();
+    double maximum = -std::numeric_limits<double>::infinity();
+    int count = 0;
+#pragma omp parallel for simd reduction(min:minimum) reduction(max:maximum) reduction(+:count)
+    for(int i=0; i<size; i++) {
+        const double value = values[i];
+        const bool finite = isFinite(value);
+        minimum = finite ? std::min(minimum, value) : minimum;
+        maximum = finite ? std::max(maximum, value) : maximum;
+        count += finite;
+    }
+
+    PerAtomRange range;
+    range.count = count;
+    if(count > 0) {
+        range.min = minimum;
+        range.max = maximum;
+    }
+    return range;
+}
+
+void PerAtomKernels::histogram(const double *values, int size, double min, double max, QVector<int> &counts)
+{
+    const int bins = counts.size();
+    counts.fill(0);
+    if(bins == 0 || max <= min) return;
+    const double oneOverDx = bins / (max - min);
+
+    // Each thread fills its own bins, merged at the end
+#pragma omp parallel
+    {
+        std::vector<int> localCounts(bins, 0);
+#pragma omp for nowait
+        for(int i=0; i<size; i++) {
+            const double value = values[i];
+            if(!isFinite(value)) continue;
+            int bin = (value - min) * oneOverDx;
+            bin = std::max(0, std::min(bin, bins-1)); // The very last number is exactly on the edge, put it in last bin
+            localCounts[bin]++;
+        }
+#pragma omp critical
+        for(int bin=0; bin<bins; bin++) counts[bin] += localCounts[bin];
+    }
+}
+
+ColorMap::ColorMap()
+{
+    const double limits[] = {0, 0.15, 0.35, 0.65, 0.85, 1.0};
+    const double red[] = {0, 0, 0, 255./255, 255./255, 255./255};
+    const double green[] = {0, 50./255, 255./255, 255./255, 30./255, 0};
+    const double blue[] = {100./255, 255./255, 255./255, 0, 0, 0};
+
+    int j = 0;
+    for(int i=0; i<tableSize; i++) {
+        const double scaled = double(i) / (tableSize-1);
+        while(j < 4 && scaled > limits[j+1]) j++;
+        // Where between the two limits including this value we are
+        const double fraction = 1.0 - (scaled - limits[j]) / (limits[j+1] - limits[j]);
+        m_table[i] = QVector3D(red[j]*fraction + (1.0 - fraction)*red[j+1],
+                               green[j]*fraction + (1.0 - fraction)*green[j+1],
+                               blue[j]*fraction + (1.0 - fraction)*blue[j+1]);
+    }
+}
+
+const QVector3D &ColorMap::color(double scaled) const
+{
+    const int index = std::max(0, std::min(int(scaled*(tableSize-1) + 0.5), tableSize-1));
+    return m_table[index];
+}
+
+void ColorMap::apply(const double *values, const int *bitmask, int groupBit, int size, double min, double max, QVector3D *colors) const
+{
+    const double oneOverRange = max > min ? 1.0 / (max - min) : 0.0;
+    const QVector3D notInGroup(0.1, 0.1, 0.1);
+    const QVector3D notFinite(1.0, 1.0, 1.0);
+#pragma omp parallel for
+    for(int i=0; i<size; i++) {
+        const double value = values[i];
+        if(!(bitmask[i] & groupBit)) colors[i] = notInGroup; // Each group in LAMMPS is represented as a bit in an int
+        else if(!isFinite(value)) colors[i] = notFinite;
+        else colors[i] = color((value - min) * oneOverRange);
+    }
+}
+
+void PerAtomKernels::benchmark(int numberOfAtoms)
+{
+    // Random values with some NaN, like a compute restricted to a group
+    std::vector<double> values(numberOfAtoms);
+    QVector<int> bitmask(numberOfAtoms, 1);
+    QVector<QVector3D> colors(numberOfAtoms);
+    std::mt19937 generator(1);
+    std::normal_distribution<double> distribution(0.0, 1.0);
+    for(int i=0; i<numberOfAtoms; i++) {
+        values[i] = (i % 10 == 0) ? std::numeric_limits<double>::quiet_NaN() : distribution(generator);
+    }
+
+    const int repetitions = 20;
+    const ColorMap colorMap;
+    QVector<int> counts(20);
+    PerAtomRange valueRange;
+    QElapsedTimer timer;
+    qint64 rangeTime = 0, histogramTime = 0, colorTime = 0;
+    for(int repetition=0; repetition<repetitions; repetition++) {
+        timer.start();
+        valueRange = range(values.data(), numberOfAtoms);
+        rangeTime += timer.nsecsElapsed();
+
+        timer.start();
+        histogram(values.data(), numberOfAtoms, valueRange.min, valueRange.max, counts);
+        histogramTime += timer.nsecsElapsed();
+
+        timer.start();
+        colorMap.apply(values.data(), bitmask.constData(), 1, numberOfAtoms, valueRange.min, valueRange.max, colors.data());
+        colorTime += timer.nsecsElapsed();
+    }
+
+    const double nanosecondsPerAtom = 1.0 / (double(repetitions) * std::max(1, numberOfAtoms));
+    qDebug() << "Per atom kernels with" << numberOfAtoms << "atoms (ns/atom)";
+    qDebug() << "  range:    " << rangeTime*nanosecondsPerAtom;
+    qDebug() << "  histogram:" << histogramTime*nanosecondsPerAtom;
+    qDebug() << "  color map:" << colorTime*nanosecondsPerAtom;
+}
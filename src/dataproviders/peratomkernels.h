@@ -0,0 +1,39 @@
+#ifndef PERATOMKERNELS_H
+#define PERATOMKERNELS_H
+#include <QVector>
+#include <QVector3D>
+
+// Range of the finite values in a per atom array. NaN marks atoms outside the group.
+struct PerAtomRange {
+    double min = 0;
+    double max = 0;
+    int count = 0;
+};
+
+// Kernels over per atom values from computes, fixes and variables. NaN and inf are skipped.
+// Parallel over atoms with OpenMP and written so the inner loops vectorize.
+class PerAtomKernels
+{
+public:
+    static PerAtomRange range(const double *values, int size);
+    // counts.size() bins spanning [min, max], values exactly at max go in the last bin
+    static void histogram(const double *values, int size, double min, double max, QVector<int> &counts);
+    // Prints the time per atom of each kernel, for atomify --benchmark
+    static void benchmark(int numberOfAtoms);
+};
+
+// Color map sampled into a 256 entry lookup table, so coloring an atom is one table lookup
+class ColorMap
+{
+public:
+    ColorMap(); // Blue, cyan, yellow, red, used for per atom properties
+    const QVector3D &color(double scaled) const; // scaled in [0, 1]
+    // Colors atoms in groupBit by value, others dark grey and non-finite values white
+    void apply(const double *values, const int *bitmask, int groupBit, int size, double min, double max, QVector3D *colors) const;
+
+private:
+    static const int tableSize = 256;
+    QVector3D m_table[tableSize];
+};
+
+#endif // PERATOMKERNELS_H
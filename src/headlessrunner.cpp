@@ -0,0 +1,203 @@
+#include "headlessrunner.h"
+#include "lammpscontroller.h"
+#include "mysimulator.h"
+#include "performance.h"
+#include "LammpsWrappers/system.h"
+#include "LammpsWrappers/atoms.h"
+#include "LammpsWrappers/modifiers/modifiers.h"
+#include "LammpsWrappers/simulatorcontrols/simulatorcontrol.h"
+#include "dataproviders/data1d.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegExp>
+#include <QThread>
+#include <algorithm>
+
+HeadlessRunner::HeadlessRunner()
+{
+
+}
+
+HeadlessRunner::~HeadlessRunner()
+{
+    delete m_simulator;
+}
+
+void HeadlessRunner::createModifiers()
+{
+    // Same modifiers and defaults as AtomifyVisualizer.qml
+    ColorModifier *colorModifier = new ColorModifier();
+    colorModifier->setEnabled(true);
+    ColorAllGroupsModifier *colorAllGroupsModifier = new ColorAllGroupsModifier();
+    colorAllGroupsModifier->setEnabled(false);
+    ColorAllRegionsModifier *colorAllRegionsModifier = new ColorAllRegionsModifier();
+    colorAllRegionsModifier->setEnabled(false);
+    PropertyModifier *propertyModifier = new PropertyModifier();
+    propertyModifier->setEnabled(true);
+    GroupModifier *groupModifier = new GroupModifier();
+    groupModifier->setEnabled(true);
+    RegionModifier *regionModifier = new RegionModifier();
+    regionModifier->setEnabled(true);
+    PeriodicImages *periodicImages = new PeriodicImages();
+    Slice *sliceModifier = new Slice();
+    sliceModifier->setEnabled(false);
+
+    QVariantList modifiers;
+    QList<Modifier*> list = {colorModifier, colorAllGroupsModifier, colorAllRegionsModifier, propertyModifier,
+                             groupModifier, regionModifier, periodicImages, sliceModifier};
+    for(Modifier *modifier : list) {
+        modifier->setParent(m_simulator);
+        modifiers.append(QVariant::fromValue(modifier));
+    }
+    m_simulator->system()->atoms()->setModifiers(modifiers);
+}
+
+int HeadlessRunner::run()
+{
+    QFileInfo scriptFileInfo(scriptFilePath);
+    if(!scriptFileInfo.exists()) {
+        qWarning() << "HeadlessRunner: Script does not exist:" << scriptFilePath;
+        return 1;
+    }
+
+    // LAMMPSController changes the working directory to the script location, so resolve paths first
+    QDir outputDir(QDir::current().absoluteFilePath(outputDirectory));
+    if(!outputDir.mkpath("plots")) {
+        qWarning() << "HeadlessRunner: Could not create" << outputDir.absolutePath();
+        return 1;
+    }
+    outputDirectory = outputDir.absolutePath();
+
+    if(writeFrames) {
+        m_framesFile.setFileName(outputDir.absoluteFilePath("frames.xyz"));
+        m_framesFile.open(QIODevice::WriteOnly | QIODevice::Text);
+        m_frames.setDevice(&m_framesFile);
+    }
+    m_performanceFile.setFileName(outputDir.absoluteFilePath("performance.jsonl"));
+    m_performanceFile.open(QIODevice::WriteOnly | QIODevice::Text);
+    m_performance.setDevice(&m_performanceFile);
+
+    // The simulator owns the System and the command parser, but its worker thread is never
+    // started since nothing drives its timer without an event loop.
+    m_simulator = new AtomifySimulator();
+    m_simulator->setRunning(false);
+    System *system = m_simulator->system();
+    createModifiers();
+
+    LAMMPSController lammpsController;
+    lammpsController.system = system;
+    lammpsController.headlessRunner = this;
+    lammpsController.qmlThread = QThread::currentThread();
+    lammpsController.simulationSpeed = std::max(1, frameInterval);
+    lammpsController.scriptFilePath = scriptFileInfo.absoluteFilePath();
+
+    m_simulator->parser().parseFile(scriptFileInfo.absoluteFilePath(), false);
+    lammpsController.start();
+    lammpsController.run();
+
+    int exitCode = 0;
+    if(lammpsController.crashed) {
+        qWarning() << "HeadlessRunner: LAMMPS crashed:" << lammpsController.errorMessage;
+        exitCode = 1;
+    }
+
+    system->performance()->updateStageStatistics();
+    writePlotSeries(system);
+    writePerformance(system);
+    system->performance()->exportChromeTrace(outputDir.absoluteFilePath("trace.json"));
+    lammpsController.stop();
+    m_frames.flush();
+    m_performance.flush();
+
+    qDebug() << "Wrote" << m_frameCount << "frames to" << outputDirectory;
+    return exitCode;
+}
+
+void HeadlessRunner::processFrame(LAMMPSController *lammpsController)
+{
+    // What the QML thread does in MyWorker::synchronizeSimulator and synchronizeRenderer
+    System *system = lammpsController->system;
+    system->synchronizeQML(lammpsController);
+    system->atoms()->synchronizeRenderer();
+
+    if(writeFrames) writeFrame(system);
+    m_frameCount++;
+    if(reportInterval > 0 && m_frameCount % reportInterval == 0) {
+        writePlotSeries(system);
+        writePerformance(system);
+    }
+}
+
+void HeadlessRunner::writeFrame(System *system)
+{
+    // Extended XYZ with the processed (rendered) data of every visible atom in every periodic image
+    const AtomData &atomData = system->atoms()->atomDataProcessed();
+    const ImageTranslations &images = system->atoms()->sphereData()->images();
+    const QMatrix4x4 imageTransform = images.transform();
+    m_frames << atomData.visible.count()*images.count() << "\n";
+    m_frames << "Timestep=" << system->currentTimestep()
+             << " Properties=type:I:1:pos:R:3:color:R:3:radius:R:1\n";
+    for(int image=0; image<images.count(); image++) {
+        const QVector3D imageIndex(image % images.counts[0], (image / images.counts[0]) % images.counts[1], image / (images.counts[0]*images.counts[1]));
+        const QVector3D translation = imageTransform.map(imageIndex);
+        for(int i=0; i<atomData.size(); i++) {
+            if(!atomData.visible.test(i)) continue;
+            const QVector3D position = atomData.position(i) + translation;
+            const QVector3D &color = atomData.colors[i];
+            m_frames << atomData.types[i] << " "
+                     << position[0] << " " << position[1] << " " << position[2] << " "
+                     << color[0] << " " << color[1] << " " << color[2] << " "
+                     << atomData.radii[i] << "\n";
+        }
+    }
+}
+
+void HeadlessRunner::writePlotSeries(System *system)
+{
+    // One file per series, overwritten each time since histograms replace all their points
+    QDir plotsDir(QDir(outputDirectory).absoluteFilePath("plots"));
+    for(SimulatorControl *control : system->simulatorControls()) {
+        QVariantMap data1D = control->data1D();
+        for(auto it = data1D.constBegin(); it != data1D.constEnd(); ++it) {
+            Data1D *data = it.value().value<Data1D*>();
+            if(!data) continue;
+            QString fileName = QString("%1_%2.txt").arg(control->identifier(), it.key());
+            fileName.replace(QRegExp("[^A-Za-z0-9_.-]"), "_");
+            QFile file(plotsDir.absoluteFilePath(fileName));
+            if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                qWarning() << "HeadlessRunner: Could not open" << file.fileName();
+                continue;
+            }
+            QTextStream out(&file);
+            out << "# " << control->xLabel() << " " << it.key() << "\n";
+            for(const QPointF &point : data->points()) {
+                out << point.x() << " " << point.y() << "\n";
+            }
+        }
+    }
+}
+
+void HeadlessRunner::writePerformance(System *system)
+{
+    Performance *performance = system->performance();
+    QJsonObject metrics;
+    metrics["timestep"] = system->currentTimestep();
+    metrics["frame"] = qint64(m_frameCount);
+    metrics["numberOfAtoms"] = system->numberOfAtoms();
+    metrics["numberOfBonds"] = system->atoms()->numberOfBonds();
+    metrics["timestepsPerSecond"] = performance->timestepsPerSecond();
+    metrics["memoryLAMMPS"] = qint64(performance->memoryLAMMPS());
+    metrics["memoryAtomify"] = qint64(performance->memoryAtomify());
+    metrics["droppedFrames"] = qint64(performance->droppedFrames());
+    metrics["forcedTallies"] = qint64(performance->forcedTallies());
+    metrics["synchronizationNanosecondsPerAtom"] = performance->synchronizationNanosecondsPerAtom();
+    metrics["modifierTimings"] = QJsonObject::fromVariantMap(performance->modifierTimings());
+    metrics["stageStatistics"] = QJsonArray::fromVariantList(performance->stageStatistics());
+    metrics["bottleneck"] = performance->bottleneck();
+    m_performance << QJsonDocument(metrics).toJson(QJsonDocument::Compact) << "\n";
+    m_performance.flush();
+}
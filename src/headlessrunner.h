@@ -0,0 +1,37 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+#include <QFile>
+#include <QString>
+#include <QTextStream>
+
+// Runs a script through LAMMPSController and the full Atoms/modifier/Data1D pipeline on the
+// calling thread, without a window or a QML thread. Frames are taken every frameInterval
+// timesteps, so the output only depends on the script and the options.
+class HeadlessRunner
+{
+public:
+    HeadlessRunner();
+    ~HeadlessRunner();
+    QString scriptFilePath;
+    QString outputDirectory = "atomify_headless";
+    int frameInterval = 100; // Timesteps between processed frames
+    int reportInterval = 10; // Frames between writing plot series and performance metrics
+    bool writeFrames = true;
+
+    int run(); // Returns the process exit code
+    void processFrame(class LAMMPSController *lammpsController);
+
+private:
+    class AtomifySimulator *m_simulator = nullptr;
+    QFile m_framesFile;
+    QFile m_performanceFile;
+    QTextStream m_frames;
+    QTextStream m_performance;
+    long m_frameCount = 0;
+    void createModifiers();
+    void writeFrame(class System *system);
+    void writePlotSeries(class System *system);
+    void writePerformance(class System *system);
+};
+
+#endif // HEADLESSRUNNER_H
@@ -27,14 +27,20 @@
 #include <iostream>
 #include <sstream>
 #include <functional>
+#include <algorithm>
+#include <cmath>
 #include <QFileInfo>
 #include "LammpsWrappers/computes.h"
+#include "LammpsWrappers/variables.h"
+#include "LammpsWrappers/simulatorcontrols/cpcompute.h"
 #include "parser/scriptcommand.h"
 #include "mysimulator.h"
 #include "LammpsWrappers/simulatorcontrols/simulatorcontrol.h"
 #include "LammpsWrappers/system.h"
 #include "LammpsWrappers/atoms.h"
+#include "LammpsWrappers/trajectoryreader.h"
 #include "performance.h"
+#include "headlessrunner.h"
 #include <QDir>
 
 using namespace std;
@@ -63,6 +69,55 @@ void synchronizeLAMMPS_callback(void *caller, int mode)
     controller->synchronizeLAMMPS(mode);
 }
 
+bool LAMMPSController::needsTallyNextTimestep()
+{
+    // Frames sample scalar values and the per atom energies and stresses of plotted or hovered
+    // controls. The decision is kept for the next timestep even if simulationSpeed changes, so
+    // a frame is never shown on a timestep that wasn't tallied.
+    m_frameDecisionTimestep = m_lammps->update->ntimestep + 1;
+    m_nextTimestepIsFrame = m_frameDecisionTimestep - m_lastSynchronizationTimestep >= simulationSpeed;
+
+    if(tallyEveryTimestep) return true;
+    return m_nextTimestepIsFrame || m_controlsNeedTally;
+}
+
+void LAMMPSController::updateTallyRequirements()
+{
+    m_controlsNeedTally = false;
+    if(!m_lammps || !system) return;
+
+    // Any variable can use energies or pressures through thermo keywords or computes
+    for(SimulatorControl *control : system->variables()->simulatorControls()) {
+        if(control->sampledEveryTimestep()) m_controlsNeedTally = true;
+    }
+
+    for(SimulatorControl *control : system->computes()->simulatorControls()) {
+        if(!control->sampledEveryTimestep()) continue;
+        // Per atom values are only sampled on frames, which are always tallied
+        Compute *compute = static_cast<CPCompute*>(control)->lammpsCompute(this);
+        if(compute && (compute->peflag || compute->pressflag)) m_controlsNeedTally = true;
+    }
+}
+
+bool LAMMPSController::energyAndVirialTallied()
+{
+    // LAMMPS only tallies energy (virial) if some compute needs it, e.g. thermo_pe (thermo_press)
+    Modify *modify = m_lammps->modify;
+    if(m_computeGeneration.update(m_lammps, modify->compute_generation)) {
+        m_hasEnergyCompute = false;
+        m_hasVirialCompute = false;
+        for(int i=0; i<modify->ncompute; i++) {
+            if(modify->compute[i]->peflag) m_hasEnergyCompute = true;
+            if(modify->compute[i]->pressflag) m_hasVirialCompute = true;
+        }
+    }
+
+    Update *update = m_lammps->update;
+    if(m_hasEnergyCompute && update->eflag_global != update->ntimestep) return false;
+    if(m_hasVirialCompute && update->vflag_global != update->ntimestep) return false;
+    return true;
+}
+
 void LAMMPSController::synchronizeLAMMPS(int mode)
 {
     if(mode != LAMMPS_NS::FixConst::END_OF_STEP && mode != LAMMPS_NS::FixConst::MIN_POST_FORCE) return;
@@ -71,18 +126,106 @@ void LAMMPSController::synchronizeLAMMPS(int mode)
         exit(1);
     }
 
+    // Only every simulationSpeed timesteps is shown. The other timesteps only sample time series.
+    const bigint ntimestep = m_lammps->update->ntimestep;
+    if(ntimestep == m_frameDecisionTimestep) m_synchronizingFrame = m_nextTimestepIsFrame;
+    else m_synchronizingFrame = ntimestep - m_lastSynchronizationTimestep >= simulationSpeed;
     system->synchronize(this);
     m_synchronizationCount++;
 
-    if(m_lammps->update->ntimestep - m_lastSynchronizationTimestep < simulationSpeed) return;
-    m_lastSynchronizationTimestep = m_lammps->update->ntimestep;
+    // The time since the previous step, minus the frame produced in it, is the cost of one timestep
+    const qint64 stepStart = m_timer.nsecsElapsed();
+    if(m_lastStepStart >= 0) {
+        double timePerTimestep = 1e-9*(stepStart - m_lastStepStart - m_lastFrameDuration);
+        if(m_timePerTimestep > 0) {
+            // Clamp outliers like the setup of a new run command
+            timePerTimestep = std::min(timePerTimestep, 4*m_timePerTimestep);
+            m_timePerTimestep = 0.9*m_timePerTimestep + 0.1*timePerTimestep; // low pass filter
+        } else {
+            m_timePerTimestep = timePerTimestep;
+        }
+    }
+    m_lastStepStart = stepStart;
+    m_lastFrameDuration = 0;
+
+    if(m_synchronizingFrame) {
+        m_lastSynchronizationTimestep = m_lammps->update->ntimestep;
+        synchronizeFrame();
+        m_lastFrameDuration = m_timer.nsecsElapsed() - stepStart;
+        if(!synchronizeEveryFrame) {
+            // Waiting while paused says nothing about what a frame costs
+            double timePerFrame = 1e-9*m_lastFrameDuration;
+            m_timePerFrame = m_timePerFrame > 0 ? 0.9*m_timePerFrame + 0.1*timePerFrame : timePerFrame;
+        }
+        // Retuned once per frame, not per timestep, so the stride can't compound within a frame
+        if(adaptiveSimulationSpeed) updateAdaptiveSimulationSpeed();
+    }
+
+    // FixAtomify requests the tally for the next timestep right after this callback
+    FixAtomify *fix = fixAtomify();
+    if(fix) fix->tally_next_step = needsTallyNextTimestep();
+}
+
+FixAtomify *LAMMPSController::fixAtomify()
+{
+    if(m_fixAtomifyGeneration.update(m_lammps, m_lammps->modify->fix_generation)) {
+        m_fixAtomify = dynamic_cast<FixAtomify*>(findFixByIdentifier(QString("atomify")));
+    }
+    return m_fixAtomify;
+}
 
+void LAMMPSController::updateAdaptiveSimulationSpeed()
+{
+    // Largest number of timesteps per frame that still reaches the target frame rate, i.e.
+    // simulationSpeed*timePerTimestep + timePerFrame <= 1/targetFrameRate. If frames alone are
+    // too expensive for the target we render every timestep.
+    if(m_timePerTimestep <= 0 || targetFrameRate <= 0) return;
+    double budget = 1.0/targetFrameRate - m_timePerFrame;
+    double target = std::floor(budget / m_timePerTimestep);
+    target = std::max(1.0, std::min(target, double(maximumSimulationSpeed)));
+
+    // Damped: move a quarter of the way to the target per frame and by at most 25 %, so noisy
+    // timings make the stride converge instead of oscillating. The unrounded value is kept
+    // so small strides can still grow. A manual change of simulationSpeed restarts from there.
+    if(m_adaptiveSimulationSpeed <= 0 || std::lround(m_adaptiveSimulationSpeed) != long(simulationSpeed)) {
+        m_adaptiveSimulationSpeed = simulationSpeed;
+    }
+    double speed = m_adaptiveSimulationSpeed + 0.25*(target - m_adaptiveSimulationSpeed);
+    speed = std::max(speed, 0.8*m_adaptiveSimulationSpeed);
+    speed = std::min(speed, 1.25*m_adaptiveSimulationSpeed);
+    speed = std::max(1.0, std::min(speed, double(maximumSimulationSpeed)));
+    m_adaptiveSimulationSpeed = speed;
+    simulationSpeed = static_cast<unsigned long>(std::lround(speed));
+}
+
+void LAMMPSController::synchronizeFrame()
+{
+    // The frame is published to the render thread which picks it up without us waiting for it
+    if(!m_playingTrajectory) system->synchronizeFrame(this);
     system->atoms()->processModifiers(system);
     system->atoms()->createRenderererData(this);
-    worker->m_reprocessRenderingData = false;
 
     system->updateThreadOnDataObjects(qmlThread);
 
+    if(headlessRunner) {
+        // No QML thread to wait for, the frame is consumed right here
+        headlessRunner->processFrame(this);
+        return;
+    }
+    worker->m_reprocessRenderingData = false;
+
+    if(QThread::currentThread()->isInterruptionRequested()) {
+        // Happens if main thread wants to exit application
+        throw Cancelled();
+    }
+
+    // QML objects (plots, lists of computes etc) and state changes (pause, reset) still need
+    // LAMMPS to hold still while the QML thread synchronizes, but not on every rendered frame.
+    bool qmlSynchronizationDue = !m_qmlSynchronizationTimer.isValid() || m_qmlSynchronizationTimer.elapsed() >= qmlSynchronizationInterval;
+    if(!qmlSynchronizationDue && !synchronizeEveryFrame) return;
+    m_qmlSynchronizationTimer.restart();
+
+    ProfilerScope profilerScope(system->performance()->profiler(), "LAMMPSController::waitForQML");
     worker->setNeedsSynchronization(true);
     while(worker->needsSynchronization()) {
         if(QThread::currentThread()->isInterruptionRequested()) {
@@ -91,19 +234,20 @@ void LAMMPSController::synchronizeLAMMPS(int mode)
         }
 
         if(worker->m_reprocessRenderingData) {
-            system->atoms()->processModifiers(system);
-            if(worker->m_workerRenderingMutex.tryLock()) {
-                system->atoms()->createRenderererData(this);
-                worker->m_reprocessRenderingData = false;
-                worker->m_workerRenderingMutex.unlock();
+            worker->m_reprocessRenderingData = false;
+            const int playbackFrame = system->trajectoryReader()->playbackFrame();
+            if(m_playingTrajectory && playbackFrame >= 0 && playbackFrame != m_trajectoryFrame) {
+                showTrajectoryFrame(playbackFrame);
+            } else {
+                system->atoms()->replayRecordedFrame();
             }
+            system->atoms()->processModifiers(system);
+            system->atoms()->createRenderererData(this);
         }
 
-        if(m_paused) {
-            QThread::currentThread()->msleep(100); // Check fairly slow
-        } else {
-            QThread::currentThread()->msleep(1); // As fast as possible
-        }
+        // Woken as soon as the QML thread synchronized. While paused it keeps synchronizing
+        // once per rendered frame and asks for the reprocessing above when the picture changed.
+        worker->waitForSynchronization(100);
     }
 
     if(worker->m_cancelPending) {
@@ -116,12 +260,25 @@ LAMMPS *LAMMPSController::lammps() const
     return m_lammps;
 }
 
+bool LAMMPSController::synchronizingFrame() const
+{
+    return m_synchronizingFrame;
+}
+
+long LAMMPSController::forcedTallies()
+{
+    FixAtomify *fix = m_lammps ? fixAtomify() : nullptr;
+    return fix ? fix->forced_tallies : 0;
+}
+
 void LAMMPSController::stop()
 {
     if(m_lammps) {
         m_lammps->screen = NULL; // Avoids closing of the output parser.
         lammps_close((void*)m_lammps);
         m_lammps = nullptr;
+        m_fixAtomify = nullptr;
+        m_fixAtomifyGeneration.invalidate();
     }
     doContinue = false;
     finished = false;
@@ -129,6 +286,18 @@ void LAMMPSController::stop()
     crashed = false;
     m_synchronizationCount = 0;
     m_lastSynchronizationTimestep = -1000;
+    m_synchronizingFrame = false;
+    m_lastStepStart = -1;
+    m_lastFrameDuration = 0;
+    m_timePerTimestep = 0;
+    m_timePerFrame = 0;
+    m_adaptiveSimulationSpeed = 0;
+    m_qmlSynchronizationTimer.invalidate();
+    m_playingTrajectory = false;
+    m_trajectoryFrame = -1;
+    m_controlsNeedTally = false;
+    m_frameDecisionTimestep = -1;
+    m_computeGeneration.invalidate();
 }
 
 int LAMMPSController::findVariableIndex(QString identifier) {
@@ -255,6 +424,10 @@ void LAMMPSController::start() {
     }
     FixAtomify *fix = dynamic_cast<FixAtomify*>(originalFix);
     fix->set_callback(&synchronizeLAMMPS_callback, this);
+    fix->tally_policy = FixAtomify::TALLY_REQUESTED;
+    m_fixAtomify = fix;
+    m_fixAtomifyGeneration.update(m_lammps, m_lammps->modify->fix_generation);
+    m_playingTrajectory = TrajectoryReader::isTrajectoryFile(scriptFilePath);
     changeWorkingDirectoryToScriptLocation();
 }
 
@@ -265,6 +438,15 @@ bool LAMMPSController::run()
     if(finished || didCancel || crashed) return false;
 
     try {
+        if(m_playingTrajectory) {
+            if(playTrajectory()) {
+                finished = true;
+            } else {
+                crashed = true;
+            }
+            return true;
+        }
+
         if(doContinue) {
             QString command = "run 1000000000";
 
@@ -297,3 +479,52 @@ bool LAMMPSController::run()
     }
     return true;
 }
+
+bool LAMMPSController::showTrajectoryFrame(int frame)
+{
+    std::shared_ptr<const TrajectoryFrame> trajectoryFrame = system->trajectoryReader()->read(frame);
+    if(!trajectoryFrame) return false;
+    system->synchronizeTrajectoryFrame(*trajectoryFrame);
+    m_trajectoryFrame = frame;
+    return true;
+}
+
+bool LAMMPSController::playTrajectory()
+{
+    // Shows the frames of scriptFilePath, simulationSpeed frames apart, at most targetFrameRate
+    // frames per second. Continuing after the last frame starts from the beginning.
+    TrajectoryReader *reader = system->trajectoryReader();
+    if(!scriptFilePath.isEmpty()) {
+        if(!reader->open(scriptFilePath)) {
+            errorMessage = reader->error();
+            return false;
+        }
+        scriptFilePath = "";
+    }
+
+    QElapsedTimer frameTimer;
+    int frame = 0;
+    while(frame < reader->indexedFrames() || !reader->indexingFinished()) {
+        if(frame >= reader->indexedFrames()) {
+            // Ahead of the indexer. Keep showing the current frame so QML can still pause or reset.
+            QThread::currentThread()->msleep(10);
+            synchronizeFrame();
+            continue;
+        }
+
+        if(targetFrameRate > 0 && frameTimer.isValid()) {
+            const qint64 frameDuration = qint64(1e9/targetFrameRate);
+            const qint64 remaining = frameDuration - frameTimer.nsecsElapsed();
+            if(remaining > 0) QThread::currentThread()->usleep(remaining/1000);
+        }
+        frameTimer.restart();
+
+        if(!showTrajectoryFrame(frame)) {
+            errorMessage = QString("Could not read frame %1 of %2").arg(frame).arg(reader->fileName());
+            return false;
+        }
+        synchronizeFrame();
+        frame = m_trajectoryFrame + std::max(1ul, simulationSpeed);
+    }
+    return true;
+}
@@ -12,11 +12,13 @@
 #include <variable.h>
 #include <error.h>
 #include "parser/scriptcommand.h"
+#include "LammpsWrappers/lammpsgeneration.h"
 #include <QThread>
 #include <lmptype.h>
 #include <qelapsedtimer.h>
 
 void synchronizeLAMMPS_callback(void *caller, int mode);
+namespace LAMMPS_NS { class FixAtomify; }
 
 class Cancelled : public std::exception { };
 
@@ -25,13 +27,41 @@ class LAMMPSController
 private:
     LAMMPS_NS::LAMMPS *m_lammps = nullptr;
     long m_lastSynchronizationTimestep = 0;
+    bool m_synchronizingFrame = false;
+    LAMMPS_NS::FixAtomify *m_fixAtomify = nullptr;
+    LammpsGeneration m_fixAtomifyGeneration; // A clear command replaces the fix
     void changeWorkingDirectoryToScriptLocation();
     QElapsedTimer m_timer;
+    QElapsedTimer m_qmlSynchronizationTimer;
     unsigned long m_synchronizationCount = 0;
-    double m_timePerTimestep = 0;
+    qint64 m_lastStepStart = -1;
+    qint64 m_lastFrameDuration = 0;
+    double m_timePerTimestep = 0; // Seconds, low pass filtered
+    double m_timePerFrame = 0; // Seconds spent producing a frame and waiting for QML
+    double m_adaptiveSimulationSpeed = 0; // Damped, unrounded simulationSpeed in adaptive mode
+    bool m_playingTrajectory = false; // scriptFilePath is a dump, XYZ or DCD file, LAMMPS is idle
+    int m_trajectoryFrame = -1;
+    bool m_controlsNeedTally = false; // An open plot samples energies or pressures every timestep
+    long m_frameDecisionTimestep = -1; // Timestep m_nextTimestepIsFrame was decided for
+    bool m_nextTimestepIsFrame = false;
+    bool m_hasEnergyCompute = false;
+    bool m_hasVirialCompute = false;
+    LammpsGeneration m_computeGeneration;
+    void synchronizeFrame();
+    void updateAdaptiveSimulationSpeed();
+    bool needsTallyNextTimestep();
+    LAMMPS_NS::FixAtomify *fixAtomify();
+    bool playTrajectory();
+    bool showTrajectoryFrame(int frame);
 public:
     class System *system = nullptr;
     unsigned long simulationSpeed = 1;
+    bool adaptiveSimulationSpeed = false; // Choose simulationSpeed to reach targetFrameRate
+    double targetFrameRate = 30;
+    static const unsigned long maximumSimulationSpeed = 10000;
+    int qmlSynchronizationInterval = 50; // ms between each time LAMMPS waits for the QML thread
+    bool synchronizeEveryFrame = false; // e.g. when paused, so we stop on the very next frame
+    bool tallyEveryTimestep = false; // Otherwise energy and virial are only tallied on timesteps we sample
     char **argv;
     int nargs = 0;
     bool m_paused = false;
@@ -39,6 +69,7 @@ public:
     LAMMPSController();
     ~LAMMPSController();
     class MyWorker *worker = nullptr;
+    class HeadlessRunner *headlessRunner = nullptr; // Set instead of worker when running without a window
     // Getters/setters
     QString scriptFilePath;
     QMap<QString, class SimulatorControl*> simulatorControls;
@@ -48,6 +79,10 @@ public:
     bool doContinue = false;
     QString errorMessage;
     LAMMPS_NS::LAMMPS *lammps() const;
+    bool synchronizingFrame() const; // Whether the current timestep will be shown
+    long forcedTallies(); // Timesteps FixAtomify requested energy/virial tallies on
+    bool energyAndVirialTallied(); // Whether energies and pressures can be evaluated this timestep
+    void updateTallyRequirements(); // Call when controls or their plots can have changed
     bool run();
     void stop();
     void start();
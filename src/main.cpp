@@ -12,6 +12,13 @@
 #include <input.h>
 #include <exceptions.h>
 #include "vendor.h"
+#include "headlessrunner.h"
+#include "dataproviders/peratomkernels.h"
+#include "LammpsWrappers/atomdata.h"
+#include "LammpsWrappers/atomculler.h"
+#include "LammpsWrappers/depthsorter.h"
+#include "LammpsWrappers/trajectoryrecorder.h"
+#include "LammpsWrappers/trajectoryreader.h"
 #ifdef Q_OS_LINUX
 #include <locale>
 #endif
@@ -42,6 +49,45 @@ int regularLAMMPS (int argc, char **argv)
     return 0;
 }
 
+int headlessAtomify(int argc, char **argv)
+{
+    // atomify --headless -in script.in [-o outputdir] [--frame-interval N] [--report-interval N] [--no-frames]
+    QCoreApplication app(argc, argv);
+    app.setOrganizationName("Ovilab");
+    app.setOrganizationDomain("ovilab");
+    app.setApplicationName("Atomify");
+#ifdef Q_OS_LINUX
+    setlocale(LC_ALL, "C");
+    setlocale(LC_NUMERIC, "C");
+#endif
+
+    HeadlessRunner runner;
+    for(int i=2; i<argc; i++) {
+        bool hasValue = i+1 < argc;
+        if(strcmp(argv[i], "-in") == 0 && hasValue) {
+            runner.scriptFilePath = QString::fromUtf8(argv[++i]);
+        } else if(strcmp(argv[i], "-o") == 0 && hasValue) {
+            runner.outputDirectory = QString::fromUtf8(argv[++i]);
+        } else if(strcmp(argv[i], "--frame-interval") == 0 && hasValue) {
+            runner.frameInterval = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--report-interval") == 0 && hasValue) {
+            runner.reportInterval = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--no-frames") == 0) {
+            runner.writeFrames = false;
+        } else {
+            qWarning() << "Unknown or incomplete headless option" << argv[i];
+            return 1;
+        }
+    }
+
+    if(runner.scriptFilePath.isEmpty()) {
+        qWarning() << "Headless mode needs a script, use --headless -in script.in";
+        return 1;
+    }
+
+    return runner.run();
+}
+
 void copyFiles(QDirIterator &iterator, QDir &dataDir) {
     QDir rootQrcFolder(":/");
     while(iterator.hasNext()) {
@@ -107,6 +153,22 @@ int main(int argc, char *argv[])
         } else if(strcmp(argv[1], "--clearcache")==0) {
             // We need to create Qt app for this, but now we know that the user does not
             // want to run a regular script.
+        } else if(strcmp(argv[1], "--headless")==0) {
+            return headlessAtomify(argc, argv);
+        } else if(strcmp(argv[1], "--benchmark")==0) {
+            // atomify --benchmark [numberOfAtoms]
+            int numberOfAtoms = argc > 2 ? atoi(argv[2]) : 1000000;
+            if(numberOfAtoms <= 0) {
+                printf("Usage: atomify --benchmark [numberOfAtoms]\n");
+                return 1;
+            }
+            PerAtomKernels::benchmark(numberOfAtoms);
+            AtomData::benchmark(numberOfAtoms);
+            AtomCuller::benchmark(numberOfAtoms);
+            DepthSorter::benchmark(numberOfAtoms);
+            TrajectoryRecorder::benchmark(numberOfAtoms);
+            TrajectoryReader::benchmark(numberOfAtoms);
+            return 0;
         } else if(strcmp(argv[1], "--version")==0) {
             printf(ATOMIFYVERSION);
             printf("\n");
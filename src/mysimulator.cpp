@@ -31,6 +31,7 @@
 #include "LammpsWrappers/computes.h"
 #include "LammpsWrappers/fixes.h"
 #include "LammpsWrappers/bonds.h"
+#include "LammpsWrappers/trajectoryreader.h"
 using namespace std;
 
 MyWorker::MyWorker() {
@@ -42,6 +43,7 @@ MyWorker::MyWorker() {
 void MyWorker::setNeedsSynchronization(bool value)
 {
     m_needsSynchronization = value;
+    if(value) requestStep(); // Don't wait for the next frame to be swapped
 }
 
 bool MyWorker::needsSynchronization()
@@ -112,6 +114,12 @@ QString AtomifySimulator::getUuid()
     return m_settings.value("machine/uuid").toString();
 }
 
+bool AtomifySimulator::isTrajectoryFile(QString fileName)
+{
+    fileName.replace("file://", "");
+    return TrajectoryReader::isTrajectoryFile(fileName);
+}
+
 System *AtomifySimulator::system() const
 {
     return m_system;
@@ -137,7 +145,11 @@ void MyWorker::synchronizeSimulator(Simulator *simulator)
     QElapsedTimer t;
     t.start();
     AtomifySimulator *atomifySimulator = qobject_cast<AtomifySimulator*>(simulator);
-    m_lammpsController.simulationSpeed = atomifySimulator->simulationSpeed();
+    m_lammpsController.adaptiveSimulationSpeed = atomifySimulator->adaptiveSimulationSpeed();
+    m_lammpsController.targetFrameRate = atomifySimulator->targetFrameRate();
+    m_lammpsController.tallyEveryTimestep = atomifySimulator->tallyEveryTimestep();
+    if(!m_lammpsController.adaptiveSimulationSpeed) m_lammpsController.simulationSpeed = atomifySimulator->simulationSpeed();
+    atomifySimulator->setEffectiveSimulationSpeed(m_lammpsController.simulationSpeed);
     m_lammpsController.qmlThread = QThread::currentThread();
     // m_lammpsController.m_paused = atomifySimulator->states()->paused()->active(); // commented out since stepOnce doesn't work
     m_stepOnce = atomifySimulator->stepOnce();
@@ -147,12 +159,14 @@ void MyWorker::synchronizeSimulator(Simulator *simulator)
     States &states = *atomifySimulator->states();
     // Sync properties from lammps controller and back
     m_lammpsController.system = atomifySimulator->system();
+    m_lammpsController.synchronizeEveryFrame = states.paused()->active();
     if(states.paused()->active() && !m_stepOnce) {
-        if(m_workerRenderingMutex.tryLock()) {
-            atomifySimulator->system()->atoms()->synchronizeRenderer();
-            m_workerRenderingMutex.unlock();
-            m_reprocessRenderingData = true;
-        }
+        // This runs once per rendered frame, only process the atoms again when the picture changes
+        System *system = atomifySimulator->system();
+        bool cameraMoved = system->synchronizeCamera();
+        bool renderingStateChanged = system->atoms()->renderingStateChanged(system);
+        if(cameraMoved || renderingStateChanged) m_reprocessRenderingData = true;
+        system->atoms()->synchronizeRenderer();
         return;
     }
     m_stepOnce = false;
@@ -215,15 +229,24 @@ void MyWorker::synchronizeSimulator(Simulator *simulator)
 
         // Don't move camera if we rerun a simulation
         bool moveCamera = atomifySimulator->scriptFilePath() != atomifySimulator->lastScript();
-        atomifySimulator->parser().parseFile(atomifySimulator->scriptFilePath(), moveCamera);
+        if(!TrajectoryReader::isTrajectoryFile(atomifySimulator->scriptFilePath())) {
+            // Trajectories can be many GB and have no Atomify commands to parse
+            atomifySimulator->parser().parseFile(atomifySimulator->scriptFilePath(), moveCamera);
+        }
         atomifySimulator->setLastScript(atomifySimulator->scriptFilePath());
         m_lammpsController.start();
         return;
     }
 
     if(!states.crashed()->active()) {
-        atomifySimulator->system()->synchronizeQML(&m_lammpsController);
-        atomifySimulator->system()->atoms()->synchronizeRenderer();
+        System *system = atomifySimulator->system();
+        system->synchronizeQML(&m_lammpsController);
+        if(m_lammpsController.finished && m_lammpsController.lammps() && system->cameraMoved()) {
+            // LAMMPS is idle and won't produce another frame, cull the last one for the new view here
+            system->atoms()->processModifiers(system);
+            system->atoms()->createRenderererData(&m_lammpsController);
+        }
+        system->atoms()->synchronizeRenderer();
     }
 
     if(states.parsing()->active()) {
@@ -235,6 +258,13 @@ void MyWorker::synchronizeSimulator(Simulator *simulator)
     m_needsSynchronization = false;
 }
 
+void MyWorker::synchronizeRenderer(Simulator *simulator)
+{
+    AtomifySimulator *atomifySimulator = qobject_cast<AtomifySimulator*>(simulator);
+    ProfilerScope profilerScope(atomifySimulator->system()->performance()->profiler(), "Atoms::synchronizeRenderer");
+    atomifySimulator->system()->atoms()->synchronizeRenderer();
+}
+
 void MyWorker::work()
 {
     m_workCount += 1;
@@ -447,3 +477,59 @@ void AtomifySimulator::requestRightBarFooterText()
 
     mgr->post(request, jsonString);
 }
+
+bool AtomifySimulator::adaptiveSimulationSpeed() const
+{
+    return m_adaptiveSimulationSpeed;
+}
+
+double AtomifySimulator::targetFrameRate() const
+{
+    return m_targetFrameRate;
+}
+
+int AtomifySimulator::effectiveSimulationSpeed() const
+{
+    return m_effectiveSimulationSpeed;
+}
+
+bool AtomifySimulator::tallyEveryTimestep() const
+{
+    return m_tallyEveryTimestep;
+}
+
+void AtomifySimulator::setAdaptiveSimulationSpeed(bool adaptiveSimulationSpeed)
+{
+    if (m_adaptiveSimulationSpeed == adaptiveSimulationSpeed)
+        return;
+
+    m_adaptiveSimulationSpeed = adaptiveSimulationSpeed;
+    emit adaptiveSimulationSpeedChanged(m_adaptiveSimulationSpeed);
+}
+
+void AtomifySimulator::setTargetFrameRate(double targetFrameRate)
+{
+    if (m_targetFrameRate == targetFrameRate)
+        return;
+
+    m_targetFrameRate = targetFrameRate;
+    emit targetFrameRateChanged(m_targetFrameRate);
+}
+
+void AtomifySimulator::setEffectiveSimulationSpeed(int effectiveSimulationSpeed)
+{
+    if (m_effectiveSimulationSpeed == effectiveSimulationSpeed)
+        return;
+
+    m_effectiveSimulationSpeed = effectiveSimulationSpeed;
+    emit effectiveSimulationSpeedChanged(m_effectiveSimulationSpeed);
+}
+
+void AtomifySimulator::setTallyEveryTimestep(bool tallyEveryTimestep)
+{
+    if (m_tallyEveryTimestep == tallyEveryTimestep)
+        return;
+
+    m_tallyEveryTimestep = tallyEveryTimestep;
+    emit tallyEveryTimestepChanged(m_tallyEveryTimestep);
+}
@@ -22,7 +22,6 @@ public:
     bool m_cancelPending = false;
     bool m_reprocessRenderingData = false;
     bool m_stepOnce = false;
-    QMutex m_workerRenderingMutex; // horrible name
 private:
     QElapsedTimer m_elapsed;
     QElapsedTimer m_sinceStart;
@@ -30,6 +29,7 @@ private:
 
     // SimulatorWorker interface
     virtual void synchronizeSimulator(Simulator *simulator) override;
+    virtual void synchronizeRenderer(Simulator *simulator) override;
     virtual void work() override;
 };
 
@@ -47,6 +47,10 @@ class AtomifySimulator : public Simulator
     Q_PROPERTY(UsageStatistics* usageStatistics READ usageStatistics WRITE setUsageStatistics NOTIFY usageStatisticsChanged)
     Q_PROPERTY(QString rightBarFooterText READ rightBarFooterText WRITE setRightBarFooterText NOTIFY rightBarFooterTextChanged)
     Q_PROPERTY(bool stepOnce READ stepOnce WRITE setStepOnce NOTIFY stepOnceChanged)
+    Q_PROPERTY(bool adaptiveSimulationSpeed READ adaptiveSimulationSpeed WRITE setAdaptiveSimulationSpeed NOTIFY adaptiveSimulationSpeedChanged)
+    Q_PROPERTY(double targetFrameRate READ targetFrameRate WRITE setTargetFrameRate NOTIFY targetFrameRateChanged)
+    Q_PROPERTY(int effectiveSimulationSpeed READ effectiveSimulationSpeed WRITE setEffectiveSimulationSpeed NOTIFY effectiveSimulationSpeedChanged)
+    Q_PROPERTY(bool tallyEveryTimestep READ tallyEveryTimestep WRITE setTallyEveryTimestep NOTIFY tallyEveryTimestepChanged)
 public:
     int syncCount = 0;
     AtomifySimulator();
@@ -57,6 +61,7 @@ public:
     Q_INVOKABLE void increaseSimulationSpeed();
     Q_INVOKABLE void decreaseSimulationSpeed();
     Q_INVOKABLE QString getUuid();
+    Q_INVOKABLE bool isTrajectoryFile(QString fileName);
     class System* system() const;
     class States* states() const;
     QString scriptFilePath() const;
@@ -72,6 +77,10 @@ public:
     class UsageStatistics* usageStatistics() const;
     QString rightBarFooterText() const;
     bool stepOnce() const;
+    bool adaptiveSimulationSpeed() const;
+    double targetFrameRate() const;
+    int effectiveSimulationSpeed() const;
+    bool tallyEveryTimestep() const;
 
 public slots:
     void setSimulationSpeed(int arg);
@@ -86,6 +95,10 @@ public slots:
     void setRightBarFooterText(QString rightBarFooterText);
     void onfinish(QNetworkReply *reply);
     void setStepOnce(bool stepOnce);
+    void setAdaptiveSimulationSpeed(bool adaptiveSimulationSpeed);
+    void setTargetFrameRate(double targetFrameRate);
+    void setEffectiveSimulationSpeed(int effectiveSimulationSpeed);
+    void setTallyEveryTimestep(bool tallyEveryTimestep);
 
 signals:
     void simulationSpeedChanged(int arg);
@@ -114,6 +127,10 @@ signals:
     void usageStatisticsChanged(class UsageStatistics* usageStatistics);
     void rightBarFooterTextChanged(QString rightBarFooterText);
     void stepOnceChanged(bool stepOnce);
+    void adaptiveSimulationSpeedChanged(bool adaptiveSimulationSpeed);
+    void targetFrameRateChanged(double targetFrameRate);
+    void effectiveSimulationSpeedChanged(int effectiveSimulationSpeed);
+    void tallyEveryTimestepChanged(bool tallyEveryTimestep);
 
 protected:
     virtual MyWorker *createWorker() override;
@@ -137,6 +154,10 @@ private:
     QString m_rightBarFooterText;
     void requestRightBarFooterText();
     bool m_stepOnce = false;
+    bool m_adaptiveSimulationSpeed = false;
+    double m_targetFrameRate = 30;
+    int m_effectiveSimulationSpeed = 1;
+    bool m_tallyEveryTimestep = false;
 };
 
 #endif // MYSIMULATOR_H
@@ -6,6 +6,9 @@
 #include <update.h>
 #include <force.h>
 #include <modify.h>
+#include <timer.h>
+#include <cmath>
+#include <QMap>
 #include "LammpsWrappers/system.h"
 #include "LammpsWrappers/atoms.h"
 
@@ -21,10 +24,24 @@ void Performance::reset()
     setMemoryAtomify(0);
     setMemoryLAMMPS(0);
     setTimestepsPerSecond(0);
+    setDroppedFrames(0);
+    setForcedTallies(0);
+    setSynchronizationNanosecondsPerAtom(0);
+    setModifierTimings(QVariantMap());
+    setStageStatistics(QVariantList());
+    setBottleneck("");
+    m_lammpsTimers.clear();
+    m_profiler.clear();
 }
 
 void Performance::synchronize(LAMMPSController *controller)
 {
+    recordLAMMPSTimers(controller);
+}
+
+void Performance::synchronizeFrame(LAMMPSController *controller)
+{
+    // Memory usage walks all LAMMPS data structures, so not every timestep
     LAMMPS *lammps = controller->lammps();
     bigint bytes = 0;
     bytes += lammps->atom->memory_usage();
@@ -35,6 +52,108 @@ void Performance::synchronize(LAMMPSController *controller)
     bytes += lammps->modify->memory_usage();
     setMemoryLAMMPS(bytes);
     setMemoryAtomify(controller->system->atoms()->memoryUsage());
+    setForcedTallies(controller->forcedTallies());
+
+    if(!m_statisticsTimer.isValid() || m_statisticsTimer.elapsed() > 500) {
+        m_statisticsTimer.restart();
+        updateStageStatistics();
+    }
+}
+
+void Performance::recordLAMMPSTimers(LAMMPSController *controller)
+{
+    // LAMMPS accumulates wall time per category over a run. The increments since last step are
+    // recorded back to back on their own track. Note that Atomify's own synchronization runs
+    // inside a fix, so it is part of Modify.
+    static const Timer::ttype categories[] = {Timer::PAIR, Timer::BOND, Timer::KSPACE, Timer::NEIGH, Timer::COMM, Timer::MODIFY, Timer::OUTPUT};
+    static const char *names[] = {"Pair", "Bond", "Kspace", "Neigh", "Comm", "Modify", "Output"};
+    const int numCategories = sizeof(categories) / sizeof(categories[0]);
+
+    Timer *timer = controller->lammps()->timer;
+    if(!timer || !timer->has_normal()) return;
+    if(m_lammpsTimers.size() != numCategories) m_lammpsTimers.fill(0, numCategories);
+
+    qint64 durations[numCategories];
+    qint64 totalDuration = 0;
+    for(int i=0; i<numCategories; i++) {
+        double wallTime = timer->get_wall(categories[i]);
+        double delta = wallTime - m_lammpsTimers[i];
+        m_lammpsTimers[i] = wallTime;
+        durations[i] = delta > 0 ? qint64(delta*1e9) : 0; // Negative when a new run resets the timers
+        totalDuration += durations[i];
+    }
+
+    qint64 start = m_profiler.now() - totalDuration;
+    for(int i=0; i<numCategories; i++) {
+        if(durations[i] > 0) m_profiler.record(names[i], start, durations[i], "LAMMPS");
+        start += durations[i];
+    }
+}
+
+void Performance::updateStageStatistics()
+{
+    // Statistics over the last five seconds, with histograms in power of two bins from 1 us
+    const int numBins = 20;
+    const qint64 windowStart = m_profiler.now() - qint64(5e9);
+    QMap<QString, QVector<qint64>> durationsPerStage;
+    qint64 lammpsTime = 0;
+    qint64 synchronizationTime = 0;
+    qint64 renderingTime = 0;
+    QHash<const void*, bool> isLAMMPSTrack;
+    for(const Profiler::Event &event : m_profiler.events()) {
+        if(event.start < windowStart) continue;
+        QString name = QString::fromUtf8(event.name);
+        durationsPerStage[name].append(event.duration);
+        if(!isLAMMPSTrack.contains(event.track)) isLAMMPSTrack[event.track] = m_profiler.trackName(event.track) == "LAMMPS";
+
+        if(isLAMMPSTrack[event.track]) {
+            if(name != "Modify") lammpsTime += event.duration; // Modify contains our own synchronization
+        } else if(name == "Atoms::synchronizeRenderer") {
+            renderingTime += event.duration;
+        } else if(name != "LAMMPSController::waitForQML" && name != "Atoms::synchronize") {
+            synchronizationTime += event.duration; // Atoms::synchronize is nested in System::synchronize
+        }
+    }
+
+    QVariantList statistics;
+    for(auto it = durationsPerStage.constBegin(); it != durationsPerStage.constEnd(); ++it) {
+        const QVector<qint64> &durations = it.value();
+        QVariantList histogram;
+        QVector<int> counts(numBins, 0);
+        qint64 total = 0;
+        qint64 max = 0;
+        for(qint64 duration : durations) {
+            total += duration;
+            max = std::max(max, duration);
+            int bin = duration < 1000 ? 0 : int(std::log2(duration / 1000.0));
+            counts[std::min(bin, numBins-1)]++;
+        }
+        for(int count : counts) histogram.append(count);
+
+        QVariantMap stage;
+        stage["name"] = it.key();
+        stage["count"] = durations.size();
+        stage["mean"] = 1e-6*total / durations.size(); // Milliseconds
+        stage["max"] = 1e-6*max;
+        stage["histogram"] = histogram;
+        statistics.append(stage);
+    }
+    setStageStatistics(statistics);
+
+    if(lammpsTime + synchronizationTime + renderingTime == 0) setBottleneck("");
+    else if(lammpsTime >= synchronizationTime && lammpsTime >= renderingTime) setBottleneck("LAMMPS");
+    else if(synchronizationTime >= renderingTime) setBottleneck("Synchronization");
+    else setBottleneck("Rendering");
+}
+
+Profiler *Performance::profiler()
+{
+    return &m_profiler;
+}
+
+bool Performance::exportChromeTrace(QString fileName)
+{
+    return m_profiler.exportChromeTrace(fileName);
 }
 
 long Performance::memoryLAMMPS() const
@@ -57,6 +176,36 @@ int Performance::threads() const
     return m_threads;
 }
 
+long Performance::droppedFrames() const
+{
+    return m_droppedFrames;
+}
+
+long Performance::forcedTallies() const
+{
+    return m_forcedTallies;
+}
+
+double Performance::synchronizationNanosecondsPerAtom() const
+{
+    return m_synchronizationNanosecondsPerAtom;
+}
+
+QVariantMap Performance::modifierTimings() const
+{
+    return m_modifierTimings;
+}
+
+QVariantList Performance::stageStatistics() const
+{
+    return m_stageStatistics;
+}
+
+QString Performance::bottleneck() const
+{
+    return m_bottleneck;
+}
+
 void Performance::setMemoryLAMMPS(long memoryLAMMPS)
 {
     if (m_memoryLAMMPS == memoryLAMMPS)
@@ -92,3 +241,57 @@ void Performance::setThreads(int threads)
     m_threads = threads;
     emit threadsChanged(m_threads);
 }
+
+void Performance::setDroppedFrames(long droppedFrames)
+{
+    if (m_droppedFrames == droppedFrames)
+        return;
+
+    m_droppedFrames = droppedFrames;
+    emit droppedFramesChanged(m_droppedFrames);
+}
+
+void Performance::setForcedTallies(long forcedTallies)
+{
+    if (m_forcedTallies == forcedTallies)
+        return;
+
+    m_forcedTallies = forcedTallies;
+    emit forcedTalliesChanged(m_forcedTallies);
+}
+
+void Performance::setSynchronizationNanosecondsPerAtom(double synchronizationNanosecondsPerAtom)
+{
+    if (m_synchronizationNanosecondsPerAtom == synchronizationNanosecondsPerAtom)
+        return;
+
+    m_synchronizationNanosecondsPerAtom = synchronizationNanosecondsPerAtom;
+    emit synchronizationNanosecondsPerAtomChanged(m_synchronizationNanosecondsPerAtom);
+}
+
+void Performance::setModifierTimings(QVariantMap modifierTimings)
+{
+    if (m_modifierTimings == modifierTimings)
+        return;
+
+    m_modifierTimings = modifierTimings;
+    emit modifierTimingsChanged(m_modifierTimings);
+}
+
+void Performance::setStageStatistics(QVariantList stageStatistics)
+{
+    if (m_stageStatistics == stageStatistics)
+        return;
+
+    m_stageStatistics = stageStatistics;
+    emit stageStatisticsChanged(m_stageStatistics);
+}
+
+void Performance::setBottleneck(QString bottleneck)
+{
+    if (m_bottleneck == bottleneck)
+        return;
+
+    m_bottleneck = bottleneck;
+    emit bottleneckChanged(m_bottleneck);
+}
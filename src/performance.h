@@ -2,6 +2,9 @@
 #define PERFORMANCE_H
 
 #include <QObject>
+#include <QVariantMap>
+#include <QElapsedTimer>
+#include "profiler.h"
 
 class Performance : public QObject
 {
@@ -10,32 +13,70 @@ class Performance : public QObject
     Q_PROPERTY(long memoryAtomify READ memoryAtomify WRITE setMemoryAtomify NOTIFY memoryAtomifyChanged)
     Q_PROPERTY(double timestepsPerSecond READ timestepsPerSecond WRITE setTimestepsPerSecond NOTIFY timestepsPerSecondChanged)
     Q_PROPERTY(int threads READ threads WRITE setThreads NOTIFY threadsChanged)
+    Q_PROPERTY(long droppedFrames READ droppedFrames WRITE setDroppedFrames NOTIFY droppedFramesChanged)
+    Q_PROPERTY(long forcedTallies READ forcedTallies WRITE setForcedTallies NOTIFY forcedTalliesChanged)
+    Q_PROPERTY(double synchronizationNanosecondsPerAtom READ synchronizationNanosecondsPerAtom WRITE setSynchronizationNanosecondsPerAtom NOTIFY synchronizationNanosecondsPerAtomChanged)
+    Q_PROPERTY(QVariantMap modifierTimings READ modifierTimings WRITE setModifierTimings NOTIFY modifierTimingsChanged)
+    Q_PROPERTY(QVariantList stageStatistics READ stageStatistics WRITE setStageStatistics NOTIFY stageStatisticsChanged)
+    Q_PROPERTY(QString bottleneck READ bottleneck WRITE setBottleneck NOTIFY bottleneckChanged)
 public:
     explicit Performance(QObject *parent = 0);
     void reset();
-    void synchronize(class LAMMPSController *controller);
+    void synchronize(class LAMMPSController *controller); // Every timestep
+    void synchronizeFrame(class LAMMPSController *controller);
     long memoryLAMMPS() const;
     long memoryAtomify() const;
     double timestepsPerSecond() const;
     int threads() const;
+    long droppedFrames() const;
+    long forcedTallies() const;
+    double synchronizationNanosecondsPerAtom() const;
+    QVariantMap modifierTimings() const;
+    QVariantList stageStatistics() const;
+    QString bottleneck() const;
+    Profiler *profiler();
+    Q_INVOKABLE bool exportChromeTrace(QString fileName);
+    void updateStageStatistics();
 
 signals:
     void memoryLAMMPSChanged(long memoryLAMMPS);
     void memoryAtomifyChanged(long memoryAtomify);
     void timestepsPerSecondChanged(double timestepsPerSecond);
     void threadsChanged(int threads);
+    void droppedFramesChanged(long droppedFrames);
+    void forcedTalliesChanged(long forcedTallies);
+    void synchronizationNanosecondsPerAtomChanged(double synchronizationNanosecondsPerAtom);
+    void modifierTimingsChanged(QVariantMap modifierTimings);
+    void stageStatisticsChanged(QVariantList stageStatistics);
+    void bottleneckChanged(QString bottleneck);
 
 public slots:
     void setMemoryLAMMPS(long memoryLAMMPS);
     void setMemoryAtomify(long memoryAtomify);
     void setTimestepsPerSecond(double timestepsPerSecond);
     void setThreads(int threads);
+    void setDroppedFrames(long droppedFrames);
+    void setForcedTallies(long forcedTallies);
+    void setSynchronizationNanosecondsPerAtom(double synchronizationNanosecondsPerAtom);
+    void setModifierTimings(QVariantMap modifierTimings);
+    void setStageStatistics(QVariantList stageStatistics);
+    void setBottleneck(QString bottleneck);
 
 private:
     long m_memoryLAMMPS = 0;
     long m_memoryAtomify = 0;
     double m_timestepsPerSecond = 0;
     int m_threads = 1;
+    long m_droppedFrames = 0;
+    long m_forcedTallies = 0; // Timesteps where Atomify made LAMMPS tally energy and virial
+    double m_synchronizationNanosecondsPerAtom = 0;
+    QVariantMap m_modifierTimings; // Milliseconds per modifier in the last frame
+    QVariantList m_stageStatistics;
+    QString m_bottleneck;
+    Profiler m_profiler;
+    QElapsedTimer m_statisticsTimer;
+    QVector<double> m_lammpsTimers;
+    void recordLAMMPSTimers(class LAMMPSController *controller);
 };
 
 #endif // PERFORMANCE_H
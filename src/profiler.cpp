@@ -0,0 +1,111 @@
+#include "profiler.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QThread>
+
+Profiler::Profiler(int capacity)
+{
+    m_events.resize(capacity);
+    m_clock.start();
+}
+
+qint64 Profiler::now() const
+{
+    return m_clock.nsecsElapsed();
+}
+
+void Profiler::record(const char *name, qint64 start, qint64 duration, const char *track)
+{
+    const void *trackKey = track ? static_cast<const void*>(track) : static_cast<const void*>(QThread::currentThreadId());
+
+    QMutexLocker locker(&m_mutex);
+    if(!m_trackNames.contains(trackKey)) {
+        QString trackName;
+        if(track) trackName = QString::fromUtf8(track);
+        else if(QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread()) trackName = "Main";
+        else if(!QThread::currentThread()->objectName().isEmpty()) trackName = QThread::currentThread()->objectName();
+        else trackName = QString("Thread %1").arg(m_trackNames.size());
+        m_trackNames[trackKey] = trackName;
+    }
+
+    Event &event = m_events[m_next];
+    event.name = name;
+    event.track = trackKey;
+    event.start = start;
+    event.duration = duration;
+    m_next++;
+    if(m_next == m_events.size()) {
+        m_next = 0;
+        m_wrapped = true;
+    }
+}
+
+const char *Profiler::intern(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_internedNames.find(name);
+    if(it == m_internedNames.end()) it = m_internedNames.insert(name, name.toUtf8());
+    return it.value().constData();
+}
+
+QVector<Profiler::Event> Profiler::events() const
+{
+    QMutexLocker locker(&m_mutex);
+    if(!m_wrapped) return m_events.mid(0, m_next);
+    return m_events.mid(m_next) + m_events.mid(0, m_next);
+}
+
+QString Profiler::trackName(const void *track) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_trackNames.value(track);
+}
+
+void Profiler::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_next = 0;
+    m_wrapped = false;
+}
+
+bool Profiler::exportChromeTrace(QString fileName) const
+{
+    // Trace Event Format, can be opened in chrome://tracing or Perfetto
+    QVector<Event> events = this->events();
+    QHash<const void*, int> threadIds;
+    QJsonArray traceEvents;
+    for(const Event &event : events) {
+        if(!threadIds.contains(event.track)) {
+            int threadId = threadIds.size() + 1;
+            threadIds[event.track] = threadId;
+            QJsonObject metadata;
+            metadata["name"] = "thread_name";
+            metadata["ph"] = "M";
+            metadata["pid"] = 1;
+            metadata["tid"] = threadId;
+            metadata["args"] = QJsonObject({{"name", trackName(event.track)}});
+            traceEvents.append(metadata);
+        }
+
+        QJsonObject traceEvent;
+        traceEvent["name"] = QString::fromUtf8(event.name);
+        traceEvent["ph"] = "X";
+        traceEvent["pid"] = 1;
+        traceEvent["tid"] = threadIds[event.track];
+        traceEvent["ts"] = event.start*1e-3; // Microseconds
+        traceEvent["dur"] = event.duration*1e-3;
+        traceEvents.append(traceEvent);
+    }
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly)) return false;
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
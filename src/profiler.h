@@ -0,0 +1,58 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// Records timed events from any thread into a fixed size ring buffer. Feeds the stage
+// statistics in the Performance panel and the Chrome trace export.
+class Profiler
+{
+public:
+    struct Event {
+        const char *name = nullptr; // Must outlive the profiler, e.g. a string literal
+        const void *track = nullptr; // Thread handle, or a string literal for pseudo tracks
+        qint64 start = 0; // Nanoseconds since the profiler was created
+        qint64 duration = 0;
+    };
+
+    explicit Profiler(int capacity = 16384);
+    qint64 now() const;
+    void record(const char *name, qint64 start, qint64 duration, const char *track = nullptr);
+    // Copy of a name built at runtime that lives as long as the profiler
+    const char *intern(const QString &name);
+    QVector<Event> events() const; // Oldest first
+    QString trackName(const void *track) const;
+    void clear();
+    bool exportChromeTrace(QString fileName) const;
+
+private:
+    mutable QMutex m_mutex;
+    QElapsedTimer m_clock;
+    QVector<Event> m_events;
+    int m_next = 0;
+    bool m_wrapped = false;
+    QHash<const void*, QString> m_trackNames;
+    QHash<QString, QByteArray> m_internedNames;
+};
+
+// Times the enclosing scope. A null profiler makes this a no-op.
+class ProfilerScope
+{
+public:
+    ProfilerScope(Profiler *profiler, const char *name)
+        : m_profiler(profiler), m_name(name), m_start(profiler ? profiler->now() : 0) { }
+    ~ProfilerScope() {
+        if(m_profiler) m_profiler->record(m_name, m_start, m_profiler->now() - m_start);
+    }
+
+private:
+    Profiler *m_profiler;
+    const char *m_name;
+    qint64 m_start;
+};
+
+#endif // PROFILER_H
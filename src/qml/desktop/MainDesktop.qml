@@ -54,6 +54,10 @@ Rectangle {
             }
             //            visualizer.simulator.scriptFilePath = initialExampleUrl
             //            visualizer.simulator.started()
+            if(simulator.isTrajectoryFile(initialScriptUrl)) {
+                editor.editorWindow.playTrajectory(initialScriptUrl)
+                return
+            }
             editor.editorWindow.openTab(initialScriptUrl)
             editor.editorWindow.runScript()
         }
@@ -80,6 +84,10 @@ Rectangle {
                 var numUrls = drop.urls.length
                 for(var i=0; i<drop.urls.length; i++) {
                     var url = drop.urls[i]
+                    if(simulator.isTrajectoryFile(url)) {
+                        editor.editorWindow.playTrajectory(url)
+                        continue
+                    }
                     EventCenter.postEvent("mode.edit")
                     editor.editorWindow.openTab(url)
                 }
@@ -215,6 +215,160 @@ Pane {
                             }
                         }
                     }
+
+                    CheckBox {
+                        id: cullingCheckBox
+                        text: "Skip hidden atoms"
+                        checked: visualizer.simulator.system.atoms.culling
+                        focusPolicy: Qt.NoFocus
+                        hoverEnabled: true
+                        ToolTip.visible: hovered
+                        ToolTip.delay: 1000
+                        ToolTip.text: "Do not draw atoms outside the view or inside dense bulk, useful for large systems"
+                        Binding {
+                            target: visualizer.simulator.system.atoms
+                            property: "culling"
+                            value: cullingCheckBox.checked
+                        }
+                    }
+
+                    CheckBox {
+                        id: sortCheckBox
+                        text: "Draw nearest atoms first"
+                        checked: visualizer.simulator.system.atoms.sort
+                        focusPolicy: Qt.NoFocus
+                        hoverEnabled: true
+                        ToolTip.visible: hovered
+                        ToolTip.delay: 1000
+                        ToolTip.text: "Sort atoms by distance to the camera, faster rendering of large systems on some GPUs"
+                        Binding {
+                            target: visualizer.simulator.system.atoms
+                            property: "sort"
+                            value: sortCheckBox.checked
+                        }
+                    }
+
+                    Row {
+                        width: parent.width
+                        height: lodDistanceSlider.height
+                        Label {
+                            width: parent.width*0.4
+                            text: "Detail distance: "
+                        }
+                        QQC1.Slider {
+                            id: lodDistanceSlider
+                            enabled: cullingCheckBox.checked
+                            width: parent.width*0.6
+                            minimumValue: 0
+                            maximumValue: 1000
+                            stepSize: 10
+                            value: visualizer.simulator.system.atoms.lodDistance
+                            Binding {
+                                target: visualizer.simulator.system.atoms
+                                property: "lodDistance"
+                                value: lodDistanceSlider.value
+                            }
+                        }
+                    }
+                }
+            }
+
+            GroupBox {
+                id: recordingGroup
+                property TrajectoryRecorder recorder: visualizer.simulator.system.atoms.recorder
+                property bool paused: visualizer.simulator.states.paused.active
+                width: parent.width
+                title: "Recording"
+                onPausedChanged: {
+                    if(!paused) recorder.playbackFrame = -1 // Live again
+                }
+
+                Column {
+                    width: parent.width
+                    CheckBox {
+                        id: recordingCheckBox
+                        text: "Record frames"
+                        checked: recordingGroup.recorder.recording
+                        focusPolicy: Qt.NoFocus
+                        hoverEnabled: true
+                        ToolTip.visible: hovered
+                        ToolTip.delay: 1000
+                        ToolTip.text: "Keep the most recent frames so they can be replayed while paused"
+                        Binding {
+                            target: recordingGroup.recorder
+                            property: "recording"
+                            value: recordingCheckBox.checked
+                        }
+                    }
+
+                    Label {
+                        width: parent.width
+                        text: {
+                            var recorder = recordingGroup.recorder
+                            var megabytes = (recorder.memoryUsage/(1024*1024)).toFixed(0)
+                            var frame = recorder.playbackFrame < 0 ? "live" : "timestep "+recorder.timestep(recorder.playbackFrame)
+                            return recorder.numberOfFrames+" frames ("+megabytes+" MB), showing "+frame
+                        }
+                    }
+
+                    QQC1.Slider {
+                        id: playbackSlider
+                        width: parent.width
+                        enabled: recordingGroup.paused && recordingGroup.recorder.numberOfFrames > 0
+                        minimumValue: 0
+                        maximumValue: recordingGroup.recorder.numberOfFrames // The last value is live
+                        stepSize: 1
+                        value: recordingGroup.recorder.playbackFrame < 0 ? maximumValue : recordingGroup.recorder.playbackFrame
+                        onValueChanged: {
+                            if(!recordingGroup.paused) return
+                            recordingGroup.recorder.playbackFrame = value < maximumValue ? value : -1
+                        }
+                    }
+                }
+            }
+
+            GroupBox {
+                id: trajectoryGroup
+                property TrajectoryReader reader: visualizer.simulator.system.trajectoryReader
+                property bool paused: visualizer.simulator.states.paused.active
+                width: parent.width
+                title: "Trajectory"
+                visible: reader.fileName !== ""
+                onPausedChanged: {
+                    if(!paused) reader.playbackFrame = -1 // Continue from the frame shown
+                }
+
+                Column {
+                    width: parent.width
+                    Label {
+                        width: parent.width
+                        elide: Text.ElideMiddle
+                        text: trajectoryGroup.reader.fileName.replace(/^.*[\\/]/, "")
+                    }
+
+                    Label {
+                        width: parent.width
+                        text: {
+                            var reader = trajectoryGroup.reader
+                            var frames = reader.numberOfFrames+(reader.indexing ? "+" : "")+" frames"
+                            if(reader.currentFrame < 0) return frames
+                            return "Frame "+reader.currentFrame+" of "+frames+", timestep "+reader.timestep(reader.currentFrame)
+                        }
+                    }
+
+                    QQC1.Slider {
+                        id: trajectorySlider
+                        width: parent.width
+                        enabled: trajectoryGroup.paused && trajectoryGroup.reader.numberOfFrames > 1
+                        minimumValue: 0
+                        maximumValue: Math.max(0, trajectoryGroup.reader.numberOfFrames - 1)
+                        stepSize: 1
+                        value: trajectoryGroup.reader.playbackFrame < 0 ? trajectoryGroup.reader.currentFrame : trajectoryGroup.reader.playbackFrame
+                        onValueChanged: {
+                            if(!trajectoryGroup.paused) return
+                            trajectoryGroup.reader.playbackFrame = value
+                        }
+                    }
                 }
             }
 
@@ -256,12 +256,24 @@ Flickable {
                         }
                     }
                 }
+                CheckBox {
+                    id: adaptiveSpeedCheckBox
+                    text: "Adaptive speed"
+                    checked: simulator ? simulator.adaptiveSimulationSpeed : false
+                    onCheckedChanged: if(simulator !== undefined) { simulator.adaptiveSimulationSpeed = checked }
+                    hoverEnabled: true
+                    ToolTip.visible: hovered
+                    ToolTip.delay: 1000
+                    ToolTip.text: "Simulate as many timesteps as possible per frame while keeping the target frame rate"
+                }
                 ToolTipLabel {
+                    visible: !adaptiveSpeedCheckBox.checked
                     toolTipText: "1x targets 60 frames per second."
                     text: "Target speed: "+speedSlider.value.toFixed(0)+"x"
                 }
                 Slider {
                     id: speedSlider
+                    visible: !adaptiveSpeedCheckBox.checked
                     anchors {
                         left: parent.left
                         right: parent.right
@@ -273,6 +285,33 @@ Flickable {
                     value: simulator ? simulator.simulationSpeed : 1
                     onValueChanged: if(simulator !== undefined) { simulator.simulationSpeed = value }
                 }
+                Label {
+                    visible: adaptiveSpeedCheckBox.checked
+                    text: "Target frame rate: "+frameRateSlider.value.toFixed(0)+" fps ("+(simulator ? simulator.effectiveSimulationSpeed : 1)+"x)"
+                }
+                Slider {
+                    id: frameRateSlider
+                    visible: adaptiveSpeedCheckBox.checked
+                    anchors {
+                        left: parent.left
+                        right: parent.right
+                    }
+                    from: 5
+                    to: 60
+                    stepSize: 5
+                    snapMode: Slider.SnapAlways
+                    value: simulator ? simulator.targetFrameRate : 30
+                    onValueChanged: if(simulator !== undefined) { simulator.targetFrameRate = value }
+                }
+                CheckBox {
+                    text: "Tally energy every timestep"
+                    checked: simulator ? simulator.tallyEveryTimestep : false
+                    onCheckedChanged: if(simulator !== undefined) { simulator.tallyEveryTimestep = checked }
+                    hoverEnabled: true
+                    ToolTip.visible: hovered
+                    ToolTip.delay: 1000
+                    ToolTip.text: "Otherwise energy and pressure are only computed on timesteps that are shown or plotted"
+                }
             }
         }
 
@@ -390,12 +429,64 @@ Flickable {
                 Label {
                     text: "Timesteps per second: "+ system.performance.timestepsPerSecond.toFixed(1)
                 }
+                Label {
+                    text: "Dropped frames: "+ system.performance.droppedFrames
+                }
+                Label {
+                    text: "Forced energy/virial tallies: "+ system.performance.forcedTallies
+                }
+                Label {
+                    text: "Atom sync: "+ system.performance.synchronizationNanosecondsPerAtom.toFixed(1) + " ns/atom"
+                }
+                Label {
+                    property var timings: system.performance.modifierTimings
+                    text: Object.keys(timings).map(function(name) { return name + ": " + timings[name].toFixed(2) + " ms" }).join("\n")
+                }
                 Label {
                     text: "Memory usage LAMMPS: "+ (system.performance.memoryLAMMPS / 1024 / 1024).toFixed(0) +" MB"
                 }
                 Label {
                     text: "Memory usage Atomify: "+ (system.performance.memoryAtomify / 1024 / 1024).toFixed(0) +" MB"
                 }
+                Label {
+                    text: "Bottleneck: "+ (system.performance.bottleneck !== "" ? system.performance.bottleneck : "-")
+                }
+                Repeater {
+                    model: system.performance.stageStatistics
+                    Row {
+                        property var stage: modelData
+                        property real maxCount: Math.max.apply(Math, stage.histogram)
+                        spacing: 5
+                        Label {
+                            width: 220
+                            elide: Text.ElideRight
+                            text: stage.name + ": " + stage.mean.toFixed(2) + " ms (max " + stage.max.toFixed(1) + ")"
+                        }
+                        Row {
+                            height: 12
+                            anchors.verticalCenter: parent.verticalCenter
+                            Repeater {
+                                // Power of two bins from 1 us
+                                model: stage.histogram
+                                Rectangle {
+                                    anchors.bottom: parent.bottom
+                                    width: 3
+                                    height: maxCount > 0 ? 12*modelData/maxCount : 0
+                                    color: "#4fc3f7"
+                                }
+                            }
+                        }
+                    }
+                }
+                Button {
+                    text: "Export Chrome trace"
+                    onClicked: {
+                        var url = StandardPaths.writableLocation(StandardPaths.DocumentsLocation, "atomify_trace.json")
+                        if(system.performance.exportChromeTrace(StandardPaths.toLocalFile(url))) {
+                            text = "Saved to " + StandardPaths.toLocalFile(url)
+                        }
+                    }
+                }
             }
         }
 
@@ -39,8 +39,9 @@ Item {
 
     function handleVisibleChanged() {
         if(visible) {
-            if(visualizer.simulator.scriptFilePath!=="") {
-                openTab("file://"+visualizer.simulator.scriptFilePath)
+            var scriptFilePath = visualizer.simulator.scriptFilePath
+            if(scriptFilePath!=="" && !visualizer.simulator.isTrajectoryFile(scriptFilePath)) {
+                openTab("file://"+scriptFilePath)
             }
             focusCurrentEditor()
             currentEditor.refresh()
@@ -79,6 +80,25 @@ Item {
         didRun()
     }
 
+    function playTrajectory(fileUrl) {
+        // Dumps are played back instead of opened, they can be far too large for the editor
+        if(simulator.states.reset.active) return;
+
+        if(!simulator.states.idle.active) {
+            simulator.reset()
+            var play = function() {
+                simulator.didReset.disconnect(play)
+                playTrajectory(fileUrl)
+            }
+            simulator.didReset.connect(play)
+            return;
+        }
+
+        simulator.scriptFilePath = fileUrl
+        simulator.started()
+        didRun()
+    }
+
     Component.onCompleted: {
         if(openFiles==="") {
             // First time app opens, this is an empty string which doesn't parse as array
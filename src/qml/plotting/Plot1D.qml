@@ -19,7 +19,7 @@ WindowGL2 {
         for(var key in control.data1D) {
             var data = control.data1D[key]
             data.updated.connect(updateGraphs(key))
-            data.updateXYSeries(dataSeries[key])
+            data.updateXYSeries(dataSeries[key], maximumPoints())
             data.xySeries = dataSeries[key]
         }
         title = control.type+" '"+control.identifier+"'"
@@ -46,10 +46,15 @@ WindowGL2 {
     function updateGraphs(key) {
         return function() {
             if(!root.visible) return;
-            control.data1D[key].updateXYSeries(dataSeries[key])
+            control.data1D[key].updateXYSeries(dataSeries[key], maximumPoints())
         }
     }
 
+    function maximumPoints() {
+        // Minimum and maximum per pixel column is all the chart can show
+        return Math.max(100, 2*Math.round(chart.plotArea.width))
+    }
+
     function updateLimits() {
         if(!root.control) return
         var xMin = 1e9
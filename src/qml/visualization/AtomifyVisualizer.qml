@@ -1,6 +1,7 @@
 import QtQuick 2.7
 import QtQuick.Controls 1.4
 import QtQuick.Dialogs 1.2
+import QtQuick.Window 2.2
 import QtQuick.Layouts 1.1
 import Atomify 1.0
 
@@ -175,6 +176,7 @@ Scene3D {
         property var nearestPoint
         property real distanceToNearestPoint: cameraPosition.minus(nearestPoint).length()
         property var cameraPosition: camera.position
+        property matrix4x4 viewProjectionMatrix: camera.projectionMatrix.times(camera.viewMatrix)
         property Camera camera: root.mode === "flymode" ? flymodeCamera : trackballCamera
 
         onCameraPositionChanged: {
@@ -184,6 +186,13 @@ Scene3D {
             visualizer.updateNearestPoint()
         }
 
+        onViewProjectionMatrixChanged: {
+            // Used to cull atoms outside the view before they are uploaded
+            if(simulator != undefined) {
+                simulator.system.viewProjectionMatrix = viewProjectionMatrix
+            }
+        }
+
         ParallelAnimation {
             id: animateCamera
             property int duration: 1000
@@ -379,6 +388,7 @@ Scene3D {
         AtomifySimulator {
             id: simulator
             simulationSpeed: 1
+            window: root.Window.window // Steps right after each rendered frame
             system.onSizeChanged: { visualizer.updateNearestPoint() }
             system.onOriginChanged: { visualizer.updateNearestPoint() }
             onNewCameraPositionRequest: {
@@ -418,41 +428,49 @@ Scene3D {
 
         ColorModifier {
             id: colorModifier
+            objectName: "colorModifier"
             enabled: true
         }
 
         ColorAllGroupsModifier {
             id: colorAllGroupsModifier
+            objectName: "colorAllGroupsModifier"
             enabled: false
         }
 
         ColorAllRegionsModifier {
             id: colorAllRegionsModifier
+            objectName: "colorAllRegionsModifier"
             enabled: false
         }
 
         GroupModifier {
             id: groupModifier
+            objectName: "groupModifier"
             enabled: true
         }
 
         RegionModifier {
             id: regionModifier
+            objectName: "regionModifier"
             enabled: true
         }
 
         PropertyModifier {
             id: propertyModifier
+            objectName: "propertyModifier"
             enabled: true
         }
 
         SliceModifier {
             id: sliceModifier
+            objectName: "sliceModifier"
             enabled: false
         }
 
         PeriodicImages {
             id: periodicImages
+            objectName: "periodicImages"
             numberOfCopiesX: 1
             numberOfCopiesY: 1
             numberOfCopiesZ: 1
@@ -10,6 +10,7 @@
 #include "datasource.h"
 #include "LammpsWrappers/atoms.h"
 #include "LammpsWrappers/system.h"
+#include "LammpsWrappers/trajectoryreader.h"
 #include "LammpsWrappers/groups.h"
 #include "LammpsWrappers/fixes.h"
 #include "LammpsWrappers/regions.h"
@@ -39,6 +40,8 @@ void registerQML() {
     qmlRegisterType<CPVariable>("Atomify", 1, 0, "Variable");
     qmlRegisterType<DataSource>("Atomify", 1, 0, "DataSource");
     qmlRegisterType<Atoms>("Atomify", 1, 0, "Atoms");
+    qmlRegisterType<TrajectoryRecorder>("Atomify", 1, 0, "TrajectoryRecorder");
+    qmlRegisterType<TrajectoryReader>("Atomify", 1, 0, "TrajectoryReader");
     qmlRegisterType<System>("Atomify", 1, 0, "System");
     qmlRegisterType<Units>("Atomify", 1, 0, "Units");
     qmlRegisterType<Groups>("Atomify", 1, 0, "Groups");
@@ -117,6 +117,11 @@ SOURCES += \
     LammpsWrappers/groups.cpp \
     LammpsWrappers/neighborlist.cpp \
     LammpsWrappers/bonds.cpp \
+    LammpsWrappers/bondfinder.cpp \
+    LammpsWrappers/atomculler.cpp \
+    LammpsWrappers/depthsorter.cpp \
+    LammpsWrappers/trajectoryrecorder.cpp \
+    LammpsWrappers/trajectoryreader.cpp \
     LammpsWrappers/lammpserror.cpp \
     LammpsWrappers/computes.cpp \
     LammpsWrappers/variables.cpp \
@@ -130,8 +135,12 @@ SOURCES += \
     mousemover.cpp \
     states.cpp \
     dataproviders/data1d.cpp \
+    dataproviders/decimatedseries.cpp \
+    dataproviders/peratomkernels.cpp \
     commandparser.cpp \
     performance.cpp \
+    profiler.cpp \
+    headlessrunner.cpp \
     parsefileuploader.cpp \
     standardpaths.cpp \
     keysequence.cpp \
@@ -165,7 +174,13 @@ HEADERS += \
     LammpsWrappers/groups.h \
     LammpsWrappers/neighborlist.h \
     LammpsWrappers/bonds.h \
+    LammpsWrappers/bondfinder.h \
+    LammpsWrappers/atomculler.h \
+    LammpsWrappers/depthsorter.h \
+    LammpsWrappers/trajectoryrecorder.h \
+    LammpsWrappers/trajectoryreader.h \
     LammpsWrappers/lammpserror.h \
+    LammpsWrappers/lammpsgeneration.h \
     LammpsWrappers/computes.h \
     LammpsWrappers/variables.h \
     LammpsWrappers/units.h \
@@ -178,8 +193,12 @@ HEADERS += \
     mousemover.h \
     states.h \
     dataproviders/data1d.h \
+    dataproviders/decimatedseries.h \
+    dataproviders/peratomkernels.h \
     commandparser.h \
     performance.h \
+    profiler.h \
+    headlessrunner.h \
     parsefileuploader.h \
     standardpaths.h \
     keysequence.h \